@@ -0,0 +1,129 @@
+/**
+ * @file cic_decimator.h
+ * @brief Diezmado CIC con compensación FIR para sobremuestrear el ADC
+ *
+ * En lugar de una lectura del ADC por periodo de 4 ms se toman Rate lecturas
+ * (Rate = 4 -> 1 kHz, Rate = 8 -> 2 kHz) y un CIC de orden Order las reduce a
+ * la frecuencia de salida. El ruido del ADC y de cuantización que cae fuera
+ * de la banda del ECG se filtra antes de diezmar en vez de plegarse sobre
+ * ella, y la cadena de ecg_dsp.h recibe la misma escala de cuentas ADC.
+ *
+ * Todo es aritmética entera de 32 bits:
+ *   - Order integradores por lectura (sumas módulo 2^32, que se cancelan en
+ *     los peines aunque desborden) y Order peines por muestra de salida.
+ *   - La ganancia Rate^Order se quita con un desplazamiento (Rate potencia
+ *     de 2), conservando FRAC_BITS bits fraccionarios.
+ *   - Un FIR de 3 tomas [-a, 1 + 2a, -a] en Q14 a la frecuencia de salida
+ *     compensa la caída del CIC: a se calcula constexpr para que la ganancia
+ *     conjunta valga 1 en PassbandMilliHz.
+ * Las entradas se restan del valor de reset(), así que un ADC de 12 bits
+ * deja margen para Rate^Order de hasta 2^18.
+ *
+ * Retardo: Order·(Rate - 1)/2 lecturas del CIC más una muestra de salida
+ * del compensador. Por lectura son Order sumas de 32 bits y por muestra de
+ * salida Order restas y tres productos de 32 bits: en el AVR, poco frente a
+ * los ~112 us de cada analogRead(). El benchmark "cic" del entorno native
+ * mide el coste en el host, la mejora de SNR y la respuesta.
+ */
+
+#ifndef CIC_DECIMATOR_H
+#define CIC_DECIMATOR_H
+
+#include <stdint.h>
+#include "filter_chain.h"
+
+constexpr uint8_t cicLog2(uint32_t x) { return x <= 1 ? 0 : 1 + cicLog2(x >> 1); }
+
+constexpr double cicPow(double x, uint8_t n) { return n == 0 ? 1.0 : x * cicPow(x, n - 1); }
+
+// Ganancia del CIC normalizado en f, con w = pi·f/fsalida
+constexpr double cicResponse(double w, uint8_t rate, uint8_t order) {
+    return cicPow(filterSin(w) / (rate * filterSin(w / rate)), order);
+}
+
+// Toma lateral a del compensador: (1 + 2a(1 - cos 2w))·H_cic(w) = 1
+constexpr double cicCompensationTap(uint8_t rate, uint8_t order, uint32_t outputRateHz, uint32_t passbandMilliHz) {
+    return (1.0 / cicResponse(FILTER_PI * passbandMilliHz / 1000.0 / outputRateHz, rate, order) - 1.0) /
+           (2.0 * (1.0 - filterCos(2.0 * FILTER_PI * passbandMilliHz / 1000.0 / outputRateHz)));
+}
+
+template <uint8_t Rate, uint8_t Order, uint32_t OutputRateHz, uint32_t PassbandMilliHz = 40000>
+class CICDecimator {
+public:
+    static_assert(Rate >= 2 && (Rate & (Rate - 1)) == 0, "Rate debe ser potencia de 2");
+    static_assert(Order >= 1, "el CIC necesita al menos una etapa");
+    static_assert(PassbandMilliHz < OutputRateHz * 500UL, "la banda de paso debe estar por debajo de Nyquist");
+
+    static constexpr int FRAC_BITS = 2;
+    static constexpr int GAIN_SHIFT = Order * cicLog2(Rate);
+    static_assert(GAIN_SHIFT > FRAC_BITS && GAIN_SHIFT <= 18, "Rate^Order fuera de rango para entradas de 12 bits");
+
+    static constexpr int COMP_SHIFT = 14;
+    static constexpr int32_t COMP_EDGE_Q14 =
+        filterRound(cicCompensationTap(Rate, Order, OutputRateHz, PassbandMilliHz) * (1L << COMP_SHIFT));
+    static constexpr int32_t COMP_CENTER_Q14 = (1L << COMP_SHIFT) + 2 * COMP_EDGE_Q14;
+
+    // Retardo de grupo en lecturas de entrada (doble, para que sea entero)
+    static constexpr uint16_t DELAY_X2 = Order * (Rate - 1) + 2 * Rate;
+
+    CICDecimator() { reset(0); }
+
+    // Estado estacionario para una entrada constante 'initial'
+    void reset(int16_t initial) {
+        offset = initial;
+        for (uint8_t k = 0; k < Order; k++) {
+            integrator[k] = 0;
+            comb[k] = 0;
+        }
+        history[0] = history[1] = 0;
+        phase = 0;
+        y = initial;
+    }
+
+    /**
+     * Añade una lectura del ADC.
+     * @return true cuando completa una muestra de salida (output())
+     */
+    bool push(int16_t x) {
+        uint32_t v = (uint32_t)(int32_t)(x - offset);
+        integrator[0] += v;
+        for (uint8_t k = 1; k < Order; k++) integrator[k] += integrator[k - 1];
+        if (++phase < Rate) return false;
+        phase = 0;
+
+        uint32_t c = integrator[Order - 1];
+        for (uint8_t k = 0; k < Order; k++) {
+            uint32_t delayed = comb[k];
+            comb[k] = c;
+            c -= delayed;
+        }
+
+        // Salida del CIC sin la ganancia Rate^Order, en cuentas con FRAC_BITS decimales
+        int32_t v0 = ((int32_t)c + (1L << (GAIN_SHIFT - FRAC_BITS - 1))) >> (GAIN_SHIFT - FRAC_BITS);
+        int32_t acc = COMP_CENTER_Q14 * history[0] - COMP_EDGE_Q14 * (v0 + history[1]);
+        history[1] = history[0];
+        history[0] = v0;
+
+        const int shift = COMP_SHIFT + FRAC_BITS;
+        y = filterSaturate16(offset + ((acc + (1L << (shift - 1))) >> shift));
+        return true;
+    }
+
+    int16_t output() const { return y; }
+
+    // Lecturas acumuladas hacia la próxima muestra de salida
+    uint8_t pending() const { return phase; }
+
+    static constexpr uint8_t rate() { return Rate; }
+    static constexpr uint8_t order() { return Order; }
+
+private:
+    uint32_t integrator[Order];
+    uint32_t comb[Order];
+    int32_t history[2];
+    int16_t offset;
+    uint8_t phase;
+    int16_t y;
+};
+
+#endif // CIC_DECIMATOR_H
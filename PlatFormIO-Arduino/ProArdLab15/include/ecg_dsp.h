@@ -0,0 +1,186 @@
+/**
+ * @file ecg_dsp.h
+ * @brief Cadena de filtrado ECG (DC removal + cancelador de red + media móvil) en float y en coma fija
+ *
+ * No depende de Arduino.h: la comparten los entornos uno, esp32dev y native.
+ */
+
+#ifndef ECG_DSP_H
+#define ECG_DSP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "filter_chain.h"
+#include "powerline_canceller.h"
+
+// Selección de la ruta DSP en tiempo de compilación:
+//   ECG_FIXED_POINT=1 -> aritmética entera (por defecto; el UNO no tiene FPU)
+//   ECG_FIXED_POINT=0 -> ruta original en float
+#ifndef ECG_FIXED_POINT
+#define ECG_FIXED_POINT 1
+#endif
+
+// Cancelador adaptativo de red de 50/60 Hz (powerline_canceller.h) entre
+// el paso-alto y la media móvil: 1 = activo (por defecto), 0 = sin él
+#ifndef ECG_HUM_CANCELLER
+#define ECG_HUM_CANCELLER 1
+#endif
+
+// Configuración de muestreo (la comparten los tres entornos)
+constexpr unsigned long SAMPLE_RATE_HZ = 250;
+constexpr unsigned long SAMPLE_INTERVAL_US = 1000000UL / SAMPLE_RATE_HZ;
+
+// Configuración de filtrado: paso-alto de un polo a 0.2 Hz (alpha = 0.99498;
+// en Q14, 1 - alpha = 82/16384, el mismo coeficiente que daba el antiguo
+// DC_ALPHA = 0.995), cancelador de red y media móvil de 5 muestras
+constexpr uint32_t DC_CORNER_MILLIHZ = 200;
+constexpr uint8_t MA_WINDOW = 5;
+
+// Retardo de grupo de la cadena en muestras: el de la media móvil (el paso-
+// alto y el cancelador apenas desplazan el QRS). Se resta al fechar el pico R.
+constexpr uint8_t ECG_FILTER_DELAY = (MA_WINDOW - 1) / 2;
+
+/**
+ * Cadena de filtrado ECG sobre filter_chain.h. T = float es la ruta de
+ * referencia y T = int16_t la de coma fija; las dos salen de la misma
+ * definición de etapas.
+ *
+ * Cota de error de la ruta fija frente a la float (entradas de hasta 12
+ * bits, mismo valor inicial): |lp_fixed - lp_float| <= 2.5 cuentas ADC
+ * (1.5 con ECG_HUM_CANCELLER = 0). La ruta fija trunca hp hacia cero
+ * (hasta 1 cuenta por toma de la media móvil), el cancelador de red
+ * redondea su salida a la cuenta y sus pesos Q8 se separan un poco de los
+ * float, y la salida se redondea a entero (hasta 0.5).
+ * El benchmark "dsp" del entorno native mide el error en señal sintética.
+ */
+template <typename T>
+class ECGFilterChain {
+public:
+    typedef T Value;
+    typedef DCBlocker<T, SAMPLE_RATE_HZ, DC_CORNER_MILLIHZ> DCStage;
+    typedef PowerlineCanceller<T, SAMPLE_RATE_HZ> HumStage;
+    typedef MovingAverage<T, MA_WINDOW> MAStage;
+#if ECG_HUM_CANCELLER
+    typedef FilterChain<T, DCStage, HumStage, MAStage> Chain;
+#else
+    typedef FilterChain<T, DCStage, MAStage> Chain;
+#endif
+
+    ECGFilterChain() { reset(0); }
+
+    void reset(int initial) { chain.reset((T)initial); }
+
+    // Devuelve la salida paso-bajo (lp) para una nueva muestra cruda
+    Value process(int raw) { return chain.process((T)raw); }
+
+    /**
+     * process() sobre 'count' muestras, dejando lp y la entrada de la media
+     * móvil (lastUnsmoothed(), truncada a int16) de cada una, con los
+     * mismos resultados que muestra a muestra. El estado va en una copia
+     * local para que no pueda solaparse con los arrays de salida. Las etapas
+     * son recursivas en el tiempo, así que el bucle no se vectoriza: en el
+     * host cuesta lo mismo que process() (benchmark "block").
+     */
+    void processBlock(const int16_t* raw, Value* lp, int16_t* unsmoothed, size_t count) {
+        Chain c = chain;
+        for (size_t i = 0; i < count; i++) {
+            lp[i] = c.process((T)raw[i]);
+            unsmoothed[i] = (int16_t)unsmoothedOf(c);
+        }
+        chain = c;
+    }
+
+    int lastHighPass() const { return (int)chain.head().last(); }
+
+    // Entrada de la media móvil: hp tras el cancelador de red, si está activo
+    int lastUnsmoothed() const { return unsmoothedOf(chain); }
+
+    // Frecuencia de red a la que se ha enganchado el cancelador (0 = ninguna)
+    uint8_t mainsHz() const {
+#if ECG_HUM_CANCELLER
+        return chain.tail().head().mainsHz();
+#else
+        return 0;
+#endif
+    }
+
+private:
+    Chain chain;
+
+    static int unsmoothedOf(const Chain& c) {
+#if ECG_HUM_CANCELLER
+        return (int)c.tail().head().last();
+#else
+        return (int)c.head().last();
+#endif
+    }
+};
+
+typedef ECGFilterChain<float> ECGFilterFloat;
+typedef ECGFilterChain<int16_t> ECGFilterFixed;
+
+/**
+ * Banco de Channels filtros muestreados en el mismo tick, hecho con las
+ * etapas de ECGFilterChain<T> en su forma de banco (filter_chain.h): el
+ * paso-alto y la media móvil llevan el estado en estructura de arrays, sin
+ * saltos, y el compilador puede vectorizar los bucles por canal. Cada canal
+ * da exactamente lo mismo que un ECGFilterChain<T> porque la etapa de un
+ * canal es ese mismo banco. El cancelador de red, con su propia fase y
+ * enganche por canal, va como un array de etapas.
+ */
+template <typename T, uint8_t Channels>
+class ECGFilterChainBank {
+public:
+    typedef T Value;
+    typedef typename ECGFilterChain<T>::DCStage::template Bank<Channels> DCBank;
+    typedef typename ECGFilterChain<T>::HumStage HumStage;
+    typedef typename ECGFilterChain<T>::MAStage::template Bank<Channels> MABank;
+
+    ECGFilterChainBank() {
+        for (uint8_t c = 0; c < Channels; c++) reset(c, 0);
+    }
+
+    // Como ECGFilterChain::reset(): cada etapa arranca con la salida de la anterior
+    void reset(uint8_t ch, int initial) {
+#if ECG_HUM_CANCELLER
+        ma.reset(ch, hum[ch].reset(dc.reset(ch, (T)initial)));
+#else
+        ma.reset(ch, dc.reset(ch, (T)initial));
+#endif
+    }
+
+    // Una muestra cruda por canal en 'raw'; salida lp de cada canal en 'out'
+    void process(const int16_t* raw, Value* out) {
+        T x[Channels];
+        T hp[Channels];
+        for (uint8_t c = 0; c < Channels; c++) x[c] = (T)raw[c];
+        dc.process(x, hp);
+#if ECG_HUM_CANCELLER
+        for (uint8_t c = 0; c < Channels; c++) hp[c] = hum[c].process(hp[c]);
+#endif
+        ma.process(hp, out);
+    }
+
+    // Entrada de la media móvil del canal en la última muestra
+    Value lastUnsmoothed(uint8_t ch) const { return ma.lastInput(ch); }
+
+private:
+    DCBank dc;
+#if ECG_HUM_CANCELLER
+    HumStage hum[Channels];
+#endif
+    MABank ma;
+};
+
+template <uint8_t Channels> using ECGFilterBankFloat = ECGFilterChainBank<float, Channels>;
+template <uint8_t Channels> using ECGFilterBankFixed = ECGFilterChainBank<int16_t, Channels>;
+
+#if ECG_FIXED_POINT
+typedef ECGFilterFixed ECGFilter;
+template <uint8_t Channels> using ECGFilterBank = ECGFilterBankFixed<Channels>;
+#else
+typedef ECGFilterFloat ECGFilter;
+template <uint8_t Channels> using ECGFilterBank = ECGFilterBankFloat<Channels>;
+#endif
+
+#endif // ECG_DSP_H
@@ -1,23 +1,69 @@
 /**
  * @file ecg_monitor.h
  * @brief Gestor del monitor ECG
+ *
+ * Cada muestra entregada a processSample() avanza el reloj de muestras
+ * (sample_history.h), también sin electrodos: los tiempos de latido salen
+ * del índice del pico R, no de millis().
+ *
+ * processBlock() procesa un bloque de la fuente de muestras de una vez:
+ * lee los electrodos una sola vez, filtra el bloque entero en un bucle
+ * cerrado (ECGFilterChain::processBlock) y lo guarda en la historia por
+ * tramos; después la detección recorre el bloque con el mismo paso por
+ * muestra que processSample(). Mientras los electrodos no cambien dentro
+ * del bloque, los resultados son idénticos bit a bit a los de llamar a
+ * processSample() y leer los getters tras cada muestra (benchmark "block").
+ * Solo se ahorran esas lecturas de electrodos y de getters por muestra: la
+ * detección, que es casi todo el coste, sigue siendo muestra a muestra, y
+ * en el host processBlock() no es claramente más rápido que processSample().
+ *
+ * Cada latido con RR alimenta además la frecuencia respiratoria derivada
+ * del ECG (respiration.h) con la amplitud pico a pico del QRS en la
+ * historia y la media del crudo desde el latido anterior: la línea base
+ * que quita el paso-alto, sin la forma del latido.
  */
 
 #ifndef ECG_MONITOR_H
 #define ECG_MONITOR_H
 
 #include "ecg_types.h"
-#include <CircularBuffer.h>
+#include "qrs_detector.h"
+#include "signal_quality.h"
+#include "sample_history.h"
+#include "spectral_hr.h"
+#include "respiration.h"
 
 class ECGMonitor {
 public:
+    typedef SignalQuality<SAMPLE_RATE_HZ, ECG_ADC_MAX> Quality;
+
+    // ~1 s de historia (256 muestras a 250 Hz, 1 KB)
+    typedef SampleHistory<SAMPLE_RATE_HZ, 256> History;
+
+    // FC por autocorrelación de la envolvente: respaldo si el detector
+    // pierde el enganche y contraste con él (spectral_hr.h)
+    typedef SpectralHeartRate<SAMPLE_RATE_HZ> SpectralHR;
+
+    typedef RespirationEstimator<SAMPLE_RATE_HZ> Respiration;
+
+    // Índice por debajo del cual los latidos se descartan como artefactos
+    static constexpr uint8_t QUALITY_GATE = Quality::GATE;
+
+    // processBlock() filtra por tramos de este tamaño (arrays en la pila)
+    static constexpr uint8_t BLOCK_CHUNK = 32;
+
+    // Amplitud del QRS: pico a pico del filtrado a ±40 ms de la onda R
+    static constexpr uint8_t QRS_HALF_WIDTH = 40 * SAMPLE_RATE_HZ / 1000;
+
     ECGMonitor() : 
-        dcEstimate(0),
+        hrv(HRV_WINDOW_MS),
         beatInfo{0, 0, false},
-        leadsConnected(false) {
-        for (int i = 0; i < MA_WINDOW; i++) {
-            maBuffer[i] = 0;
-        }
+        lastBeatSample(0),
+        lastFiltered(0),
+        cycleSum(0),
+        cycleSamples(0),
+        leadsConnected(false),
+        filterPrimed(false) {
     }
 
     void begin() {
@@ -25,8 +71,14 @@ public:
         pinMode(AD8232Pins::LO_PLUS, INPUT);
         pinMode(AD8232Pins::LO_MINUS, INPUT);
         pinMode(AD8232Pins::OUTPUT_PIN, INPUT);
-        
-        dcEstimate = analogRead(AD8232Pins::OUTPUT_PIN);
+
+        // La estimación DC se inicializa con la primera muestra que llegue
+        // de la fuente (sample_source.h), no con un analogRead aquí
+        filterPrimed = false;
+        history.reset();
+        respiration.reset();
+        cycleSum = 0;
+        cycleSamples = 0;
     }
 
     bool checkLeadsConnected() {
@@ -39,74 +91,243 @@ public:
             // Reset de variables si hay cambio en la conexión
             if (!connected) {
                 beatInfo = {0, 0, false};
-                dcEstimate = 0;
+                lastBeatSample = 0;
+                filterPrimed = false;
+                qrs.reset();
+                quality.reset();
+                hrv.reset();
+                spectral.reset();
+                arbiter.reset();
+                respiration.reset();
+                cycleSum = 0;
+                cycleSamples = 0;
             }
         }
         return leadsConnected;
     }
 
-    bool processSample() {
-        // Verificar conexión de electrodos
+    // Procesa una muestra cruda entregada por la fuente de muestras
+    bool processSample(int raw) {
+        // Verificar conexión de electrodos. La muestra cuenta igualmente
+        // para que el índice siga siendo el tiempo.
         if (!checkLeadsConnected()) {
+            lastFiltered = 0;
+            history.push((int16_t)raw, 0);
             return false;
         }
 
-        int raw = analogRead(AD8232Pins::OUTPUT_PIN);
-        bool beatDetected = false;
+        if (!filterPrimed) {
+            filter.reset(raw);
+            filterPrimed = true;
+        }
 
-        // DC removal
-        dcEstimate = DC_ALPHA * dcEstimate + (1.0f - DC_ALPHA) * raw;
-        float hp = raw - dcEstimate;
-
-        // Moving average
-        maSum -= maBuffer[maIndex];
-        maBuffer[maIndex] = (int)hp;
-        maSum += maBuffer[maIndex];
-        maIndex = (maIndex + 1) % MA_WINDOW;
-        float lp = (float)maSum / MA_WINDOW;
-
-        // Beat detection
-        unsigned long now = millis();
-        if (lp > THRESHOLD && (now - beatInfo.lastBeatTime) > 250) {
-            if (!beatInfo.isInBeat) {
-                beatInfo.isInBeat = true;
-                if (beatInfo.lastBeatTime != 0) {
-                    unsigned long beatInterval = now - beatInfo.lastBeatTime;
-                    beatInfo.bpm = 60000.0f / beatInterval;
-                    beatDetected = true;
-                }
-                beatInfo.lastBeatTime = now;
-            }
-        } 
-        else if (lp < (THRESHOLD / 2)) {
-            beatInfo.isInBeat = false;
+        // DC removal + moving average (float o coma fija según ECG_FIXED_POINT)
+        ECGFilter::Value lp = filter.process(raw);
+        history.push((int16_t)raw, (int16_t)lp);
+        return detect((int16_t)raw, lp, (int16_t)filter.lastUnsmoothed(), history.sampleCount() - 1);
+    }
+
+    /**
+     * processSample() de 'count' muestras consecutivas de la fuente. Si
+     * 'out' no es nulo, deja en out[i] lo que darían processSample() y los
+     * getters tras la muestra i (filtrado truncado como en la cola del
+     * ESP32, 0 sin electrodos).
+     * @return latidos con RR en el bloque
+     */
+    uint16_t processBlock(const int16_t* raw, size_t count, ProcessedSample* out) {
+        uint16_t beats = 0;
+        if (count == 0) return 0;
+
+        if (!checkLeadsConnected()) {
+            lastFiltered = 0;
+            history.pushBlock(raw, nullptr, count);
+            for (size_t i = 0; out && i < count; i++) fillSample(out[i], raw[i], 0, false, false);
+            return 0;
         }
 
-        // Store sample
-        samples.push(ECGSample{raw, lp, now});
-        return beatDetected;
+        if (!filterPrimed) {
+            filter.reset(raw[0]);
+            filterPrimed = true;
+        }
+
+        ECGFilter::Value lp[BLOCK_CHUNK];
+        int16_t lp16[BLOCK_CHUNK];
+        int16_t unsmoothed[BLOCK_CHUNK];
+        for (size_t done = 0; done < count; done += BLOCK_CHUNK) {
+            size_t n = count - done < BLOCK_CHUNK ? count - done : BLOCK_CHUNK;
+            const int16_t* in = raw + done;
+            filter.processBlock(in, lp, unsmoothed, n);
+            for (size_t i = 0; i < n; i++) lp16[i] = (int16_t)lp[i];
+            history.pushBlock(in, lp16, n);
+
+            // La historia ya tiene el tramo entero: detect() fecha los
+            // latidos con el índice de la muestra que procesa
+            uint32_t first = history.sampleCount() - (uint32_t)n;
+            for (size_t i = 0; i < n; i++) {
+                bool beat = detect(in[i], lp[i], unsmoothed[i], first + (uint32_t)i);
+                beats += beat;
+                if (out) fillSample(out[done + i], in[i], lp16[i], true, beat);
+            }
+        }
+        return beats;
     }
 
+
     const BeatInfo& getBeatInfo() const {
         return beatInfo;
     }
 
+    // SDNN, RMSSD, pNN50... de la ventana HRV, sin recorrer la historia
+    HRVMetrics getHRV() const {
+        return hrv.metrics();
+    }
+
+    // De dónde sale getBeatInfo().bpm ahora mismo
+    HeartRateSource getHeartRateSource() const {
+        return arbiter.source();
+    }
+
+    // Detector y estimación espectral no coinciden (ver HeartRateArbiter)
+    bool heartRateDisagreement() const {
+        return arbiter.disagreement();
+    }
+
+    const SpectralHR& getSpectralHR() const {
+        return spectral;
+    }
+
+    // Frecuencia respiratoria derivada del ECG (rate = 0 si no hay)
+    RespirationEstimate getRespiration() const {
+        return respiration.estimate(history.sampleCount());
+    }
+
+    const Respiration& getRespirationEstimator() const {
+        return respiration;
+    }
+
+    // Índice de calidad 0-100 (QUALITY_UNKNOWN hasta el primer segundo)
+    uint8_t getSignalQuality() const {
+        return quality.index();
+    }
+
+    // QRS descartados como artefactos desde la última conexión
+    uint32_t getRejectedBeats() const {
+        return quality.rejectedBeats();
+    }
+
+    // Índice (reloj de muestras) del pico R del último latido aceptado
+    uint32_t getLastBeatSample() const {
+        return lastBeatSample;
+    }
+
+    // Crudo y filtrado (truncado a int16) del último segundo
+    const History& getHistory() const {
+        return history;
+    }
+
     int getLastRawValue() const {
-        return samples.last().raw;
+        return history.lastRaw();
     }
 
+    // Sin truncar, para que coincida con ECGMultiMonitor en coma flotante
     float getLastFilteredValue() const {
-        return samples.last().filtered;
+        return (float)lastFiltered;
     }
 
 private:
-    CircularBuffer<ECGSample, 250> samples; // 1 segundo de historia
-    float dcEstimate;
-    int maBuffer[MA_WINDOW];
-    int maIndex = 0;
-    long maSum = 0;
+    /**
+     * Calidad, detección de QRS, HRV y FC de la muestra 'index' (ya en la
+     * historia), común a processSample() y processBlock().
+     * @return true si hay latido con RR
+     */
+    bool detect(int16_t raw, ECGFilter::Value lp, int16_t unsmoothed, uint32_t index) {
+        bool beatDetected = false;
+        lastFiltered = lp;
+        // Sin latido en más de un ciclo respiratorio la media se rehace con
+        // lo último: cycleSum no desborda por largo que sea el hueco
+        if (cycleSamples >= Respiration::MAX_INTERVAL) {
+            cycleSum = 0;
+            cycleSamples = 0;
+        }
+        cycleSum += raw;
+        cycleSamples++;
+
+        // Beat detection (Pan-Tompkins con umbrales adaptativos). Cada QRS
+        // pasa por el índice de calidad: los artefactos no llegan a la FC
+        BeatVerdict verdict = quality.process(raw, unsmoothed, (int16_t)lp);
+        if (qrs.process((int16_t)lp)) {
+            BeatVerdict v = quality.addBeat(qrs.sampleCount() - 1 - qrs.lastBeatSample());
+            if (v != BEAT_NONE) verdict = v;
+        }
+        if (verdict == BEAT_ACCEPTED) {
+            // El latido se fecha en su pico R, con la resolución del reloj
+            // de muestras. El RR se mide en muestras y solo entre dos
+            // latidos aceptados seguidos. La FC mostrada es la media de los
+            // últimos intervalos normales (hrv_engine.h): un extrasístole no
+            // la hace saltar.
+            if (quality.acceptedRR() > 0) {
+                hrv.addRR((uint16_t)(quality.acceptedRR() * 1000UL / SAMPLE_RATE_HZ));
+                beatDetected = true;
+            }
+            lastBeatSample = index - quality.lastAcceptedAge() - ECG_FILTER_DELAY;
+            beatInfo.lastBeatTime = History::timeMs(lastBeatSample);
+            if (beatDetected) {
+                arbiter.onDetectorBpm(hrv.metrics().displayHr, lastBeatSample);
+                respiration.onBeat(lastBeatSample, qrsAmplitude(index), (int16_t)(cycleSum / (int32_t)cycleSamples));
+            }
+            cycleSum = 0;
+            cycleSamples = 0;
+        }
+
+        // Sin latidos recientes la FC sale de la estimación espectral en
+        // vez de quedarse congelada; su cálculo se reparte entre muestras
+        bool newEstimate = spectral.process((int16_t)lp);
+        beatInfo.bpm = arbiter.update(index, spectral, newEstimate);
+        beatInfo.isInBeat = qrs.isInRefractory();
+        return beatDetected;
+    }
+
+    // Pico a pico del filtrado alrededor de la onda R del último latido,
+    // sin pasar de la muestra 'index' (igual muestra a muestra que en bloque)
+    int16_t qrsAmplitude(uint32_t index) const {
+        uint32_t center = lastBeatSample + ECG_FILTER_DELAY;
+        uint32_t from = center > QRS_HALF_WIDTH ? center - QRS_HALF_WIDTH : 0;
+        uint32_t to = center + QRS_HALF_WIDTH < index ? center + QRS_HALF_WIDTH : index;
+        if (from < history.oldestIndex()) from = history.oldestIndex();
+        int16_t lo = history.filteredAt(to), hi = lo;
+        for (uint32_t i = from; i < to; i++) {
+            int16_t v = history.filteredAt(i);
+            if (v < lo) lo = v;
+            if (v > hi) hi = v;
+        }
+        return (int16_t)(hi - lo);
+    }
+
+    void fillSample(ProcessedSample& s, int16_t raw, int16_t filtered, bool connected, bool beat) const {
+        s.raw = raw;
+        s.filtered = filtered;
+        s.bpm = beatInfo.bpm;
+        s.leadsConnected = connected;
+        s.beat = beat;
+        s.quality = quality.index();
+        s.hrSource = arbiter.source();
+    }
+
+    History history;
+    ECGFilter filter;
+    QRSDetector<SAMPLE_RATE_HZ> qrs;
+    Quality quality;
+    HRVEngine<HRV_MAX_BEATS> hrv;
+    SpectralHR spectral;
+    HeartRateArbiter<SAMPLE_RATE_HZ> arbiter;
     BeatInfo beatInfo;
+    uint32_t lastBeatSample;
+    ECGFilter::Value lastFiltered;
+    Respiration respiration;
+    int32_t cycleSum;       // crudo desde el último latido aceptado
+    uint32_t cycleSamples;
     bool leadsConnected = false;
+    bool filterPrimed;
 };
 
 #endif // ECG_MONITOR_H
\ No newline at end of file
@@ -0,0 +1,167 @@
+/**
+ * @file ecg_multi_monitor.h
+ * @brief Monitor ECG de varios canales (varios AD8232) en una sola pasada
+ *
+ * Equivale a Channels copias de ECGMonitor muestreadas en el mismo tick:
+ * processFrame() recibe una muestra por canal, lee los electrodos de todos,
+ * filtra todos los canales en un único bucle sobre estado en estructura de
+ * arrays (ECGFilterBank) y después pasa por el índice de calidad, el
+ * detector de QRS y la HRV de cada canal conectado. Estos son máquinas de
+ * estados con saltos por muestra: van en un array por canal, donde el SoA
+ * no aporta.
+ * Para el mismo canal, beats, RR y BPM son idénticos a los de ECGMonitor,
+ * incluida la FC espectral de respaldo (spectral_hr.h): unos 2.8 KB más
+ * por canal, con el cálculo repartido entre muestras igual que allí.
+ *
+ * Los canales se identifican por su índice; las máscaras de bits (bit c =
+ * canal c) indican electrodos conectados o latido en este tick.
+ */
+
+#ifndef ECG_MULTI_MONITOR_H
+#define ECG_MULTI_MONITOR_H
+
+#include "ecg_types.h"
+#include "qrs_detector.h"
+#include "signal_quality.h"
+#include "sample_history.h"
+#include "spectral_hr.h"
+
+template <uint8_t Channels, uint16_t HrvCapacity = HRV_MAX_BEATS>
+class ECGMultiMonitor {
+public:
+    static_assert(Channels >= 1 && Channels <= 16, "la máscara de canales es de 16 bits");
+    typedef uint16_t ChannelMask;
+    typedef typename ECGFilterBank<Channels>::Value Value;
+
+    explicit ECGMultiMonitor(const ECGChannelPins (&channelPins)[Channels])
+        : frames(0), leadsMask(0), primedMask(0), refractoryMask(0) {
+        for (uint8_t c = 0; c < Channels; c++) {
+            pins[c] = channelPins[c];
+            hrv[c].setWindowMs(HRV_WINDOW_MS);
+            bpm[c] = 0;
+            lastBeatTime[c] = 0;
+            lastRaw[c] = 0;
+            lastFiltered[c] = 0;
+        }
+    }
+
+    void begin() {
+        for (uint8_t c = 0; c < Channels; c++) {
+            pinMode(pins[c].output, INPUT);
+            if (pins[c].loPlus >= 0) pinMode(pins[c].loPlus, INPUT);
+            if (pins[c].loMinus >= 0) pinMode(pins[c].loMinus, INPUT);
+        }
+        primedMask = 0;
+        frames = 0;
+    }
+
+    // Lee LO+/LO- de todos los canales y reinicia los que se han desconectado
+    ChannelMask checkLeadsConnected() {
+        ChannelMask connected = 0;
+        for (uint8_t c = 0; c < Channels; c++) {
+            // Cada pin por separado: un canal puede tener solo LO+ o solo LO-
+            bool on = (pins[c].loPlus < 0 || digitalRead(pins[c].loPlus) == LOW) &&
+                      (pins[c].loMinus < 0 || digitalRead(pins[c].loMinus) == LOW);
+            if (on) connected |= (ChannelMask)(1u << c);
+        }
+
+        ChannelMask lost = leadsMask & (ChannelMask)~connected;
+        for (uint8_t c = 0; c < Channels; c++) {
+            if (!(lost & (1u << c))) continue;
+            bpm[c] = 0;
+            lastBeatTime[c] = 0;
+            qrs[c].reset();
+            quality[c].reset();
+            hrv[c].reset();
+            spectral[c].reset();
+            arbiter[c].reset();
+        }
+        primedMask &= (ChannelMask)~lost;
+        refractoryMask &= (ChannelMask)~lost;
+        leadsMask = connected;
+        return leadsMask;
+    }
+
+    /**
+     * Procesa una muestra cruda por canal, todas del mismo tick.
+     * @return máscara de los canales con latido (con RR) en este tick
+     */
+    ChannelMask processFrame(const int16_t* raw) {
+        // Reloj de muestras común, como el de ECGMonitor (sample_history.h)
+        uint32_t frame = frames++;
+        ChannelMask connected = checkLeadsConnected();
+        if (!connected) return 0;
+
+        // La estimación DC de cada canal arranca con su primera muestra
+        ChannelMask unprimed = connected & (ChannelMask)~primedMask;
+        for (uint8_t c = 0; unprimed && c < Channels; c++) {
+            if (unprimed & (1u << c)) filters.reset(c, raw[c]);
+        }
+        primedMask |= connected;
+
+        // Todos los canales en una pasada; los desconectados se descartan
+        filters.process(raw, lastFiltered);
+        for (uint8_t c = 0; c < Channels; c++) lastRaw[c] = raw[c];
+
+        ChannelMask beats = 0;
+        for (uint8_t c = 0; c < Channels; c++) {
+            if (!(connected & (1u << c))) continue;
+            BeatVerdict verdict = quality[c].process(raw[c], (int16_t)filters.lastUnsmoothed(c),
+                                                     (int16_t)lastFiltered[c]);
+            if (qrs[c].process((int16_t)lastFiltered[c])) {
+                BeatVerdict v = quality[c].addBeat(qrs[c].sampleCount() - 1 - qrs[c].lastBeatSample());
+                if (v != BEAT_NONE) verdict = v;
+            }
+            if (verdict == BEAT_ACCEPTED) {
+                // RR entre latidos aceptados y FC media de los últimos NN, como ECGMonitor
+                if (quality[c].acceptedRR() > 0) {
+                    hrv[c].addRR((uint16_t)(quality[c].acceptedRR() * 1000UL / SAMPLE_RATE_HZ));
+                    beats |= (ChannelMask)(1u << c);
+                }
+                uint32_t beatSample = frame - quality[c].lastAcceptedAge() - ECG_FILTER_DELAY;
+                lastBeatTime[c] = SampleClock<SAMPLE_RATE_HZ>::toMillis(beatSample);
+                if (beats & (1u << c)) arbiter[c].onDetectorBpm(hrv[c].metrics().displayHr, beatSample);
+            }
+            bool newEstimate = spectral[c].process((int16_t)lastFiltered[c]);
+            bpm[c] = arbiter[c].update(frame, spectral[c], newEstimate);
+            if (qrs[c].isInRefractory()) refractoryMask |= (ChannelMask)(1u << c);
+            else refractoryMask &= (ChannelMask)~(1u << c);
+        }
+        return beats;
+    }
+
+    static uint8_t channels() { return Channels; }
+    ChannelMask getLeadsMask() const { return leadsMask; }
+
+    BeatInfo getBeatInfo(uint8_t ch) const {
+        BeatInfo info = {bpm[ch], lastBeatTime[ch], (refractoryMask & (1u << ch)) != 0};
+        return info;
+    }
+
+    HRVMetrics getHRV(uint8_t ch) const { return hrv[ch].metrics(); }
+    HeartRateSource getHeartRateSource(uint8_t ch) const { return arbiter[ch].source(); }
+    bool heartRateDisagreement(uint8_t ch) const { return arbiter[ch].disagreement(); }
+    uint8_t getSignalQuality(uint8_t ch) const { return quality[ch].index(); }
+    int getLastRawValue(uint8_t ch) const { return lastRaw[ch]; }
+    float getLastFilteredValue(uint8_t ch) const { return (float)lastFiltered[ch]; }
+
+private:
+    ECGChannelPins pins[Channels];
+    ECGFilterBank<Channels> filters;
+    QRSDetector<SAMPLE_RATE_HZ> qrs[Channels];
+    SignalQuality<SAMPLE_RATE_HZ, ECG_ADC_MAX> quality[Channels];
+    HRVEngine<HrvCapacity> hrv[Channels];
+    SpectralHeartRate<SAMPLE_RATE_HZ> spectral[Channels];
+    HeartRateArbiter<SAMPLE_RATE_HZ> arbiter[Channels];
+
+    uint32_t frames;
+    ChannelMask leadsMask;
+    ChannelMask primedMask;
+    ChannelMask refractoryMask;
+    float bpm[Channels];
+    unsigned long lastBeatTime[Channels];
+    int16_t lastRaw[Channels];
+    Value lastFiltered[Channels];
+};
+
+#endif // ECG_MULTI_MONITOR_H
@@ -0,0 +1,304 @@
+/**
+ * @file ecg_stream.h
+ * @brief Protocolo binario por tramas para enviar el ECG por el puerto serie
+ *
+ * Sustituye la línea CSV por muestra ("%.2f,%d,%d") por tramas de
+ * STREAM_FRAME_SAMPLES muestras. Formato de la trama antes de codificar:
+ *
+ *   u8  tipo       STREAM_FRAME_SAMPLES_TYPE (0x01)
+ *   u8  secuencia  +1 por trama (módulo 256), para detectar pérdidas
+ *   u8  n          número de muestras
+ *   u8  flags      bit0 = electrodos conectados, bit1 = latido en la trama
+ *   u16 bpm x10    little endian
+ *   i16 muestra 0  valor absoluto, little endian
+ *   n-1 deltas     i8; si no cabe: STREAM_DELTA_ESCAPE seguido de i16 absoluto
+ *   u16 CRC        CRC-16/CCITT (poly 0x1021, init 0xFFFF) de todo lo anterior
+ *
+ * Trama de HRV (una por latido, hrv_engine.h), mismo COBS y CRC:
+ *
+ *   u8  tipo       STREAM_FRAME_HRV_TYPE (0x02)
+ *   u16 FC x10     media de los últimos latidos normales (la del LCD)
+ *   u16 SDNN x10   ms
+ *   u16 RMSSD x10  ms
+ *   u16 pNN50 x10  %
+ *   u16 NN         intervalos en la ventana
+ *   u16 rechazados ectópicos/artefactos desde el último reset (satura)
+ *   u16 CRC
+ *
+ * Trama de estado del equipo (una por segundo), mismo COBS y CRC:
+ *
+ *   u8  tipo       STREAM_FRAME_STATUS_TYPE (0x03)
+ *   u16 lecturas   muestras del ADC perdidas desde el arranque
+ *                  (SampleSource::overruns(), satura)
+ *   u16 escrituras lo que no llegó a este flujo desde el arranque (satura):
+ *                  - UNO: tramas enteras que no cabían en la cola de envío
+ *                    de la UART (UnoUartTx::droppedWrites());
+ *                  - ESP32: muestras procesadas que el bus (sample_bus.h)
+ *                    descartó para el consumidor que envía este flujo (el
+ *                    continuo o el de episodios), contadas bloque a
+ *                    bloque aunque no estén llenos (droppedSamples). No
+ *                    incluye las de otros consumidores (LCD, Holter).
+ *   u8  calidad    índice 0-100 de signal_quality.h, 255 si aún no hay
+ *   u16 CRC
+ *
+ * Trama de episodio (event_capture.h) al empezar y al terminar de enviar
+ * cada uno; sus muestras van entre las dos en tramas de muestras normales:
+ *
+ *   u8  tipo       STREAM_FRAME_EPISODE_TYPE (0x04)
+ *   u8  fase       0 = inicio, 1 = fin
+ *   u16 id         número de episodio (módulo 65536)
+ *   u8  disparo    EpisodeType que lo abrió
+ *   u8  tipos      máscara de los que saltaron dentro de la ventana
+ *   u32 muestra    índice de muestra del disparo
+ *   u16 previas    muestras de la ventana antes del disparo
+ *   u16 posteriores muestras desde el disparo
+ *   u16 FC x10     al disparar
+ *   u16 perdidas   muestras que no llegaron a enviarse (en la de fin)
+ *   u16 CRC
+ *
+ * Trama de respiración derivada del ECG (respiration.h), tras la de HRV de
+ * cada latido, mismo COBS y CRC:
+ *
+ *   u8  tipo       STREAM_FRAME_RESPIRATION_TYPE (0x05)
+ *   u16 resp x10   respiraciones por minuto, 0 si no hay estimación
+ *   u8  fuente     RespirationSource: 1 = amplitud del QRS, 2 = línea base
+ *   u8  regularidad 100 - coeficiente de variación de los ciclos, %
+ *   u16 CRC
+ *
+ * La trama se codifica con COBS y termina en 0x00, así el receptor se
+ * resincroniza en el siguiente 0x00 tras cualquier byte perdido o texto de
+ * depuración. El decodificador del host está en tools/ecg_protocol.py.
+ */
+
+#ifndef ECG_STREAM_H
+#define ECG_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hrv_engine.h"
+#include "event_capture.h"
+#include "respiration.h"
+
+constexpr uint8_t STREAM_FRAME_SAMPLES_TYPE = 0x01;
+constexpr uint8_t STREAM_FRAME_SAMPLES = 10;      // 25 tramas/s a 250 Hz
+constexpr uint8_t STREAM_DELTA_ESCAPE = 0x80;     // -128 no se usa como delta
+constexpr uint8_t STREAM_FLAG_LEADS = 0x01;
+constexpr uint8_t STREAM_FLAG_BEAT = 0x02;
+constexpr uint8_t STREAM_FRAME_HRV_TYPE = 0x02;
+constexpr size_t STREAM_HRV_RAW = 1 + 6 * 2 + 2;
+constexpr uint8_t STREAM_FRAME_STATUS_TYPE = 0x03;
+constexpr size_t STREAM_STATUS_RAW = 1 + 2 * 2 + 1 + 2;
+constexpr uint8_t STREAM_FRAME_EPISODE_TYPE = 0x04;
+constexpr uint8_t STREAM_EPISODE_START = EPISODE_START;
+constexpr uint8_t STREAM_EPISODE_END = EPISODE_END;
+constexpr size_t STREAM_EPISODE_RAW = 1 + 1 + 2 + 1 + 1 + 4 + 2 * 4 + 2;
+constexpr uint8_t STREAM_FRAME_RESPIRATION_TYPE = 0x05;
+constexpr size_t STREAM_RESPIRATION_RAW = 1 + 2 + 1 + 1 + 2;
+
+// Tamaño máximo de la trama sin codificar y codificada (COBS + delimitador)
+constexpr size_t STREAM_HEADER_SIZE = 6;
+constexpr size_t STREAM_MAX_RAW = STREAM_HEADER_SIZE + 2 + (STREAM_FRAME_SAMPLES - 1) * 3 + 2;
+constexpr size_t STREAM_MAX_ENCODED = STREAM_MAX_RAW + STREAM_MAX_RAW / 254 + 2;
+
+inline uint16_t crc16Ccitt(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * Codificación COBS de 'len' bytes en 'out' (que debe tener len + len/254 + 1
+ * bytes). No añade el delimitador 0x00. Devuelve los bytes escritos.
+ */
+inline size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out) {
+    size_t codeIndex = 0;
+    size_t o = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[codeIndex] = code;
+            codeIndex = o++;
+            code = 1;
+        } else {
+            out[o++] = in[i];
+            if (++code == 0xFF) {
+                out[codeIndex] = code;
+                codeIndex = o++;
+                code = 1;
+            }
+        }
+    }
+    out[codeIndex] = code;
+    return o;
+}
+
+class ECGStreamEncoder {
+public:
+    ECGStreamEncoder() : seq(0), count(0), flags(0), bpmX10(0), prev(0), rawLen(0), encodedLen(0) {}
+
+    /**
+     * Añade una muestra a la trama en curso.
+     * @return true si la trama se ha completado; entonces data()/size()
+     *         contienen los bytes listos para enviar.
+     */
+    bool push(int16_t value, float bpm, bool leadsConnected, bool beat) {
+        if (count == 0) {
+            rawLen = STREAM_HEADER_SIZE;
+            flags = 0;
+            writeAbsolute(value);
+        } else {
+            int16_t delta = (int16_t)(value - prev);
+            if (delta > -128 && delta < 128) {
+                raw[rawLen++] = (uint8_t)(int8_t)delta;
+            } else {
+                raw[rawLen++] = STREAM_DELTA_ESCAPE;
+                writeAbsolute(value);
+            }
+        }
+        prev = value;
+        count++;
+
+        if (leadsConnected) flags |= STREAM_FLAG_LEADS;
+        if (beat) flags |= STREAM_FLAG_BEAT;
+        bpmX10 = bpm > 0 ? (uint16_t)(bpm * 10.0f + 0.5f) : 0;
+
+        if (count == STREAM_FRAME_SAMPLES) {
+            finish();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Prepara una trama de HRV en data()/size(). No toca la trama de
+     * muestras en curso ni su número de secuencia.
+     */
+    void encodeHrv(const HRVMetrics& m) {
+        uint8_t frame[STREAM_HRV_RAW];
+        frame[0] = STREAM_FRAME_HRV_TYPE;
+        putX10(frame + 1, m.displayHr);
+        putX10(frame + 3, m.sdnnMs);
+        putX10(frame + 5, m.rmssdMs);
+        putX10(frame + 7, m.pnn50);
+        putU16(frame + 9, m.beats);
+        putU16(frame + 11, m.rejected > 0xFFFF ? 0xFFFF : (uint16_t)m.rejected);
+        putU16(frame + 13, crc16Ccitt(frame, 13));
+
+        encodedLen = cobsEncode(frame, sizeof(frame), encoded);
+        encoded[encodedLen++] = 0x00;
+    }
+
+    /**
+     * Prepara una trama de estado en data()/size(), como encodeHrv().
+     * Los contadores saturan en 65535; qué cuenta cada uno, en la cabecera
+     * del fichero (lecturas y escrituras).
+     */
+    void encodeStatus(uint32_t adcOverruns, uint32_t txDropped, uint8_t quality) {
+        uint8_t frame[STREAM_STATUS_RAW];
+        frame[0] = STREAM_FRAME_STATUS_TYPE;
+        putU16(frame + 1, adcOverruns > 0xFFFF ? 0xFFFF : (uint16_t)adcOverruns);
+        putU16(frame + 3, txDropped > 0xFFFF ? 0xFFFF : (uint16_t)txDropped);
+        frame[5] = quality;
+        putU16(frame + 6, crc16Ccitt(frame, 6));
+
+        encodedLen = cobsEncode(frame, sizeof(frame), encoded);
+        encoded[encodedLen++] = 0x00;
+    }
+
+    /**
+     * Prepara una trama de episodio en data()/size(), como encodeHrv().
+     * 'phase': STREAM_EPISODE_START o STREAM_EPISODE_END.
+     */
+    void encodeEpisode(const CaptureEpisode& e, uint8_t phase, uint32_t lostSamples) {
+        uint8_t frame[STREAM_EPISODE_RAW];
+        uint32_t before = e.triggerSample - e.firstSample;
+        uint32_t after = e.endSample - e.triggerSample;
+        frame[0] = STREAM_FRAME_EPISODE_TYPE;
+        frame[1] = phase;
+        putU16(frame + 2, (uint16_t)e.id);
+        frame[4] = e.trigger;
+        frame[5] = e.types;
+        putU16(frame + 6, (uint16_t)(e.triggerSample & 0xFFFF));
+        putU16(frame + 8, (uint16_t)(e.triggerSample >> 16));
+        putU16(frame + 10, before > 0xFFFF ? 0xFFFF : (uint16_t)before);
+        putU16(frame + 12, after > 0xFFFF ? 0xFFFF : (uint16_t)after);
+        putX10(frame + 14, e.bpm);
+        putU16(frame + 16, lostSamples > 0xFFFF ? 0xFFFF : (uint16_t)lostSamples);
+        putU16(frame + 18, crc16Ccitt(frame, 18));
+
+        encodedLen = cobsEncode(frame, sizeof(frame), encoded);
+        encoded[encodedLen++] = 0x00;
+    }
+
+    // Prepara una trama de respiración en data()/size(), como encodeHrv()
+    void encodeRespiration(const RespirationEstimate& r) {
+        uint8_t frame[STREAM_RESPIRATION_RAW];
+        frame[0] = STREAM_FRAME_RESPIRATION_TYPE;
+        putX10(frame + 1, r.rate);
+        frame[3] = r.source;
+        frame[4] = r.regularity;
+        putU16(frame + 5, crc16Ccitt(frame, 5));
+
+        encodedLen = cobsEncode(frame, sizeof(frame), encoded);
+        encoded[encodedLen++] = 0x00;
+    }
+
+    // Cierra la trama en curso aunque no esté llena (p. ej. al parar)
+    bool flush() {
+        if (count == 0) return false;
+        finish();
+        return true;
+    }
+
+    const uint8_t* data() const { return encoded; }
+    size_t size() const { return encodedLen; }
+
+private:
+    uint8_t seq;
+    uint8_t count;
+    uint8_t flags;
+    uint16_t bpmX10;
+    int16_t prev;
+    uint8_t raw[STREAM_MAX_RAW];
+    size_t rawLen;
+    uint8_t encoded[STREAM_MAX_ENCODED];
+    size_t encodedLen;
+
+    static void putU16(uint8_t* p, uint16_t v) {
+        p[0] = (uint8_t)(v & 0xFF);
+        p[1] = (uint8_t)(v >> 8);
+    }
+
+    static void putX10(uint8_t* p, float v) {
+        float x10 = v * 10.0f + 0.5f;
+        putU16(p, x10 <= 0.0f ? 0 : (x10 >= 65535.0f ? 0xFFFF : (uint16_t)x10));
+    }
+
+    void writeAbsolute(int16_t value) {
+        raw[rawLen++] = (uint8_t)(value & 0xFF);
+        raw[rawLen++] = (uint8_t)((uint16_t)value >> 8);
+    }
+
+    void finish() {
+        raw[0] = STREAM_FRAME_SAMPLES_TYPE;
+        raw[1] = seq++;
+        raw[2] = count;
+        raw[3] = flags;
+        raw[4] = (uint8_t)(bpmX10 & 0xFF);
+        raw[5] = (uint8_t)(bpmX10 >> 8);
+
+        uint16_t crc = crc16Ccitt(raw, rawLen);
+        raw[rawLen++] = (uint8_t)(crc & 0xFF);
+        raw[rawLen++] = (uint8_t)(crc >> 8);
+
+        encodedLen = cobsEncode(raw, rawLen, encoded);
+        encoded[encodedLen++] = 0x00;
+        count = 0;
+    }
+};
+
+#endif // ECG_STREAM_H
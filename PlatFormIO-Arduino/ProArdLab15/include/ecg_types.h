@@ -7,6 +7,9 @@
 #define ECG_TYPES_H
 
 #include <Arduino.h>
+#include "ecg_dsp.h"
+#include "hrv_engine.h"
+#include "respiration.h"
 
 // Configuración de pines para AD8232 (conexiones a GPIO del ESP32)
 // Nota: VCC y GND son las rails de alimentación (usar 3.3V y GND físicos)
@@ -17,33 +20,64 @@ struct AD8232Pins {
     static constexpr int LO_MINUS = 12;    // Lead-Off Detection Negative (LO-)
 };
 
+// ADC de 12 bits del ESP32 (saturación en signal_quality.h)
+constexpr uint16_t ECG_ADC_MAX = 4095;
+
+// Pines de un front-end AD8232 para ECGMultiMonitor (ecg_multi_monitor.h).
+// loPlus/loMinus = -1 si ese canal no tiene detección de electrodos.
+struct ECGChannelPins {
+    int output;
+    int loPlus;
+    int loMinus;
+};
+
 // Configuración de pines para LCD I2C
 struct LCDPins {
     static constexpr int SDA = 21;      // Pin SDA para I2C
     static constexpr int SCL = 22;      // Pin SCL para I2C
     static constexpr uint8_t ADDR = 0x27; // Dirección I2C típica para LCD
+    // Fast mode. El PCF8574 está especificado a 100 kHz, pero los backpacks
+    // habituales funcionan a 400 kHz; bajar a 100000 si aparecen caracteres
+    // corruptos. No subir de 400 kHz (ver hd44780_i2c.h).
+    static constexpr uint32_t CLOCK_HZ = 400000;
 };
 
-// Configuración de muestreo
-constexpr unsigned long SAMPLE_RATE_HZ = 250;
-constexpr unsigned long SAMPLE_INTERVAL_US = 1000000UL / SAMPLE_RATE_HZ;
+// HRV: ventana estándar de 5 min; 512 intervalos la cubren hasta ~100 lpm
+// (por encima se queda con los últimos 512 latidos)
+constexpr uint32_t HRV_WINDOW_MS = 300000UL;
+constexpr uint16_t HRV_MAX_BEATS = 512;
+
+// Configuración de muestreo y de filtrado en ecg_dsp.h (SAMPLE_RATE_HZ,
+// DC_CORNER_MILLIHZ, MA_WINDOW) y de detección en qrs_detector.h
+// (umbrales adaptativos, sin THRESHOLD fijo)
 
-// Configuración de filtrado
-constexpr float DC_ALPHA = 0.995f;
-constexpr int MA_WINDOW = 5;
-constexpr int THRESHOLD = 40;
+// La historia de muestras (crudo y filtrado en int16, tiempo implícito en
+// el índice) está en sample_history.h
 
-// Estructura para muestras ECG
-struct ECGSample {
-    int raw;           // Valor crudo del ADC
-    float filtered;    // Valor filtrado
-    unsigned long timestamp; // Marca de tiempo en millis()
+// Resultado de procesar una muestra, tal como lo publica la tarea de
+// adquisición (núcleo 0) en el bus de muestras (sample_bus.h)
+struct ProcessedSample {
+    int16_t raw;
+    int16_t filtered;
+    float bpm;
+    bool leadsConnected;
+    bool beat;
+    uint8_t quality;   // índice de signal_quality.h (QUALITY_UNKNOWN al arrancar)
+    uint8_t hrSource;  // HeartRateSource de spectral_hr.h: de dónde sale bpm
+};
+
+// Latido con RR, publicado una vez en el bus para los consumidores que lo piden
+struct BeatEvent {
+    uint32_t sample;   // índice (reloj de muestras) del pico R
+    float bpm;
+    HRVMetrics hrv;    // métricas tras este latido
+    RespirationEstimate respiration;  // respiración derivada del ECG tras este latido
 };
 
 // Estructura para datos de latido
 struct BeatInfo {
     float bpm;
-    unsigned long lastBeatTime;
+    unsigned long lastBeatTime;   // ms del pico R en el reloj de muestras (0 = ninguno)
     bool isInBeat;
 };
 
@@ -0,0 +1,101 @@
+/**
+ * @file esp32_holter_storage.h
+ * @brief HolterStorage sobre LittleFS (partición "spiffs" del ESP32)
+ *
+ * Los segmentos se guardan como /holter/<id>.seg. Con la tabla de
+ * particiones por defecto (1.4 MB) caben ~1.5 h de registro a 250 Hz
+ * (~230 B/s con una señal ruidosa como la del AD8232).
+ */
+
+#ifndef ESP32_HOLTER_STORAGE_H
+#define ESP32_HOLTER_STORAGE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "holter_storage.h"
+
+class LittleFSHolterStorage : public HolterStorage {
+public:
+    bool begin() override {
+        // true: formatea la partición si no tiene un LittleFS válido
+        if (!LittleFS.begin(true)) return false;
+        if (!LittleFS.exists(dirName())) LittleFS.mkdir(dirName());
+        return true;
+    }
+
+    size_t listSegments(uint32_t* ids, size_t maxIds) override {
+        size_t count = 0;
+        File dir = LittleFS.open(dirName());
+        if (!dir || !dir.isDirectory()) return 0;
+        File entry;
+        while ((entry = dir.openNextFile())) {
+            const char* name = strrchr(entry.name(), '/');
+            name = name ? name + 1 : entry.name();
+            char* end;
+            uint32_t id = strtoul(name, &end, 10);
+            entry.close();
+            if (end == name || strcmp(end, ".seg") != 0) continue;
+
+            // Inserción ordenada; si no caben se quedan los más antiguos
+            size_t pos = count;
+            while (pos > 0 && ids[pos - 1] > id) pos--;
+            if (pos >= maxIds) continue;
+            size_t last = count < maxIds ? count : maxIds - 1;
+            for (size_t i = last; i > pos; i--) ids[i] = ids[i - 1];
+            ids[pos] = id;
+            if (count < maxIds) count++;
+        }
+        return count;
+    }
+
+    bool createSegment(uint32_t id) override {
+        closeSegment();
+        file = LittleFS.open(path(id), FILE_WRITE);
+        return (bool)file;
+    }
+
+    size_t append(const uint8_t* data, size_t len) override {
+        return file ? file.write(data, len) : 0;
+    }
+
+    // LittleFS solo confirma los datos de un fichero abierto al sincronizarlo
+    void sync() override {
+        if (file) file.flush();
+    }
+
+    void closeSegment() override {
+        if (file) file.close();
+    }
+
+    uint32_t segmentSize(uint32_t id) override {
+        File f = LittleFS.open(path(id), FILE_READ);
+        uint32_t size = f ? f.size() : 0;
+        f.close();
+        return size;
+    }
+
+    size_t readSegment(uint32_t id, uint32_t offset, uint8_t* out, size_t len) override {
+        File f = LittleFS.open(path(id), FILE_READ);
+        if (!f) return 0;
+        size_t n = f.seek(offset) ? f.read(out, len) : 0;
+        f.close();
+        return n;
+    }
+
+    bool removeSegment(uint32_t id) override { return LittleFS.remove(path(id)); }
+
+    uint32_t freeBytes() override { return LittleFS.totalBytes() - LittleFS.usedBytes(); }
+
+private:
+    File file;
+    char pathBuffer[32];
+
+    const char* path(uint32_t id) {
+        snprintf(pathBuffer, sizeof(pathBuffer), "%s/%08lu.seg", dirName(), (unsigned long)id);
+        return pathBuffer;
+    }
+
+    static const char* dirName() { return "/holter"; }
+};
+
+#endif // ESP32_HOLTER_STORAGE_H
@@ -0,0 +1,373 @@
+/**
+ * @file esp32_sample_sources.h
+ * @brief Fuentes de muestras del ESP32: timer + analogRead (uno o varios canales) y ADC continuo por DMA
+ *
+ * Escrito para el core Arduino-ESP32 2.x (ESP-IDF 4.4), el mismo que usa la
+ * API timerBegin(0, 80, true) del resto del proyecto.
+ */
+
+#ifndef ESP32_SAMPLE_SOURCES_H
+#define ESP32_SAMPLE_SOURCES_H
+
+#include <Arduino.h>
+#include <driver/adc.h>
+#include "ecg_types.h"
+#include "sample_source.h"
+#include "cic_decimator.h"
+
+// Ticks del timer pendientes de leer (contador, no bool: no se pierde ninguno)
+volatile uint32_t pendingSampleTicks = 0;
+portMUX_TYPE sampleTicksMux = portMUX_INITIALIZER_UNLOCKED;
+
+// micros() del último tick y periodo del timer, para fechar los pendientes.
+// micros() y no ciclos: la ISR y la tarea de adquisición pueden ir en
+// núcleos distintos, y sus contadores de ciclos no están sincronizados.
+volatile uint32_t lastSampleTickUs = 0;
+uint32_t sampleTickIntervalUs = SAMPLE_INTERVAL_US;
+
+void IRAM_ATTR onSampleTimer()
+{
+    uint32_t now = micros();
+    portENTER_CRITICAL_ISR(&sampleTicksMux);
+    pendingSampleTicks++;
+    lastSampleTickUs = now;
+    portEXIT_CRITICAL_ISR(&sampleTicksMux);
+}
+
+// Arranca el timer 0 con un tick cada intervalUs (por defecto, uno por muestra)
+static hw_timer_t* startSampleTimer(uint32_t intervalUs = SAMPLE_INTERVAL_US)
+{
+    sampleTickIntervalUs = intervalUs;
+    hw_timer_t* timer = timerBegin(0, 80, true);
+    timerAttachInterrupt(timer, &onSampleTimer, true);
+    timerAlarmWrite(timer, intervalUs, true);
+    timerAlarmEnable(timer);
+    return timer;
+}
+
+/**
+ * Toma hasta maxTicks ticks pendientes; los que pasan de maxPending se
+ * pierden. oldestTickUs recibe el instante del primero que se toma, que es
+ * el más antiguo de los que quedan.
+ */
+static uint32_t claimSampleTicks(uint32_t maxTicks, uint32_t maxPending, uint32_t& lost, uint32_t& oldestTickUs)
+{
+    portENTER_CRITICAL(&sampleTicksMux);
+    uint32_t pending = pendingSampleTicks;
+    if (pending > maxPending) {
+        lost += pending - maxPending;
+        pending = maxPending;
+    }
+    uint32_t count = pending < maxTicks ? pending : maxTicks;
+    pendingSampleTicks = pending - count;
+    if (count > 0) oldestTickUs = lastSampleTickUs - (pending - 1) * sampleTickIntervalUs;
+    portEXIT_CRITICAL(&sampleTicksMux);
+    return count;
+}
+
+/**
+ * Fuente clásica: el timer marca el periodo y analogRead() se llama desde
+ * read(). La lectura sigue teniendo el jitter del loop, pero los ticks ya no
+ * se pierden y los que no caben en el buffer se cuentan como overruns.
+ */
+class TimerAnalogSource : public SampleSource {
+public:
+    static const uint32_t MAX_PENDING = 64;
+
+    explicit TimerAnalogSource(int pin) : pin(pin), timer(nullptr), lost(0), firstTickUs(0), haveTick(false) {}
+
+    bool begin() override {
+        pinMode(pin, INPUT);
+        timer = startSampleTimer();
+        return timer != nullptr;
+    }
+
+    size_t read(int16_t* out, size_t maxCount) override {
+        uint32_t tickUs;
+        uint32_t count = claimSampleTicks((uint32_t)maxCount, MAX_PENDING, lost, tickUs);
+        for (uint32_t i = 0; i < count; i++) {
+            out[i] = (int16_t)analogRead(pin);
+        }
+        if (count > 0) {
+            firstTickUs = tickUs;
+            haveTick = true;
+        }
+        return count;
+    }
+
+    uint32_t overruns() const override { return lost; }
+
+    bool firstSampleTickUs(uint32_t& us) const override {
+        us = firstTickUs;
+        return haveTick;
+    }
+
+private:
+    int pin;
+    hw_timer_t* timer;
+    uint32_t lost;
+    uint32_t firstTickUs;
+    bool haveTick;
+};
+
+/**
+ * Sobremuestreo: el timer marca Ratio lecturas por periodo de muestreo
+ * (Ratio = 8 -> 2 kHz, 500 us) y un CICDecimator de orden 3 las reduce a
+ * SAMPLE_RATE_HZ con compensación hasta 40 Hz (cic_decimator.h). Con el
+ * ruido del ADC1 mejora la SNR unos 10 dB (benchmark "cic" del entorno
+ * native) a cambio de Ratio analogRead() por muestra (~80 us de cada 4 ms).
+ * Solo se reclaman las lecturas que completan muestras de salida.
+ */
+template <uint8_t Ratio>
+class OversampledAnalogSource : public SampleSource {
+public:
+    static const uint32_t MAX_PENDING = 64 * Ratio;
+    typedef CICDecimator<Ratio, 3, SAMPLE_RATE_HZ> Decimator;
+
+    explicit OversampledAnalogSource(int pin)
+        : pin(pin), timer(nullptr), lost(0), primed(false), firstTickUs(0), haveTick(false) {}
+
+    bool begin() override {
+        pinMode(pin, INPUT);
+        timer = startSampleTimer(SAMPLE_INTERVAL_US / Ratio);
+        return timer != nullptr;
+    }
+
+    size_t read(int16_t* out, size_t maxCount) override {
+        if (maxCount == 0) return 0;
+        uint8_t carried = decimator.pending();
+        uint32_t maxTicks = (uint32_t)maxCount * Ratio - carried;
+        uint32_t tickUs;
+        uint32_t ticks = claimSampleTicks(maxTicks, MAX_PENDING, lost, tickUs);
+        size_t produced = 0;
+        for (uint32_t i = 0; i < ticks; i++) {
+            int16_t x = (int16_t)analogRead(pin);
+            if (!primed) {
+                // El estado del CIC arranca con la primera lectura
+                decimator.reset(x);
+                primed = true;
+            }
+            if (decimator.push(x)) out[produced++] = decimator.output();
+        }
+        if (produced > 0) {
+            // La primera salida la completa la lectura Ratio - carried
+            firstTickUs = tickUs + (uint32_t)(Ratio - 1 - carried) * (SAMPLE_INTERVAL_US / Ratio);
+            haveTick = true;
+        }
+        return produced;
+    }
+
+    // En lecturas del ADC, no en muestras de salida
+    uint32_t overruns() const override { return lost; }
+
+    bool firstSampleTickUs(uint32_t& us) const override {
+        us = firstTickUs;
+        return haveTick;
+    }
+
+private:
+    int pin;
+    hw_timer_t* timer;
+    uint32_t lost;
+    bool primed;
+    uint32_t firstTickUs;
+    bool haveTick;
+    Decimator decimator;
+};
+
+/**
+ * Varios AD8232 (ECGMultiMonitor) con el mismo timer: en cada tick se leen
+ * todos los canales seguidos, así que las muestras de un tick son
+ * simultáneas salvo los ~10 us de cada analogRead(). read() entrega tramas
+ * entrelazadas: out[t * Channels + c] es el canal c del tick t.
+ */
+template <uint8_t Channels>
+class TimerAnalogMultiSource : public SampleSource {
+public:
+    static const uint32_t MAX_PENDING = 64;
+
+    explicit TimerAnalogMultiSource(const ECGChannelPins (&channelPins)[Channels])
+        : timer(nullptr), lost(0), firstTickUs(0), haveTick(false) {
+        for (uint8_t c = 0; c < Channels; c++) pins[c] = channelPins[c].output;
+    }
+
+    bool begin() override {
+        for (uint8_t c = 0; c < Channels; c++) pinMode(pins[c], INPUT);
+        timer = startSampleTimer();
+        return timer != nullptr;
+    }
+
+    // maxCount en muestras; solo se devuelven tramas completas
+    size_t read(int16_t* out, size_t maxCount) override {
+        uint32_t tickUs;
+        uint32_t ticks = claimSampleTicks((uint32_t)(maxCount / Channels), MAX_PENDING, lost, tickUs);
+        for (uint32_t t = 0; t < ticks; t++) {
+            for (uint8_t c = 0; c < Channels; c++) {
+                out[t * Channels + c] = (int16_t)analogRead(pins[c]);
+            }
+        }
+        if (ticks > 0) {
+            firstTickUs = tickUs;
+            haveTick = true;
+        }
+        return (size_t)ticks * Channels;
+    }
+
+    uint8_t channels() const override { return Channels; }
+    uint32_t overruns() const override { return lost; }
+
+    // Instante del tick de la primera trama
+    bool firstSampleTickUs(uint32_t& us) const override {
+        us = firstTickUs;
+        return haveTick;
+    }
+
+private:
+    int pins[Channels];
+    hw_timer_t* timer;
+    uint32_t lost;
+    uint32_t firstTickUs;
+    bool haveTick;
+};
+
+/**
+ * ADC1 en modo continuo (I2S/DMA). El hardware muestrea a DMA_SAMPLE_RATE_HZ,
+ * el mínimo que admite el ESP32, y read() promedia bloques de DECIMATION
+ * conversiones para entregar SAMPLE_RATE_HZ. El reloj de muestreo no depende
+ * del loop: el driver guarda hasta DMA_STORE_BYTES mientras el LCD o el
+ * puerto serie ocupan la CPU. Las conversiones no llevan marca de tiempo,
+ * así que firstSampleTickUs() no está disponible; el retraso se ve en la
+ * ocupación de la cola del núcleo 1 (loop_stats.h en esp32_main.cpp).
+ *
+ * Si el buffer del driver se llena, descarta tramas enteras y solo lo avisa
+ * con ESP_ERR_INVALID_STATE en la siguiente lectura, sin decir cuántas.
+ * overruns() lo estima en muestras, como las otras fuentes: lo convertido
+ * desde la última vez que se vació el buffer (por el tiempo transcurrido)
+ * menos lo leído y lo que sigue guardado, y al menos una trama por aviso.
+ * overflowEvents() cuenta los avisos.
+ */
+class Esp32DmaSource : public SampleSource {
+public:
+    static const uint32_t DMA_SAMPLE_RATE_HZ = 20000;
+    static const uint32_t DECIMATION = DMA_SAMPLE_RATE_HZ / SAMPLE_RATE_HZ; // 80
+    static const uint32_t DMA_FRAME_BYTES = 256;   // bytes por interrupción del DMA
+    static const uint32_t DMA_STORE_BYTES = 8192;  // ~200 ms a 20 kHz
+
+    explicit Esp32DmaSource(adc1_channel_t channel)
+        : channel(channel), acc(0), accCount(0), lost(0), overflows(0), windowUs(0), windowConversions(0) {}
+
+    bool begin() override {
+        adc_digi_init_config_t init = {};
+        init.max_store_buf_size = DMA_STORE_BYTES;
+        init.conv_num_each_intr = DMA_FRAME_BYTES;
+        init.adc1_chan_mask = BIT(channel);
+        init.adc2_chan_mask = 0;
+        if (adc_digi_initialize(&init) != ESP_OK) return false;
+
+        // Misma atenuación y resolución que analogRead() por defecto
+        adc_digi_pattern_config_t pattern = {};
+        pattern.atten = ADC_ATTEN_DB_11;
+        pattern.channel = channel & 0x7;
+        pattern.unit = 0; // ADC1
+        pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+        adc_digi_configuration_t config = {};
+        config.conv_limit_en = 1;
+        config.conv_limit_num = 250;
+        config.pattern_num = 1;
+        config.adc_pattern = &pattern;
+        config.sample_freq_hz = DMA_SAMPLE_RATE_HZ;
+        config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+        config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+        if (adc_digi_controller_configure(&config) != ESP_OK) return false;
+
+        if (adc_digi_start() != ESP_OK) return false;
+        windowUs = micros();
+        windowConversions = 0;
+        return true;
+    }
+
+    size_t read(int16_t* out, size_t maxCount) override {
+        return readWait(out, maxCount, 0);
+    }
+
+    // Bloquea en el driver (sin sondeo) hasta que llega el primer DMA
+    size_t readWait(int16_t* out, size_t maxCount, uint32_t timeoutMs) override {
+        size_t produced = 0;
+        while (produced < maxCount) {
+            // Solo se piden las conversiones necesarias para no producir de más
+            uint32_t needed = (uint32_t)(maxCount - produced) * DECIMATION - accCount;
+            uint32_t bytes = needed * SOC_ADC_DIGI_RESULT_BYTES;
+            if (bytes > sizeof(dmaBuffer)) bytes = sizeof(dmaBuffer);
+
+            uint32_t got = 0;
+            esp_err_t err = adc_digi_read_bytes(dmaBuffer, bytes, &got, timeoutMs);
+            timeoutMs = 0; // solo se espera por el primer bloque
+            if (err == ESP_ERR_INVALID_STATE) {
+                // El buffer del driver se llenó: se han descartado conversiones
+                countOverflow();
+            } else if (err != ESP_OK) {
+                markDrained();
+                break; // ESP_ERR_TIMEOUT: no hay más datos por ahora
+            }
+            if (got == 0) {
+                markDrained();
+                break;
+            }
+            windowConversions += (int32_t)(got / SOC_ADC_DIGI_RESULT_BYTES);
+            if (got < bytes) markDrained();
+
+            for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+                const adc_digi_output_data_t* p = (const adc_digi_output_data_t*)&dmaBuffer[i];
+                if (p->type1.channel != (channel & 0x7)) continue;
+                acc += p->type1.data;
+                if (++accCount == DECIMATION) {
+                    out[produced++] = (int16_t)(acc / DECIMATION);
+                    acc = 0;
+                    accCount = 0;
+                }
+            }
+        }
+        return produced;
+    }
+
+    // Muestras (a SAMPLE_RATE_HZ) que descartó el driver, estimadas
+    uint32_t overruns() const override { return lost; }
+
+    // Veces que el driver avisó de que había descartado conversiones
+    uint32_t overflowEvents() const { return overflows; }
+
+private:
+    static const uint32_t STORE_CONVERSIONS = DMA_STORE_BYTES / SOC_ADC_DIGI_RESULT_BYTES;
+    static const uint32_t FRAME_CONVERSIONS = DMA_FRAME_BYTES / SOC_ADC_DIGI_RESULT_BYTES;
+
+    adc1_channel_t channel;
+    uint8_t dmaBuffer[DMA_FRAME_BYTES];
+    uint32_t acc;
+    uint32_t accCount;
+    uint32_t lost;
+    uint32_t overflows;
+    // Desde windowUs: conversiones leídas menos las que ya estaban guardadas
+    uint32_t windowUs;
+    int32_t windowConversions;
+
+    // El buffer del driver quedó vacío: todo lo convertido se ha leído
+    void markDrained() {
+        windowUs = micros();
+        windowConversions = 0;
+    }
+
+    void countOverflow() {
+        overflows++;
+        uint32_t now = micros();
+        int64_t produced = (int64_t)(now - windowUs) * DMA_SAMPLE_RATE_HZ / 1000000;
+        int64_t dropped = produced - windowConversions - STORE_CONVERSIONS;
+        if (dropped < (int64_t)FRAME_CONVERSIONS) dropped = FRAME_CONVERSIONS;
+        lost += (uint32_t)((dropped + DECIMATION - 1) / DECIMATION);
+        // El buffer sigue lleno: lo guardado se convirtió antes de 'now'
+        windowUs = now;
+        windowConversions = -(int32_t)STORE_CONVERSIONS;
+    }
+};
+
+#endif // ESP32_SAMPLE_SOURCES_H
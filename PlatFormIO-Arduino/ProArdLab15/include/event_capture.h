@@ -0,0 +1,413 @@
+/**
+ * @file event_capture.h
+ * @brief Captura de episodios por eventos: ventanas antes y después de una bradicardia, taquicardia, pausa o RR irregular
+ *
+ * En una sesión larga lo que se revisa son los episodios anormales, no
+ * horas de ritmo sinusal. EventCapture guarda las últimas Capacity
+ * muestras (crudo y filtrado, SampleHistory) y mira el ritmo latido a
+ * latido; al detectar un evento abre un episodio de PreSamples muestras
+ * antes del disparo y PostSamples después, y solo eso se envía por serie
+ * o se graba en la flash.
+ *
+ * Eventos (EpisodeType):
+ *   - Bradicardia / taquicardia: media de los últimos RATE_BEATS RR por
+ *     debajo de BRADY_BPM o por encima de TACHY_BPM, las mismas bandas que
+ *     aplica tools/controller.py a la FC. Se rearma al volver HYSTERESIS_BPM
+ *     dentro de la banda: un episodio por cruce, no uno cada ventana.
+ *   - Pausa: PAUSE_MS sin latido con los electrodos puestos y la señal
+ *     en calma: desde PAUSE_QUIET_DELAY_MS tras el último latido, el
+ *     filtrado no pasa del PAUSE_QUIET_PERCENT % de su onda R. Un
+ *     artefacto de movimiento no es una pausa; una línea plana sí, aunque
+ *     el índice de calidad caiga (sin QRS la ventana parece solo ruido).
+ *     Se dispara en ese momento, sin esperar al latido siguiente.
+ *   - RR irregular: de las diferencias sucesivas entre los últimos
+ *     IRREGULAR_BEATS RR, IRREGULAR_ON o más pasan del IRREGULAR_PERCENT %
+ *     del RR medio (fibrilación auricular, extrasístoles frecuentes). Un
+ *     extrasístole aislado da dos y no dispara. Se rearma por debajo de
+ *     IRREGULAR_OFF.
+ * Los latidos son los que ECGMonitor acepta (pasan la puerta de calidad,
+ * BeatEvent). Un RR que abarca señal con artefactos no se usa (faltarían
+ * latidos rechazados y parecería una bradicardia); sin electrodos se
+ * olvida también el historial de RR.
+ *
+ * La ventana no se copia: el disparo fija sus límites en el índice de
+ * muestra y las muestras posteriores siguen entrando en el mismo anillo.
+ * Los lectores (EpisodeCursor, uno por destino) leen por índice mientras
+ * se captura; el static_assert deja al menos 1 s de margen para que lo
+ * previo no se sobrescriba antes de leerlo. Un disparo durante la ventana
+ * de otro episodio solo se anota en su máscara 'types'; los episodios no
+ * se solapan. streamEpisode() y recordEpisode() son los dos destinos del
+ * firmware (serie binaria y HolterRecorder), compartidos con el benchmark
+ * "events" del entorno native.
+ *
+ * Un solo hilo (el consumidor del bus en loop()).
+ */
+
+#ifndef EVENT_CAPTURE_H
+#define EVENT_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sample_history.h"
+
+enum EpisodeType : uint8_t {
+    EPISODE_BRADYCARDIA = 0x01,
+    EPISODE_TACHYCARDIA = 0x02,
+    EPISODE_PAUSE = 0x04,
+    EPISODE_IRREGULAR = 0x08,
+};
+
+// Tramas de inicio y fin de un episodio (STREAM_EPISODE_* de ecg_stream.h)
+enum EpisodePhase : uint8_t {
+    EPISODE_START = 0,
+    EPISODE_END = 1,
+};
+
+struct CaptureEpisode {
+    uint32_t id;             // desde 0, en orden de disparo
+    uint32_t firstSample;    // primera muestra de la ventana
+    uint32_t triggerSample;  // latido o instante que lo disparó
+    uint32_t endSample;      // una después de la última
+    uint8_t trigger;         // EpisodeType que lo abrió
+    uint8_t types;           // todos los que saltaron dentro de la ventana
+    float bpm;               // FC de los últimos RR al disparar (0 si no había)
+};
+
+// Posición de un destino (serie, flash...) en los episodios de EventCapture
+struct EpisodeCursor {
+    uint32_t nextId;
+    bool active;
+    CaptureEpisode episode;
+    uint32_t position;         // siguiente muestra a leer
+    uint32_t lostSamples;      // sobrescritas antes de leerlas, en total
+    uint32_t episodeLost;      // las del episodio en curso
+    uint32_t skippedEpisodes;  // olvidados antes de empezar a leerlos
+
+    EpisodeCursor()
+        : nextId(0), active(false), episode(), position(0), lostSamples(0), episodeLost(0), skippedEpisodes(0) {}
+};
+
+template <uint16_t RateHz, uint16_t PreSamples, uint16_t PostSamples, uint16_t Capacity>
+class EventCapture {
+public:
+    typedef SampleHistory<RateHz, Capacity> History;
+
+    static_assert((uint32_t)PreSamples + PostSamples + RateHz <= Capacity,
+                  "el anillo debe cubrir la ventana y 1 s de margen de lectura");
+
+    static constexpr uint8_t BRADY_BPM = 60;       // tools/controller.py
+    static constexpr uint8_t TACHY_BPM = 100;
+    static constexpr uint8_t HYSTERESIS_BPM = 5;
+    static constexpr uint8_t RATE_BEATS = 8;
+    static constexpr uint16_t PAUSE_MS = 2000;
+    static constexpr uint16_t PAUSE_QUIET_DELAY_MS = 300;  // pasado el QRS y la onda T
+    static constexpr uint8_t PAUSE_QUIET_PERCENT = 50;
+    static constexpr uint8_t IRREGULAR_BEATS = 16;
+    static constexpr uint8_t IRREGULAR_PERCENT = 15;
+    static constexpr uint8_t IRREGULAR_ON = 8;     // de IRREGULAR_BEATS - 1 diferencias
+    static constexpr uint8_t IRREGULAR_OFF = 4;
+    static constexpr uint8_t RECENT_EPISODES = 4;  // recordados para los lectores
+    static constexpr uint32_t PAUSE_SAMPLES = (uint32_t)PAUSE_MS * RateHz / 1000;
+    static constexpr uint32_t PAUSE_QUIET_DELAY = (uint32_t)PAUSE_QUIET_DELAY_MS * RateHz / 1000;
+
+    EventCapture() { reset(); }
+
+    void reset() {
+        history.reset();
+        haveBeat = false;
+        lastBeat = 0;
+        rrValid = false;
+        beatPeak = quietPeak = 0;
+        rrCount = 0;
+        rrHead = 0;
+        bradyArmed = tachyArmed = irregularArmed = pauseArmed = true;
+        started = 0;
+        open = false;
+        for (uint8_t i = 0; i < 4; i++) triggerCounts[i] = 0;
+    }
+
+    /**
+     * Una muestra con su índice en el reloj de muestras. 'clean': calidad
+     * sobre la puerta de ECGMonitor. Si faltan índices (el consumidor del
+     * bus perdió bloques) el hueco se guarda como ceros y cuenta como sin
+     * electrodos.
+     */
+    void push(uint32_t index, int16_t raw, int16_t filtered, bool leadsConnected, bool clean) {
+        uint32_t count = history.sampleCount();
+        if (index < count) return;
+        if (index > count) {
+            history.skip(index - count);
+            leadsConnected = false;
+        }
+        history.push(raw, filtered);
+
+        if (!leadsConnected) {
+            // Sin electrodos no hay ritmo que vigilar
+            haveBeat = false;
+            rrCount = 0;
+        } else if (haveBeat) {
+            if (!clean) rrValid = false;
+            uint16_t magnitude = filtered < 0 ? (uint16_t)-filtered : (uint16_t)filtered;
+            if (index > lastBeat + PAUSE_QUIET_DELAY && magnitude > quietPeak) quietPeak = magnitude;
+            if (pauseArmed && index > lastBeat && index - lastBeat >= PAUSE_SAMPLES &&
+                (uint32_t)quietPeak * 100 < (uint32_t)beatPeak * PAUSE_QUIET_PERCENT) {
+                pauseArmed = false;
+                trigger(EPISODE_PAUSE, index, rateBpm());
+            }
+        }
+
+        if (open && history.sampleCount() >= recent[(started - 1) % RECENT_EPISODES].endSample) open = false;
+    }
+
+    // Latido aceptado, con el índice de su pico R (BeatEvent::sample)
+    void onBeat(uint32_t sample) {
+        if (haveBeat && sample <= lastBeat) return;
+        bool useRr = haveBeat && rrValid;
+        uint32_t rr = sample - lastBeat;
+        haveBeat = true;
+        rrValid = true;
+        lastBeat = sample;
+        pauseArmed = true;
+
+        // Onda R en el filtrado (va retrasado: se busca hasta la última
+        // muestra) y calma desde PAUSE_QUIET_DELAY
+        beatPeak = 0;
+        quietPeak = 0;
+        for (uint32_t i = sample; history.contains(i); i++) {
+            int16_t v = history.filteredAt(i);
+            uint16_t magnitude = v < 0 ? (uint16_t)-v : (uint16_t)v;
+            if (magnitude > beatPeak) beatPeak = magnitude;
+            if (i > sample + PAUSE_QUIET_DELAY && magnitude > quietPeak) quietPeak = magnitude;
+        }
+        if (!useRr) return;
+
+        uint32_t rrMs = History::timeMs(rr);
+        rrs[rrHead] = rrMs > 0xFFFF ? 0xFFFF : (uint16_t)rrMs;
+        rrHead = (uint8_t)((rrHead + 1) % IRREGULAR_BEATS);
+        if (rrCount < IRREGULAR_BEATS) rrCount++;
+
+        if (rrCount >= RATE_BEATS) {
+            float bpm = rateBpm();
+            if (bradyArmed && bpm < BRADY_BPM) {
+                bradyArmed = false;
+                trigger(EPISODE_BRADYCARDIA, sample, bpm);
+            } else if (!bradyArmed && bpm >= BRADY_BPM + HYSTERESIS_BPM) {
+                bradyArmed = true;
+            }
+            if (tachyArmed && bpm > TACHY_BPM) {
+                tachyArmed = false;
+                trigger(EPISODE_TACHYCARDIA, sample, bpm);
+            } else if (!tachyArmed && bpm <= TACHY_BPM - HYSTERESIS_BPM) {
+                tachyArmed = true;
+            }
+        }
+
+        if (rrCount == IRREGULAR_BEATS) {
+            uint8_t irregular = irregularDiffs();
+            if (irregularArmed && irregular >= IRREGULAR_ON) {
+                irregularArmed = false;
+                trigger(EPISODE_IRREGULAR, sample, rateBpm());
+            } else if (!irregularArmed && irregular <= IRREGULAR_OFF) {
+                irregularArmed = true;
+            }
+        }
+    }
+
+    // ---- Lectores ----
+
+    /**
+     * Pasa 'c' al siguiente episodio si ha terminado el anterior. Si se
+     * quedó más de RECENT_EPISODES atrás salta a los recordados.
+     * @return true si empieza uno (c.episode tiene sus datos)
+     */
+    bool beginNext(EpisodeCursor& c) const {
+        if (c.active || c.nextId == started) return false;
+        if (started - c.nextId > RECENT_EPISODES) {
+            c.skippedEpisodes += started - RECENT_EPISODES - c.nextId;
+            c.nextId = started - RECENT_EPISODES;
+        }
+        c.episode = recent[c.nextId % RECENT_EPISODES];
+        c.nextId++;
+        c.position = c.episode.firstSample;
+        c.episodeLost = 0;
+        c.active = true;
+        return true;
+    }
+
+    /**
+     * Copia hasta 'maxCount' muestras ya capturadas del episodio de 'c'
+     * (raw o filtered pueden ser nullptr). Si el anillo ya sobrescribió la
+     * posición, salta lo perdido y lo cuenta en c.lostSamples y
+     * c.episodeLost. Al leer la
+     * última, c.active pasa a false.
+     * @return muestras copiadas
+     */
+    size_t read(EpisodeCursor& c, int16_t* raw, int16_t* filtered, size_t maxCount) const {
+        if (!c.active) return 0;
+        uint32_t oldest = history.oldestIndex();
+        if (c.position < oldest) {
+            uint32_t to = oldest < c.episode.endSample ? oldest : c.episode.endSample;
+            c.lostSamples += to - c.position;
+            c.episodeLost += to - c.position;
+            c.position = to;
+        }
+        uint32_t written = history.sampleCount();
+        uint32_t end = c.episode.endSample < written ? c.episode.endSample : written;
+        size_t n = end > c.position ? end - c.position : 0;
+        if (n > maxCount) n = maxCount;
+        for (size_t i = 0; i < n; i++) {
+            if (raw) raw[i] = history.rawAt(c.position + (uint32_t)i);
+            if (filtered) filtered[i] = history.filteredAt(c.position + (uint32_t)i);
+        }
+        c.position += (uint32_t)n;
+        if (c.position == c.episode.endSample) c.active = false;
+        return n;
+    }
+
+    /**
+     * Destino serie: envía el episodio de 'c' por un ECGStreamEncoder
+     * (ecg_stream.h) entre sus tramas de inicio y fin. Cada llamada manda
+     * hasta 'maxCount' muestras filtradas, que quedan en 'chunk'; la trama
+     * de fin lleva la máscara 'types' final y c.episodeLost, y c.episode
+     * queda con esos datos. emit(data, size) recibe cada trama completa.
+     * @param sent si no es nullptr, muestras enviadas en esta llamada
+     * @return true si el episodio terminó en esta llamada
+     */
+    template <class Encoder, class Emit>
+    bool streamEpisode(EpisodeCursor& c, Encoder& encoder, Emit emit, int16_t* chunk, size_t maxCount,
+                       size_t* sent = nullptr) const {
+        if (sent) *sent = 0;
+        if (beginNext(c)) {
+            encoder.encodeEpisode(c.episode, EPISODE_START, 0);
+            emit(encoder.data(), encoder.size());
+        }
+        if (!c.active) return false;
+        size_t n = read(c, nullptr, chunk, maxCount);
+        for (size_t i = 0; i < n; i++) {
+            if (encoder.push(chunk[i], c.episode.bpm, true, false)) emit(encoder.data(), encoder.size());
+        }
+        if (sent) *sent = n;
+        if (c.active) return false;
+        if (encoder.flush()) emit(encoder.data(), encoder.size());
+        // Con los tipos que saltaron durante la ventana
+        episode(c.episode.id, c.episode);
+        encoder.encodeEpisode(c.episode, EPISODE_END, c.episodeLost);
+        emit(encoder.data(), encoder.size());
+        return true;
+    }
+
+    /**
+     * Destino flash: graba en un HolterRecorder (holter_log.h) hasta
+     * 'maxCount' muestras crudas del episodio de 'c', y solo si su cola
+     * tiene sitio para un bloque más. Entre episodios y en lo que el anillo
+     * sobrescribió antes de leerlo, recorder.skip() deja el hueco: el
+     * índice de la flash sigue siendo el tiempo.
+     * @return muestras grabadas
+     */
+    template <class Recorder>
+    size_t recordEpisode(EpisodeCursor& c, Recorder& recorder, int16_t* chunk, size_t maxCount) const {
+        // Sin episodio activo, la posición es el final de lo ya grabado
+        const uint32_t recordedEnd = c.position;
+        if (beginNext(c)) recorder.skip(c.episode.firstSample - recordedEnd);
+        if (!c.active || recorder.getPendingBlocks() >= Recorder::PENDING_BLOCKS - 1) return 0;
+        const uint32_t from = c.position;
+        size_t n = read(c, chunk, nullptr, maxCount);
+        recorder.skip(c.position - (uint32_t)n - from);
+        for (size_t i = 0; i < n; i++) recorder.push(chunk[i], false);
+        return n;
+    }
+
+    // Datos actuales de un episodio recordado (su máscara 'types' crece
+    // mientras dura la ventana)
+    bool episode(uint32_t id, CaptureEpisode& out) const {
+        if (id >= started || started - id > RECENT_EPISODES) return false;
+        out = recent[id % RECENT_EPISODES];
+        return true;
+    }
+
+    uint32_t episodes() const { return started; }
+    bool capturing() const { return open; }
+
+    // Disparos de un tipo, también los que caen dentro de otro episodio
+    uint32_t triggers(EpisodeType type) const { return triggerCounts[typeSlot(type)]; }
+
+    const History& getHistory() const { return history; }
+
+private:
+    History history;
+
+    bool haveBeat;
+    uint32_t lastBeat;
+    bool rrValid;          // señal limpia desde lastBeat
+    uint16_t beatPeak;     // |filtrado| máximo de la onda R de lastBeat
+    uint16_t quietPeak;    // |filtrado| máximo desde lastBeat + PAUSE_QUIET_DELAY
+    uint16_t rrs[IRREGULAR_BEATS];  // ms, anillo
+    uint8_t rrCount;
+    uint8_t rrHead;
+
+    bool bradyArmed;
+    bool tachyArmed;
+    bool irregularArmed;
+    bool pauseArmed;
+
+    CaptureEpisode recent[RECENT_EPISODES];
+    uint32_t started;
+    bool open;
+    uint32_t triggerCounts[4];
+
+    static uint8_t typeSlot(uint8_t type) {
+        return type == EPISODE_BRADYCARDIA ? 0 : type == EPISODE_TACHYCARDIA ? 1 : type == EPISODE_PAUSE ? 2 : 3;
+    }
+
+    uint16_t rrAt(uint8_t back) const {
+        return rrs[(rrHead + IRREGULAR_BEATS - 1 - back) % IRREGULAR_BEATS];
+    }
+
+    // Media de los últimos RATE_BEATS RR, en lpm (0 si aún no hay tantos)
+    float rateBpm() const {
+        if (rrCount < RATE_BEATS) return 0.0f;
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < RATE_BEATS; i++) sum += rrAt(i);
+        return sum ? 60000.0f * RATE_BEATS / sum : 0.0f;
+    }
+
+    uint8_t irregularDiffs() const {
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < IRREGULAR_BEATS; i++) sum += rrs[i];
+        // |ΔRR| * 100 * n > PERCENT * suma, sin dividir
+        uint8_t n = 0;
+        for (uint8_t i = 0; i + 1 < IRREGULAR_BEATS; i++) {
+            int32_t d = (int32_t)rrAt(i) - rrAt(i + 1);
+            if (d < 0) d = -d;
+            if ((uint32_t)d * 100UL * IRREGULAR_BEATS > (uint32_t)IRREGULAR_PERCENT * sum) n++;
+        }
+        return n;
+    }
+
+    void trigger(uint8_t type, uint32_t at, float bpm) {
+        triggerCounts[typeSlot(type)]++;
+        if (open) {
+            recent[(started - 1) % RECENT_EPISODES].types |= type;
+            return;
+        }
+        CaptureEpisode& e = recent[started % RECENT_EPISODES];
+        uint32_t first = at > PreSamples ? at - PreSamples : 0;
+        if (first < history.oldestIndex()) first = history.oldestIndex();
+        // Sin solaparse con el anterior
+        if (started > 0) {
+            uint32_t previousEnd = recent[(started - 1) % RECENT_EPISODES].endSample;
+            if (first < previousEnd) first = previousEnd;
+        }
+        e.id = started;
+        e.firstSample = first;
+        e.triggerSample = at;
+        e.endSample = at + PostSamples;
+        e.trigger = type;
+        e.types = type;
+        e.bpm = bpm;
+        started++;
+        open = true;
+    }
+};
+
+#endif // EVENT_CAPTURE_H
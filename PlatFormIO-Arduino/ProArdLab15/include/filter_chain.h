@@ -0,0 +1,455 @@
+/**
+ * @file filter_chain.h
+ * @brief Cadena de filtros configurable en tiempo de compilación (etapas IIR/FIR con coeficientes constexpr)
+ *
+ * FilterChain<T, Etapa1, Etapa2, ...> encadena etapas sin funciones
+ * virtuales: process() de cada etapa es inline y el compilador funde la
+ * cadena completa en un solo bucle. Los coeficientes se calculan constexpr
+ * a partir de la frecuencia de muestreo y de las frecuencias de corte
+ * (en mHz, porque C++11 no admite float como parámetro de plantilla).
+ *
+ * T elige la aritmética de todas las etapas:
+ *   - float: referencia, y ruta de ECG_FIXED_POINT=0
+ *   - int16_t: coma fija en cuentas ADC, con estado interno de 32 bits
+ *     (solo sumas, productos de 32 bits y desplazamientos: apta para AVR)
+ *
+ * Etapas disponibles:
+ *   - DCBlocker<T, fs, fc>: paso-alto de un polo, y = x - dc
+ *   - MovingAverage<T, N>: media de las N últimas muestras (FIR rectangular)
+ *   Las dos tienen la aritmética en su forma de banco (DCBlockerBank,
+ *   MovingAverageBank; Etapa::Bank<canales>): varios canales muestreados a
+ *   la vez con el estado en estructura de arrays. La etapa es el banco de
+ *   un canal, así que las dos formas no pueden dar resultados distintos.
+ *   - FIRFilter<T, h0, h1, ...>: FIR con coeficientes en Q15
+ *   - Biquad<T, tipo, fs, fc, Q>: paso-bajo, paso-alto, paso-banda o
+ *     notch (fórmulas RBJ). En coma fija los coeficientes van en Q14 con
+ *     realimentación del error de redondeo; por debajo de ~fs/500 los
+ *     polos quedan demasiado cerca de 1 para Q14: usar DCBlocker.
+ *
+ * reset(x) deja cada etapa como si la entrada hubiera valido siempre x y
+ * devuelve su salida en ese estado, que es lo que recibe la siguiente.
+ * No depende de Arduino.h: la comparten los entornos uno, esp32dev y native.
+ */
+
+#ifndef FILTER_CHAIN_H
+#define FILTER_CHAIN_H
+
+#include <stdint.h>
+
+// ---------------------------------------------------------------------------
+// Matemática constexpr (C++11: una sola expresión por función)
+
+constexpr double FILTER_PI = 3.14159265358979323846;
+
+constexpr double filterSinTerms(double x2, double term, int k) {
+    return k > 20 ? 0.0 : term + filterSinTerms(x2, -term * x2 / ((2 * k + 2) * (2 * k + 3)), k + 1);
+}
+
+constexpr double filterCosTerms(double x2, double term, int k) {
+    return k > 20 ? 0.0 : term + filterCosTerms(x2, -term * x2 / ((2 * k + 1) * (2 * k + 2)), k + 1);
+}
+
+constexpr double filterExpTerms(double x, double term, int k) {
+    return k > 30 ? 0.0 : term + filterExpTerms(x, term * x / (k + 1), k + 1);
+}
+
+// Series de Taylor, exactas en double para |x| <= pi (las frecuencias
+// normalizadas de un filtro nunca pasan de Nyquist)
+constexpr double filterSin(double x) { return filterSinTerms(x * x, x, 0); }
+constexpr double filterCos(double x) { return filterCosTerms(x * x, 1.0, 0); }
+constexpr double filterExp(double x) { return filterExpTerms(x, 1.0, 0); }
+
+constexpr int32_t filterRound(double x) { return (int32_t)(x < 0 ? x - 0.5 : x + 0.5); }
+
+// Pulsación normalizada w0 = 2·pi·fc/fs, con fc en mHz
+constexpr double filterOmega(uint32_t rateHz, uint32_t cornerMilliHz) {
+    return 2.0 * FILTER_PI * (cornerMilliHz / 1000.0) / rateHz;
+}
+
+static inline int16_t filterSaturate16(int32_t v) {
+    return v > 32767 ? (int16_t)32767 : (v < -32768 ? (int16_t)-32768 : (int16_t)v);
+}
+
+// ---------------------------------------------------------------------------
+// Paso-alto de un polo: dc += (x - dc)·(1 - alpha), y = x - dc
+
+template <typename T, uint32_t RateHz, uint32_t CornerMilliHz, uint8_t Channels>
+class DCBlockerBank;
+
+template <uint32_t RateHz, uint32_t CornerMilliHz, uint8_t Channels>
+class DCBlockerBank<float, RateHz, CornerMilliHz, Channels> {
+public:
+    typedef float Value;
+    static constexpr float ALPHA = (float)filterExp(-filterOmega(RateHz, CornerMilliHz));
+
+    float reset(uint8_t ch, float initial) {
+        dc[ch] = initial;
+        return 0;
+    }
+
+    void process(const float* x, float* y) {
+        for (uint8_t c = 0; c < Channels; c++) {
+            dc[c] = ALPHA * dc[c] + (1.0f - ALPHA) * x[c];
+            y[c] = x[c] - dc[c];
+        }
+    }
+
+private:
+    float dc[Channels];
+};
+
+/**
+ * dc en Q12 y (1 - alpha) en Q14: con entradas de hasta 12 bits el
+ * producto cabe en int32_t. La salida se trunca hacia cero.
+ */
+template <uint32_t RateHz, uint32_t CornerMilliHz, uint8_t Channels>
+class DCBlockerBank<int16_t, RateHz, CornerMilliHz, Channels> {
+public:
+    typedef int16_t Value;
+    static constexpr int STATE_SHIFT = 12;
+    static constexpr int COEF_SHIFT = 14;
+    static constexpr int32_t COEF_Q14 =
+        filterRound((1.0 - filterExp(-filterOmega(RateHz, CornerMilliHz))) * (1L << COEF_SHIFT));
+    static_assert(COEF_Q14 > 0, "frecuencia de corte demasiado baja para Q14");
+
+    int16_t reset(uint8_t ch, int16_t initial) {
+        dcAcc[ch] = (int32_t)initial << STATE_SHIFT;
+        return 0;
+    }
+
+    void process(const int16_t* in, int16_t* y) {
+        for (uint8_t c = 0; c < Channels; c++) {
+            int32_t x = (int32_t)in[c] << STATE_SHIFT;
+            dcAcc[c] += ((x - dcAcc[c]) * COEF_Q14 + (1L << (COEF_SHIFT - 1))) >> COEF_SHIFT;
+            int32_t yQ = x - dcAcc[c];
+            y[c] = (int16_t)(yQ >= 0 ? (yQ >> STATE_SHIFT) : -((-yQ) >> STATE_SHIFT));
+        }
+    }
+
+private:
+    int32_t dcAcc[Channels];
+};
+
+template <typename T, uint32_t RateHz, uint32_t CornerMilliHz>
+class DCBlocker {
+public:
+    typedef T Value;
+    template <uint8_t Channels> using Bank = DCBlockerBank<T, RateHz, CornerMilliHz, Channels>;
+
+    T reset(T initial) {
+        y = bank.reset(0, initial);
+        return y;
+    }
+
+    T process(T x) {
+        bank.process(&x, &y);
+        return y;
+    }
+
+    T last() const { return y; }
+
+private:
+    Bank<1> bank;
+    T y;
+};
+
+// ---------------------------------------------------------------------------
+// Media móvil de Length muestras
+
+template <typename T, uint8_t Length, uint8_t Channels>
+class MovingAverageBank;
+
+/**
+ * La suma se rehace en cada muestra, de la más antigua a la más reciente:
+ * una suma acumulada en float derivaría, y el orden fijo hace que el
+ * resultado no dependa de la posición del índice, que es común a todos los
+ * canales aunque cada uno se reinicie en un momento distinto.
+ */
+template <uint8_t Length, uint8_t Channels>
+class MovingAverageBank<float, Length, Channels> {
+public:
+    typedef float Value;
+
+    MovingAverageBank() : index(0) {}
+
+    float reset(uint8_t ch, float initial) {
+        for (uint8_t i = 0; i < Length; i++) buffer[i][ch] = initial;
+        return initial;
+    }
+
+    void process(const float* x, float* y) {
+        float* column = buffer[index];
+        for (uint8_t c = 0; c < Channels; c++) column[c] = x[c];
+        if (++index == Length) index = 0;
+
+        float sum[Channels];
+        for (uint8_t c = 0; c < Channels; c++) sum[c] = 0;
+        uint8_t k = index;
+        for (uint8_t i = 0; i < Length; i++) {
+            for (uint8_t c = 0; c < Channels; c++) sum[c] += buffer[k][c];
+            k = k + 1 == Length ? 0 : k + 1;
+        }
+        for (uint8_t c = 0; c < Channels; c++) y[c] = sum[c] / Length;
+    }
+
+    // Última entrada del canal
+    float lastInput(uint8_t ch) const { return buffer[index == 0 ? Length - 1 : index - 1][ch]; }
+
+private:
+    float buffer[Length][Channels];
+    uint8_t index;
+};
+
+// Suma exacta en 32 bits y 1/Length en Q16 en lugar de la división
+template <uint8_t Length, uint8_t Channels>
+class MovingAverageBank<int16_t, Length, Channels> {
+public:
+    typedef int16_t Value;
+    static constexpr int32_t RECIP_Q16 = (int32_t)(65536L / Length);
+
+    MovingAverageBank() : index(0) {}
+
+    int16_t reset(uint8_t ch, int16_t initial) {
+        for (uint8_t i = 0; i < Length; i++) buffer[i][ch] = initial;
+        sum[ch] = (int32_t)initial * Length;
+        return initial;
+    }
+
+    void process(const int16_t* x, int16_t* y) {
+        int16_t* column = buffer[index];
+        for (uint8_t c = 0; c < Channels; c++) {
+            sum[c] += x[c] - column[c];
+            column[c] = x[c];
+            y[c] = (int16_t)((sum[c] * RECIP_Q16 + 0x8000L) >> 16);
+        }
+        if (++index == Length) index = 0;
+    }
+
+    int16_t lastInput(uint8_t ch) const { return buffer[index == 0 ? Length - 1 : index - 1][ch]; }
+
+private:
+    int16_t buffer[Length][Channels];
+    int32_t sum[Channels];
+    uint8_t index;
+};
+
+template <typename T, uint8_t Length>
+class MovingAverage {
+public:
+    typedef T Value;
+    template <uint8_t Channels> using Bank = MovingAverageBank<T, Length, Channels>;
+
+    T reset(T initial) {
+        y = bank.reset(0, initial);
+        return y;
+    }
+
+    T process(T x) {
+        bank.process(&x, &y);
+        return y;
+    }
+
+    T last() const { return y; }
+
+private:
+    Bank<1> bank;
+    T y;
+};
+
+// ---------------------------------------------------------------------------
+// FIR con coeficientes en Q15 (32768 = 1.0)
+
+template <typename T, int16_t... TapsQ15>
+class FIRFilter {
+public:
+    typedef T Value;
+    static constexpr uint8_t LENGTH = sizeof...(TapsQ15);
+    static_assert(LENGTH > 0, "el FIR necesita al menos un coeficiente");
+
+    FIRFilter() : taps{TapsQ15...} {}
+
+    T reset(T initial) {
+        for (uint8_t i = 0; i < LENGTH; i++) history[i] = initial;
+        index = 0;
+        y = process(initial);
+        return y;
+    }
+
+    T process(T x) {
+        history[index] = x;
+        Acc acc = 0;
+        uint8_t k = index;
+        for (uint8_t i = 0; i < LENGTH; i++) {
+            acc += (Acc)taps[i] * history[k];
+            k = k == 0 ? LENGTH - 1 : k - 1;
+        }
+        if (++index == LENGTH) index = 0;
+        y = scale(acc);
+        return y;
+    }
+
+    T last() const { return y; }
+
+private:
+    // float en la ruta float, int32_t en coma fija
+    typedef decltype((T)0 * (int32_t)0) Acc;
+
+    int16_t taps[LENGTH];
+    T history[LENGTH];
+    uint8_t index;
+    T y;
+
+    static float scale(float acc) { return acc / 32768.0f; }
+    static int16_t scale(int32_t acc) { return filterSaturate16((acc + 0x4000) >> 15); }
+};
+
+// ---------------------------------------------------------------------------
+// Biquad (fórmulas RBJ del "Audio EQ Cookbook")
+
+enum BiquadType { BIQUAD_LOWPASS, BIQUAD_HIGHPASS, BIQUAD_BANDPASS, BIQUAD_NOTCH };
+
+// Coeficientes normalizados por a0, en double para el cálculo constexpr
+struct BiquadCoefficients {
+    double b0, b1, b2, a1, a2;
+
+    constexpr BiquadCoefficients(double b0, double b1, double b2, double a1, double a2)
+        : b0(b0), b1(b1), b2(b2), a1(a1), a2(a2) {}
+
+    // Ganancia en continua: salida estable para una entrada constante
+    constexpr double dcGain() const { return (b0 + b1 + b2) / (1.0 + a1 + a2); }
+};
+
+constexpr BiquadCoefficients biquadNormalize(double b0, double b1, double b2, double a0, double a1, double a2) {
+    return BiquadCoefficients(b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0);
+}
+
+constexpr BiquadCoefficients biquadFromTrig(BiquadType type, double cosW, double alpha) {
+    return type == BIQUAD_LOWPASS
+               ? biquadNormalize((1 - cosW) / 2, 1 - cosW, (1 - cosW) / 2, 1 + alpha, -2 * cosW, 1 - alpha)
+           : type == BIQUAD_HIGHPASS
+               ? biquadNormalize((1 + cosW) / 2, -(1 + cosW), (1 + cosW) / 2, 1 + alpha, -2 * cosW, 1 - alpha)
+           : type == BIQUAD_BANDPASS
+               ? biquadNormalize(alpha, 0, -alpha, 1 + alpha, -2 * cosW, 1 - alpha)
+               : biquadNormalize(1, -2 * cosW, 1, 1 + alpha, -2 * cosW, 1 - alpha);
+}
+
+constexpr BiquadCoefficients biquadDesign(BiquadType type, uint32_t rateHz, uint32_t cornerMilliHz, uint32_t qMilli) {
+    return biquadFromTrig(type, filterCos(filterOmega(rateHz, cornerMilliHz)),
+                          filterSin(filterOmega(rateHz, cornerMilliHz)) / (2.0 * qMilli / 1000.0));
+}
+
+template <typename T, BiquadType Type, uint32_t RateHz, uint32_t CornerMilliHz, uint32_t QMilli = 707>
+class Biquad;
+
+// Forma directa II transpuesta
+template <BiquadType Type, uint32_t RateHz, uint32_t CornerMilliHz, uint32_t QMilli>
+class Biquad<float, Type, RateHz, CornerMilliHz, QMilli> {
+public:
+    typedef float Value;
+    static_assert(CornerMilliHz < RateHz * 500UL, "la frecuencia de corte debe estar por debajo de Nyquist");
+    static constexpr BiquadCoefficients C = biquadDesign(Type, RateHz, CornerMilliHz, QMilli);
+    static constexpr float B0 = (float)C.b0, B1 = (float)C.b1, B2 = (float)C.b2;
+    static constexpr float A1 = (float)C.a1, A2 = (float)C.a2;
+    static constexpr float DC_GAIN = (float)C.dcGain();
+
+    float reset(float initial) {
+        y = initial * DC_GAIN;
+        // Estado estacionario: s1 = y - b0·x, s2 = b2·x - a2·y
+        s1 = y - B0 * initial;
+        s2 = B2 * initial - A2 * y;
+        return y;
+    }
+
+    float process(float x) {
+        y = B0 * x + s1;
+        s1 = B1 * x - A1 * y + s2;
+        s2 = B2 * x - A2 * y;
+        return y;
+    }
+
+    float last() const { return y; }
+
+private:
+    float s1, s2;
+    float y;
+};
+
+/**
+ * Forma directa I con coeficientes en Q14 y realimentación del error de
+ * redondeo (el resto del desplazamiento entra en la muestra siguiente), que
+ * evita ciclos límite con polos cercanos a 1. Entradas de hasta ±8192
+ * cuentas: cinco productos de 15 bits por 14 bits caben en int32_t.
+ */
+template <BiquadType Type, uint32_t RateHz, uint32_t CornerMilliHz, uint32_t QMilli>
+class Biquad<int16_t, Type, RateHz, CornerMilliHz, QMilli> {
+public:
+    typedef int16_t Value;
+    static_assert(CornerMilliHz < RateHz * 500UL, "la frecuencia de corte debe estar por debajo de Nyquist");
+    static constexpr int SHIFT = 14;
+    static constexpr BiquadCoefficients C = biquadDesign(Type, RateHz, CornerMilliHz, QMilli);
+    static constexpr int32_t B0 = filterRound(C.b0 * (1L << SHIFT));
+    static constexpr int32_t B1 = filterRound(C.b1 * (1L << SHIFT));
+    static constexpr int32_t B2 = filterRound(C.b2 * (1L << SHIFT));
+    static constexpr int32_t A1 = filterRound(C.a1 * (1L << SHIFT));
+    static constexpr int32_t A2 = filterRound(C.a2 * (1L << SHIFT));
+    static constexpr int32_t DC_GAIN_Q14 = filterRound(C.dcGain() * (1L << SHIFT));
+
+    int16_t reset(int16_t initial) {
+        x1 = x2 = initial;
+        y1 = y2 = filterSaturate16(((int32_t)initial * DC_GAIN_Q14 + (1L << (SHIFT - 1))) >> SHIFT);
+        err = 0;
+        return y1;
+    }
+
+    int16_t process(int16_t x) {
+        int32_t acc = B0 * x + B1 * x1 + B2 * x2 - A1 * y1 - A2 * y2 + err;
+        int32_t y = acc >> SHIFT;
+        err = acc - (y << SHIFT);
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = filterSaturate16(y);
+        return y1;
+    }
+
+    int16_t last() const { return y1; }
+
+private:
+    int16_t x1, x2;
+    int16_t y1, y2;
+    int32_t err;
+};
+
+// ---------------------------------------------------------------------------
+// Cadena
+
+template <typename T, typename... Stages>
+class FilterChain;
+
+template <typename T>
+class FilterChain<T> {
+public:
+    typedef T Value;
+    T reset(T initial) { return initial; }
+    T process(T x) { return x; }
+};
+
+template <typename T, typename First, typename... Rest>
+class FilterChain<T, First, Rest...> {
+public:
+    typedef T Value;
+    static_assert(sizeof(typename First::Value) == sizeof(T), "todas las etapas usan la misma aritmética");
+
+    T reset(T initial) { return rest.reset(first.reset(initial)); }
+    T process(T x) { return rest.process(first.process(x)); }
+
+    // Acceso a las etapas: chain.head() es la primera, chain.tail() el resto
+    const First& head() const { return first; }
+    const FilterChain<T, Rest...>& tail() const { return rest; }
+
+private:
+    First first;
+    FilterChain<T, Rest...> rest;
+};
+
+#endif // FILTER_CHAIN_H
@@ -0,0 +1,179 @@
+/**
+ * @file hd44780_i2c.h
+ * @brief Driver HD44780 sobre PCF8574 (backpack I2C) con escrituras por lotes
+ *
+ * LiquidCrystal_I2C hace una transmisión Wire por cada cambio de pines
+ * (6 por carácter) y espera 50 us por nibble. Este driver acumula la
+ * secuencia de nibbles y flancos de EN en un buffer y la envía en una sola
+ * transmisión de hasta BatchSize bytes:
+ *   - 2 bytes PCF8574 por nibble (EN alto, EN bajo), 4 por carácter.
+ *   - Sin esperas entre caracteres: a 400 kHz cada byte del bus dura 22.5 us,
+ *     así que entre dos flancos de bajada de EN pasan 45 us, más que los
+ *     37 us que necesita el HD44780 para ejecutar un comando o dato.
+ *     Por eso el reloj del bus no debe superar 400 kHz.
+ *   - clear() y home() (1.52 ms) sí esperan explícitamente.
+ *
+ * WireT es cualquier clase con beginTransmission(addr), write(buf, len) y
+ * endTransmission(): TwoWire en el ESP32 o el bus simulado del entorno native.
+ * Las escrituras quedan pendientes hasta flush() (o hasta llenar el lote).
+ */
+
+#ifndef HD44780_I2C_H
+#define HD44780_I2C_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+// En el host las define el HAL simulado del entorno native
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+#endif
+
+template <typename WireT, size_t BatchSize = 32>
+class HD44780I2C {
+public:
+    // Conexiones del backpack PCF8574 habitual: P0..P3 control, P4..P7 = D4..D7
+    static const uint8_t PIN_RS = 0x01;
+    static const uint8_t PIN_RW = 0x02;
+    static const uint8_t PIN_EN = 0x04;
+    static const uint8_t PIN_BACKLIGHT = 0x08;
+
+    HD44780I2C(WireT& wire, uint8_t addr, uint8_t cols, uint8_t rows)
+        : wire(wire), addr(addr), cols(cols), rows(rows),
+          backlightBit(PIN_BACKLIGHT), lastMode(0xFF), batchLen(0),
+          transactionCount(0), byteCount(0) {}
+
+    void setAddress(uint8_t address) { addr = address; }
+
+    void init() {
+        delay(50); // > 40 ms tras el encendido
+
+        // Secuencia de inicialización por software en modo 8 bits -> 4 bits
+        writeRaw(backlightBit);
+        flush();
+        pushNibble(0x30, 0);
+        flush();
+        delayMicroseconds(4500);
+        pushNibble(0x30, 0);
+        flush();
+        delayMicroseconds(4500);
+        pushNibble(0x30, 0);
+        flush();
+        delayMicroseconds(150);
+        pushNibble(0x20, 0);
+        flush();
+        delayMicroseconds(150);
+
+        command(0x20 | (rows > 1 ? 0x08 : 0x00)); // 4 bits, 2 líneas, 5x8
+        command(0x0C);                           // display on, sin cursor
+        clear();
+        command(0x06);                           // autoincremento, sin desplazamiento
+        flush();
+    }
+
+    void backlight() {
+        backlightBit = PIN_BACKLIGHT;
+        writeRaw(backlightBit);
+        flush();
+    }
+
+    void noBacklight() {
+        backlightBit = 0;
+        writeRaw(backlightBit);
+        flush();
+    }
+
+    void clear() {
+        command(0x01);
+        flush();
+        delayMicroseconds(2000);
+    }
+
+    void home() {
+        command(0x02);
+        flush();
+        delayMicroseconds(2000);
+    }
+
+    // Deja el contador de direcciones en la CGRAM: hay que llamar a setCursor()
+    void createChar(uint8_t location, const uint8_t charmap[8]) {
+        command(0x40 | ((location & 0x07) << 3));
+        for (uint8_t i = 0; i < 8; i++) {
+            send(charmap[i], PIN_RS);
+        }
+        flush();
+    }
+
+    void setCursor(uint8_t col, uint8_t row) {
+        if (row >= rows) row = rows - 1;
+        const uint8_t rowOffsets[4] = {0x00, 0x40, cols, (uint8_t)(0x40 + cols)};
+        command(0x80 | (uint8_t)(rowOffsets[row & 0x03] + col));
+    }
+
+    size_t write(uint8_t value) {
+        send(value, PIN_RS);
+        return 1;
+    }
+
+    size_t print(const char* text) {
+        size_t n = 0;
+        while (*text) n += write((uint8_t)*text++);
+        return n;
+    }
+
+    // Envía el lote pendiente en una sola transmisión I2C
+    void flush() {
+        if (batchLen == 0) return;
+        wire.beginTransmission(addr);
+        wire.write(batch, batchLen);
+        wire.endTransmission();
+        transactionCount++;
+        byteCount += batchLen;
+        batchLen = 0;
+    }
+
+    // Estadísticas de bus (sin contar el byte de dirección)
+    uint32_t transactions() const { return transactionCount; }
+    uint32_t bytesSent() const { return byteCount; }
+
+private:
+    WireT& wire;
+    uint8_t addr;
+    uint8_t cols;
+    uint8_t rows;
+    uint8_t backlightBit;
+    uint8_t lastMode;
+    uint8_t batch[BatchSize];
+    size_t batchLen;
+    uint32_t transactionCount;
+    uint32_t byteCount;
+
+    void command(uint8_t value) { send(value, 0); }
+
+    void send(uint8_t value, uint8_t mode) {
+        // RS debe estar estable antes del flanco de subida de EN
+        if (mode != lastMode) {
+            writeRaw(mode | backlightBit);
+            lastMode = mode;
+        }
+        pushNibble(value & 0xF0, mode);
+        pushNibble((uint8_t)(value << 4), mode);
+    }
+
+    // El HD44780 captura D4..D7 en el flanco de bajada de EN
+    void pushNibble(uint8_t nibble, uint8_t mode) {
+        uint8_t bits = (nibble & 0xF0) | mode | backlightBit;
+        writeRaw(bits | PIN_EN);
+        writeRaw(bits);
+    }
+
+    void writeRaw(uint8_t value) {
+        if (batchLen == BatchSize) flush();
+        batch[batchLen++] = value;
+    }
+};
+
+#endif // HD44780_I2C_H
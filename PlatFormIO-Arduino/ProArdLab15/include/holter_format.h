@@ -0,0 +1,304 @@
+/**
+ * @file holter_format.h
+ * @brief Formato en flash del registro Holter: bloques comprimidos y segmentos
+ *
+ * Bloque (1 s de muestras crudas del ADC), little endian:
+ *
+ *   u16 sync        HOLTER_BLOCK_SYNC
+ *   u16 n           número de muestras (<= HOLTER_BLOCK_SAMPLES)
+ *   u32 first       índice global de la primera muestra
+ *   u8  flags       bit0 = electrodos desconectados en algún momento del bloque
+ *   u8  params      bits 0-3 = k de Rice (15 = sin comprimir), bit 4 = predictor de 2º orden
+ *   i16 x0          primera muestra en claro
+ *   u16 len         bytes de payload
+ *   ... payload     residuos de x1..x(n-1) con código de Rice
+ *   u16 CRC         CRC-16/CCITT de todo lo anterior (el de ecg_stream.h)
+ *
+ * Los residuos son la diferencia con la muestra anterior (1er orden) o con
+ * la extrapolación lineal 2·x[i-1] - x[i-2] (2º orden), en zigzag y con
+ * código de Rice de parámetro k. El codificador prueba los dos predictores
+ * y todos los k y se queda con el más corto; si no mejora las muestras en
+ * claro (p. ej. electrodos sueltos) guarda el bloque sin comprimir.
+ * Un cociente de HOLTER_RICE_ESCAPE unos seguido del residuo en
+ * HOLTER_ESCAPE_BITS bits acota el coste de los saltos grandes.
+ *
+ * Segmento (un fichero): cabecera de HOLTER_SEGMENT_HEADER bytes, hasta
+ * HOLTER_SEGMENT_BLOCKS bloques y, al cerrarlo, un índice de tiempo con
+ * (first u32, offset u32) por bloque más (count u32, HOLTER_INDEX_MAGIC u32).
+ * Un segmento sin índice (corte de alimentación) se lee recorriendo los
+ * bloques hasta el primero incompleto.
+ */
+
+#ifndef HOLTER_FORMAT_H
+#define HOLTER_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ecg_stream.h"
+
+constexpr uint16_t HOLTER_BLOCK_SAMPLES = 250;   // 1 s a 250 Hz
+constexpr uint16_t HOLTER_SEGMENT_BLOCKS = 120;  // 2 min por segmento
+constexpr uint16_t HOLTER_BLOCK_SYNC = 0x4B42;   // "BK"
+constexpr uint32_t HOLTER_SEGMENT_MAGIC = 0x48474345; // "ECGH"
+constexpr uint32_t HOLTER_INDEX_MAGIC = 0x58444945;   // "EIDX"
+constexpr uint8_t HOLTER_FORMAT_VERSION = 1;
+
+constexpr uint8_t HOLTER_FLAG_LEADS_OFF = 0x01;
+constexpr uint8_t HOLTER_SEGMENT_FLAG_NEW_SESSION = 0x01; // primer segmento tras begin()
+constexpr uint8_t HOLTER_VERBATIM = 0x0F;
+constexpr uint8_t HOLTER_ORDER2 = 0x10;
+constexpr uint8_t HOLTER_RICE_ESCAPE = 24;
+constexpr uint8_t HOLTER_ESCAPE_BITS = 20;
+
+constexpr size_t HOLTER_BLOCK_HEADER = 14;
+constexpr size_t HOLTER_MAX_PAYLOAD = (HOLTER_BLOCK_SAMPLES - 1) * 2;
+constexpr size_t HOLTER_MAX_RECORD = HOLTER_BLOCK_HEADER + HOLTER_MAX_PAYLOAD + 2;
+constexpr size_t HOLTER_SEGMENT_HEADER = 16;
+constexpr size_t HOLTER_INDEX_ENTRY = 8;
+constexpr size_t HOLTER_INDEX_TRAILER = 8;
+constexpr size_t HOLTER_MAX_INDEX = HOLTER_SEGMENT_BLOCKS * HOLTER_INDEX_ENTRY + HOLTER_INDEX_TRAILER;
+
+inline void holterPut16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+inline void holterPut32(uint8_t* p, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+inline uint16_t holterGet16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+inline uint32_t holterGet32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Cabecera de segmento: magic, versión, flags, frecuencia, id, primera muestra
+struct HolterSegmentHeader {
+    uint8_t flags;
+    uint16_t rateHz;
+    uint32_t id;
+    uint32_t startIndex;
+};
+
+inline void holterWriteSegmentHeader(uint8_t* out, const HolterSegmentHeader& h) {
+    holterPut32(out, HOLTER_SEGMENT_MAGIC);
+    out[4] = HOLTER_FORMAT_VERSION;
+    out[5] = h.flags;
+    holterPut16(out + 6, h.rateHz);
+    holterPut32(out + 8, h.id);
+    holterPut32(out + 12, h.startIndex);
+}
+
+inline bool holterParseSegmentHeader(const uint8_t* in, HolterSegmentHeader& h) {
+    if (holterGet32(in) != HOLTER_SEGMENT_MAGIC || in[4] != HOLTER_FORMAT_VERSION) return false;
+    h.flags = in[5];
+    h.rateHz = holterGet16(in + 6);
+    h.id = holterGet32(in + 8);
+    h.startIndex = holterGet32(in + 12);
+    return true;
+}
+
+// Escritor de bits MSB primero sobre un buffer de tamaño fijo
+class HolterBitWriter {
+public:
+    HolterBitWriter(uint8_t* out, size_t capacity)
+        : out(out), capacity(capacity), pos(0), acc(0), bits(0), overflow(false) {}
+
+    // n <= 24
+    void put(uint32_t value, uint8_t n) {
+        acc = (acc << n) | (value & ((1UL << n) - 1));
+        bits += n;
+        while (bits >= 8) {
+            bits -= 8;
+            emit((uint8_t)(acc >> bits));
+        }
+    }
+
+    void putRice(uint32_t zz, uint8_t k) {
+        uint32_t q = zz >> k;
+        if (q >= HOLTER_RICE_ESCAPE) {
+            put((1UL << HOLTER_RICE_ESCAPE) - 1, HOLTER_RICE_ESCAPE);
+            put(zz, HOLTER_ESCAPE_BITS);
+            return;
+        }
+        put(((1UL << q) - 1) << 1, (uint8_t)(q + 1)); // q unos y un cero
+        if (k) put(zz, k);
+    }
+
+    // Completa el último byte con ceros; devuelve los bytes escritos
+    size_t finish() {
+        if (bits) put(0, 8 - bits);
+        return pos;
+    }
+
+    bool overflowed() const { return overflow; }
+
+private:
+    uint8_t* out;
+    size_t capacity;
+    size_t pos;
+    uint32_t acc;
+    uint8_t bits;
+    bool overflow;
+
+    void emit(uint8_t b) {
+        if (pos < capacity) out[pos++] = b;
+        else overflow = true;
+    }
+};
+
+class HolterBitReader {
+public:
+    HolterBitReader(const uint8_t* in, size_t len) : in(in), len(len), pos(0), bit(0) {}
+
+    bool get(uint8_t n, uint32_t& value) {
+        value = 0;
+        while (n--) {
+            if (pos >= len) return false;
+            value = (value << 1) | ((in[pos] >> (7 - bit)) & 1);
+            if (++bit == 8) {
+                bit = 0;
+                pos++;
+            }
+        }
+        return true;
+    }
+
+    bool getRice(uint8_t k, uint32_t& zz) {
+        uint32_t q = 0;
+        uint32_t b;
+        while (q < HOLTER_RICE_ESCAPE) {
+            if (!get(1, b)) return false;
+            if (b == 0) break;
+            q++;
+        }
+        if (q == HOLTER_RICE_ESCAPE) return get(HOLTER_ESCAPE_BITS, zz);
+        uint32_t low = 0;
+        if (k && !get(k, low)) return false;
+        zz = (q << k) | low;
+        return true;
+    }
+
+private:
+    const uint8_t* in;
+    size_t len;
+    size_t pos;
+    uint8_t bit;
+};
+
+inline uint32_t holterZigzag(int32_t r) { return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31); }
+inline int32_t holterUnzigzag(uint32_t zz) { return (int32_t)(zz >> 1) ^ -(int32_t)(zz & 1); }
+
+inline int32_t holterResidual(const int16_t* x, uint16_t i, bool order2) {
+    if (order2 && i >= 2) return (int32_t)x[i] - 2 * (int32_t)x[i - 1] + x[i - 2];
+    return (int32_t)x[i] - x[i - 1];
+}
+
+/**
+ * Codifica n muestras (1..HOLTER_BLOCK_SAMPLES) en un registro completo.
+ * 'out' debe tener HOLTER_MAX_RECORD bytes. Devuelve los bytes del registro.
+ */
+inline size_t holterEncodeBlock(const int16_t* x, uint16_t n, uint32_t firstIndex, uint8_t flags,
+                                uint8_t* out) {
+    // Coste en bits de cada predictor y cada k (exacto, 2 x 15 combinaciones)
+    uint32_t best = 0xFFFFFFFFUL;
+    uint8_t bestParams = HOLTER_VERBATIM;
+    for (uint8_t order2 = 0; order2 < 2; order2++) {
+        uint32_t cost[HOLTER_VERBATIM] = {0};
+        for (uint16_t i = 1; i < n; i++) {
+            uint32_t zz = holterZigzag(holterResidual(x, i, order2));
+            for (uint8_t k = 0; k < HOLTER_VERBATIM; k++) {
+                uint32_t q = zz >> k;
+                cost[k] += q < HOLTER_RICE_ESCAPE ? q + 1 + k : HOLTER_RICE_ESCAPE + HOLTER_ESCAPE_BITS;
+            }
+        }
+        for (uint8_t k = 0; k < HOLTER_VERBATIM; k++) {
+            if (cost[k] < best) {
+                best = cost[k];
+                bestParams = (uint8_t)(k | (order2 ? HOLTER_ORDER2 : 0));
+            }
+        }
+    }
+
+    uint8_t* payload = out + HOLTER_BLOCK_HEADER;
+    size_t payloadLen;
+    if ((best + 7) / 8 >= (size_t)(n - 1) * 2) {
+        bestParams = HOLTER_VERBATIM;
+        for (uint16_t i = 1; i < n; i++) holterPut16(payload + 2 * (i - 1), (uint16_t)x[i]);
+        payloadLen = (size_t)(n - 1) * 2;
+    } else {
+        HolterBitWriter writer(payload, HOLTER_MAX_PAYLOAD);
+        const uint8_t k = bestParams & 0x0F;
+        const bool order2 = (bestParams & HOLTER_ORDER2) != 0;
+        for (uint16_t i = 1; i < n; i++) writer.putRice(holterZigzag(holterResidual(x, i, order2)), k);
+        payloadLen = writer.finish();
+    }
+
+    holterPut16(out, HOLTER_BLOCK_SYNC);
+    holterPut16(out + 2, n);
+    holterPut32(out + 4, firstIndex);
+    out[8] = flags;
+    out[9] = bestParams;
+    holterPut16(out + 10, (uint16_t)x[0]);
+    holterPut16(out + 12, (uint16_t)payloadLen);
+    size_t len = HOLTER_BLOCK_HEADER + payloadLen;
+    holterPut16(out + len, crc16Ccitt(out, len));
+    return len + 2;
+}
+
+struct HolterBlockInfo {
+    uint16_t count;
+    uint32_t firstIndex;
+    uint8_t flags;
+    uint8_t params;
+    uint16_t recordLen; // cabecera + payload + CRC
+};
+
+// Valida la cabecera (sin el CRC); 'in' debe tener HOLTER_BLOCK_HEADER bytes
+inline bool holterParseBlockHeader(const uint8_t* in, HolterBlockInfo& info) {
+    if (holterGet16(in) != HOLTER_BLOCK_SYNC) return false;
+    info.count = holterGet16(in + 2);
+    info.firstIndex = holterGet32(in + 4);
+    info.flags = in[8];
+    info.params = in[9];
+    uint16_t payloadLen = holterGet16(in + 12);
+    if (info.count == 0 || info.count > HOLTER_BLOCK_SAMPLES || payloadLen > HOLTER_MAX_PAYLOAD) return false;
+    info.recordLen = (uint16_t)(HOLTER_BLOCK_HEADER + payloadLen + 2);
+    return true;
+}
+
+/**
+ * Decodifica un registro completo (recordLen bytes) en 'x', que debe tener
+ * HOLTER_BLOCK_SAMPLES muestras. false si la cabecera o el CRC no cuadran.
+ */
+inline bool holterDecodeBlock(const uint8_t* in, size_t len, int16_t* x, HolterBlockInfo& info) {
+    if (len < HOLTER_BLOCK_HEADER + 2 || !holterParseBlockHeader(in, info) || len < info.recordLen) {
+        return false;
+    }
+    const size_t payloadLen = info.recordLen - HOLTER_BLOCK_HEADER - 2;
+    if (crc16Ccitt(in, HOLTER_BLOCK_HEADER + payloadLen) != holterGet16(in + HOLTER_BLOCK_HEADER + payloadLen)) {
+        return false;
+    }
+
+    const uint8_t* payload = in + HOLTER_BLOCK_HEADER;
+    x[0] = (int16_t)holterGet16(in + 10);
+    const uint8_t k = info.params & 0x0F;
+    if (k == HOLTER_VERBATIM) {
+        if (payloadLen != (size_t)(info.count - 1) * 2) return false;
+        for (uint16_t i = 1; i < info.count; i++) x[i] = (int16_t)holterGet16(payload + 2 * (i - 1));
+        return true;
+    }
+
+    const bool order2 = (info.params & HOLTER_ORDER2) != 0;
+    HolterBitReader reader(payload, payloadLen);
+    for (uint16_t i = 1; i < info.count; i++) {
+        uint32_t zz;
+        if (!reader.getRice(k, zz)) return false;
+        int32_t prediction = (order2 && i >= 2) ? 2 * (int32_t)x[i - 1] - x[i - 2] : x[i - 1];
+        x[i] = (int16_t)(prediction + holterUnzigzag(zz));
+    }
+    return true;
+}
+
+#endif // HOLTER_FORMAT_H
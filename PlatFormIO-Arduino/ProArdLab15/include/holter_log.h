@@ -0,0 +1,536 @@
+/**
+ * @file holter_log.h
+ * @brief Registro Holter continuo en flash: grabador y lector por segmentos
+ *
+ * HolterRecorder junta las muestras crudas en bloques de 1 s, los comprime
+ * (holter_format.h) y los deja en una cola de PENDING_BLOCKS bloques.
+ * service() escribe esa cola en la flash a trozos de WRITE_CHUNK bytes
+ * separados al menos WRITE_INTERVAL_MS: una escritura de LittleFS puede
+ * borrar un sector y parar la caché de la flash decenas de ms, así que se
+ * limita cuánto trabajo de flash hay por llamada. A 250 Hz se generan
+ * ~230 B/s frente a los ~5 kB/s que admite el límite, de modo que la cola
+ * se recupera enseguida tras un borrado lento. Si aun así se llena, el
+ * bloque se descarta (droppedBlocks) y queda un hueco en los índices.
+ * Cada bloque completo se sincroniza (HolterStorage::sync()): un corte de
+ * alimentación solo pierde el bloque a medio escribir y los de la cola.
+ *
+ * Cuando no queda sitio para otro segmento se borra el más antiguo: la
+ * flash guarda siempre las últimas horas de registro.
+ *
+ * HolterReader busca una muestra por su índice global en O(log n): búsqueda
+ * binaria entre segmentos (por la cabecera) y dentro del índice de tiempo
+ * del segmento.
+ */
+
+#ifndef HOLTER_LOG_H
+#define HOLTER_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "holter_format.h"
+#include "holter_storage.h"
+
+constexpr size_t HOLTER_MAX_SEGMENTS = 256;
+
+class HolterRecorder {
+public:
+    static const uint8_t PENDING_BLOCKS = 4;
+    static const uint16_t WRITE_CHUNK = 256;        // una página de flash
+    static const uint32_t WRITE_INTERVAL_MS = 50;   // -> 5.1 kB/s como máximo
+    // Hueco que se deja libre antes de abrir un segmento (peor caso)
+    static const uint32_t SEGMENT_RESERVE =
+        HOLTER_SEGMENT_HEADER + HOLTER_SEGMENT_BLOCKS * HOLTER_MAX_RECORD + HOLTER_MAX_INDEX;
+
+    HolterRecorder(HolterStorage& storage, uint16_t rateHz)
+        : storage(storage), rateHz(rateHz), nextIndex(0), blockCount(0), blockFlags(0),
+          head(0), tail(0), pendingCount(0), slotOffset(0), segmentOpen(false),
+          footerPending(false), footerLen(0), footerOffset(0), newSession(true),
+          lastWriteMs(0), wroteOnce(false), oldestId(0), nextId(0), segmentBlocks(0),
+          segmentBytes(0), droppedBlocks(0), writeErrors(0), bytesWritten(0), samplesRecorded(0) {}
+
+    /**
+     * Monta el almacenamiento y continúa tras el último segmento existente:
+     * el índice global sigue donde terminó la sesión anterior.
+     */
+    bool begin() {
+        if (!storage.begin()) return false;
+        uint32_t ids[HOLTER_MAX_SEGMENTS];
+        size_t count = storage.listSegments(ids, HOLTER_MAX_SEGMENTS);
+        if (count > 0) {
+            oldestId = ids[0];
+            nextId = ids[count - 1] + 1;
+            nextIndex = segmentEndIndex(ids[count - 1]);
+        }
+        newSession = true;
+        return true;
+    }
+
+    // Añade una muestra cruda del ADC. No escribe en la flash.
+    void push(int16_t raw, bool leadsOff) {
+        block[blockCount++] = raw;
+        if (leadsOff) blockFlags |= HOLTER_FLAG_LEADS_OFF;
+        if (blockCount == HOLTER_BLOCK_SAMPLES) finishBlock();
+    }
+
+    /**
+     * Escribe como mucho WRITE_CHUNK bytes si han pasado WRITE_INTERVAL_MS
+     * desde la última escritura. Llamar en cada vuelta de loop().
+     * @return bytes escritos en esta llamada
+     */
+    size_t service(uint32_t nowMs) {
+        if (pendingCount == 0 && !footerPending) return 0;
+        if (wroteOnce && nowMs - lastWriteMs < WRITE_INTERVAL_MS) return 0;
+        lastWriteMs = nowMs;
+        wroteOnce = true;
+        return writeChunk(WRITE_CHUNK);
+    }
+
+    /**
+     * Deja un hueco de 'samples' índices sin grabar (entre episodios de
+     * event_capture.h): cierra el bloque en curso y la siguiente muestra
+     * conserva su tiempo. HolterReader salta los huecos como los de un
+     * bloque descartado.
+     */
+    void skip(uint32_t samples) {
+        if (samples == 0) return;
+        if (blockCount > 0) finishBlock();
+        nextIndex += samples;
+    }
+
+    // Cierra el bloque en curso y vuelca todo, índice incluido (bloqueante)
+    void stop() {
+        if (blockCount > 0) finishBlock();
+        while (pendingCount > 0 || footerPending) writeChunk(0xFFFF);
+        if (segmentOpen) startFooter();
+        while (footerPending) writeChunk(0xFFFF);
+    }
+
+    uint32_t nextSampleIndex() const { return nextIndex; }
+    uint32_t getDroppedBlocks() const { return droppedBlocks; }
+    uint32_t getWriteErrors() const { return writeErrors; }
+    uint32_t getBytesWritten() const { return bytesWritten; }
+    uint32_t getSamplesRecorded() const { return samplesRecorded; }
+    uint8_t getPendingBlocks() const { return pendingCount; }
+
+private:
+    struct Slot {
+        uint8_t data[HOLTER_MAX_RECORD];
+        uint16_t len;
+        uint32_t firstIndex;
+    };
+
+    HolterStorage& storage;
+    uint16_t rateHz;
+
+    int16_t block[HOLTER_BLOCK_SAMPLES];
+    uint32_t nextIndex;   // índice global de la siguiente muestra
+    uint16_t blockCount;
+    uint8_t blockFlags;
+
+    Slot slots[PENDING_BLOCKS];
+    uint8_t head;
+    uint8_t tail;
+    uint8_t pendingCount;
+    uint16_t slotOffset;  // bytes ya escritos del bloque en tail
+
+    bool segmentOpen;
+    bool footerPending;
+    uint8_t footer[HOLTER_MAX_INDEX];
+    uint16_t footerLen;
+    uint16_t footerOffset;
+    bool newSession;
+
+    uint32_t lastWriteMs;
+    bool wroteOnce;
+    uint32_t oldestId;
+    uint32_t nextId;
+    uint16_t segmentBlocks;
+    uint32_t segmentBytes;
+
+    uint32_t droppedBlocks;
+    uint32_t writeErrors;
+    uint32_t bytesWritten;
+    uint32_t samplesRecorded;
+
+    void finishBlock() {
+        const uint32_t first = nextIndex;
+        nextIndex += blockCount;
+        if (pendingCount == PENDING_BLOCKS) {
+            droppedBlocks++;
+        } else {
+            Slot& slot = slots[head];
+            slot.len = (uint16_t)holterEncodeBlock(block, blockCount, first, blockFlags, slot.data);
+            slot.firstIndex = first;
+            head = (head + 1) % PENDING_BLOCKS;
+            pendingCount++;
+            samplesRecorded += blockCount;
+        }
+        blockCount = 0;
+        blockFlags = 0;
+    }
+
+    size_t writeChunk(size_t maxBytes) {
+        if (footerPending) {
+            size_t n = footerLen - footerOffset;
+            if (n > maxBytes) n = maxBytes;
+            size_t written = storage.append(footer + footerOffset, n);
+            bytesWritten += written;
+            footerOffset += written;
+            // Sin sitio para el índice: el lector recorrerá los bloques
+            if (written != n) writeErrors++;
+            if (written != n || footerOffset == footerLen) {
+                storage.closeSegment();
+                segmentOpen = false;
+                footerPending = false;
+            }
+            return written;
+        }
+
+        Slot& slot = slots[tail];
+        size_t extra = 0;
+        if (slotOffset == 0) {
+            if (!segmentOpen) {
+                if (!openSegment(slot.firstIndex)) {
+                    writeErrors++;
+                    releaseSlot();
+                    return 0;
+                }
+                extra = HOLTER_SEGMENT_HEADER;
+            }
+            holterPut32(footer + segmentBlocks * HOLTER_INDEX_ENTRY, slot.firstIndex);
+            holterPut32(footer + segmentBlocks * HOLTER_INDEX_ENTRY + 4, segmentBytes);
+        }
+
+        size_t n = slot.len - slotOffset;
+        if (n > maxBytes) n = maxBytes;
+        size_t written = storage.append(slot.data + slotOffset, n);
+        bytesWritten += written;
+        segmentBytes += written;
+        slotOffset += written;
+
+        if (written != n) {
+            // Flash llena o error: el bloque queda truncado, el lector se para
+            // ahí. Se cierra el segmento y el siguiente bloque abre otro.
+            writeErrors++;
+            storage.closeSegment();
+            segmentOpen = false;
+            releaseSlot();
+        } else if (slotOffset == slot.len) {
+            // Bloque completo: persistente aunque se corte la alimentación
+            storage.sync();
+            releaseSlot();
+            if (++segmentBlocks == HOLTER_SEGMENT_BLOCKS) startFooter();
+        }
+        return written + extra;
+    }
+
+    void releaseSlot() {
+        tail = (tail + 1) % PENDING_BLOCKS;
+        pendingCount--;
+        slotOffset = 0;
+    }
+
+    void startFooter() {
+        footerLen = (uint16_t)(segmentBlocks * HOLTER_INDEX_ENTRY);
+        holterPut32(footer + footerLen, segmentBlocks);
+        holterPut32(footer + footerLen + 4, HOLTER_INDEX_MAGIC);
+        footerLen += HOLTER_INDEX_TRAILER;
+        footerOffset = 0;
+        footerPending = true;
+    }
+
+    bool openSegment(uint32_t startIndex) {
+        // Libera los segmentos más antiguos hasta que quepa uno completo
+        while (storage.freeBytes() < SEGMENT_RESERVE && oldestId < nextId) {
+            storage.removeSegment(oldestId++);
+        }
+
+        const uint32_t id = nextId++;
+        if (!storage.createSegment(id)) return false;
+
+        HolterSegmentHeader h;
+        h.flags = newSession ? HOLTER_SEGMENT_FLAG_NEW_SESSION : 0;
+        h.rateHz = rateHz;
+        h.id = id;
+        h.startIndex = startIndex;
+        uint8_t header[HOLTER_SEGMENT_HEADER];
+        holterWriteSegmentHeader(header, h);
+        if (storage.append(header, sizeof(header)) != sizeof(header)) {
+            storage.closeSegment();
+            return false;
+        }
+
+        newSession = false;
+        segmentOpen = true;
+        segmentBlocks = 0;
+        segmentBytes = HOLTER_SEGMENT_HEADER;
+        bytesWritten += HOLTER_SEGMENT_HEADER;
+        return true;
+    }
+
+    // Índice siguiente a la última muestra legible del segmento
+    uint32_t segmentEndIndex(uint32_t id) {
+        uint8_t header[HOLTER_SEGMENT_HEADER];
+        HolterSegmentHeader h;
+        if (storage.readSegment(id, 0, header, sizeof(header)) != sizeof(header) ||
+            !holterParseSegmentHeader(header, h)) {
+            return 0;
+        }
+        uint32_t end = h.startIndex;
+        uint32_t offset = HOLTER_SEGMENT_HEADER;
+        const uint32_t size = storage.segmentSize(id);
+        uint8_t blockHeader[HOLTER_BLOCK_HEADER];
+        HolterBlockInfo info;
+        while (offset + HOLTER_BLOCK_HEADER <= size &&
+               storage.readSegment(id, offset, blockHeader, sizeof(blockHeader)) == sizeof(blockHeader) &&
+               holterParseBlockHeader(blockHeader, info) && offset + info.recordLen <= size) {
+            end = info.firstIndex + info.count;
+            offset += info.recordLen;
+        }
+        return end;
+    }
+};
+
+class HolterReader {
+public:
+    explicit HolterReader(HolterStorage& storage)
+        : storage(storage), segmentCount(0), loadedSegment(-1), indexCount(0),
+          blockSegment(0), blockIndex(0), blockSamples(0), blockPos(0), blockFirst(0),
+          crcErrors(0), unindexedSegments(0) {}
+
+    // Lista los segmentos y se coloca en la primera muestra disponible
+    bool open() {
+        segmentCount = storage.listSegments(segments, HOLTER_MAX_SEGMENTS);
+        loadedSegment = -1;
+        unindexedSegments = 0;
+        for (size_t s = 0; s < segmentCount; s++) {
+            if (!hasIndex(s)) unindexedSegments++;
+        }
+        if (segmentCount == 0) return false;
+        return positionAt(0, 0);
+    }
+
+    size_t getSegmentCount() const { return segmentCount; }
+
+    // Primera muestra guardada (la más antigua que no se ha borrado)
+    uint32_t firstSample() {
+        HolterSegmentHeader h;
+        return segmentCount && readHeader(0, h) ? h.startIndex : 0;
+    }
+
+    // Índice siguiente a la última muestra legible
+    uint32_t endSample() {
+        for (size_t s = segmentCount; s-- > 0;) {
+            if (!loadSegment(s)) continue;
+            if (indexCount > 0) {
+                HolterBlockInfo info;
+                if (readBlockInfo(indexCount - 1, info)) return info.firstIndex + info.count;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * Se coloca en la muestra 'sampleIndex' o, si cae en un hueco (bloque
+     * descartado o segmento borrado), en la siguiente que exista.
+     * @return false si no hay ninguna muestra en o después de sampleIndex
+     */
+    bool seek(uint32_t sampleIndex) {
+        if (segmentCount == 0) return false;
+
+        // Último segmento que empieza en o antes de sampleIndex
+        size_t lo = 0;
+        size_t hi = segmentCount;
+        while (hi - lo > 1) {
+            size_t mid = (lo + hi) / 2;
+            HolterSegmentHeader h;
+            if (readHeader(mid, h) && h.startIndex <= sampleIndex) lo = mid;
+            else hi = mid;
+        }
+
+        for (size_t s = lo; s < segmentCount; s++) {
+            if (!loadSegment(s) || indexCount == 0) continue;
+
+            // Último bloque que empieza en o antes de sampleIndex
+            size_t blo = 0;
+            size_t bhi = indexCount;
+            while (bhi - blo > 1) {
+                size_t mid = (blo + bhi) / 2;
+                if (indexFirst[mid] <= sampleIndex) blo = mid;
+                else bhi = mid;
+            }
+            for (size_t b = blo; b < indexCount; b++) {
+                if (!decodeBlock(b)) continue;
+                if (sampleIndex < blockFirst + blockSamples) {
+                    blockPos = sampleIndex > blockFirst ? (uint16_t)(sampleIndex - blockFirst) : 0;
+                    return true;
+                }
+            }
+        }
+        blockSamples = blockPos = 0;
+        return false;
+    }
+
+    // Índice global de la siguiente muestra que devolverá read()
+    uint32_t position() const { return blockFirst + blockPos; }
+
+    /**
+     * Copia hasta maxCount muestras consecutivas. Se detiene antes de un
+     * hueco: tras él, position() salta al siguiente índice grabado.
+     * @return muestras copiadas (0 al final del registro)
+     */
+    size_t read(int16_t* out, size_t maxCount) {
+        size_t count = 0;
+        while (count < maxCount && blockPos < blockSamples) {
+            out[count++] = samples[blockPos++];
+            if (blockPos == blockSamples) {
+                // Se carga ya el siguiente bloque para que position() sea exacto
+                const uint32_t expected = blockFirst + blockSamples;
+                if (!advance() || blockFirst != expected) break;
+            }
+        }
+        return count;
+    }
+
+    uint32_t getCrcErrors() const { return crcErrors; }
+    uint32_t getUnindexedSegments() const { return unindexedSegments; }
+
+private:
+    HolterStorage& storage;
+    uint32_t segments[HOLTER_MAX_SEGMENTS];
+    size_t segmentCount;
+
+    // Índice de tiempo del segmento cargado
+    long loadedSegment;
+    uint32_t indexFirst[HOLTER_SEGMENT_BLOCKS];
+    uint32_t indexOffset[HOLTER_SEGMENT_BLOCKS];
+    size_t indexCount;
+
+    // Bloque decodificado
+    size_t blockSegment;
+    size_t blockIndex;
+    int16_t samples[HOLTER_BLOCK_SAMPLES];
+    uint16_t blockSamples;
+    uint16_t blockPos;
+    uint32_t blockFirst;
+    uint8_t record[HOLTER_MAX_RECORD];
+
+    uint32_t crcErrors;
+    uint32_t unindexedSegments;
+
+    bool readHeader(size_t s, HolterSegmentHeader& h) {
+        uint8_t header[HOLTER_SEGMENT_HEADER];
+        return storage.readSegment(segments[s], 0, header, sizeof(header)) == sizeof(header) &&
+               holterParseSegmentHeader(header, h);
+    }
+
+    // Número de bloques del índice del pie (0 si el segmento no tiene índice)
+    uint32_t readIndexCount(uint32_t id, uint32_t size) {
+        uint8_t trailer[HOLTER_INDEX_TRAILER];
+        if (size < HOLTER_SEGMENT_HEADER + HOLTER_INDEX_TRAILER ||
+            storage.readSegment(id, size - HOLTER_INDEX_TRAILER, trailer, sizeof(trailer)) != sizeof(trailer) ||
+            holterGet32(trailer + 4) != HOLTER_INDEX_MAGIC) {
+            return 0;
+        }
+        const uint32_t count = holterGet32(trailer);
+        if (count == 0 || count > HOLTER_SEGMENT_BLOCKS ||
+            size < HOLTER_SEGMENT_HEADER + HOLTER_INDEX_TRAILER + count * HOLTER_INDEX_ENTRY) {
+            return 0;
+        }
+        return count;
+    }
+
+    bool hasIndex(size_t s) {
+        return readIndexCount(segments[s], storage.segmentSize(segments[s])) > 0;
+    }
+
+    // Carga el índice del pie del segmento o, si no lo tiene, recorre los bloques
+    bool loadSegment(size_t s) {
+        if (loadedSegment == (long)s) return true;
+        loadedSegment = (long)s;
+        indexCount = 0;
+
+        const uint32_t id = segments[s];
+        const uint32_t size = storage.segmentSize(id);
+        uint8_t* buffer = record; // el índice se lee por partes en el buffer del bloque
+        const uint32_t count = readIndexCount(id, size);
+        if (count > 0) {
+            const uint32_t perRead = sizeof(record) / HOLTER_INDEX_ENTRY;
+            uint32_t offset = size - HOLTER_INDEX_TRAILER - count * HOLTER_INDEX_ENTRY;
+            while (indexCount < count) {
+                uint32_t n = count - indexCount < perRead ? count - indexCount : perRead;
+                size_t bytes = n * HOLTER_INDEX_ENTRY;
+                if (storage.readSegment(id, offset, buffer, bytes) != bytes) break;
+                for (uint32_t i = 0; i < n; i++) {
+                    indexFirst[indexCount] = holterGet32(buffer + i * HOLTER_INDEX_ENTRY);
+                    indexOffset[indexCount] = holterGet32(buffer + i * HOLTER_INDEX_ENTRY + 4);
+                    indexCount++;
+                }
+                offset += bytes;
+            }
+            if (indexCount == count) return true;
+            indexCount = 0;
+        }
+
+        // Segmento sin índice: recorrer las cabeceras hasta el primer bloque incompleto
+        uint32_t offset = HOLTER_SEGMENT_HEADER;
+        HolterBlockInfo info;
+        while (indexCount < HOLTER_SEGMENT_BLOCKS && offset + HOLTER_BLOCK_HEADER <= size &&
+               storage.readSegment(id, offset, buffer, HOLTER_BLOCK_HEADER) == HOLTER_BLOCK_HEADER &&
+               holterParseBlockHeader(buffer, info) && offset + info.recordLen <= size) {
+            indexFirst[indexCount] = info.firstIndex;
+            indexOffset[indexCount] = offset;
+            indexCount++;
+            offset += info.recordLen;
+        }
+        return true;
+    }
+
+    bool readBlockInfo(size_t b, HolterBlockInfo& info) {
+        uint8_t header[HOLTER_BLOCK_HEADER];
+        return storage.readSegment(segments[loadedSegment], indexOffset[b], header, sizeof(header)) == sizeof(header) &&
+               holterParseBlockHeader(header, info);
+    }
+
+    bool decodeBlock(size_t b) {
+        HolterBlockInfo info;
+        if (!readBlockInfo(b, info) ||
+            storage.readSegment(segments[loadedSegment], indexOffset[b], record, info.recordLen) != info.recordLen ||
+            !holterDecodeBlock(record, info.recordLen, samples, info)) {
+            crcErrors++;
+            return false;
+        }
+        blockSegment = (size_t)loadedSegment;
+        blockIndex = b;
+        blockFirst = info.firstIndex;
+        blockSamples = info.count;
+        blockPos = 0;
+        return true;
+    }
+
+    bool positionAt(size_t s, size_t b) {
+        while (s < segmentCount) {
+            if (loadSegment(s)) {
+                for (; b < indexCount; b++) {
+                    if (decodeBlock(b)) return true;
+                }
+            }
+            s++;
+            b = 0;
+        }
+        blockSamples = blockPos = 0;
+        return false;
+    }
+
+    bool advance() {
+        const uint32_t previousEnd = blockFirst + blockSamples;
+        if (!positionAt(blockSegment, blockIndex + 1)) {
+            blockFirst = previousEnd;
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif // HOLTER_LOG_H
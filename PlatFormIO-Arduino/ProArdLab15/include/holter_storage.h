@@ -0,0 +1,61 @@
+/**
+ * @file holter_storage.h
+ * @brief Interfaz de almacenamiento por segmentos del registro Holter
+ *
+ * Cada segmento es un fichero identificado por un id creciente. Solo hay un
+ * segmento abierto para escritura a la vez y se escribe siempre al final.
+ * Implementaciones:
+ *   - LittleFSHolterStorage (esp32_holter_storage.h): LittleFS en la flash
+ *   - FileHolterStorage (src/native): directorio del host con capacidad
+ *     limitada, como sustituto de la partición de flash
+ * No depende de Arduino.h para poder usarla también en el entorno native.
+ */
+
+#ifndef HOLTER_STORAGE_H
+#define HOLTER_STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class HolterStorage {
+public:
+    virtual ~HolterStorage() {}
+
+    // Monta el sistema de ficheros. false si no es posible.
+    virtual bool begin() = 0;
+
+    /**
+     * Copia en 'ids' los segmentos existentes en orden creciente.
+     * @return número de ids copiados (como mucho maxIds, los más antiguos)
+     */
+    virtual size_t listSegments(uint32_t* ids, size_t maxIds) = 0;
+
+    // Crea el segmento 'id' vacío y lo deja abierto para append()
+    virtual bool createSegment(uint32_t id) = 0;
+
+    /**
+     * Añade al segmento abierto. Devuelve los bytes escritos (< len si no
+     * cabe). Lo añadido no es persistente hasta sync() o closeSegment(): si
+     * se corta la alimentación antes, se pierde.
+     */
+    virtual size_t append(const uint8_t* data, size_t len) = 0;
+
+    // Hace persistente lo añadido al segmento abierto
+    virtual void sync() = 0;
+
+    // Cierra el segmento abierto (implica sync())
+    virtual void closeSegment() = 0;
+
+    // Tamaño en bytes del segmento (0 si no existe)
+    virtual uint32_t segmentSize(uint32_t id) = 0;
+
+    // Lee 'len' bytes desde 'offset'. Devuelve los bytes leídos.
+    virtual size_t readSegment(uint32_t id, uint32_t offset, uint8_t* out, size_t len) = 0;
+
+    virtual bool removeSegment(uint32_t id) = 0;
+
+    // Espacio libre aproximado para nuevos segmentos
+    virtual uint32_t freeBytes() = 0;
+};
+
+#endif // HOLTER_STORAGE_H
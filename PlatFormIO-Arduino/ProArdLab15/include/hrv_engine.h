@@ -0,0 +1,217 @@
+/**
+ * @file hrv_engine.h
+ * @brief Variabilidad de la frecuencia cardiaca (HRV) incremental sobre intervalos RR
+ *
+ * Recibe un intervalo RR por latido y mantiene, sobre una ventana de tiempo
+ * configurable (5 min por defecto, la ventana estándar de corto plazo):
+ *   - FC media e intervalo NN medio
+ *   - SDNN: desviación típica de los intervalos NN
+ *   - RMSSD y pNN50: sobre las diferencias entre intervalos NN consecutivos
+ * Cada latido cuesta O(1): se suman el intervalo que entra y se restan los
+ * que salen de la ventana, con sumas enteras exactas (no acumulan error).
+ * La memoria es fija: Capacity intervalos; si llegan más latidos de los que
+ * caben en la ventana de tiempo, la ventana se acorta a los últimos Capacity.
+ *
+ * Rechazo de latidos ectópicos: un RR fuera de [MIN_RR_MS, MAX_RR_MS] o que
+ * se aparta más de un ECTOPIC_PERCENT % de la media de los últimos
+ * DISPLAY_BEATS intervalos aceptados no entra en las estadísticas, y la
+ * diferencia sucesiva con el siguiente intervalo tampoco (no son NN
+ * consecutivos). Tras RELEARN_REJECTS rechazos seguidos se asume un cambio
+ * de ritmo real y se vuelve a aprender la referencia.
+ *
+ * La media de esos últimos DISPLAY_BEATS intervalos es también la FC que se
+ * muestra en el LCD: no salta con cada latido ni con un extrasístole.
+ */
+
+#ifndef HRV_ENGINE_H
+#define HRV_ENGINE_H
+
+#include <stdint.h>
+#include <math.h>
+
+struct HRVMetrics {
+    float displayHr;   // lpm, media de los últimos DISPLAY_BEATS intervalos NN
+    float meanHr;      // lpm, media de la ventana
+    float meanNnMs;
+    float sdnnMs;
+    float rmssdMs;
+    float pnn50;       // % de diferencias sucesivas > 50 ms
+    uint16_t beats;    // intervalos NN en la ventana
+    uint16_t diffs;    // diferencias sucesivas en la ventana
+    uint32_t accepted; // intervalos aceptados desde reset()
+    uint32_t rejected; // intervalos rechazados (ectópicos o artefactos) desde reset()
+};
+
+template <uint16_t Capacity>
+class HRVEngine {
+public:
+    static const uint16_t MIN_RR_MS = 300;   // 200 lpm
+    static const uint16_t MAX_RR_MS = 2000;  // 30 lpm
+    static const uint8_t ECTOPIC_PERCENT = 20;
+    static const uint8_t DISPLAY_BEATS = 8;
+    static const uint8_t REFERENCE_MIN_BEATS = 3; // antes se acepta todo lo fisiológico
+    static const uint8_t RELEARN_REJECTS = 5;
+    static const uint32_t DEFAULT_WINDOW_MS = 300000UL;
+
+    explicit HRVEngine(uint32_t windowMs = DEFAULT_WINDOW_MS) : windowMs(windowMs) { reset(); }
+
+    void reset() {
+        head = tail = count = 0;
+        sumNn = 0;
+        sumNn2 = 0;
+        sumDiff2 = 0;
+        diffCount = 0;
+        nn50Count = 0;
+        refHead = refCount = 0;
+        refSum = 0;
+        lastAccepted = false;
+        consecutiveRejects = 0;
+        acceptedTotal = rejectedTotal = 0;
+    }
+
+    // Cambia la ventana de tiempo; si se acorta, se descartan los más antiguos
+    void setWindowMs(uint32_t ms) {
+        windowMs = ms;
+        trimWindow();
+    }
+
+    uint32_t getWindowMs() const { return windowMs; }
+
+    /**
+     * Añade el intervalo RR de un latido.
+     * @return true si se acepta como intervalo normal (NN)
+     */
+    bool addRR(uint16_t rrMs) {
+        if (!isNormal(rrMs)) {
+            rejectedTotal++;
+            lastAccepted = false;
+            if (++consecutiveRejects >= RELEARN_REJECTS) {
+                refHead = refCount = 0;
+                refSum = 0;
+                consecutiveRejects = 0;
+            }
+            return false;
+        }
+        consecutiveRejects = 0;
+        acceptedTotal++;
+
+        // Referencia para el rechazo y FC mostrada: últimos DISPLAY_BEATS
+        if (refCount == DISPLAY_BEATS) refSum -= reference[refHead];
+        else refCount++;
+        reference[refHead] = rrMs;
+        refSum += rrMs;
+        refHead = (refHead + 1) % DISPLAY_BEATS;
+
+        // Diferencia sucesiva solo entre NN consecutivos
+        int16_t diff = NO_DIFF;
+        if (lastAccepted && count > 0) {
+            diff = (int16_t)((int32_t)rrMs - nn[(head + Capacity - 1) % Capacity]);
+            addDiff(diff);
+        }
+        lastAccepted = true;
+
+        if (count == Capacity) evictOldest();
+        nn[head] = rrMs;
+        diffs[head] = diff;
+        head = (head + 1) % Capacity;
+        count++;
+        sumNn += rrMs;
+        sumNn2 += (uint64_t)rrMs * rrMs;
+
+        trimWindow();
+        return true;
+    }
+
+    // Estadísticas de la ventana actual, en O(1)
+    HRVMetrics metrics() const {
+        HRVMetrics m;
+        m.beats = count;
+        m.diffs = diffCount;
+        m.accepted = acceptedTotal;
+        m.rejected = rejectedTotal;
+        m.displayHr = refCount ? 60000.0f * refCount / refSum : 0.0f;
+        m.meanNnMs = count ? (float)sumNn / count : 0.0f;
+        m.meanHr = count ? 60000.0f * count / sumNn : 0.0f;
+        m.sdnnMs = 0.0f;
+        if (count > 1) {
+            // n·Σx² - (Σx)² es exacto en enteros: sin cancelación en float
+            uint64_t scaled = (uint64_t)count * sumNn2 - (uint64_t)sumNn * sumNn;
+            m.sdnnMs = sqrtf((float)scaled / ((float)count * (count - 1)));
+        }
+        m.rmssdMs = diffCount ? sqrtf((float)sumDiff2 / diffCount) : 0.0f;
+        m.pnn50 = diffCount ? 100.0f * nn50Count / diffCount : 0.0f;
+        return m;
+    }
+
+    uint16_t size() const { return count; }
+    static uint16_t capacity() { return Capacity; }
+
+private:
+    static const int16_t NO_DIFF = INT16_MIN;
+
+    uint32_t windowMs;
+
+    // Ventana de intervalos NN y la diferencia con el anterior (o NO_DIFF)
+    uint16_t nn[Capacity];
+    int16_t diffs[Capacity];
+    uint16_t head;
+    uint16_t tail;
+    uint16_t count;
+    uint32_t sumNn;
+    uint64_t sumNn2;
+    uint64_t sumDiff2;
+    uint16_t diffCount;
+    uint16_t nn50Count;
+
+    uint16_t reference[DISPLAY_BEATS];
+    uint8_t refHead;
+    uint8_t refCount;
+    uint32_t refSum;
+    bool lastAccepted;
+    uint8_t consecutiveRejects;
+
+    uint32_t acceptedTotal;
+    uint32_t rejectedTotal;
+
+    bool isNormal(uint16_t rrMs) const {
+        if (rrMs < MIN_RR_MS || rrMs > MAX_RR_MS) return false;
+        if (refCount < REFERENCE_MIN_BEATS) return true;
+        // |rr - media| > p% de la media, sin dividir: |rr·n - suma|·100 > p·suma
+        int32_t deviation = (int32_t)rrMs * refCount - (int32_t)refSum;
+        if (deviation < 0) deviation = -deviation;
+        return (uint32_t)deviation * 100 <= (uint32_t)ECTOPIC_PERCENT * refSum;
+    }
+
+    void addDiff(int16_t diff) {
+        int32_t d = diff;
+        sumDiff2 += (uint64_t)(d * d);
+        diffCount++;
+        if (d > 50 || d < -50) nn50Count++;
+    }
+
+    void removeDiff(int16_t diff) {
+        int32_t d = diff;
+        sumDiff2 -= (uint64_t)(d * d);
+        diffCount--;
+        if (d > 50 || d < -50) nn50Count--;
+    }
+
+    void evictOldest() {
+        uint16_t rr = nn[tail];
+        sumNn -= rr;
+        sumNn2 -= (uint64_t)rr * rr;
+        tail = (tail + 1) % Capacity;
+        count--;
+        // La diferencia del nuevo primero apunta a un intervalo que ya no está
+        if (count > 0 && diffs[tail] != NO_DIFF) {
+            removeDiff(diffs[tail]);
+            diffs[tail] = NO_DIFF;
+        }
+    }
+
+    void trimWindow() {
+        while (count > 1 && sumNn > windowMs) evictOldest();
+    }
+};
+
+#endif // HRV_ENGINE_H
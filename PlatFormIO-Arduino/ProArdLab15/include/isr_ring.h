@@ -0,0 +1,94 @@
+/**
+ * @file isr_ring.h
+ * @brief Cola circular de un productor y un consumidor entre una ISR y loop(), sin std::atomic
+ *
+ * Versión de SpscRing (spsc_ring.h) para el AVR, donde no hay <atomic>:
+ * índices de 8 bits (su lectura y escritura son atómicas en el AVR) y
+ * búfer volatile, así que el compilador no adelanta la publicación de head
+ * a la escritura del elemento. Solo vale para un núcleo: una ISR y el
+ * programa principal, en cualquiera de los dos papeles. T debe ser un
+ * escalar (uint8_t, int16_t...).
+ *
+ * El productor nunca espera: si no cabe, descarta y cuenta en dropped().
+ * Capacity, potencia de 2 y como mucho 128, para que head - tail en 8 bits
+ * distinga lleno de vacío.
+ */
+
+#ifndef ISR_RING_H
+#define ISR_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+template <typename T, uint8_t Capacity>
+class IsrRing {
+    static_assert(Capacity >= 2 && Capacity <= 128 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity debe ser potencia de 2 y como mucho 128");
+
+public:
+    IsrRing() : head(0), tail(0), droppedCount(0) {}
+
+    // Solo productor
+    bool push(T item) {
+        uint8_t h = head;
+        if ((uint8_t)(h - tail) == Capacity) {
+            countDrop();
+            return false;
+        }
+        buffer[h & (Capacity - 1)] = item;
+        head = (uint8_t)(h + 1);
+        return true;
+    }
+
+    // Solo productor: los n elementos o ninguno (una trama entera al UART)
+    bool pushBlock(const T* items, size_t n) {
+        uint8_t h = head;
+        if ((size_t)(Capacity - (uint8_t)(h - tail)) < n) {
+            countDrop();
+            return false;
+        }
+        for (uint8_t i = 0; i < (uint8_t)n; i++) buffer[(uint8_t)(h + i) & (Capacity - 1)] = items[i];
+        head = (uint8_t)(h + n);
+        return true;
+    }
+
+    // Solo consumidor
+    bool pop(T& item) {
+        uint8_t t = tail;
+        if (t == head) return false;
+        item = buffer[t & (Capacity - 1)];
+        tail = (uint8_t)(t + 1);
+        return true;
+    }
+
+    // Aproximado si se llama desde el otro lado
+    uint8_t size() const { return (uint8_t)(head - tail); }
+
+    /**
+     * push() o pushBlock() rechazados (satura en 65535). Se puede leer
+     * desde el otro lado: repite la lectura de 16 bits si la ISR la cambió
+     * a medias.
+     */
+    uint16_t dropped() const {
+        uint16_t a, b;
+        do {
+            a = droppedCount;
+            b = droppedCount;
+        } while (a != b);
+        return a;
+    }
+
+    static constexpr uint8_t capacity() { return Capacity; }
+
+private:
+    volatile T buffer[Capacity];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+    volatile uint16_t droppedCount;
+
+    void countDrop() {
+        if (droppedCount != 0xFFFF) droppedCount = droppedCount + 1;
+    }
+};
+
+#endif // ISR_RING_H
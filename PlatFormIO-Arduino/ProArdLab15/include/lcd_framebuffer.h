@@ -0,0 +1,125 @@
+/**
+ * @file lcd_framebuffer.h
+ * @brief Framebuffer con copia sombra para LCD de caracteres (HD44780)
+ *
+ * Las escrituras van a 'target'; flush() compara con 'shadow' (lo que ya
+ * muestra la pantalla) y solo envía las celdas que cambiaron. Las celdas
+ * sucias cercanas de una misma fila se agrupan en un único setCursor()
+ * seguido de una ráfaga de write(): en el HD44780 mover el cursor cuesta lo
+ * mismo que escribir un carácter, así que un hueco de una celda limpia se
+ * reescribe en lugar de pagar otro setCursor().
+ *
+ * Display es cualquier clase con setCursor(col, row) y write(uint8_t), p. ej.
+ * HD44780I2C o el LCD simulado del entorno native.
+ */
+
+#ifndef LCD_FRAMEBUFFER_H
+#define LCD_FRAMEBUFFER_H
+
+#include <stdint.h>
+#include <string.h>
+
+template <uint8_t Cols, uint8_t Rows>
+class LCDFrameBuffer {
+public:
+    // Huecos limpios de hasta este tamaño se reescriben dentro de la ráfaga
+    static const uint8_t MERGE_GAP = 1;
+
+    LCDFrameBuffer() { reset(' '); }
+
+    // La pantalla contiene 'fill' en todas las celdas (p. ej. tras clear())
+    void reset(uint8_t fill) {
+        memset(target, fill, sizeof(target));
+        memset(shadow, fill, sizeof(shadow));
+        cursorValid = false;
+    }
+
+    void setChar(uint8_t col, uint8_t row, uint8_t c) {
+        if (col < Cols && row < Rows) target[row][col] = c;
+    }
+
+    // Escribe texto desde (col, row) sin pasar de la fila
+    void setText(uint8_t col, uint8_t row, const char* text) {
+        while (*text && col < Cols) {
+            setChar(col++, row, (uint8_t)*text++);
+        }
+    }
+
+    // Rellena 'count' celdas con 'c'
+    void fill(uint8_t col, uint8_t row, uint8_t count, uint8_t c) {
+        for (uint8_t i = 0; i < count; i++) setChar(col + i, row, c);
+    }
+
+    bool isDirty() const { return memcmp(target, shadow, sizeof(target)) != 0; }
+
+    /**
+     * Envía al display solo las celdas que cambiaron.
+     * @param maxBytes límite de bytes al HD44780 en esta llamada: lo que no
+     *        cabe queda pendiente y la siguiente llamada sigue donde se quedó
+     *        (sin repetir setCursor si el cursor ya está ahí)
+     * @return número de bytes enviados al HD44780 (comandos + datos)
+     */
+    template <typename Display>
+    uint16_t flush(Display& display, uint16_t maxBytes = 0xFFFF) {
+        uint16_t sent = 0;
+        for (uint8_t row = 0; row < Rows; row++) {
+            uint8_t col = 0;
+            while (col < Cols) {
+                if (target[row][col] == shadow[row][col]) {
+                    col++;
+                    continue;
+                }
+
+                // Inicio de un tramo sucio: buscar su final, absorbiendo
+                // huecos limpios de hasta MERGE_GAP celdas
+                uint8_t start = col;
+                uint8_t end = col + 1;
+                uint8_t scan = end;
+                while (scan < Cols) {
+                    if (target[row][scan] != shadow[row][scan]) {
+                        end = ++scan;
+                    } else if (scan - end < MERGE_GAP) {
+                        scan++;
+                    } else {
+                        break;
+                    }
+                }
+
+                // El HD44780 avanza el cursor solo: si ya está ahí no se mueve
+                bool moveCursor = !cursorValid || cursorRow != row || cursorCol != start;
+                uint16_t budget = maxBytes - sent;
+                if (budget < (moveCursor ? 2 : 1)) return sent;
+                if (moveCursor) {
+                    display.setCursor(start, row);
+                    sent++;
+                    budget--;
+                }
+                if (end - start > budget) end = start + budget;
+                for (uint8_t c = start; c < end; c++) {
+                    display.write(target[row][c]);
+                    shadow[row][c] = target[row][c];
+                    sent++;
+                }
+
+                // Tras la última columna la DDRAM no sigue en la fila siguiente
+                cursorValid = end < Cols;
+                cursorRow = row;
+                cursorCol = end;
+                col = end;
+            }
+        }
+        return sent;
+    }
+
+    // Invalida la posición del cursor (si alguien escribió sin pasar por aquí)
+    void invalidateCursor() { cursorValid = false; }
+
+private:
+    uint8_t target[Rows][Cols];
+    uint8_t shadow[Rows][Cols];
+    bool cursorValid;
+    uint8_t cursorRow;
+    uint8_t cursorCol;
+};
+
+#endif // LCD_FRAMEBUFFER_H
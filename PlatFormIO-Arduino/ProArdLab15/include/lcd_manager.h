@@ -7,8 +7,9 @@
 #define LCD_MANAGER_H
 
 #include <Wire.h>
-#include <LiquidCrystal_I2C.h>
 #include "ecg_types.h"
+#include "hd44780_i2c.h"
+#include "lcd_framebuffer.h"
 
 // Definición del caracter personalizado de corazón
 byte heart[8] = {
@@ -24,88 +25,168 @@ byte heart[8] = {
 
 class LCDManager {
 public:
-    LCDManager() : lcd(nullptr), currentAddr(LCDPins::ADDR), beatDisplayTime(0) {}
+    // Presupuesto de LCD por vuelta de loop(). Cada byte del HD44780 son 4
+    // bytes del PCF8574 (36 bits de bus) y la transmisión añade dirección,
+    // start y stop: ~90 us por byte a 400 kHz, así que 400 us dan para
+    // setCursor + 2 caracteres (3 si el cursor ya está en su sitio).
+    static const uint32_t TICK_BUDGET_US = 400;
+    static const uint32_t BYTE_US = 36UL * 1000000UL / LCDPins::CLOCK_HZ;
+    static const uint32_t TRANSACTION_US = 20UL * 1000000UL / LCDPins::CLOCK_HZ;
+    static const uint16_t TICK_BUDGET_BYTES =
+        (TICK_BUDGET_US - TRANSACTION_US) / BYTE_US < 2 ? 2 : (TICK_BUDGET_US - TRANSACTION_US) / BYTE_US;
+
+    LCDManager() :
+        lcd(Wire, LCDPins::ADDR, 20, 4),
+        ready(false),
+        currentAddr(LCDPins::ADDR),
+        beatDisplayTime(0),
+        lastTickUs(0),
+        worstTickUs(0),
+        busyTicks(0) {}
 
     void begin() {
         Wire.begin(LCDPins::SDA, LCDPins::SCL);
+        Wire.setClock(LCDPins::CLOCK_HZ);
         currentAddr = scanForLCD();
 
-        if (lcd) delete lcd;
-        lcd = new LiquidCrystal_I2C(currentAddr, 20, 4);
-        lcd->init();
-        lcd->backlight();
-        lcd->clear();
-
-        lcd->createChar(0, heart);
-
-        lcd->setCursor(0, 0);
-        lcd->print("Monitor ECG AD8232");
-        lcd->setCursor(0, 1);
-        lcd->print("BPM: ---");
-        lcd->setCursor(0, 2);
-        lcd->print("Status: Iniciando...");
-        lcd->setCursor(0, 3);
-        lcd->print("Signal: [..........]");
+        lcd.setAddress(currentAddr);
+        lcd.init();
+        lcd.backlight();
+        lcd.clear();
+
+        lcd.createChar(0, heart);
+        // createChar() deja el cursor en la CGRAM
+        screen.reset(' ');
+        ready = true;
+
+        screen.setText(0, 0, "Monitor ECG AD8232");
+        screen.setText(0, 1, "BPM: ---");
+        screen.setText(0, 2, "Status: Iniciando...");
+        screen.setText(0, 3, "Signal: [..........]");
+        refresh();
     }
 
     uint8_t getAddress() const { return currentAddr; }
 
+    /**
+     * Envía al LCD parte de los cambios pendientes, como mucho
+     * TICK_BUDGET_BYTES bytes del HD44780 (~TICK_BUDGET_US). Llamar en cada
+     * vuelta de loop(): las funciones update* solo escriben en el framebuffer
+     * y es aquí donde se vacía, poco a poco, en una transmisión I2C por tick.
+     */
+    void service() {
+        if (!ready || !screen.isDirty()) return;
+        unsigned long start = micros();
+        screen.flush(lcd, TICK_BUDGET_BYTES);
+        lcd.flush();
+        uint32_t elapsed = micros() - start;
+
+        lastTickUs = elapsed;
+        if (elapsed > worstTickUs) worstTickUs = elapsed;
+        busyTicks++;
+    }
+
+    // Instrumentación: tiempo de LCD de la última vuelta con trabajo, peor
+    // caso y número de vueltas con trabajo desde resetTickStats()
+    uint32_t getLastTickUs() const { return lastTickUs; }
+    uint32_t getWorstTickUs() const { return worstTickUs; }
+    uint32_t getBusyTicks() const { return busyTicks; }
+    bool hasPendingWork() const { return screen.isDirty(); }
+    void resetTickStats() { lastTickUs = worstTickUs = busyTicks = 0; }
+
+    // Las funciones update* solo escriben en el framebuffer; service() envía
+    // por I2C las celdas que han cambiado desde la última vez
     void updateBPM(float bpm) {
-        if (!lcd) return;
-        lcd->setCursor(5, 1);
+        if (!ready) return;
         if (bpm > 0) {
-            char bpmStr[4];
-            sprintf(bpmStr, "%3.0f", bpm);
-            lcd->print(bpmStr);
+            char bpmStr[8];
+            snprintf(bpmStr, sizeof(bpmStr), "%3.0f", bpm);
+            screen.setText(5, 1, bpmStr);
         } else {
-            lcd->print("---");
+            screen.setText(5, 1, "---");
         }
     }
 
+    // Fila 0: título hasta que hay HRV_MIN_DIFFS diferencias, luego SDNN y RMSSD
+    void updateHRV(const HRVMetrics& hrv) {
+        if (!ready) return;
+        screen.fill(0, 0, 20, ' ');
+        if (hrv.diffs < HRV_MIN_DIFFS) {
+            screen.setText(0, 0, "Monitor ECG AD8232");
+            return;
+        }
+        char line[24];
+        snprintf(line, sizeof(line), "SDNN%3d RMSSD%3d ms",
+                 (int)(hrv.sdnnMs + 0.5f), (int)(hrv.rmssdMs + 0.5f));
+        screen.setText(0, 0, line);
+    }
+
+    // Fila 1, tras la FC: índice de calidad 0-100 (signal_quality.h)
+    void updateQuality(uint8_t quality) {
+        if (!ready) return;
+        char qStr[8];
+        if (quality <= 100) snprintf(qStr, sizeof(qStr), "Q:%3u", (unsigned)quality);
+        else snprintf(qStr, sizeof(qStr), "Q:---");
+        screen.setText(9, 1, qStr);
+    }
+
+    // Fila 1, tras el corazón: respiraciones por minuto derivadas del ECG
+    void updateRespiration(float rate) {
+        if (!ready) return;
+        char rStr[8];
+        if (rate > 0) snprintf(rStr, sizeof(rStr), "R%2d", rate < 99.5f ? (int)(rate + 0.5f) : 99);
+        else snprintf(rStr, sizeof(rStr), "R--");
+        screen.setText(17, 1, rStr);
+    }
+
     void updateStatus(const char* status) {
-        if (!lcd) return;
-        lcd->setCursor(8, 2);
-        lcd->print("            ");
-        lcd->setCursor(8, 2);
-        lcd->print(status);
+        if (!ready) return;
+        screen.fill(8, 2, 12, ' ');
+        screen.setText(8, 2, status);
     }
 
     // Muestra el corazón y registra el tiempo (no bloqueante)
     void showBeat() {
-        if (!lcd) return;
-        lcd->setCursor(16, 1);
-        lcd->write((uint8_t)0);
+        if (!ready) return;
+        screen.setChar(16, 1, 0);
         beatDisplayTime = millis();
     }
 
     // Gestiona el apagado del corazón después de un tiempo
     void manageBeatIndicator() {
+        if (!ready) return;
         if (beatDisplayTime > 0 && millis() - beatDisplayTime > BEAT_DISPLAY_DURATION) {
-            lcd->setCursor(16, 1);
-            lcd->print(" ");
+            screen.setChar(16, 1, ' ');
             beatDisplayTime = 0; // Resetea el temporizador
         }
     }
 
     void updateSignalBar(int filteredValue) {
-        if (!lcd) return;
+        if (!ready) return;
         // Mapear el valor filtrado a una escala de 0-18 para la barra
         // Un rango de -400 a 400 suele ser un buen punto de partida para la visualización
         int mappedValue = map(constrain(filteredValue, -400, 400), -400, 400, 0, 18);
         
-        lcd->setCursor(8, 3);
-        lcd->print("[");
+        screen.setChar(8, 3, '[');
         for (int i = 0; i < 10; ++i) {
-            lcd->print(i < mappedValue ? "=" : ".");
+            screen.setChar(9 + i, 3, i < mappedValue ? '=' : '.');
         }
-        lcd->print("]");
+        screen.setChar(19, 3, ']');
     }
 
 private:
-    LiquidCrystal_I2C* lcd;
+    // Lotes de hasta 128 bytes: el buffer de TwoWire en el ESP32
+    HD44780I2C<TwoWire, 128> lcd;
+    LCDFrameBuffer<20, 4> screen; // Copia sombra de la pantalla 20x4
+    bool ready;
     uint8_t currentAddr;
     unsigned long beatDisplayTime;
     static const unsigned long BEAT_DISPLAY_DURATION = 100; // ms
+    static const uint16_t HRV_MIN_DIFFS = 30; // ~30 s de latidos normales
+
+    uint32_t lastTickUs;
+    uint32_t worstTickUs;
+    uint32_t busyTicks;
 
     uint8_t scanForLCD() {
         uint8_t found = 0;
@@ -118,6 +199,12 @@ private:
         }
         return (found != 0) ? found : LCDPins::ADDR;
     }
+
+    // Envía todas las celdas cambiadas de una vez (solo en begin())
+    void refresh() {
+        screen.flush(lcd);
+        lcd.flush();
+    }
 };
 
 #endif // LCD_MANAGER_H
\ No newline at end of file
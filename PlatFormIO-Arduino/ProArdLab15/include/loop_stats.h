@@ -0,0 +1,118 @@
+/**
+ * @file loop_stats.h
+ * @brief Histogramas de duraciones y latencias para instrumentar el lazo de tiempo real
+ *
+ * TimingHistogram reparte los valores en cubetas de potencias de 2: la
+ * cubeta 0 guarda los ceros, la k guarda [2^(k-1), 2^k) y la última todo lo
+ * que no cabe. Además lleva número, suma y máximo. add() es O(1), sin
+ * divisiones ni memoria dinámica, así que se puede llamar por muestra en la
+ * tarea de adquisición. Las unidades las decide quien mide: ciclos de CPU
+ * para duraciones en un mismo núcleo, us de micros() para latencias entre
+ * núcleos o desde una ISR, o muestras en cola.
+ *
+ * Un solo escritor. Otro núcleo puede leerlo para el volcado: cada contador
+ * es de 32 bits y se lee entero, pero el conjunto es solo una instantánea
+ * aproximada. El reset lo hace el escritor (esp32_main.cpp lo pide con un
+ * flag).
+ *
+ * dumpTimingHistogram() genera las líneas del volcado ("# ...", como el
+ * resto de la depuración por serie) y las entrega a un callback: Serial en
+ * el ESP32 y stdout en el comando "loopstats" del entorno native.
+ */
+
+#ifndef LOOP_STATS_H
+#define LOOP_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+class TimingHistogram {
+public:
+    // 2^22 ciclos son ~17 ms a 240 MHz; lo que pase de ahí va a la última
+    static constexpr uint8_t BUCKETS = 24;
+
+    TimingHistogram() { reset(); }
+
+    void reset() {
+        for (uint8_t k = 0; k < BUCKETS; k++) buckets[k] = 0;
+        n = 0;
+        sum = 0;
+        maxSeen = 0;
+    }
+
+    void add(uint32_t value) {
+        buckets[bucketOf(value)]++;
+        n++;
+        sum += value;
+        if (value > maxSeen) maxSeen = value;
+    }
+
+    uint32_t count() const { return n; }
+    uint32_t maxValue() const { return maxSeen; }
+    uint32_t bucket(uint8_t k) const { return buckets[k]; }
+    float mean() const { return n ? (float)sum / n : 0.0f; }
+
+    // Límite superior (exclusivo) de la cubeta k; 0 para la última (sin límite)
+    static uint32_t bucketLimit(uint8_t k) {
+        return k + 1 < BUCKETS ? (uint32_t)1 << k : 0;
+    }
+
+    static uint8_t bucketOf(uint32_t value) {
+        if (value == 0) return 0;
+        uint8_t k = (uint8_t)(32 - __builtin_clz(value));
+        return k < BUCKETS ? k : BUCKETS - 1;
+    }
+
+    /**
+     * Cota superior del percentil 'permille' (990 = p99): el límite de la
+     * cubeta donde cae, sin pasar del máximo visto.
+     */
+    uint32_t percentile(uint16_t permille) const {
+        if (n == 0) return 0;
+        uint64_t target = ((uint64_t)n * permille + 999) / 1000;
+        uint64_t seen = 0;
+        for (uint8_t k = 0; k < BUCKETS; k++) {
+            seen += buckets[k];
+            if (seen >= target) {
+                uint32_t limit = bucketLimit(k);
+                return limit == 0 || limit - 1 > maxSeen ? maxSeen : limit - 1;
+            }
+        }
+        return maxSeen;
+    }
+
+private:
+    uint32_t buckets[BUCKETS];
+    uint32_t n;
+    uint64_t sum;
+    uint32_t maxSeen;
+};
+
+/**
+ * Vuelca 'h' línea a línea: un resumen y las cubetas no vacías.
+ * Los valores se multiplican por 'scale' al imprimirlos (1/MHz para pasar
+ * ciclos a us). emit(const char*) recibe cada línea sin salto final.
+ */
+template <typename Emit>
+void dumpTimingHistogram(const char* name, const TimingHistogram& h, float scale, const char* unit, Emit emit) {
+    // Enteros para us y muestras; con ciclos las cubetas bajas son fracciones de us
+    const int decimals = scale < 1.0f ? 2 : 0;
+    char line[96];
+    snprintf(line, sizeof(line), "# %s: n=%lu media=%.1f p50<=%.*f p99<=%.*f max=%.*f %s",
+             name, (unsigned long)h.count(), h.mean() * scale, decimals, h.percentile(500) * scale,
+             decimals, h.percentile(990) * scale, decimals, h.maxValue() * scale, unit);
+    emit(line);
+    for (uint8_t k = 0; k < TimingHistogram::BUCKETS; k++) {
+        if (h.bucket(k) == 0) continue;
+        uint32_t limit = TimingHistogram::bucketLimit(k);
+        if (limit == 0) {
+            snprintf(line, sizeof(line), "#   >= %.*f %s: %lu",
+                     decimals, TimingHistogram::bucketLimit(k - 1) * scale, unit, (unsigned long)h.bucket(k));
+        } else {
+            snprintf(line, sizeof(line), "#   < %.*f %s: %lu", decimals, limit * scale, unit, (unsigned long)h.bucket(k));
+        }
+        emit(line);
+    }
+}
+
+#endif // LOOP_STATS_H
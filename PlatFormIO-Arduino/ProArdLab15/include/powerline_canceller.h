@@ -0,0 +1,225 @@
+/**
+ * @file powerline_canceller.h
+ * @brief Cancelador adaptativo (LMS) del zumbido de red de 50/60 Hz, etapa de filter_chain.h
+ *
+ * Cada HumLMS estima el zumbido como w_s·sin + w_c·cos de una referencia
+ * a la frecuencia de red y lo resta; el error e = x - estimación actualiza
+ * los pesos con LMS (w += mu·e·referencia). Es un notch de anchura
+ * ~mu·fs/(2·pi) (0.6 Hz con mu = 2^-6 a 250 Hz) que sigue la fase y la
+ * amplitud del zumbido y desvíos lentos de la frecuencia de red, sin tocar
+ * el resto del espectro del ECG.
+ *
+ * PowerlineCanceller empieza con un HumLMS de 50 Hz y otro de 60 Hz que
+ * comparten el error (un LMS de cuatro pesos: las dos referencias son
+ * ortogonales). Cuando uno domina (doble de amplitud y al menos
+ * HUM_LOCK_MIN cuentas) durante 2 s, se engancha a esa frecuencia y deja
+ * de calcular el otro: la mitad de coste.
+ *
+ * Las referencias son tablas constexpr de un periodo exacto de la
+ * combinación red/muestreo (5 muestras a 50 Hz y 25 a 60 Hz con
+ * fs = 250 Hz), sin osciladores que deriven. En coma fija: pesos en
+ * cuentas Q8 limitados a ±512 cuentas, referencias en Q12 y error
+ * saturado a ±1024 cuentas en la actualización (un QRS grande no
+ * desajusta los pesos), todo en int32_t.
+ * Coste: 4 productos de 32 bits por HumLMS y muestra; en el AVR las
+ * tablas (30 pares sin/cos) ocupan 120 bytes de RAM y el estado 20 bytes
+ * por canal.
+ */
+
+#ifndef POWERLINE_CANCELLER_H
+#define POWERLINE_CANCELLER_H
+
+#include <stdint.h>
+#include "filter_chain.h"
+
+constexpr uint32_t humGcd(uint32_t a, uint32_t b) { return b == 0 ? a : humGcd(b, a % b); }
+
+// Muestras de un periodo exacto de la referencia
+constexpr uint32_t humPeriod(uint32_t rateHz, uint32_t mainsHz) { return rateHz / humGcd(rateHz, mainsHz); }
+
+// Fase de la muestra i reducida a [-pi, pi), donde filterSin/filterCos son exactas
+constexpr double humPhase(uint32_t i, uint32_t rateHz, uint32_t mainsHz) {
+    return 2.0 * FILTER_PI * ((i * mainsHz) % rateHz) / rateHz -
+           (((i * mainsHz) % rateHz) * 2 >= rateHz ? 2.0 * FILTER_PI : 0.0);
+}
+
+constexpr int HUM_REF_SHIFT = 12;
+
+// Lista de índices 0..N-1 para expandir las tablas constexpr (C++11)
+template <int... I>
+struct HumIndexList {};
+
+template <int N, int... I>
+struct HumMakeIndex : HumMakeIndex<N - 1, N - 1, I...> {};
+
+template <int... I>
+struct HumMakeIndex<0, I...> {
+    typedef HumIndexList<I...> Type;
+};
+
+template <uint32_t RateHz, uint32_t MainsHz,
+          typename Indices = typename HumMakeIndex<humPeriod(RateHz, MainsHz)>::Type>
+struct HumReference;
+
+// sin y cos de la red en Q12, un periodo exacto
+template <uint32_t RateHz, uint32_t MainsHz, int... I>
+struct HumReference<RateHz, MainsHz, HumIndexList<I...>> {
+    static_assert(MainsHz * 2 < RateHz, "la red debe estar por debajo de Nyquist");
+    static_assert(sizeof...(I) <= 255, "periodo de la referencia demasiado largo");
+    static constexpr uint8_t LENGTH = sizeof...(I);
+    static constexpr int16_t SIN[LENGTH] = {
+        (int16_t)filterRound(filterSin(humPhase(I, RateHz, MainsHz)) * (1 << HUM_REF_SHIFT))...};
+    static constexpr int16_t COS[LENGTH] = {
+        (int16_t)filterRound(filterCos(humPhase(I, RateHz, MainsHz)) * (1 << HUM_REF_SHIFT))...};
+};
+
+template <uint32_t RateHz, uint32_t MainsHz, int... I>
+constexpr int16_t HumReference<RateHz, MainsHz, HumIndexList<I...>>::SIN[];
+template <uint32_t RateHz, uint32_t MainsHz, int... I>
+constexpr int16_t HumReference<RateHz, MainsHz, HumIndexList<I...>>::COS[];
+
+// ---------------------------------------------------------------------------
+// Pesos LMS de una frecuencia de red. estimate() da el zumbido estimado en
+// la muestra actual y update(e) corrige los pesos con el error y avanza la
+// fase; el error es común cuando hay varios HumLMS sobre la misma señal.
+
+template <typename T, uint32_t RateHz, uint32_t MainsHz, uint8_t MuShift>
+class HumLMS;
+
+template <uint32_t RateHz, uint32_t MainsHz, uint8_t MuShift>
+class HumLMS<float, RateHz, MainsHz, MuShift> {
+public:
+    typedef HumReference<RateHz, MainsHz> Reference;
+    typedef float Acc;
+
+    static Acc toAcc(float x) { return x; }
+    static float fromAcc(Acc e) { return e; }
+
+    void reset() {
+        ws = wc = 0;
+        index = 0;
+    }
+
+    Acc estimate() const { return ws * sinRef() + wc * cosRef(); }
+
+    void update(Acc e) {
+        const float mu = 1.0f / (1UL << MuShift);
+        ws += mu * e * sinRef();
+        wc += mu * e * cosRef();
+        if (++index == Reference::LENGTH) index = 0;
+    }
+
+    // |w_s| + |w_c|: entre 1 y 1.41 veces la amplitud estimada del zumbido
+    float amplitude() const { return (ws < 0 ? -ws : ws) + (wc < 0 ? -wc : wc); }
+
+private:
+    float ws, wc;
+    uint8_t index;
+
+    float sinRef() const { return Reference::SIN[index] * (1.0f / (1 << HUM_REF_SHIFT)); }
+    float cosRef() const { return Reference::COS[index] * (1.0f / (1 << HUM_REF_SHIFT)); }
+};
+
+// Estimación y error en cuentas Q8
+template <uint32_t RateHz, uint32_t MainsHz, uint8_t MuShift>
+class HumLMS<int16_t, RateHz, MainsHz, MuShift> {
+public:
+    typedef HumReference<RateHz, MainsHz> Reference;
+    typedef int32_t Acc;
+    static constexpr int WEIGHT_SHIFT = 8;
+    static constexpr int32_t WEIGHT_MAX = 512L << WEIGHT_SHIFT;
+    static constexpr int32_t ERROR_MAX = (1024L << WEIGHT_SHIFT) - 1;
+
+    static Acc toAcc(int16_t x) { return (int32_t)x << WEIGHT_SHIFT; }
+    static int16_t fromAcc(Acc e) { return filterSaturate16((e + (1L << (WEIGHT_SHIFT - 1))) >> WEIGHT_SHIFT); }
+
+    void reset() {
+        ws = wc = 0;
+        index = 0;
+    }
+
+    Acc estimate() const {
+        return (ws * Reference::SIN[index] + wc * Reference::COS[index]) >> HUM_REF_SHIFT;
+    }
+
+    void update(Acc e) {
+        int32_t eu = e > ERROR_MAX ? ERROR_MAX : (e < -ERROR_MAX ? -ERROR_MAX : e);
+        const int shift = HUM_REF_SHIFT + MuShift;
+        ws = clampWeight(ws + ((eu * Reference::SIN[index] + (1L << (shift - 1))) >> shift));
+        wc = clampWeight(wc + ((eu * Reference::COS[index] + (1L << (shift - 1))) >> shift));
+        if (++index == Reference::LENGTH) index = 0;
+    }
+
+    int16_t amplitude() const {
+        return (int16_t)(((ws < 0 ? -ws : ws) + (wc < 0 ? -wc : wc)) >> WEIGHT_SHIFT);
+    }
+
+private:
+    int32_t ws, wc;
+    uint8_t index;
+
+    static int32_t clampWeight(int32_t w) { return w > WEIGHT_MAX ? WEIGHT_MAX : (w < -WEIGHT_MAX ? -WEIGHT_MAX : w); }
+};
+
+// ---------------------------------------------------------------------------
+// Etapa de la cadena: 50 y 60 Hz a la vez hasta engancharse a una
+
+constexpr uint8_t HUM_LOCK_MIN = 4; // cuentas ADC
+
+template <typename T, uint32_t RateHz, uint8_t MuShift = 6>
+class PowerlineCanceller {
+public:
+    typedef T Value;
+    typedef HumLMS<T, RateHz, 50, MuShift> Lms50;
+    typedef HumLMS<T, RateHz, 60, MuShift> Lms60;
+    typedef typename Lms50::Acc Acc;
+    static constexpr uint32_t LOCK_SAMPLES = 2 * RateHz;
+
+    // Frecuencia de red enganchada: 0 mientras busca
+    uint8_t mainsHz() const { return locked; }
+
+    T reset(T initial) {
+        lms50.reset();
+        lms60.reset();
+        locked = 0;
+        lockCandidate = 0;
+        lockCount = 0;
+        y = initial;
+        return y;
+    }
+
+    T process(T x) {
+        Acc e = Lms50::toAcc(x);
+        if (locked != 60) e -= lms50.estimate();
+        if (locked != 50) e -= lms60.estimate();
+        if (locked != 60) lms50.update(e);
+        if (locked != 50) lms60.update(e);
+        if (!locked) track(lms50.amplitude(), lms60.amplitude());
+        y = Lms50::fromAcc(e);
+        return y;
+    }
+
+    T last() const { return y; }
+
+private:
+    Lms50 lms50;
+    Lms60 lms60;
+    uint8_t locked;
+    uint8_t lockCandidate;
+    uint16_t lockCount;
+    T y;
+
+    template <typename A>
+    void track(A a50, A a60) {
+        uint8_t candidate = 0;
+        if (a50 >= HUM_LOCK_MIN && a50 >= 2 * a60) candidate = 50;
+        else if (a60 >= HUM_LOCK_MIN && a60 >= 2 * a50) candidate = 60;
+
+        // Solo cuentan las muestras seguidas con el mismo candidato
+        if (candidate != lockCandidate) lockCount = 0;
+        lockCandidate = candidate;
+        if (candidate != 0 && ++lockCount >= LOCK_SAMPLES) locked = candidate;
+    }
+};
+
+#endif // POWERLINE_CANCELLER_H
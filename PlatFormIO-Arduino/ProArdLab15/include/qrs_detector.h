@@ -0,0 +1,303 @@
+/**
+ * @file qrs_detector.h
+ * @brief Detector de QRS en streaming tipo Pan-Tompkins (umbrales adaptativos)
+ *
+ * Etapas por muestra, todas O(1) y en aritmética entera:
+ *   derivada de 5 puntos -> cuadrado -> integración en ventana móvil (150 ms)
+ *   -> detección de picos -> clasificación señal/ruido con umbrales adaptativos
+ *   -> discriminación de onda T y búsqueda hacia atrás (search-back).
+ *
+ * La entrada es la salida lp de ECGFilter (DC eliminado y suavizado), que
+ * hace el papel del paso-banda del algoritmo original. No depende de
+ * Arduino.h, así que se puede verificar en el host con el entorno native.
+ */
+
+#ifndef QRS_DETECTOR_H
+#define QRS_DETECTOR_H
+
+#include <stdint.h>
+
+template <uint16_t RateHz>
+class QRSDetector {
+public:
+    // Ventanas en muestras derivadas de la frecuencia de muestreo
+    static constexpr uint16_t MWI_WINDOW = (uint16_t)(RateHz * 150UL / 1000);    // integración
+    static constexpr uint16_t REFRACTORY = (uint16_t)(RateHz * 200UL / 1000);    // periodo refractario
+    static constexpr uint16_t T_WAVE_WINDOW = (uint16_t)(RateHz * 360UL / 1000); // posible onda T
+    static constexpr uint16_t PEAK_TIMEOUT = (uint16_t)(RateHz * 95UL / 1000);   // fin de un pico
+    static constexpr uint16_t LEARNING = 2 * RateHz;                             // fase de aprendizaje
+    static constexpr uint16_t LOST_LIMIT = 3 * RateHz;                           // sin QRS -> reaprender
+    static constexpr uint8_t RR_HISTORY = 8;
+
+    // Retardo aproximado entre el pico R y el máximo de la integración
+    // (medido con el generador sintético del entorno native)
+    static constexpr uint16_t DELAY = MWI_WINDOW / 4 + 2;
+
+    QRSDetector() { reset(); }
+
+    void reset() {
+        n = 0;
+        for (uint8_t i = 0; i < 4; i++) x[i] = 0;
+        for (uint16_t i = 0; i < MWI_WINDOW; i++) mwiBuffer[i] = 0;
+        mwiIndex = 0;
+        mwiSum = 0;
+        prevMwi = 0;
+
+        rising = false;
+        candPeak = 0;
+        candIndex = 0;
+        slope = 0;
+
+        startLearning();
+    }
+
+    /**
+     * Procesa una muestra filtrada.
+     * @return true si en esta llamada se ha confirmado un QRS
+     *         (su posición está en lastBeatSample()).
+     */
+    bool process(int16_t sample) {
+        // Derivada de 5 puntos: (2x[n] + x[n-1] - x[n-3] - 2x[n-4]) / 8
+        int32_t d = (2L * sample + x[0] - x[2] - 2L * x[3]) >> 3;
+        x[3] = x[2];
+        x[2] = x[1];
+        x[1] = x[0];
+        x[0] = sample;
+        if (d > 4095) d = 4095;
+        if (d < -4095) d = -4095;
+
+        uint16_t absD = (uint16_t)(d < 0 ? -d : d);
+        if (absD > slope) slope = absD;
+
+        // Cuadrado e integración. Los umbrales se comparan contra la suma de
+        // la ventana (no contra la media) para evitar una división por muestra.
+        uint32_t sq = (uint32_t)(d * d);
+        mwiSum -= mwiBuffer[mwiIndex];
+        mwiBuffer[mwiIndex] = sq;
+        mwiSum += sq;
+        if (++mwiIndex == MWI_WINDOW) mwiIndex = 0;
+
+        bool beat = false;
+        if (learning) {
+            learnSum += mwiSum >> 6;
+        }
+
+        // Detección de picos: máximo local confirmado cuando la señal cae a la
+        // mitad o pasa PEAK_TIMEOUT sin superarse
+        if (!rising) {
+            if (mwiSum > prevMwi) {
+                rising = true;
+                candPeak = mwiSum;
+                candIndex = n;
+            }
+        } else if (mwiSum > candPeak) {
+            candPeak = mwiSum;
+            candIndex = n;
+        } else if (mwiSum < (candPeak >> 1) || (n - candIndex) > PEAK_TIMEOUT) {
+            // slope = máxima |derivada| desde el pico anterior (flancos del QRS)
+            beat = classifyPeak(candPeak, candIndex, slope);
+            rising = false;
+            slope = 0;
+        }
+        prevMwi = mwiSum;
+
+        if (learning) {
+            if (n - learnStart >= LEARNING) finishLearning();
+        } else if (!beat) {
+            uint32_t since = n - lastQrsIndex;
+            // Búsqueda hacia atrás: demasiado tiempo sin QRS, se acepta el mejor
+            // pico que superó el umbral secundario
+            if (rrCount > 0 && since > missLimit && sbPeak > 0) {
+                acceptQrs(sbPeak, sbIndex, sbSlope, true);
+                beat = true;
+            } else if (since > LOST_LIMIT && since > 2 * missLimit) {
+                // Se ha perdido la señal (amplitud muy distinta): reaprender
+                startLearning();
+            }
+        }
+
+        n++;
+        return beat;
+    }
+
+    // Índice de muestra (contador interno) del último QRS, corregido por DELAY
+    uint32_t lastBeatSample() const { return lastQrsIndex - DELAY; }
+
+    // Último intervalo RR en muestras (0 si aún no hay dos latidos)
+    uint16_t lastRR() const { return lastRr; }
+
+    // Media de los RR "regulares" en muestras (0 si no hay historia)
+    uint16_t rrAverage() const { return rrAvg2; }
+
+    // Contador de muestras procesadas desde reset()
+    uint32_t sampleCount() const { return n; }
+
+    bool isLearning() const { return learning; }
+    bool isInRefractory() const { return !learning && hasQrs && (n - lastQrsIndex) <= REFRACTORY; }
+    uint32_t signalLevel() const { return spki; }
+    uint32_t noiseLevel() const { return npki; }
+    uint32_t threshold() const { return threshold1; }
+
+private:
+    uint32_t n;
+
+    // Derivada
+    int16_t x[4];
+
+    // Integración en ventana móvil
+    uint32_t mwiBuffer[MWI_WINDOW];
+    uint16_t mwiIndex;
+    uint32_t mwiSum;
+    uint32_t prevMwi;
+
+    // Pico en curso
+    bool rising;
+    uint32_t candPeak;
+    uint32_t candIndex;
+    uint16_t slope;
+
+    // Aprendizaje inicial
+    bool learning;
+    uint32_t learnStart;
+    uint32_t learnMax;
+    uint32_t learnSum;
+
+    // Niveles y umbrales adaptativos (unidades de mwiSum)
+    uint32_t spki;
+    uint32_t npki;
+    uint32_t threshold1;
+    uint32_t threshold2;
+
+    // Último QRS y candidato para la búsqueda hacia atrás
+    bool hasQrs;
+    uint32_t lastQrsIndex;
+    uint16_t lastQrsSlope;
+    uint32_t sbPeak;
+    uint32_t sbIndex;
+    uint16_t sbSlope;
+
+    // Historia RR: media de los 8 últimos y de los 8 últimos regulares
+    uint16_t rr1[RR_HISTORY];
+    uint16_t rr2[RR_HISTORY];
+    uint32_t rr1Sum;
+    uint32_t rr2Sum;
+    uint8_t rr1Index;
+    uint8_t rr2Index;
+    uint8_t rrCount;
+    uint8_t rr2Count;
+    uint16_t rrAvg2;
+    uint16_t lastRr;
+    uint32_t missLimit;
+
+    void startLearning() {
+        learning = true;
+        learnStart = n;
+        learnMax = 0;
+        learnSum = 0;
+        spki = npki = threshold1 = threshold2 = 0;
+        hasQrs = false;
+        lastQrsIndex = n;
+        lastQrsSlope = 0;
+        sbPeak = 0;
+        sbIndex = 0;
+        sbSlope = 0;
+        for (uint8_t i = 0; i < RR_HISTORY; i++) rr1[i] = rr2[i] = 0;
+        rr1Sum = rr2Sum = 0;
+        rr1Index = rr2Index = 0;
+        rrCount = rr2Count = 0;
+        rrAvg2 = 0;
+        lastRr = 0;
+        missLimit = 0;
+    }
+
+    void finishLearning() {
+        learning = false;
+        // Pan-Tompkins: señal = 1/3 del máximo, ruido = 1/2 de la media
+        spki = learnMax / 3;
+        npki = (learnSum / LEARNING) << 5;
+        updateThresholds();
+        lastQrsIndex = n;
+    }
+
+    void updateThresholds() {
+        threshold1 = npki + ((spki > npki ? spki - npki : 0) >> 2);
+        threshold2 = threshold1 >> 1;
+    }
+
+    bool classifyPeak(uint32_t peak, uint32_t index, uint16_t peakSlope) {
+        if (learning) {
+            if (peak > learnMax) learnMax = peak;
+            return false;
+        }
+
+        uint32_t since = index - lastQrsIndex;
+        bool outOfRefractory = !hasQrs || since > REFRACTORY;
+
+        if (peak > threshold1 && outOfRefractory) {
+            // Onda T: pico cercano al QRS anterior con pendiente menor que la mitad
+            bool tWave = hasQrs && since < T_WAVE_WINDOW && peakSlope < (lastQrsSlope >> 1);
+            if (!tWave) {
+                acceptQrs(peak, index, peakSlope, false);
+                return true;
+            }
+        }
+
+        npki += ((int32_t)(peak - npki)) >> 3;
+        updateThresholds();
+        if (peak > threshold2 && outOfRefractory && peak > sbPeak) {
+            sbPeak = peak;
+            sbIndex = index;
+            sbSlope = peakSlope;
+        }
+        return false;
+    }
+
+    void acceptQrs(uint32_t peak, uint32_t index, uint16_t peakSlope, bool searchBack) {
+        // En search-back la señal se actualiza con peso 1/4 en lugar de 1/8
+        if (searchBack) {
+            spki += ((int32_t)(peak - spki)) >> 2;
+        } else {
+            spki += ((int32_t)(peak - spki)) >> 3;
+        }
+        updateThresholds();
+
+        if (hasQrs) {
+            uint32_t rr = index - lastQrsIndex;
+            lastRr = rr > 0xFFFF ? 0xFFFF : (uint16_t)rr;
+            addRR(lastRr);
+        }
+
+        hasQrs = true;
+        lastQrsIndex = index;
+        lastQrsSlope = peakSlope;
+        sbPeak = 0;
+    }
+
+    void addRR(uint16_t rr) {
+        rr1Sum -= rr1[rr1Index];
+        rr1[rr1Index] = rr;
+        rr1Sum += rr;
+        if (++rr1Index == RR_HISTORY) rr1Index = 0;
+        if (rrCount < RR_HISTORY) rrCount++;
+
+        // Solo los RR entre el 92 % y el 116 % de la media regular entran en ella
+        bool regular = rr2Count == 0 ||
+                       ((uint32_t)rr * 25 >= (uint32_t)rrAvg2 * 23 &&
+                        (uint32_t)rr * 25 <= (uint32_t)rrAvg2 * 29);
+        if (regular) {
+            rr2Sum -= rr2[rr2Index];
+            rr2[rr2Index] = rr;
+            rr2Sum += rr;
+            if (++rr2Index == RR_HISTORY) rr2Index = 0;
+            if (rr2Count < RR_HISTORY) rr2Count++;
+            rrAvg2 = (uint16_t)(rr2Sum / rr2Count);
+        } else if (rrCount == RR_HISTORY && rr2Count < RR_HISTORY) {
+            // Ritmo irregular desde el principio: usar la media de los 8 últimos
+            rrAvg2 = (uint16_t)(rr1Sum / RR_HISTORY);
+        }
+
+        missLimit = (uint32_t)rrAvg2 * 166 / 100;
+    }
+};
+
+#endif // QRS_DETECTOR_H
@@ -0,0 +1,211 @@
+/**
+ * @file respiration.h
+ * @brief Frecuencia respiratoria derivada del ECG (EDR), incremental por latido
+ *
+ * La respiración modula el ECG de dos formas sin otro sensor:
+ *   - la línea base, la componente de baja frecuencia que el paso-alto de
+ *     ecg_dsp.h estima y descarta. ECGMonitor la mide como la media del
+ *     crudo entre dos latidos, que además anula la forma del propio latido;
+ *   - la amplitud del QRS (pico a pico del filtrado alrededor de la onda
+ *     R), que cambia con el eje eléctrico y la impedancia del tórax.
+ * RespirationEstimator recibe un valor de cada una por latido y, en cada
+ * serie por separado:
+ *   1. le quita la tendencia (media exponencial de 2^TREND_SHIFT latidos)
+ *      y la suaviza con la media de los dos últimos latidos;
+ *   2. busca los cruces por cero ascendentes con histéresis (la mitad de
+ *      la media de |x|, también exponencial): uno por ciclo respiratorio.
+ *      Solo cuentan si esa media supera un mínimo (MIN_AMPLITUDE_PERCENT
+ *      de la amplitud del QRS, MIN_BASELINE_COUNTS de línea base): sin
+ *      respiración los cruces del ruido podrían salir regulares por azar;
+ *   3. guarda los últimos BREATHS intervalos entre cruces (de MIN_RPM a
+ *      MAX_RPM) con su suma y su suma de cuadrados.
+ * La frecuencia es 60 / intervalo medio de la serie más regular (menor
+ * coeficiente de variación), si tiene MIN_BREATHS intervalos y su
+ * variación no pasa de MAX_CV_PERCENT. Sin cruces en MAX_INTERVAL (apnea)
+ * la serie se vacía y deja de dar estimación.
+ *
+ * O(1) por latido y memoria fija (120 bytes), en enteros salvo la
+ * estimación, que se calcula al consultarla. Los latidos muestrean la
+ * respiración: solo se mide por debajo de la mitad de la FC (40 rpm
+ * necesitan más de 80 lpm). El benchmark "resp" del entorno native lo
+ * valida con señales sintéticas moduladas en amplitud y en línea base.
+ */
+
+#ifndef RESPIRATION_H
+#define RESPIRATION_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Serie de la que sale la estimación
+enum RespirationSource : uint8_t {
+    RESP_SOURCE_NONE = 0,
+    RESP_SOURCE_AMPLITUDE = 1,   // amplitud del QRS
+    RESP_SOURCE_BASELINE = 2     // línea base
+};
+
+struct RespirationEstimate {
+    float rate;          // respiraciones por minuto, 0 = sin estimación
+    uint8_t source;      // RespirationSource
+    uint8_t regularity;  // 100 - coeficiente de variación de los intervalos, %
+};
+
+template <uint16_t RateHz>
+class RespirationEstimator {
+public:
+    static constexpr uint8_t MIN_RPM = 4;
+    static constexpr uint8_t MAX_RPM = 40;
+    static constexpr uint8_t BREATHS = 8;          // intervalos por serie
+    static constexpr uint8_t MIN_BREATHS = 4;
+    static constexpr uint8_t MAX_CV_PERCENT = 20;
+    static constexpr uint8_t TREND_SHIFT = 3;      // tendencia: 8 latidos
+    static constexpr uint8_t LEVEL_SHIFT = 3;      // media de |x|: 8 latidos
+    static constexpr uint8_t MIN_AMPLITUDE_PERCENT = 2;
+    static constexpr uint8_t MIN_BASELINE_COUNTS = 2;
+    static constexpr uint32_t MIN_INTERVAL = 60UL * RateHz / MAX_RPM;
+    static constexpr uint32_t MAX_INTERVAL = 60UL * RateHz / MIN_RPM;
+    static_assert((uint64_t)BREATHS * MAX_INTERVAL * MAX_INTERVAL <= 0xFFFFFFFFUL,
+                  "la suma de cuadrados de los intervalos debe caber en 32 bits");
+
+    RespirationEstimator() { reset(); }
+
+    void reset() {
+        amplitude.reset(MIN_AMPLITUDE_PERCENT, 0);
+        baseline.reset(0, MIN_BASELINE_COUNTS);
+    }
+
+    /**
+     * Un latido: índice de su pico R, amplitud del QRS y nivel de línea
+     * base (en las unidades que sean: la histéresis es relativa).
+     */
+    void onBeat(uint32_t sample, int16_t qrsAmplitude, int16_t baselineLevel) {
+        amplitude.add(sample, qrsAmplitude);
+        baseline.add(sample, baselineLevel);
+    }
+
+    // Estimación en la muestra 'now' (reloj de muestras)
+    RespirationEstimate estimate(uint32_t now) const {
+        RespirationEstimate e = {0.0f, RESP_SOURCE_NONE, 0};
+        float cvAmplitude = amplitude.variation(now);
+        float cvBaseline = baseline.variation(now);
+        const Series* best = &amplitude;
+        float cv = cvAmplitude;
+        uint8_t source = RESP_SOURCE_AMPLITUDE;
+        if (cvBaseline < cvAmplitude) {
+            best = &baseline;
+            cv = cvBaseline;
+            source = RESP_SOURCE_BASELINE;
+        }
+        if (cv > MAX_CV_PERCENT) return e;
+
+        e.rate = 60.0f * RateHz * best->count / best->sum;
+        e.source = source;
+        e.regularity = (uint8_t)(100.0f - cv + 0.5f);
+        return e;
+    }
+
+    // Ciclos contados en cada serie desde reset()
+    uint32_t amplitudeBreaths() const { return amplitude.crossings; }
+    uint32_t baselineBreaths() const { return baseline.crossings; }
+
+private:
+    struct Series {
+        bool primed;
+        int32_t trend;       // Q8
+        int32_t prev;        // valor sin tendencia del latido anterior, Q8
+        int32_t level;       // media de |x|, Q8
+        int8_t state;        // +1 sobre la histéresis, -1 bajo ella
+        bool haveCross;
+        uint32_t lastCross;
+        uint32_t crossings;
+        uint16_t intervals[BREATHS];
+        uint8_t head;
+        uint8_t count;
+        uint32_t sum;
+        uint32_t sumSq;
+        uint8_t minPercent;  // mínimo de la media de |x|: % de la tendencia
+        uint8_t minCounts;   // o valor absoluto
+
+        void reset(uint8_t percent, uint8_t counts) {
+            minPercent = percent;
+            minCounts = counts;
+            primed = false;
+            trend = prev = level = 0;
+            state = 0;
+            haveCross = false;
+            lastCross = 0;
+            crossings = 0;
+            clear();
+        }
+
+        void clear() {
+            head = count = 0;
+            sum = sumSq = 0;
+        }
+
+        void add(uint32_t sample, int16_t v) {
+            int32_t x = (int32_t)v << 8;
+            if (!primed) {
+                trend = x;
+                primed = true;
+                return;
+            }
+            trend += (x - trend) >> TREND_SHIFT;
+            int32_t d = x - trend;
+            int32_t s = (d + prev) / 2;
+            prev = d;
+            level += ((s < 0 ? -s : s) - level) >> LEVEL_SHIFT;
+
+            if (haveCross && sample - lastCross > MAX_INTERVAL) {
+                haveCross = false;
+                clear();
+            }
+            int32_t magnitude = trend < 0 ? -trend : trend;
+            int32_t minLevel = ((int32_t)minCounts << 8) + magnitude / 100 * minPercent;
+            if (level < minLevel) return;
+            int32_t hysteresis = level / 2;
+            if (state <= 0 && s > hysteresis) {
+                state = 1;
+                cross(sample);
+            } else if (state >= 0 && s < -hysteresis) {
+                state = -1;
+            }
+        }
+
+        void cross(uint32_t sample) {
+            if (haveCross) {
+                uint32_t interval = sample - lastCross;
+                // Más rápido que MAX_RPM: ruido entre dos cruces de verdad
+                if (interval < MIN_INTERVAL) return;
+                if (count == BREATHS) {
+                    uint32_t old = intervals[head];
+                    sum -= old;
+                    sumSq -= old * old;
+                } else {
+                    count++;
+                }
+                intervals[head] = (uint16_t)interval;
+                head = head + 1 == BREATHS ? 0 : head + 1;
+                sum += interval;
+                sumSq += interval * interval;
+            }
+            haveCross = true;
+            lastCross = sample;
+            crossings++;
+        }
+
+        // Coeficiente de variación de los intervalos en %, o uno mayor que
+        // MAX_CV_PERCENT si la serie no da estimación en 'now'
+        float variation(uint32_t now) const {
+            if (count < MIN_BREATHS || now - lastCross > MAX_INTERVAL) return 1000.0f;
+            float mean = (float)sum / count;
+            float var = (float)sumSq / count - mean * mean;
+            return var > 0 ? 100.0f * sqrtf(var) / mean : 0.0f;
+        }
+    };
+
+    Series amplitude;
+    Series baseline;
+};
+
+#endif // RESPIRATION_H
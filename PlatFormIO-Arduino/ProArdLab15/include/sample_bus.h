@@ -0,0 +1,348 @@
+/**
+ * @file sample_bus.h
+ * @brief Bus publicador/suscriptor de bloques de muestras con memoria fija y sin copias
+ *
+ * La adquisición publica cada bloque una sola vez; los consumidores
+ * (serie, LCD, flash, red...) se suscriben con su profundidad de cola, su
+ * política de saturación y su ritmo, y cada uno los recoge cuando quiere.
+ *
+ * Los bloques viven en un pool fijo de Blocks entradas con cuenta de
+ * referencias. claim() da al productor un bloque libre para rellenarlo en
+ * su sitio (ECGMonitor::processBlock() escribe directamente en él) y
+ * publish() lo entrega, sin copiarlo, a la cola de cada suscriptor: solo
+ * viaja su índice. El bloque vuelve al pool cuando el último suscriptor lo
+ * suelta.
+ *
+ * Ningún suscriptor puede frenar la adquisición: subscribe() reserva en el
+ * pool su profundidad más el bloque que esté leyendo, así que claim()
+ * siempre encuentra uno libre y publish() nunca espera. Si la cola de un
+ * suscriptor está llena, según su política:
+ *   - BUS_DROP_NEWEST: el bloque nuevo no se le entrega y se cuenta como
+ *     perdido (serie, flash: lo que llega, llega en orden y sin huecos
+ *     ocultos).
+ *   - BUS_KEEP_LATEST: buzón de un solo bloque; el nuevo sustituye al que
+ *     no ha recogido (LCD: solo le interesa el último estado).
+ * Con 'divider' = N el suscriptor recibe uno de cada N bloques.
+ *
+ * Los latidos van aparte, como eventos pequeños copiados a una cola de
+ * EVENT_DEPTH por suscriptor: así un suscriptor BUS_KEEP_LATEST no pierde
+ * el latido de un bloque sustituido.
+ *
+ * Un productor; cada suscriptor, un consumidor (puede ser otra tarea u
+ * otro núcleo). subscribe() va en setup(), antes de publicar. Usa
+ * std::atomic, como spsc_ring.h: ESP32 y host, no AVR.
+ */
+
+#ifndef SAMPLE_BUS_H
+#define SAMPLE_BUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <atomic>
+
+enum BusPolicy : uint8_t {
+    BUS_DROP_NEWEST,
+    BUS_KEEP_LATEST,
+};
+
+// Contadores de un suscriptor, en bloques (eventos y droppedSamples aparte)
+struct BusSubscriberStats {
+    uint32_t delivered;       // entregados a su cola o buzón
+    uint32_t dropped;         // no entregados (cola llena) o sustituidos sin leer
+    uint32_t droppedSamples;  // muestras de esos bloques (count de cada uno)
+    uint32_t pending;         // esperando ahora mismo
+    uint32_t maxPending;      // máximo de pending visto al publicar
+    uint32_t lag;             // bloques publicados desde el último que recogió
+    uint32_t eventsDropped;   // eventos perdidos con su cola llena
+};
+
+template <typename Sample, uint8_t BlockSize>
+struct BusBlock {
+    uint32_t sequence;      // número de bloque publicado, desde 0
+    uint32_t firstSample;   // índice (reloj de muestras) de samples[0]
+    uint8_t count;
+    Sample samples[BlockSize];
+};
+
+template <typename Sample, typename Event, uint8_t BlockSize, uint8_t Blocks, uint8_t MaxSubscribers = 4>
+class SampleBus {
+public:
+    typedef BusBlock<Sample, BlockSize> Block;
+    static constexpr uint8_t MAX_DEPTH = 16;     // potencia de 2
+    static constexpr uint8_t EVENT_DEPTH = 4;    // potencia de 2
+    static constexpr uint8_t NONE = 0xFF;
+
+    static_assert(Blocks >= 2 && Blocks < NONE, "pool de 2 a 254 bloques");
+    static_assert(MaxSubscribers >= 1, "al menos un suscriptor");
+
+    SampleBus() : subscriberCount(0), reserved(1), cursor(0), nextSequence(0), claimed(NONE) {
+        for (uint8_t i = 0; i < Blocks; i++) refs[i].store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * Da de alta un suscriptor. 'depth' bloques de cola (1 con
+     * BUS_KEEP_LATEST), de 1 a MAX_DEPTH.
+     * @return su identificador, o -1 si no caben más o su reserva no cabe en el pool
+     */
+    int8_t subscribe(const char* name, uint8_t depth, BusPolicy policy, uint8_t divider = 1, bool events = false) {
+        if (policy == BUS_KEEP_LATEST) depth = 1;
+        if (subscriberCount == MaxSubscribers || depth == 0 || depth > MAX_DEPTH || divider == 0) return -1;
+        if (reserved + depth + 1 > Blocks) return -1;
+        reserved += depth + 1;
+
+        Subscriber& s = subs[subscriberCount];
+        s.name = name;
+        s.depth = depth;
+        s.policy = policy;
+        s.divider = divider;
+        s.events = events;
+        s.head.store(0, std::memory_order_relaxed);
+        s.tail.store(0, std::memory_order_relaxed);
+        s.mailbox.store(NONE, std::memory_order_relaxed);
+        s.eventHead.store(0, std::memory_order_relaxed);
+        s.eventTail.store(0, std::memory_order_relaxed);
+        s.held = NONE;
+        s.delivered.store(0, std::memory_order_relaxed);
+        s.dropped.store(0, std::memory_order_relaxed);
+        s.droppedSamples.store(0, std::memory_order_relaxed);
+        s.maxPending.store(0, std::memory_order_relaxed);
+        s.lastSequence.store(0, std::memory_order_relaxed);
+        s.eventsDropped.store(0, std::memory_order_relaxed);
+        return (int8_t)subscriberCount++;
+    }
+
+    // ---- Productor ----
+
+    /**
+     * Bloque libre para rellenar; el mismo hasta publish(). Con la reserva
+     * de subscribe() siempre hay uno: nullptr solo si se llama sin haber
+     * publicado el anterior y el pool está lleno por un fallo de uso.
+     */
+    Block* claim() {
+        if (claimed != NONE) return &pool[claimed];
+        for (uint8_t n = 0; n < Blocks; n++) {
+            uint8_t i = cursor;
+            cursor = cursor + 1 == Blocks ? 0 : cursor + 1;
+            if (refs[i].load(std::memory_order_acquire) == 0) {
+                claimed = i;
+                return &pool[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // Entrega el bloque de claim() con 'count' muestras a los suscriptores
+    void publish(uint8_t count, uint32_t firstSample) {
+        if (claimed == NONE) return;
+        uint8_t index = claimed;
+        claimed = NONE;
+        Block& b = pool[index];
+        b.sequence = nextSequence.load(std::memory_order_relaxed);
+        nextSequence.store(b.sequence + 1, std::memory_order_relaxed);
+        b.firstSample = firstSample;
+        b.count = count;
+
+        // Referencia propia mientras se reparte: no vuelve al pool a medias
+        refs[index].store(1, std::memory_order_relaxed);
+        for (uint8_t k = 0; k < subscriberCount; k++) {
+            Subscriber& s = subs[k];
+            if (b.sequence % s.divider != 0) continue;
+            if (s.policy == BUS_KEEP_LATEST) {
+                refs[index].fetch_add(1, std::memory_order_relaxed);
+                uint8_t old = s.mailbox.exchange(index, std::memory_order_acq_rel);
+                if (old != NONE) {
+                    add(s.droppedSamples, pool[old].count);
+                    unref(old);
+                    bump(s.dropped);
+                }
+                bump(s.delivered);
+                raise(s.maxPending, 1);
+                continue;
+            }
+            uint32_t h = s.head.load(std::memory_order_relaxed);
+            uint32_t pending = h - s.tail.load(std::memory_order_acquire);
+            if (pending >= s.depth) {
+                bump(s.dropped);
+                add(s.droppedSamples, count);
+                continue;
+            }
+            refs[index].fetch_add(1, std::memory_order_relaxed);
+            s.queue[h & (MAX_DEPTH - 1)] = index;
+            s.head.store(h + 1, std::memory_order_release);
+            bump(s.delivered);
+            raise(s.maxPending, pending + 1);
+        }
+        unref(index);
+    }
+
+    // Copia 'event' a la cola de eventos de cada suscriptor que los pidió
+    void publishEvent(const Event& event) {
+        for (uint8_t k = 0; k < subscriberCount; k++) {
+            Subscriber& s = subs[k];
+            if (!s.events) continue;
+            uint32_t h = s.eventHead.load(std::memory_order_relaxed);
+            if (h - s.eventTail.load(std::memory_order_acquire) == EVENT_DEPTH) {
+                bump(s.eventsDropped);
+                continue;
+            }
+            s.eventQueue[h & (EVENT_DEPTH - 1)] = event;
+            s.eventHead.store(h + 1, std::memory_order_release);
+        }
+    }
+
+    // ---- Suscriptor 'id' (cada uno desde un solo hilo) ----
+
+    /**
+     * Suelta el bloque devuelto la vez anterior y da el siguiente, o
+     * nullptr si no hay (también lo suelta). El puntero vale hasta la
+     * siguiente llamada o hasta release().
+     */
+    const Block* next(int8_t id) {
+        Subscriber& s = subs[id];
+        release(id);
+        uint8_t index;
+        if (s.policy == BUS_KEEP_LATEST) {
+            index = s.mailbox.exchange(NONE, std::memory_order_acq_rel);
+            if (index == NONE) return nullptr;
+        } else {
+            uint32_t t = s.tail.load(std::memory_order_relaxed);
+            if (t == s.head.load(std::memory_order_acquire)) return nullptr;
+            index = s.queue[t & (MAX_DEPTH - 1)];
+            s.tail.store(t + 1, std::memory_order_release);
+        }
+        s.held = index;
+        s.lastSequence.store(pool[index].sequence + 1, std::memory_order_relaxed);
+        return &pool[index];
+    }
+
+    // Suelta el bloque que tenga el suscriptor, si tiene alguno
+    void release(int8_t id) {
+        Subscriber& s = subs[id];
+        if (s.held == NONE) return;
+        unref(s.held);
+        s.held = NONE;
+    }
+
+    bool nextEvent(int8_t id, Event& out) {
+        Subscriber& s = subs[id];
+        uint32_t t = s.eventTail.load(std::memory_order_relaxed);
+        if (t == s.eventHead.load(std::memory_order_acquire)) return false;
+        out = s.eventQueue[t & (EVENT_DEPTH - 1)];
+        s.eventTail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Bloques esperando a 'id' (aproximado desde otro hilo)
+    uint32_t pending(int8_t id) const {
+        const Subscriber& s = subs[id];
+        if (s.policy == BUS_KEEP_LATEST) return s.mailbox.load(std::memory_order_relaxed) != NONE ? 1 : 0;
+        return s.head.load(std::memory_order_relaxed) - s.tail.load(std::memory_order_relaxed);
+    }
+
+    // ---- Estadísticas (desde cualquier hilo; instantánea aproximada) ----
+
+    uint8_t subscribers() const { return subscriberCount; }
+    const char* name(int8_t id) const { return subs[id].name; }
+    uint32_t published() const { return nextSequence.load(std::memory_order_relaxed); }
+
+    BusSubscriberStats stats(int8_t id) const {
+        const Subscriber& s = subs[id];
+        BusSubscriberStats st;
+        st.delivered = s.delivered.load(std::memory_order_relaxed);
+        st.dropped = s.dropped.load(std::memory_order_relaxed);
+        st.droppedSamples = s.droppedSamples.load(std::memory_order_relaxed);
+        st.pending = pending(id);
+        st.maxPending = s.maxPending.load(std::memory_order_relaxed);
+        st.lag = published() - s.lastSequence.load(std::memory_order_relaxed);
+        st.eventsDropped = s.eventsDropped.load(std::memory_order_relaxed);
+        return st;
+    }
+
+    // Pone a cero los contadores de pérdidas y máximos (no las colas). Solo
+    // el productor: es el único que los escribe
+    void resetStats() {
+        for (uint8_t k = 0; k < subscriberCount; k++) {
+            subs[k].delivered.store(0, std::memory_order_relaxed);
+            subs[k].dropped.store(0, std::memory_order_relaxed);
+            subs[k].droppedSamples.store(0, std::memory_order_relaxed);
+            subs[k].maxPending.store(0, std::memory_order_relaxed);
+            subs[k].eventsDropped.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Bloques del pool reservados por los suscriptores y el productor
+    uint8_t reservedBlocks() const { return reserved; }
+
+    // Bloques sin referencias ahora mismo (instantánea)
+    uint8_t freeBlocks() const {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < Blocks; i++) n += refs[i].load(std::memory_order_relaxed) == 0;
+        return n;
+    }
+    static constexpr uint8_t capacity() { return Blocks; }
+
+private:
+    struct Subscriber {
+        const char* name;
+        uint8_t depth;
+        BusPolicy policy;
+        uint8_t divider;
+        bool events;
+        uint8_t queue[MAX_DEPTH];
+        std::atomic<uint32_t> head;      // productor
+        std::atomic<uint32_t> tail;      // suscriptor
+        std::atomic<uint8_t> mailbox;    // BUS_KEEP_LATEST
+        uint8_t held;                    // bloque en lectura (solo el suscriptor)
+        Event eventQueue[EVENT_DEPTH];
+        std::atomic<uint32_t> eventHead;
+        std::atomic<uint32_t> eventTail;
+        std::atomic<uint32_t> delivered;
+        std::atomic<uint32_t> dropped;
+        std::atomic<uint32_t> droppedSamples;
+        std::atomic<uint32_t> maxPending;
+        std::atomic<uint32_t> lastSequence;  // secuencia + 1 del último recogido
+        std::atomic<uint32_t> eventsDropped;
+    };
+
+    Block pool[Blocks];
+    std::atomic<uint8_t> refs[Blocks];
+    Subscriber subs[MaxSubscribers];
+    uint8_t subscriberCount;
+    uint8_t reserved;
+    uint8_t cursor;
+    std::atomic<uint32_t> nextSequence;
+    uint8_t claimed;
+
+    void unref(uint8_t index) { refs[index].fetch_sub(1, std::memory_order_acq_rel); }
+
+    // Contadores de un solo escritor: sin read-modify-write atómico
+    static void bump(std::atomic<uint32_t>& c) { add(c, 1); }
+
+    static void add(std::atomic<uint32_t>& c, uint32_t n) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void raise(std::atomic<uint32_t>& c, uint32_t v) {
+        if (v > c.load(std::memory_order_relaxed)) c.store(v, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * Una línea "# bus <nombre>: ..." por suscriptor, con el formato de
+ * dumpTimingHistogram() (loop_stats.h). emit(const char*) recibe cada línea.
+ */
+template <typename Bus, typename Emit>
+void dumpBusStats(const Bus& bus, Emit emit) {
+    char line[192];
+    for (uint8_t k = 0; k < bus.subscribers(); k++) {
+        BusSubscriberStats st = bus.stats((int8_t)k);
+        snprintf(line, sizeof(line), "# bus %s: entregados=%lu perdidos=%lu (%lu muestras) pendientes=%lu max=%lu retraso=%lu eventos_perdidos=%lu",
+                 bus.name((int8_t)k), (unsigned long)st.delivered, (unsigned long)st.dropped,
+                 (unsigned long)st.droppedSamples, (unsigned long)st.pending, (unsigned long)st.maxPending, (unsigned long)st.lag,
+                 (unsigned long)st.eventsDropped);
+        emit(line);
+    }
+}
+
+#endif // SAMPLE_BUS_H
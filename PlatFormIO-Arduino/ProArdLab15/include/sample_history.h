@@ -0,0 +1,130 @@
+/**
+ * @file sample_history.h
+ * @brief Historia de muestras en arrays int16 con marcas de tiempo implícitas (reloj de muestras)
+ *
+ * Sustituye a CircularBuffer<ECGSample, 250> (int + float + millis(), 12
+ * bytes por muestra) por dos columnas int16, crudo y filtrado, en anillos
+ * de Capacity muestras (potencia de 2, índice con máscara) y un único
+ * contador de 32 bits. 4 bytes por muestra: 1 KB por segundo de historia a
+ * 250 Hz frente a 3 KB.
+ *
+ * La muestra i (contando desde reset()) se tomó en i * periodo: el muestreo
+ * lo marca un timer o el DMA, así que el tiempo sale del contador con la
+ * precisión del reloj de muestras, sin llamar a millis() por muestra ni
+ * heredar el retraso con que el loop las procesa. SampleClock hace esa
+ * conversión sin 64 bits (barata también en el AVR); el contador de 32 bits
+ * da 198 días a 250 Hz.
+ */
+
+#ifndef SAMPLE_HISTORY_H
+#define SAMPLE_HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Índice de muestra -> tiempo desde la muestra 0
+template <uint16_t RateHz>
+struct SampleClock {
+    static_assert(RateHz > 0 && RateHz <= 4000, "(índice % RateHz) * 10^6 debe caber en 32 bits");
+
+    static uint32_t toMillis(uint32_t index) {
+        return index / RateHz * 1000UL + index % RateHz * 1000UL / RateHz;
+    }
+
+    // Da la vuelta a los ~71 min, como micros()
+    static uint32_t toMicros(uint32_t index) {
+        return index / RateHz * 1000000UL + index % RateHz * 1000000UL / RateHz;
+    }
+};
+
+template <uint16_t RateHz, uint16_t Capacity>
+class SampleHistory {
+public:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity debe ser potencia de 2");
+
+    SampleHistory() { reset(); }
+
+    // Vacía la historia y vuelve a contar desde la muestra 0
+    void reset() {
+        count = 0;
+        raws[Capacity - 1] = 0;
+        filtereds[Capacity - 1] = 0;
+    }
+
+    void push(int16_t raw, int16_t filtered) {
+        uint16_t slot = (uint16_t)(count & (Capacity - 1));
+        raws[slot] = raw;
+        filtereds[slot] = filtered;
+        count++;
+    }
+
+    // push() de 'n' muestras seguidas, por tramos contiguos del anillo.
+    // Sin 'filtered' (nullptr) el filtrado se guarda como 0, sin electrodos.
+    void pushBlock(const int16_t* raw, const int16_t* filtered, size_t n) {
+        while (n > 0) {
+            uint16_t slot = (uint16_t)(count & (Capacity - 1));
+            size_t room = (size_t)(Capacity - slot);
+            size_t run = room < n ? room : n;
+            for (size_t i = 0; i < run; i++) {
+                raws[slot + i] = raw[i];
+                filtereds[slot + i] = filtered ? filtered[i] : 0;
+            }
+            count += run;
+            raw += run;
+            if (filtered) filtered += run;
+            n -= run;
+        }
+    }
+
+    // Avanza 'n' índices sin muestras (un hueco): se guardan como ceros
+    void skip(uint32_t n) {
+        uint32_t zeros = n < Capacity ? n : Capacity;
+        for (uint32_t i = n - zeros; i < n; i++) {
+            uint16_t slot = (uint16_t)((count + i) & (Capacity - 1));
+            raws[slot] = 0;
+            filtereds[slot] = 0;
+        }
+        count += n;
+    }
+
+    // Muestras recibidas desde reset(); la próxima tendrá este índice
+    uint32_t sampleCount() const { return count; }
+
+    // Muestras guardadas y primer índice que sigue en la historia
+    uint16_t size() const { return count < Capacity ? (uint16_t)count : Capacity; }
+    uint32_t oldestIndex() const { return count - size(); }
+    bool contains(uint32_t index) const { return index - oldestIndex() < size(); }
+
+    // Acceso por índice absoluto; solo válido si contains(index)
+    int16_t rawAt(uint32_t index) const { return raws[index & (Capacity - 1)]; }
+    int16_t filteredAt(uint32_t index) const { return filtereds[index & (Capacity - 1)]; }
+
+    // Última muestra (0 si aún no hay ninguna)
+    int16_t lastRaw() const { return raws[(count - 1) & (Capacity - 1)]; }
+    int16_t lastFiltered() const { return filtereds[(count - 1) & (Capacity - 1)]; }
+
+    /**
+     * Copia la señal filtrada desde 'from' (índice absoluto) en orden
+     * cronológico. Lo que ya no está en la historia no se copia.
+     * @return muestras copiadas
+     */
+    size_t copyFiltered(uint32_t from, int16_t* out, size_t maxCount) const {
+        if (from - oldestIndex() >= size()) return 0;
+        size_t available = count - from;
+        size_t n = available < maxCount ? available : maxCount;
+        for (size_t i = 0; i < n; i++) out[i] = filteredAt(from + i);
+        return n;
+    }
+
+    static uint32_t timeMs(uint32_t index) { return SampleClock<RateHz>::toMillis(index); }
+    static uint32_t timeUs(uint32_t index) { return SampleClock<RateHz>::toMicros(index); }
+
+    static constexpr uint16_t capacity() { return Capacity; }
+
+private:
+    int16_t raws[Capacity];
+    int16_t filtereds[Capacity];
+    uint32_t count;
+};
+
+#endif // SAMPLE_HISTORY_H
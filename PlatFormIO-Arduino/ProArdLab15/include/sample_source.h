@@ -0,0 +1,68 @@
+/**
+ * @file sample_source.h
+ * @brief Interfaz de fuente de muestras ECG que entrega bloques
+ *
+ * El consumidor (loop() o una tarea) pide bloques de muestras crudas en
+ * cuentas ADC. Implementaciones:
+ *   - TimerAnalogSource (esp32_sample_sources.h): timer + analogRead
+ *   - OversampledAnalogSource (esp32_sample_sources.h): timer a 2 kHz + CIC
+ *   - TimerAnalogMultiSource (esp32_sample_sources.h): varios canales por tick
+ *   - Esp32DmaSource (esp32_sample_sources.h): ADC continuo por DMA
+ *   - UnoTimerAdcSource y UnoOversampledAdcSource (uno_sample_sources.h):
+ *     ADC del UNO disparado por Timer1, con ISR y cola IsrRing
+ *   - FileReplaySource (src/native): reproduce una grabación en el host
+ * No depende de Arduino.h para poder usarla también en el entorno native.
+ */
+
+#ifndef SAMPLE_SOURCE_H
+#define SAMPLE_SOURCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class SampleSource {
+public:
+    virtual ~SampleSource() {}
+
+    // Configura el hardware o abre la grabación. false si no es posible.
+    virtual bool begin() = 0;
+
+    /**
+     * Copia en 'out' hasta 'maxCount' muestras ya adquiridas, sin bloquear.
+     * @return número de muestras copiadas (0 si no hay ninguna pendiente)
+     */
+    virtual size_t read(int16_t* out, size_t maxCount) = 0;
+
+    /**
+     * Igual que read(), pero puede bloquear hasta 'timeoutMs' esperando
+     * datos. Las fuentes sin espera nativa no bloquean.
+     */
+    virtual size_t readWait(int16_t* out, size_t maxCount, uint32_t timeoutMs) {
+        (void)timeoutMs;
+        return read(out, maxCount);
+    }
+
+    // Muestras perdidas porque el consumidor no leyó a tiempo
+    virtual uint32_t overruns() const { return 0; }
+
+    /**
+     * Canales por tick. Con más de uno, read() entrega tramas entrelazadas
+     * (canal 0, 1, ..., canal 0, ...) y el número devuelto es múltiplo de
+     * channels().
+     */
+    virtual uint8_t channels() const { return 1; }
+
+    /**
+     * Instante, en us de micros(), del tick del timer que corresponde a la
+     * primera muestra del último read() que devolvió datos; las siguientes
+     * van cada SAMPLE_INTERVAL_US. Sirve para medir la latencia desde la
+     * interrupción hasta el proceso. false si la fuente no lo sabe (DMA,
+     * reproducción de ficheros).
+     */
+    virtual bool firstSampleTickUs(uint32_t& us) const {
+        (void)us;
+        return false;
+    }
+};
+
+#endif // SAMPLE_SOURCE_H
@@ -0,0 +1,399 @@
+/**
+ * @file signal_quality.h
+ * @brief Índice de calidad de la señal en streaming y filtrado de latidos por artefactos
+ *
+ * Los pines LO+/LO- solo dicen si hay electrodos; un movimiento o un
+ * electrodo mal pegado produce picos que qrs_detector.h puede tomar por
+ * QRS. SignalQuality calcula, por ventanas de 1 s y con acumuladores
+ * actualizados en cada muestra:
+ *   - saturación: muestras crudas a menos de CLIP_MARGIN de los extremos
+ *     del ADC;
+ *   - deriva de línea base: RMS de lp bajo ~1.2 Hz (un paso-bajo de un
+ *     polo sobre lp) frente al pico de lp en la ventana;
+ *   - ruido de alta frecuencia: RMS de lo que quita la media móvil
+ *     (entrada de la media menos lp) frente al mismo pico;
+ *   - correlación media de los QRS de la ventana con una plantilla (media
+ *     de los latidos aceptados, TEMPLATE_LENGTH muestras alineadas en el
+ *     pico R).
+ *
+ * Cada componente se pasa a una puntuación 0-100 y el índice es la peor de
+ * ellas. Un latido se rechaza si el índice de la ventana anterior está por
+ * debajo de GATE, si la ventana en curso ya satura, si su correlación con
+ * la plantilla baja de CORRELATION_MIN o si cae sobre el pico R del latido
+ * anterior; acceptedRR() solo da intervalos entre dos latidos aceptados
+ * seguidos. Si la señal está limpia y se rechazan RELEARN_REJECTS latidos
+ * seguidos, la morfología ha cambiado y la plantilla se vuelve a aprender.
+ *
+ * El detector confirma el QRS ~35 muestras después del pico R, así que el
+ * veredicto suele salir en la misma llamada a addBeat(); la historia de lp
+ * (History muestras) cubre ese retraso y la búsqueda del pico. En el UNO,
+ * ~370 B de RAM.
+ *
+ * Aritmética entera de 32 bits por muestra (energías con >> 2, sin
+ * desbordar para ADC de hasta 12 bits y ventanas de 1 s a 250 Hz); dos
+ * divisiones de 64 bits por ventana y, por latido, 7 productos escalares
+ * de TEMPLATE_LENGTH y una raíz en double. El benchmark "quality" del
+ * entorno native mide el coste y el efecto sobre Se/PPV y la FC con
+ * artefactos sintéticos; los umbrales salen de ahí.
+ */
+
+#ifndef SIGNAL_QUALITY_H
+#define SIGNAL_QUALITY_H
+
+#include <stdint.h>
+#include <math.h>
+
+enum BeatVerdict : uint8_t {
+    BEAT_NONE,      // sin latido que decidir en esta muestra
+    BEAT_ACCEPTED,
+    BEAT_REJECTED,  // artefacto: no debe contar para la FC ni la HRV
+};
+
+constexpr uint8_t QUALITY_UNKNOWN = 255; // primera ventana aún sin completar
+
+template <uint16_t RateHz, uint16_t AdcMax, uint8_t History = 128>
+class SignalQuality {
+public:
+    static constexpr uint16_t WINDOW = RateHz;
+    static constexpr uint16_t CLIP_MARGIN = AdcMax / 64 + 1;
+    static constexpr uint16_t CLIP_GATE = WINDOW / 20;   // 5 % de la ventana en curso
+    static constexpr uint8_t LF_SHIFT = 5;           // paso-bajo de fs/(2·pi·32) = 1.2 Hz a 250 Hz
+    static constexpr uint8_t TEMPLATE_LENGTH = 32;   // 128 ms a 250 Hz
+    static constexpr uint8_t TEMPLATE_PRE = 12;      // muestras antes del máximo
+    // Búsqueda del pico R alrededor de la posición del detector, que con
+    // ruido puede llegar con hasta ~100 ms de retraso, y ajuste fino con la
+    // plantilla
+    static constexpr uint8_t ALIGN_BEFORE = 20;
+    static constexpr uint8_t ALIGN_AFTER = 6;
+    static constexpr uint8_t ALIGN_REFINE = 3;
+    // Muestras tras la posición del detector para correlar en cualquier alineación
+    static constexpr uint8_t JUDGE_AFTER = TEMPLATE_LENGTH - TEMPLATE_PRE + ALIGN_AFTER + ALIGN_REFINE;
+    static constexpr uint8_t JUDGE_SPAN = JUDGE_AFTER + ALIGN_BEFORE + ALIGN_REFINE + TEMPLATE_PRE;
+    static constexpr uint8_t TEMPLATE_LEARN = 4;     // latidos para la primera plantilla
+    static constexpr uint8_t RELEARN_REJECTS = 6;    // rechazos seguidos con ventana buena -> reaprender
+    static constexpr uint8_t GATE = 40;
+    static constexpr uint16_t MIN_RR = RateHz / 4;    // 240 lpm
+    static constexpr int8_t CORRELATION_MIN = 60;    // r x 100: por debajo, artefacto
+    static constexpr int8_t CORRELATION_GOOD = 80;   // desde aquí el latido actualiza la plantilla
+    // Límites de deriva y ruido en (RMS / pico de lp)^2 x 1000: puntuación
+    // 100 hasta GOOD y 0 desde BAD
+    static constexpr uint16_t WANDER_GOOD = 40;      // RMS del 20 % del pico
+    static constexpr uint16_t WANDER_BAD = 160;      // 40 %
+    static constexpr uint16_t NOISE_GOOD = 22;       // 15 %
+    static constexpr uint16_t NOISE_BAD = 160;       // 40 %
+
+    static_assert((uint32_t)WINDOW * (((uint32_t)AdcMax * AdcMax) >> 2) < 0x80000000UL,
+                  "ventana o ADC demasiado grandes para los acumuladores de 32 bits");
+    static_assert(History >= JUDGE_SPAN && (History & (History - 1)) == 0,
+                  "History debe ser potencia de 2 y cubrir la plantilla");
+
+    SignalQuality() { reset(); }
+
+    void reset() {
+        n = 0;
+        windowCount = 0;
+        clipCount = 0;
+        windowPeak = 0;
+        lfEnergy = hfEnergy = 0;
+        lfQ8 = 0;
+        corrSum = 0;
+        corrCount = 0;
+        qualityIndex = QUALITY_UNKNOWN;
+        signalIndex = 100;
+        clipScore = wanderScore = noiseScore = correlationScore = 100;
+        for (uint8_t i = 0; i < History; i++) history[i] = 0;
+        for (uint8_t i = 0; i < TEMPLATE_LENGTH; i++) templateQ2[i] = 0;
+        templateBeats = 0;
+        lastCorrelation = 100;
+        consecutiveRejects = 0;
+        pending = false;
+        haveAccepted = false;
+        chainBroken = true;
+        lastAccepted = 0;
+        acceptedRr = 0;
+        rejectedTotal = 0;
+    }
+
+    /**
+     * Una muestra: cruda (cuentas ADC), la entrada de la media móvil y lp.
+     * Devuelve el veredicto de un latido de addBeat() que esperaba muestras
+     * posteriores al QRS, o BEAT_NONE.
+     */
+    BeatVerdict process(int16_t raw, int16_t unsmoothed, int16_t lp) {
+        history[n & (History - 1)] = lp;
+        n++;
+
+        if (raw <= (int16_t)CLIP_MARGIN || raw >= (int16_t)(AdcMax - CLIP_MARGIN)) clipCount++;
+        lfQ8 += (((int32_t)lp << 8) - lfQ8) >> LF_SHIFT;
+        int32_t lf = lfQ8 >> 8;
+        int32_t hf = (int32_t)unsmoothed - lp;
+        int16_t mag = lp < 0 ? (int16_t)-lp : lp;
+        if (mag > windowPeak) windowPeak = mag;
+        lfEnergy += energy(lf);
+        hfEnergy += energy(hf);
+        if (++windowCount == WINDOW) finishWindow();
+
+        if (pending && n - pendingCenter >= JUDGE_AFTER) {
+            pending = false;
+            return judge(pendingCenter, true);
+        }
+        return BEAT_NONE;
+    }
+
+    /**
+     * QRS confirmado por el detector 'age' muestras antes de la última de
+     * process() (qrs.sampleCount() - 1 - qrs.lastBeatSample()). Si ya hay
+     * muestras suficientes tras el QRS da el veredicto; si no, BEAT_NONE y
+     * lo dará process() unas muestras después.
+     */
+    BeatVerdict addBeat(uint32_t age) {
+        BeatVerdict early = BEAT_NONE;
+        if (pending) {
+            // Otro QRS antes de poder correlar el anterior: se decide sin plantilla
+            pending = false;
+            early = judge(pendingCenter, false);
+        }
+        uint32_t center = n - 1 - age;
+        BeatVerdict v = BEAT_NONE;
+        if (age + 1 + JUDGE_SPAN - JUDGE_AFTER > History) {
+            // Search-back lejano: fuera de la historia, solo cuenta la ventana
+            v = judge(center, false);
+        } else if (n - center >= JUDGE_AFTER) {
+            v = judge(center, true);
+        } else {
+            pendingCenter = center;
+            pending = true;
+        }
+        return early != BEAT_NONE ? early : v;
+    }
+
+    // 0-100 (peor componente de la última ventana), QUALITY_UNKNOWN al arrancar
+    uint8_t index() const { return qualityIndex; }
+    bool usable() const { return qualityIndex == QUALITY_UNKNOWN || qualityIndex >= GATE; }
+
+    // Muestras entre el último latido aceptado y el anterior (0 si hubo un
+    // rechazo en medio o es el primero)
+    uint16_t acceptedRR() const { return acceptedRr; }
+
+    // Muestras desde el pico R (alineado) del último latido aceptado hasta
+    // la última muestra; válido tras un BEAT_ACCEPTED
+    uint32_t lastAcceptedAge() const { return n - 1 - lastAccepted; }
+
+    // Componentes de la última ventana (0-100) y última correlación (r x 100)
+    uint8_t clipping() const { return clipScore; }
+    uint8_t wander() const { return wanderScore; }
+    uint8_t noise() const { return noiseScore; }
+    int8_t correlation() const { return lastCorrelation; }
+    uint32_t rejectedBeats() const { return rejectedTotal; }
+
+private:
+    uint32_t n;
+    uint16_t windowCount;
+    uint16_t clipCount;
+    int16_t windowPeak;
+    uint32_t lfEnergy;
+    uint32_t hfEnergy;
+    int32_t lfQ8;
+    uint8_t qualityIndex;
+    uint8_t signalIndex;    // qualityIndex sin la correlación
+    uint8_t clipScore;
+    uint8_t wanderScore;
+    uint8_t noiseScore;
+    uint8_t correlationScore;
+    int16_t corrSum;
+    uint8_t corrCount;
+
+    int16_t history[History];
+    int16_t templateQ2[TEMPLATE_LENGTH];
+    uint8_t templateBeats;
+    int8_t lastCorrelation;
+    uint8_t consecutiveRejects;
+
+    bool pending;
+    uint32_t pendingCenter;
+    bool haveAccepted;
+    bool chainBroken;
+    uint32_t lastAccepted;
+    uint16_t acceptedRr;
+    uint32_t rejectedTotal;
+
+    static uint32_t energy(int32_t v) {
+        if (v > (int32_t)AdcMax) v = AdcMax;
+        if (v < -(int32_t)AdcMax) v = -(int32_t)AdcMax;
+        return (uint32_t)(v * v) >> 2;
+    }
+
+    // 100 con x <= good, 0 con x >= bad, lineal entre medias
+    static uint8_t score(uint32_t x, uint32_t good, uint32_t bad) {
+        if (x <= good) return 100;
+        if (x >= bad) return 0;
+        return (uint8_t)(100 - (x - good) * 100 / (bad - good));
+    }
+
+    // Potencia media de la ventana (energía con >> 2) en milésimas de la
+    // potencia de pico de lp, es decir, (RMS / pico)^2 x 1000
+    uint32_t permilleOfPeak(uint32_t energySum) const {
+        uint32_t peak2 = (uint32_t)windowPeak * windowPeak;
+        if (peak2 == 0) return energySum == 0 ? 0 : 1000;
+        return (uint32_t)((uint64_t)energySum * 4000 / ((uint32_t)WINDOW * peak2));
+    }
+
+    void finishWindow() {
+        // Saturación: 0 % bien, 5 % o más inservible. Deriva y ruido: RMS
+        // frente al pico de lp (el QRS en una ventana limpia)
+        clipScore = score((uint32_t)clipCount * 1000 / WINDOW, 0, 50);
+        wanderScore = score(permilleOfPeak(lfEnergy), WANDER_GOOD, WANDER_BAD);
+        noiseScore = score(permilleOfPeak(hfEnergy), NOISE_GOOD, NOISE_BAD);
+        // Correlación media de los QRS de la ventana (sin QRS, sin información)
+        int8_t r = corrCount ? (int8_t)(corrSum / corrCount) : 100;
+        correlationScore = score((uint32_t)(100 - r), 100 - CORRELATION_GOOD, 100 - CORRELATION_MIN);
+
+        uint8_t worst = clipScore;
+        if (wanderScore < worst) worst = wanderScore;
+        if (noiseScore < worst) worst = noiseScore;
+        signalIndex = worst;
+        if (correlationScore < worst) worst = correlationScore;
+        qualityIndex = worst;
+
+        windowCount = 0;
+        clipCount = 0;
+        windowPeak = 0;
+        lfEnergy = hfEnergy = 0;
+        corrSum = 0;
+        corrCount = 0;
+    }
+
+    // Índice para decidir ahora: la última ventana, o saturación en curso
+    bool windowGood() const {
+        if (clipCount >= CLIP_GATE) return false;
+        return usable();
+    }
+
+    // Igual, sin contar la correlación: la señal está limpia aunque los QRS
+    // no se parezcan a la plantilla
+    bool signalGood() const {
+        if (clipCount >= CLIP_GATE) return false;
+        return qualityIndex == QUALITY_UNKNOWN || signalIndex >= GATE;
+    }
+
+    BeatVerdict judge(uint32_t center, bool correlate) {
+        bool accepted = windowGood();
+        uint32_t peak = center;
+        if (correlate) {
+            // Se correla aunque la ventana sea mala: así el índice sale de
+            // ella en cuanto vuelven los QRS normales
+            peak = align(center);
+            int8_t r = correlateWithTemplate(peak);
+            lastCorrelation = r;
+            corrSum += r;
+            corrCount++;
+            if (templateBeats < TEMPLATE_LEARN) {
+                if (signalGood()) learnTemplate(peak);
+            } else if (r < CORRELATION_MIN) {
+                accepted = false;
+                // Muchos rechazos con la señal limpia: ha cambiado la morfología
+                if (signalGood() && ++consecutiveRejects >= RELEARN_REJECTS) {
+                    templateBeats = 0;
+                    consecutiveRejects = 0;
+                }
+            } else {
+                consecutiveRejects = 0;
+                if (accepted && r >= CORRELATION_GOOD) learnTemplate(peak);
+            }
+        }
+
+        // Dos QRS en el mismo pico R (un artefacto justo detrás de un latido)
+        if (accepted && haveAccepted && peak - lastAccepted < MIN_RR) accepted = false;
+
+        if (!accepted) {
+            rejectedTotal++;
+            chainBroken = true;
+            return BEAT_REJECTED;
+        }
+        uint32_t rr = peak - lastAccepted;
+        acceptedRr = (haveAccepted && !chainBroken && rr <= 0xFFFF) ? (uint16_t)rr : 0;
+        haveAccepted = true;
+        chainBroken = false;
+        lastAccepted = peak;
+        return BEAT_ACCEPTED;
+    }
+
+    int16_t segment(uint32_t peak, uint8_t i) const {
+        return history[(peak - TEMPLATE_PRE + i) & (History - 1)];
+    }
+
+    /**
+     * Posición del pico R: el máximo de |lp| entre ALIGN_BEFORE muestras
+     * antes y ALIGN_AFTER después de la del detector y, con plantilla, el
+     * desplazamiento de ±ALIGN_REFINE de mayor producto escalar con ella.
+     */
+    uint32_t align(uint32_t center) const {
+        uint32_t best = center;
+        int16_t bestMag = -1;
+        for (uint32_t i = center - ALIGN_BEFORE; i != center + ALIGN_AFTER + 1; i++) {
+            int16_t v = history[i & (History - 1)];
+            if (v < 0) v = (int16_t)-v;
+            if (v > bestMag) {
+                bestMag = v;
+                best = i;
+            }
+        }
+        if (templateBeats == 0) return best;
+
+        uint32_t coarse = best;
+        int16_t mt = templateMean();
+        int32_t bestDot = -2147483647L - 1;
+        for (uint32_t c = coarse - ALIGN_REFINE; c != coarse + ALIGN_REFINE + 1; c++) {
+            int32_t dot = 0;
+            for (uint8_t i = 0; i < TEMPLATE_LENGTH; i++) {
+                dot += (int32_t)segment(c, i) * ((templateQ2[i] >> 2) - mt);
+            }
+            if (dot > bestDot) {
+                bestDot = dot;
+                best = c;
+            }
+        }
+        return best;
+    }
+
+    int16_t templateMean() const {
+        int32_t st = 0;
+        for (uint8_t i = 0; i < TEMPLATE_LENGTH; i++) st += templateQ2[i] >> 2;
+        return (int16_t)(st / TEMPLATE_LENGTH);
+    }
+
+    // Media móvil de los latidos aceptados (la primera, media de TEMPLATE_LEARN)
+    void learnTemplate(uint32_t peak) {
+        uint8_t shift = templateBeats < TEMPLATE_LEARN ? 0 : 3;
+        for (uint8_t i = 0; i < TEMPLATE_LENGTH; i++) {
+            int16_t xQ2 = (int16_t)(segment(peak, i) * 4);
+            if (templateBeats == 0) templateQ2[i] = xQ2;
+            else if (shift == 0) templateQ2[i] = (int16_t)(templateQ2[i] + (xQ2 - templateQ2[i]) / (templateBeats + 1));
+            else templateQ2[i] = (int16_t)(templateQ2[i] + ((xQ2 - templateQ2[i]) >> shift));
+        }
+        if (templateBeats < TEMPLATE_LEARN) templateBeats++;
+    }
+
+    // Correlación de Pearson con la plantilla, x 100 (100 sin plantilla)
+    int8_t correlateWithTemplate(uint32_t peak) const {
+        if (templateBeats == 0) return 100;
+        int32_t sx = 0;
+        for (uint8_t i = 0; i < TEMPLATE_LENGTH; i++) sx += segment(peak, i);
+        int16_t mx = (int16_t)(sx / TEMPLATE_LENGTH);
+        int16_t mt = templateMean();
+        int32_t sxy = 0;
+        uint32_t sxx = 0, stt = 0;
+        for (uint8_t i = 0; i < TEMPLATE_LENGTH; i++) {
+            int32_t dx = segment(peak, i) - mx;
+            int32_t dt = (templateQ2[i] >> 2) - mt;
+            sxy += dx * dt;
+            sxx += (uint32_t)(dx * dx);
+            stt += (uint32_t)(dt * dt);
+        }
+        if (sxx == 0 || stt == 0) return 0;
+        double r = sxy / sqrt((double)sxx * (double)stt);
+        return (int8_t)(r * 100.0 + (r < 0 ? -0.5 : 0.5));
+    }
+};
+
+#endif // SIGNAL_QUALITY_H
@@ -0,0 +1,444 @@
+/**
+ * @file spectral_hr.h
+ * @brief Frecuencia cardiaca por autocorrelación (FFT radix-2 en coma fija) como canal de respaldo
+ *
+ * Cuando el detector de QRS pierde el enganche (ruido, onda R pequeña) la
+ * FC se quedaba congelada. SpectralHeartRate estima la FC sin detectar
+ * latidos, a partir de la periodicidad de la señal:
+ *   1. Por muestra: envolvente |lp[n] - lp[n-1]| (la pendiente del QRS
+ *      domina), sumada por bloques de Decimation muestras -> 31.25 Hz a
+ *      250 Hz. Se guardan las últimas Window (256: ~8 s).
+ *   2. Cada UPDATE_EVERY muestras (1 s): ventana sin media, normalizada a
+ *      14 bits y con otros Window ceros detrás (autocorrelación lineal,
+ *      sin vuelta), FFT de FFT_SIZE puntos, potencia |X|^2 normalizada e
+ *      IFFT -> autocorrelación r[lag]. El DIF directo deja el espectro en
+ *      orden de bits invertido, que es la entrada del DIT inverso: no hay
+ *      pasada de reordenado.
+ *   3. El máximo de r (sin sesgo, r * Window / (Window - lag)) entre
+ *      MIN_BPM y MAX_BPM da el periodo, afinado con una parábola; si r en
+ *      un retardo menor tiene un máximo local de al menos el 80 % (alturas
+ *      interpoladas) se toma ese (el mayor cayó en un múltiplo del
+ *      periodo). confidence() es r en
+ *      el pico frente a r[0], en %.
+ * El cálculo de 2 no se hace de golpe: es una máquina de estados que en
+ * cada muestra avanza como mucho BUDGET pasos (mariposas, copias o
+ * potencias) y termina en unas 200 muestras, antes de la siguiente
+ * actualización; el coste por muestra queda acotado y lejos de los 4 ms.
+ *
+ * Q15 con escalado fijo (>> 1 por etapa) y normalización por bloque antes
+ * de cada transformada. ~2.8 KB de RAM (re/im de FFT_SIZE int16, la
+ * envolvente y un cuarto de onda de senos): pensado para el ESP32, no cabe
+ * en el UNO. El benchmark "spectral" del entorno native mide error, coste
+ * por actualización y por muestra, y el respaldo en ECGMonitor.
+ *
+ * HeartRateArbiter decide, en ECGMonitor y ECGMultiMonitor, cuándo se usa
+ * esta estimación en lugar de la del detector.
+ */
+
+#ifndef SPECTRAL_HR_H
+#define SPECTRAL_HR_H
+
+#include <stdint.h>
+#include <math.h>
+
+constexpr uint8_t spectralLog2(uint32_t n) { return n <= 1 ? 0 : 1 + spectralLog2(n / 2); }
+
+template <uint16_t RateHz, uint8_t Decimation = 8, uint16_t Window = 256>
+class SpectralHeartRate {
+public:
+    static constexpr uint16_t FFT_SIZE = 2 * Window;
+    static constexpr uint8_t LOG2_FFT = spectralLog2(FFT_SIZE);
+    static constexpr uint16_t UPDATE_EVERY = RateHz;          // una estimación por segundo
+    static constexpr uint16_t BUDGET = 32;                    // pasos por muestra
+    static constexpr uint8_t MIN_BPM = 30;
+    static constexpr uint8_t MAX_BPM = 220;
+    static constexpr uint16_t MIN_LAG = 60UL * RateHz / ((uint32_t)Decimation * MAX_BPM);
+    static constexpr uint16_t MAX_LAG = 60UL * RateHz / ((uint32_t)Decimation * MIN_BPM) + 1;
+    static constexpr uint8_t MIN_CONFIDENCE = 30;             // % de r[0]
+    static constexpr uint32_t WARMUP_SAMPLES = (uint32_t)Window * Decimation;  // hasta la primera
+
+    // Pasos de una actualización completa (copia, escalado, dos FFT, dos
+    // pasadas de potencia y la búsqueda, que cuenta como un bloque)
+    static constexpr uint32_t UPDATE_STEPS =
+        Window + FFT_SIZE + 2UL * LOG2_FFT * (FFT_SIZE / 2) + 2UL * FFT_SIZE + BUDGET;
+
+    static_assert((Window & (Window - 1)) == 0, "Window debe ser potencia de 2");
+    static_assert(MIN_LAG >= 2 && MAX_LAG + 1 < Window, "rango de FC fuera de la ventana");
+    static_assert(UPDATE_STEPS <= (uint32_t)BUDGET * UPDATE_EVERY,
+                  "la actualización no cabe en UPDATE_EVERY muestras con BUDGET pasos");
+
+    SpectralHeartRate() {
+        for (uint16_t i = 0; i <= FFT_SIZE / 4; i++) {
+            quarterSine[i] = (int16_t)lround(32767.0 * sin(2.0 * M_PI * i / FFT_SIZE));
+        }
+        reset();
+    }
+
+    void reset() {
+        for (uint16_t i = 0; i < Window; i++) envelope[i] = 0;
+        envHead = 0;
+        envFilled = 0;
+        envSum = 0;
+        acc = 0;
+        accCount = 0;
+        prevLp = 0;
+        primed = false;
+        untilUpdate = UPDATE_EVERY;
+        phase = IDLE;
+        estimateBpm = 0.0f;
+        estimateConfidence = 0;
+        estimateValid = false;
+        updateCount = 0;
+    }
+
+    /**
+     * Una muestra filtrada (lp). Avanza la actualización en curso como
+     * mucho BUDGET pasos.
+     * @return true si en esta llamada se ha publicado una estimación nueva
+     */
+    bool process(int16_t lp) {
+        int32_t d = primed ? (int32_t)lp - prevLp : 0;
+        prevLp = lp;
+        primed = true;
+        acc += d < 0 ? -d : d;
+        if (++accCount == Decimation) {
+            int16_t e = acc > 32767 ? 32767 : (int16_t)acc;
+            envSum += (int32_t)e - envelope[envHead];
+            envelope[envHead] = e;
+            envHead = (envHead + 1) & (Window - 1);
+            if (envFilled < Window) envFilled++;
+            acc = 0;
+            accCount = 0;
+        }
+
+        if (untilUpdate > 0) untilUpdate--;
+        if (untilUpdate == 0 && phase == IDLE && envFilled == Window) {
+            untilUpdate = UPDATE_EVERY;
+            start();
+        }
+        return phase != IDLE && step(BUDGET);
+    }
+
+    float bpm() const { return estimateBpm; }
+    uint8_t confidence() const { return estimateConfidence; }
+    bool valid() const { return estimateValid; }
+    bool busy() const { return phase != IDLE; }
+    uint32_t updates() const { return updateCount; }
+
+private:
+    enum Phase : uint8_t { IDLE, COPY, SCALE, FORWARD, POWER_MAX, POWER, INVERSE, SEARCH };
+
+    int16_t envelope[Window];
+    uint16_t envHead;       // entrada más antigua = próxima a escribir
+    uint16_t envFilled;
+    int32_t envSum;
+    int32_t acc;
+    uint8_t accCount;
+    int16_t prevLp;
+    bool primed;
+    uint16_t untilUpdate;
+
+    int16_t re[FFT_SIZE];
+    int16_t im[FFT_SIZE];
+    int16_t quarterSine[FFT_SIZE / 4 + 1];
+
+    Phase phase;
+    uint16_t cursor;        // posición dentro de la fase
+    uint8_t stage;
+    uint16_t windowStart;
+    int16_t windowMean;
+    int32_t maxValue;
+    int8_t shift;           // normalización: > 0 a la izquierda, < 0 a la derecha
+
+    float estimateBpm;
+    uint8_t estimateConfidence;
+    bool estimateValid;
+    uint32_t updateCount;
+
+    int16_t sinAt(uint16_t m) const {
+        return m <= FFT_SIZE / 4 ? quarterSine[m] : quarterSine[FFT_SIZE / 2 - m];
+    }
+
+    int16_t cosAt(uint16_t m) const {
+        return m <= FFT_SIZE / 4 ? quarterSine[FFT_SIZE / 4 - m] : (int16_t)-quarterSine[m - FFT_SIZE / 4];
+    }
+
+    static int16_t half(int32_t v) { return (int16_t)((v + 1) >> 1); }
+
+    // Toma la ventana: las Window envolventes más recientes, de la más antigua
+    // a la más nueva. La copia va por delante de las escrituras nuevas.
+    void start() {
+        windowStart = envHead;
+        windowMean = (int16_t)(envSum / (int32_t)Window);
+        maxValue = 0;
+        cursor = 0;
+        phase = COPY;
+    }
+
+    void nextPhase(Phase p) {
+        phase = p;
+        cursor = 0;
+        stage = 0;
+    }
+
+    // Avanza hasta 'budget' pasos; true si termina la búsqueda
+    bool step(uint16_t budget) {
+        while (budget > 0 && phase != IDLE) {
+            switch (phase) {
+            case COPY: {
+                uint16_t n = Window - cursor < budget ? Window - cursor : budget;
+                for (uint16_t i = cursor; i < cursor + n; i++) {
+                    int16_t v = (int16_t)(envelope[(windowStart + i) & (Window - 1)] - windowMean);
+                    re[i] = v;
+                    int32_t a = v < 0 ? -(int32_t)v : v;
+                    if (a > maxValue) maxValue = a;
+                }
+                cursor += n;
+                budget -= n;
+                if (cursor == Window) {
+                    if (maxValue == 0) {
+                        // Señal plana: nada periódico que buscar
+                        estimateValid = false;
+                        estimateConfidence = 0;
+                        phase = IDLE;
+                        return false;
+                    }
+                    // |x| < 2^14: las mariposas con >> 1 ya no desbordan
+                    shift = 0;
+                    while ((maxValue << (shift + 1)) < 16384) shift++;
+                    while ((maxValue >> -shift) >= 16384) shift--;
+                    nextPhase(SCALE);
+                }
+                break;
+            }
+            case SCALE: {
+                uint16_t n = FFT_SIZE - cursor < budget ? FFT_SIZE - cursor : budget;
+                for (uint16_t i = cursor; i < cursor + n; i++) {
+                    if (i >= Window) re[i] = 0;
+                    else re[i] = shift >= 0 ? (int16_t)(re[i] << shift) : (int16_t)(re[i] >> -shift);
+                    im[i] = 0;
+                }
+                cursor += n;
+                budget -= n;
+                if (cursor == FFT_SIZE) nextPhase(FORWARD);
+                break;
+            }
+            case FORWARD:
+            case INVERSE: {
+                uint16_t n = FFT_SIZE / 2 - cursor < budget ? FFT_SIZE / 2 - cursor : budget;
+                if (phase == FORWARD) forwardButterflies(n);
+                else inverseButterflies(n);
+                cursor += n;
+                budget -= n;
+                if (cursor == FFT_SIZE / 2) {
+                    cursor = 0;
+                    if (++stage == LOG2_FFT) {
+                        if (phase == FORWARD) {
+                            maxValue = 0;
+                            nextPhase(POWER_MAX);
+                        } else {
+                            nextPhase(SEARCH);
+                        }
+                    }
+                }
+                break;
+            }
+            case POWER_MAX: {
+                uint16_t n = FFT_SIZE - cursor < budget ? FFT_SIZE - cursor : budget;
+                for (uint16_t i = cursor; i < cursor + n; i++) {
+                    int32_t p = (int32_t)re[i] * re[i] + (int32_t)im[i] * im[i];
+                    if (p > maxValue) maxValue = p;
+                }
+                cursor += n;
+                budget -= n;
+                if (cursor == FFT_SIZE) {
+                    shift = 0;
+                    while ((maxValue >> shift) > 32767) shift++;
+                    nextPhase(POWER);
+                }
+                break;
+            }
+            case POWER: {
+                // Potencia en el orden de bits invertido que deja el DIF
+                uint16_t n = FFT_SIZE - cursor < budget ? FFT_SIZE - cursor : budget;
+                for (uint16_t i = cursor; i < cursor + n; i++) {
+                    int32_t p = (int32_t)re[i] * re[i] + (int32_t)im[i] * im[i];
+                    re[i] = (int16_t)(p >> shift);
+                    im[i] = 0;
+                }
+                cursor += n;
+                budget -= n;
+                if (cursor == FFT_SIZE) nextPhase(INVERSE);
+                break;
+            }
+            case SEARCH:
+                search();
+                phase = IDLE;
+                updateCount++;
+                return true;
+            case IDLE:
+                break;
+            }
+        }
+        return false;
+    }
+
+    // DIF, W = e^(-2*pi*i*m/N); etapa s con mitades de FFT_SIZE >> (s + 1)
+    void forwardButterflies(uint16_t n) {
+        const uint8_t log2h = LOG2_FFT - 1 - stage;
+        const uint16_t h = (uint16_t)1 << log2h;
+        for (uint16_t t = cursor; t < cursor + n; t++) {
+            uint16_t k = t & (h - 1);
+            uint16_t i = (uint16_t)(((t >> log2h) << (log2h + 1)) + k);
+            uint16_t j = i + h;
+            int32_t dr = (int32_t)re[i] - re[j];
+            int32_t di = (int32_t)im[i] - im[j];
+            re[i] = half((int32_t)re[i] + re[j]);
+            im[i] = half((int32_t)im[i] + im[j]);
+            uint16_t m = (uint16_t)(k << stage);
+            int32_t c = cosAt(m), s = sinAt(m);
+            re[j] = (int16_t)((dr * c + di * s + (1L << 15)) >> 16);
+            im[j] = (int16_t)((di * c - dr * s + (1L << 15)) >> 16);
+        }
+    }
+
+    // DIT inverso, W = e^(+2*pi*i*m/N); entrada en orden de bits invertido
+    void inverseButterflies(uint16_t n) {
+        const uint8_t log2h = stage;
+        const uint16_t h = (uint16_t)1 << log2h;
+        for (uint16_t t = cursor; t < cursor + n; t++) {
+            uint16_t k = t & (h - 1);
+            uint16_t i = (uint16_t)(((t >> log2h) << (log2h + 1)) + k);
+            uint16_t j = i + h;
+            uint16_t m = (uint16_t)(k << (LOG2_FFT - 1 - stage));
+            int32_t c = cosAt(m), s = sinAt(m);
+            int32_t tr = ((int32_t)re[j] * c - (int32_t)im[j] * s + (1L << 14)) >> 15;
+            int32_t ti = ((int32_t)re[j] * s + (int32_t)im[j] * c + (1L << 14)) >> 15;
+            re[j] = half((int32_t)re[i] - tr);
+            im[j] = half((int32_t)im[i] - ti);
+            re[i] = half((int32_t)re[i] + tr);
+            im[i] = half((int32_t)im[i] + ti);
+        }
+    }
+
+    // Autocorrelación sin sesgo del retardo 'lag' (r[lag] está en re[])
+    int32_t unbiased(uint16_t lag) const {
+        return (int32_t)re[lag] * Window / (int32_t)(Window - lag);
+    }
+
+    // Altura del máximo local en 'lag' interpolada con una parábola: un
+    // periodo que cae entre dos retardos no parece más bajo que sus múltiplos
+    int32_t peakHeight(uint16_t lag) const {
+        int32_t y0 = unbiased(lag - 1), y1 = unbiased(lag), y2 = unbiased(lag + 1);
+        int32_t den = y0 - 2 * y1 + y2;
+        return den < 0 ? y1 - (y0 - y2) * (y0 - y2) / (8 * den) : y1;
+    }
+
+    void search() {
+        int32_t r0 = re[0];
+        uint16_t best = 0;
+        for (uint16_t l = MIN_LAG; l <= MAX_LAG; l++) {
+            int32_t r = unbiased(l);
+            if (r >= unbiased(l - 1) && r >= unbiased(l + 1) && (best == 0 || r > unbiased(best))) best = l;
+        }
+        if (best == 0 || r0 <= 0 || unbiased(best) <= 0) {
+            estimateValid = false;
+            estimateConfidence = 0;
+            return;
+        }
+
+        // Los múltiplos del periodo dan picos casi igual de altos, y con
+        // ruido alguno puede superar al del periodo: se toma el primer
+        // máximo local que llega al 60 % del mayor
+        int32_t top = peakHeight(best);
+        for (uint16_t l = MIN_LAG; l < best; l++) {
+            int32_t r = unbiased(l);
+            if (r >= unbiased(l - 1) && r >= unbiased(l + 1) && 5 * peakHeight(l) >= 3 * top) {
+                best = l;
+                break;
+            }
+        }
+
+        int32_t y0 = unbiased(best - 1), y1 = unbiased(best), y2 = unbiased(best + 1);
+        int32_t den = y0 - 2 * y1 + y2;
+        float lag = best + (den != 0 ? 0.5f * (float)(y0 - y2) / (float)den : 0.0f);
+        int32_t conf = y1 * 100 / r0;
+        estimateConfidence = (uint8_t)(conf > 100 ? 100 : conf);
+        estimateBpm = 60.0f * RateHz / (Decimation * lag);
+        estimateValid = estimateConfidence >= MIN_CONFIDENCE && estimateBpm >= MIN_BPM && estimateBpm <= MAX_BPM;
+    }
+};
+
+// De dónde sale la FC que se muestra (HeartRateArbiter)
+enum HeartRateSource : uint8_t {
+    HR_SOURCE_NONE,      // sin FC, o la última del detector sin respaldo
+    HR_SOURCE_DETECTOR,  // latidos aceptados recientes (hrv_engine.h)
+    HR_SOURCE_SPECTRAL,  // detector sin enganche: estimación espectral
+};
+
+/**
+ * Elige la FC mostrada y contrasta las dos fuentes. Si el detector ha dado
+ * un RR (dos latidos aceptados seguidos) en los últimos LOST_LOCK_SAMPLES
+ * manda él; un latido aceptado suelto no renueva su FC. Si no, la
+ * estimación espectral válida; si tampoco hay, queda la última del
+ * detector (el comportamiento anterior). Con cada estimación nueva, si el
+ * detector está enganchado y las dos difieren más de DISAGREE_PERCENT,
+ * disagreement() avisa: uno de los dos está contando mal.
+ */
+template <uint16_t RateHz>
+class HeartRateArbiter {
+public:
+    static constexpr uint32_t LOST_LOCK_SAMPLES = 3UL * RateHz;
+    static constexpr uint8_t DISAGREE_PERCENT = 15;
+
+    HeartRateArbiter() { reset(); }
+
+    void reset() {
+        detectorBpm = 0.0f;
+        lastBeatIndex = 0;
+        hrSource = HR_SOURCE_NONE;
+        disagree = false;
+    }
+
+    // FC del detector tras un latido con RR, con su pico R en 'index'
+    // (reloj de muestras)
+    void onDetectorBpm(float bpm, uint32_t index) {
+        detectorBpm = bpm;
+        lastBeatIndex = index;
+    }
+
+    /**
+     * Una vez por muestra, con 'index' la muestra actual y 'newEstimate' el
+     * resultado de spectral.process() en esta muestra.
+     * @return FC a mostrar (0 si aún no hay ninguna)
+     */
+    template <typename Spectral>
+    float update(uint32_t index, const Spectral& spectral, bool newEstimate) {
+        bool locked = detectorBpm > 0.0f && index - lastBeatIndex <= LOST_LOCK_SAMPLES;
+        if (newEstimate) {
+            disagree = locked && spectral.valid() &&
+                       fabsf(spectral.bpm() - detectorBpm) * 100.0f > DISAGREE_PERCENT * detectorBpm;
+        }
+        if (locked) {
+            hrSource = HR_SOURCE_DETECTOR;
+            return detectorBpm;
+        }
+        if (spectral.valid()) {
+            hrSource = HR_SOURCE_SPECTRAL;
+            return spectral.bpm();
+        }
+        hrSource = HR_SOURCE_NONE;
+        return detectorBpm;
+    }
+
+    HeartRateSource source() const { return hrSource; }
+    bool disagreement() const { return disagree; }
+
+private:
+    float detectorBpm;
+    uint32_t lastBeatIndex;
+    HeartRateSource hrSource;
+    bool disagree;
+};
+
+#endif // SPECTRAL_HR_H
@@ -0,0 +1,77 @@
+/**
+ * @file spsc_ring.h
+ * @brief Cola circular sin bloqueos de un productor y un consumidor (SPSC)
+ *
+ * El productor (tarea de adquisición) nunca espera: si la cola está llena
+ * la muestra se descarta y se cuenta en dropped(). Los índices crecen sin
+ * límite (módulo 2^32) y se enmascaran con Capacity - 1, así que Capacity
+ * debe ser potencia de 2. Usa std::atomic: compila en el ESP32 y en el host
+ * (entorno native), no en AVR.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+template <typename T, uint32_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity debe ser potencia de 2");
+
+public:
+    SpscRing() : head(0), droppedCount(0), tail(0) {}
+
+    // Solo productor
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Capacity) {
+            droppedCount.store(droppedCount.load(std::memory_order_relaxed) + 1,
+                               std::memory_order_relaxed);
+            return false;
+        }
+        buffer[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Solo consumidor
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        item = buffer[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Solo consumidor: saca hasta maxCount elementos de una vez
+    size_t popBlock(T* out, size_t maxCount) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t available = head.load(std::memory_order_acquire) - t;
+        size_t count = available < maxCount ? available : maxCount;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = buffer[(t + i) & (Capacity - 1)];
+        }
+        tail.store(t + (uint32_t)count, std::memory_order_release);
+        return count;
+    }
+
+    // Aproximado si se llama desde el otro lado
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    uint32_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+    static constexpr uint32_t capacity() { return Capacity; }
+
+private:
+    T buffer[Capacity];
+    // Productor y consumidor escriben en líneas de caché distintas
+    alignas(64) std::atomic<uint32_t> head;
+    std::atomic<uint32_t> droppedCount;
+    alignas(64) std::atomic<uint32_t> tail;
+};
+
+#endif // SPSC_RING_H
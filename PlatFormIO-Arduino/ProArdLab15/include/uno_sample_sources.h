@@ -0,0 +1,126 @@
+/**
+ * @file uno_sample_sources.h
+ * @brief Fuentes de muestras del UNO: ADC disparado por Timer1 con ISR y cola IsrRing
+ *
+ * Timer1 en modo CTC marca el periodo y su comparación B dispara la
+ * conversión del ADC por hardware (auto-trigger), así que el instante de
+ * muestreo no depende de loop() ni de lo que tarde el puerto serie. La ISR
+ * del ADC solo guarda la lectura en unoAdcReadings; read() la vacía desde
+ * loop(). Si loop() se retrasa más de lo que cabe en la cola, las lecturas
+ * se pierden y se cuentan en overruns().
+ *
+ * Define ISR(ADC_vect): se incluye desde un solo .cpp (uno_main.cpp) y no
+ * se puede usar analogRead() después de begin().
+ */
+
+#ifndef UNO_SAMPLE_SOURCES_H
+#define UNO_SAMPLE_SOURCES_H
+
+#include <Arduino.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "ecg_dsp.h"
+#include "sample_source.h"
+#include "cic_decimator.h"
+#include "isr_ring.h"
+
+// 64 lecturas: 64 ms de margen para loop() a 1 kHz, 256 ms a 250 Hz
+constexpr uint8_t UNO_ADC_RING_SIZE = 64;
+
+IsrRing<int16_t, UNO_ADC_RING_SIZE> unoAdcReadings;
+
+ISR(ADC_vect)
+{
+    // El disparo es el flanco de OCF1B: se borra para que llegue el siguiente
+    TIFR1 = _BV(OCF1B);
+    unoAdcReadings.push((int16_t)ADC);
+}
+
+/**
+ * Arranca Timer1 a readHz (prescaler 8: de 31 Hz a 1 MHz a 16 MHz) con el
+ * ADC del canal 'channel' (A0 = 0) disparado en cada periodo. Referencia
+ * AVcc, como analogRead() con DEFAULT, y reloj del ADC a 125 kHz (104 us
+ * por conversión, así que readHz no debe pasar de ~9 kHz).
+ */
+static bool startAdcTrigger(uint8_t channel, uint32_t readHz)
+{
+    const uint32_t top = F_CPU / 8 / readHz - 1;
+    if (channel > 7 || top > 0xFFFF || readHz > 9000) return false;
+
+    uint8_t sreg = SREG;
+    cli();
+    TCCR1A = 0;
+    TCCR1B = 0;
+    TCNT1 = 0;
+    OCR1A = (uint16_t)top;
+    OCR1B = (uint16_t)top;
+    TIMSK1 = 0;
+    TIFR1 = _BV(OCF1A) | _BV(OCF1B);
+
+    ADMUX = _BV(REFS0) | channel;
+    if (channel < 6) DIDR0 |= _BV(channel); // sin el buffer digital del pin
+    ADCSRB = _BV(ADTS2) | _BV(ADTS0);       // disparo: Timer1 compare match B
+    ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADIF) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+    TCCR1B = _BV(WGM12) | _BV(CS11);        // CTC hasta OCR1A, prescaler 8
+    SREG = sreg;
+    return true;
+}
+
+/**
+ * Una conversión por muestra, a SAMPLE_RATE_HZ.
+ */
+class UnoTimerAdcSource : public SampleSource {
+public:
+    explicit UnoTimerAdcSource(uint8_t channel) : channel(channel) {}
+
+    bool begin() override { return startAdcTrigger(channel, SAMPLE_RATE_HZ); }
+
+    size_t read(int16_t* out, size_t maxCount) override {
+        size_t count = 0;
+        while (count < maxCount && unoAdcReadings.pop(out[count])) count++;
+        return count;
+    }
+
+    uint32_t overruns() const override { return unoAdcReadings.dropped(); }
+
+private:
+    uint8_t channel;
+};
+
+/**
+ * Ratio conversiones por muestra (SAMPLE_RATE_HZ·Ratio) y diezmado CIC de
+ * orden 3 en read(): la ISR no hace más que guardar la lectura.
+ */
+template <uint8_t Ratio>
+class UnoOversampledAdcSource : public SampleSource {
+public:
+    typedef CICDecimator<Ratio, 3, SAMPLE_RATE_HZ> Decimator;
+
+    explicit UnoOversampledAdcSource(uint8_t channel) : channel(channel), primed(false) {}
+
+    bool begin() override { return startAdcTrigger(channel, SAMPLE_RATE_HZ * Ratio); }
+
+    size_t read(int16_t* out, size_t maxCount) override {
+        size_t produced = 0;
+        int16_t x;
+        while (produced < maxCount && unoAdcReadings.pop(x)) {
+            if (!primed) {
+                // El estado del CIC arranca con la primera lectura
+                decimator.reset(x);
+                primed = true;
+            }
+            if (decimator.push(x)) out[produced++] = decimator.output();
+        }
+        return produced;
+    }
+
+    // En lecturas del ADC, no en muestras de salida
+    uint32_t overruns() const override { return unoAdcReadings.dropped(); }
+
+private:
+    uint8_t channel;
+    bool primed;
+    Decimator decimator;
+};
+
+#endif // UNO_SAMPLE_SOURCES_H
@@ -0,0 +1,66 @@
+/**
+ * @file uno_uart_tx.h
+ * @brief Envío por el USART0 del UNO desde una cola IsrRing vaciada por interrupción, sin esperas
+ *
+ * Sustituye a Serial en la salida binaria: write() copia la trama entera
+ * en unoTxBytes o la descarta (y la cuenta) si no cabe, pero nunca espera
+ * a que el UART vacíe su búfer como hace Serial.print(). La ISR de
+ * "registro de datos vacío" (UDRE) envía un byte cada vez y se desactiva
+ * cuando la cola se queda sin datos.
+ *
+ * Define ISR(USART_UDRE_vect), así que no se puede usar Serial en el mismo
+ * programa (el core de Arduino define el mismo vector). Se incluye desde un
+ * solo .cpp (uno_main.cpp).
+ */
+
+#ifndef UNO_UART_TX_H
+#define UNO_UART_TX_H
+
+#include <Arduino.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "isr_ring.h"
+
+// Tres tramas de muestras de ecg_stream.h de tamaño máximo
+constexpr uint8_t UNO_TX_RING_SIZE = 128;
+
+IsrRing<uint8_t, UNO_TX_RING_SIZE> unoTxBytes;
+
+ISR(USART_UDRE_vect)
+{
+    uint8_t b;
+    if (unoTxBytes.pop(b)) UDR0 = b;
+    else UCSR0B &= ~_BV(UDRIE0); // cola vacía: write() la vuelve a activar
+}
+
+class UnoUartTx {
+public:
+    // 8N1 con doble velocidad (U2X), como Serial.begin()
+    void begin(uint32_t baud) {
+        UCSR0B = 0;
+        UCSR0A = _BV(U2X0);
+        UBRR0 = (uint16_t)((F_CPU / 8 + baud / 2) / baud - 1);
+        UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+        UCSR0B = _BV(TXEN0);
+    }
+
+    /**
+     * Encola los 'len' bytes o ninguno.
+     * @return false si no cabían (se cuenta en droppedWrites())
+     */
+    bool write(const uint8_t* data, size_t len) {
+        if (!unoTxBytes.pushBlock(data, len)) return false;
+        // Si la ISR la desactiva entre la lectura y la escritura, la cola ya
+        // tenía estos bytes: volver a activarla es lo correcto
+        UCSR0B |= _BV(UDRIE0);
+        return true;
+    }
+
+    // Escrituras descartadas por falta de sitio
+    uint16_t droppedWrites() const { return unoTxBytes.dropped(); }
+
+    // Bytes pendientes de enviar
+    uint8_t queued() const { return unoTxBytes.size(); }
+};
+
+#endif // UNO_UART_TX_H
@@ -23,56 +23,289 @@
 #include "ecg_types.h"
 #include "lcd_manager.h"
 #include "ecg_monitor.h"
+#include "ecg_stream.h"
+#include "esp32_sample_sources.h"
+#include "sample_bus.h"
+#include "event_capture.h"
+#include "holter_log.h"
+#include "esp32_holter_storage.h"
+#include "loop_stats.h"
 
 // Objetos globales
 LCDManager lcd;
 ECGMonitor ecgMonitor;
 
-// Habilitar salida CSV para plotter (habilitar para usar tools/plot_ecg.py)
-#define ENABLE_CSV_OUTPUT 1
+// Salida para el plotter de Python (tools/main.py):
+//   1 = tramas binarias (ecg_stream.h), las que decodifica tools/ecg_protocol.py
+//   0 = CSV legible por muestra, solo para depurar con el monitor serie
+#define ECG_BINARY_STREAM 1
 
-// Variables para el timer
-volatile bool sampleFlag = false;
-hw_timer_t *timer = NULL;
+#if ECG_BINARY_STREAM
+ECGStreamEncoder streamEncoder;
+#endif
+
+// Fuente de muestras:
+//   1 = ADC continuo por DMA (sin analogRead por muestra ni jitter del loop)
+//   0 = timer + analogRead (comportamiento anterior)
+#define ECG_SAMPLE_SOURCE_DMA 1
+
+// Lecturas por muestra con la fuente de timer (potencia de 2):
+//   8 = sobremuestreo a 2 kHz con diezmado CIC (cic_decimator.h)
+//   1 = una lectura por tick
+#define ECG_OVERSAMPLE_RATIO 8
+
+#if ECG_SAMPLE_SOURCE_DMA
+Esp32DmaSource sampleSource(ADC1_CHANNEL_6); // GPIO34 = AD8232Pins::OUTPUT_PIN
+#elif ECG_OVERSAMPLE_RATIO > 1
+OversampledAnalogSource<ECG_OVERSAMPLE_RATIO> sampleSource(AD8232Pins::OUTPUT_PIN);
+#else
+TimerAnalogSource sampleSource(AD8232Pins::OUTPUT_PIN);
+#endif
+
+// Registro Holter en la flash (LittleFS):
+//   1 = graba las muestras crudas comprimidas; sobrevive a desconectar el USB
+//   0 = sin registro
+#define ECG_HOLTER_RECORDER 1
+
+#if ECG_HOLTER_RECORDER
+LittleFSHolterStorage holterStorage;
+HolterRecorder holter(holterStorage, SAMPLE_RATE_HZ);
+bool holterReady = false;
+#endif
+
+// Captura por eventos (event_capture.h):
+//   1 = por serie y a la flash solo van los episodios (bradicardia,
+//       taquicardia, pausa, RR irregular) con 5 s antes y 5 s después del
+//       disparo, más la trama de estado; el LCD sigue mostrándolo todo
+//   0 = envío y registro continuos
+#define ECG_EVENT_CAPTURE 0
+
+#if ECG_EVENT_CAPTURE
+// 4096 muestras (16 KB, 16 s): la ventana de 10 s y margen para leerla
+typedef EventCapture<SAMPLE_RATE_HZ, 5 * SAMPLE_RATE_HZ, 5 * SAMPLE_RATE_HZ, 4096> ECGEventCapture;
+ECGEventCapture eventCapture;
+EpisodeCursor serialEpisodes;
+#if ECG_HOLTER_RECORDER
+EpisodeCursor holterEpisodes;
+#endif
+// Muestras de episodio por vuelta de loop() y destino: la parte previa
+// (1250) sale en unas decenas de vueltas sin bloquear el puerto serie ni
+// llenar la cola del Holter
+const size_t EPISODE_SERIAL_CHUNK = 50;
+#endif
+
+// Muestras leídas de la fuente por bloque
+const uint8_t SAMPLE_BLOCK_SIZE = 16;
+
+// Pipeline en dos núcleos:
+//   1 = adquisición + DSP en una tarea fijada al núcleo 0; loop() (núcleo 1)
+//       solo atiende a los consumidores. Un I2C lento ya no retrasa el muestreo.
+//   0 = todo en loop(), pasando igualmente por el bus
+#define ECG_DUAL_CORE 1
+
+const BaseType_t ACQUISITION_CORE = 0;
+const UBaseType_t ACQUISITION_PRIORITY = configMAX_PRIORITIES - 2;
+TaskHandle_t acquisitionTaskHandle = NULL;
+
+// Bloques procesados del núcleo 0 a los consumidores (sample_bus.h): cada
+// bloque se rellena una vez en el pool y cada consumidor lo lee en su
+// sitio. 32 bloques de 64 ms cubren la reserva de los consumidores de
+// sinks[] (profundidad + 1 cada uno) y la del productor. El HRV de cada
+// latido viaja como BeatEvent.
+typedef SampleBus<ProcessedSample, BeatEvent, SAMPLE_BLOCK_SIZE, 32> ECGBus;
+ECGBus sampleBus;
+
+// Últimos valores vistos por el LCD (solo se usan en loop())
+ProcessedSample lastSample = {0, 0, 0.0f, false, false, QUALITY_UNKNOWN, HR_SOURCE_NONE};
+HRVMetrics lastHrv = {};
+RespirationEstimate lastRespiration = {0.0f, RESP_SOURCE_NONE, 0};
 
 // Variable para control de actualización de LCD
 unsigned long lastLCDUpdate = 0;
 const unsigned long LCD_UPDATE_INTERVAL = 100; // Actualizar LCD cada 100ms
 
-void IRAM_ATTR onTimer()
-{
-  // set flag only, keep ISR minimal
-  sampleFlag = true;
-}
+// Lecturas perdidas por la fuente, copiadas por acquireBlock() para loop()
+volatile uint32_t sourceOverruns = 0;
 
-void setup()
+// Trama de estado (pérdidas y calidad de señal) una vez por segundo
+unsigned long lastStatusFrame = 0;
+const unsigned long STATUS_FRAME_INTERVAL = 1000;
+
+// Informe del peor tiempo de LCD por vuelta de loop() (solo en modo CSV:
+// en binario el texto rompería las tramas)
+unsigned long lastLCDStatsReport = 0;
+const unsigned long LCD_STATS_INTERVAL = 5000;
+
+// Instrumentación del lazo de tiempo real (loop_stats.h):
+//   1 = histogramas de latencia tick -> proceso, de la duración por
+//       muestra de processBlock(), del LCD y del envío por serie, y de la
+//       cola del puerto serie; contadores del bus por consumidor. 's' por
+//       el puerto serie los vuelca, 'r' los pone a cero.
+//   0 = sin medidas
+#define ECG_LOOP_STATS 1
+
+#if ECG_LOOP_STATS
+// Núcleo 0 (acquireBlock). Latencia en us desde el tick del timer que
+// disparó la muestra hasta que empieza a procesarse su bloque; solo con las
+// fuentes de timer, con DMA el muestreo no depende del software.
+TimingHistogram tickLatencyUs;
+// Ciclos por muestra de processBlock(), uno por bloque
+TimingHistogram processCycles;
+// Muestras que empezaron a procesarse después del tick siguiente
+uint32_t lateSamples = 0;
+// loop() pide el reset y lo hace acquireBlock(), el único que escribe
+volatile bool acquisitionStatsReset = false;
+
+// Núcleo 1 (loop())
+TimingHistogram queueDepth;     // muestras esperando al consumidor serie
+TimingHistogram serialCycles;   // envío de un bloque del bus al puerto serie
+TimingHistogram lcdCycles;      // actualización y servicio del LCD por vuelta
+unsigned long statsSince = 0;
+#endif
+
+// Lee un bloque de la fuente, lo procesa directamente en un bloque del bus
+// y lo publica. Es el único código que toca sampleSource y ecgMonitor.
+size_t acquireBlock(uint32_t timeoutMs)
 {
-  Serial.begin(115200);
+  int16_t block[SAMPLE_BLOCK_SIZE];
+  size_t count = sampleSource.readWait(block, SAMPLE_BLOCK_SIZE, timeoutMs);
+  sourceOverruns = sampleSource.overruns();
 
-  // Inicializar LCD
-  lcd.begin();
-  // Mostrar dirección I2C detectada
-  Serial.print("LCD I2C address: 0x");
-  Serial.println(lcd.getAddress(), HEX);
+#if ECG_LOOP_STATS
+  if (acquisitionStatsReset)
+  {
+    tickLatencyUs.reset();
+    processCycles.reset();
+    lateSamples = 0;
+    sampleBus.resetStats();
+    acquisitionStatsReset = false;
+  }
+  uint32_t firstTickUs = 0;
+  bool timedSource = count > 0 && sampleSource.firstSampleTickUs(firstTickUs);
+  if (timedSource)
+  {
+    // Todo el bloque empieza a procesarse a la vez
+    uint32_t nowUs = micros();
+    for (size_t i = 0; i < count; i++)
+    {
+      uint32_t latency = nowUs - (firstTickUs + (uint32_t)i * SAMPLE_INTERVAL_US);
+      tickLatencyUs.add(latency);
+      if (latency >= SAMPLE_INTERVAL_US)
+      {
+        lateSamples++;
+      }
+    }
+  }
+  uint32_t startCycles = ESP.getCycleCount();
+#endif
+  if (count == 0)
+  {
+    return 0;
+  }
 
-  // Inicializar monitor ECG
-  ecgMonitor.begin();
+  // Electrodos leídos una vez por bloque y filtrado del bloque entero; los
+  // resultados por muestra son los mismos que con processSample(). La
+  // reserva de subscribe() garantiza un bloque libre.
+  ECGBus::Block *out = sampleBus.claim();
+  uint32_t firstSample = ecgMonitor.getHistory().sampleCount();
+  uint16_t beats = ecgMonitor.processBlock(block, count, out ? out->samples : nullptr);
+#if ECG_LOOP_STATS
+  processCycles.add((ESP.getCycleCount() - startCycles) / count);
+#endif
+  if (out)
+  {
+    sampleBus.publish((uint8_t)count, firstSample);
+  }
 
-  // Mostrar mensaje inicial sobre electrodos
-  lcd.updateStatus("Esperando...");
+  // Un bloque dura menos que el periodo refractario: como mucho un latido
+  if (beats > 0)
+  {
+    BeatEvent beat = {ecgMonitor.getLastBeatSample(), ecgMonitor.getBeatInfo().bpm, ecgMonitor.getHRV(),
+                      ecgMonitor.getRespiration()};
+    sampleBus.publishEvent(beat);
+  }
+  return count;
+}
 
-  // Configurar timer para muestreo
-  timer = timerBegin(0, 80, true);
-  timerAttachInterrupt(timer, &onTimer, true);
-  timerAlarmWrite(timer, SAMPLE_INTERVAL_US, true);
-  timerAlarmEnable(timer);
+#if ECG_LOOP_STATS
+// Vuelca los contadores y los histogramas como texto "# ...". En binario el
+// receptor descarta el texto como una trama corrupta y se resincroniza en
+// el 0x00 final (ecg_stream.h).
+void dumpLoopStats()
+{
+  const float usPerCycle = 1.0f / getCpuFrequencyMhz();
+  auto emit = [](const char *line) { Serial.println(line); };
+  char line[96];
 
-  lcd.updateStatus("Listo");
+#if ECG_BINARY_STREAM
+  Serial.write((uint8_t)0x00);
+#endif
+  snprintf(line, sizeof(line), "# Lazo de tiempo real, %lu s desde el reset (presupuesto %lu us/muestra)",
+           (unsigned long)((millis() - statsSince) / 1000), (unsigned long)SAMPLE_INTERVAL_US);
+  emit(line);
+  snprintf(line, sizeof(line), "# perdidas: adc=%lu tarde=%lu",
+           (unsigned long)sourceOverruns, (unsigned long)lateSamples);
+  emit(line);
+  dumpBusStats(sampleBus, emit);
+  if (tickLatencyUs.count() > 0)
+  {
+    dumpTimingHistogram("tick->proceso", tickLatencyUs, 1.0f, "us", emit);
+  }
+  dumpTimingHistogram("proceso/muestra", processCycles, usPerCycle, "us", emit);
+  dumpTimingHistogram("cola", queueDepth, 1.0f, "muestras", emit);
+  dumpTimingHistogram("serie/bloque", serialCycles, usPerCycle, "us", emit);
+  dumpTimingHistogram("lcd/vuelta", lcdCycles, usPerCycle, "us", emit);
+#if ECG_BINARY_STREAM
+  Serial.write((uint8_t)0x00);
+#endif
+}
+
+// Órdenes de una letra por el puerto serie
+void serviceStatsCommands()
+{
+  while (Serial.available() > 0)
+  {
+    int c = Serial.read();
+    if (c == 's')
+    {
+      dumpLoopStats();
+    }
+    else if (c == 'r')
+    {
+      acquisitionStatsReset = true;
+      queueDepth.reset();
+      serialCycles.reset();
+      lcdCycles.reset();
+      statsSince = millis();
+    }
+  }
 }
+#endif
+
+#if ECG_DUAL_CORE
+void acquisitionTask(void *)
+{
+  for (;;)
+  {
+    // Con DMA la tarea duerme en el driver hasta que hay datos
+    if (acquireBlock(20) == 0)
+    {
+      vTaskDelay(1);
+    }
+  }
+}
+#endif
 
 // Helper function to send data in a unified format for the plotter
-void sendPlotterData(float filteredValue, float bpm, bool leadsConnected)
+void sendPlotterData(float filteredValue, float bpm, bool leadsConnected, bool beatDetected)
 {
+#if ECG_BINARY_STREAM
+  // Se acumulan STREAM_FRAME_SAMPLES muestras y se envía la trama de una vez
+  if (streamEncoder.push((int16_t)filteredValue, bpm, leadsConnected, beatDetected))
+  {
+    Serial.write(streamEncoder.data(), streamEncoder.size());
+  }
+#else
   static char buffer[50];
   int leadStatus = leadsConnected ? 1 : 0;
 
@@ -80,57 +313,372 @@ void sendPlotterData(float filteredValue, float bpm, bool leadsConnected)
   snprintf(buffer, sizeof(buffer), "%.2f,%d,%d", filteredValue, (int)bpm, leadStatus);
   
   Serial.println(buffer);
+#endif
 }
 
-void loop()
+// Consumidor serie: cada muestra al plotter y tramas de HRV y respiración por latido
+void serviceSerialSink(int8_t id, unsigned long now)
 {
-  if (sampleFlag)
+  static uint8_t lastQuality = QUALITY_UNKNOWN;
+  const ECGBus::Block *b;
+#if ECG_LOOP_STATS
+  queueDepth.add(sampleBus.pending(id) * SAMPLE_BLOCK_SIZE);
+  uint32_t startCycles = ESP.getCycleCount();
+#endif
+  while ((b = sampleBus.next(id)) != nullptr)
   {
-    sampleFlag = false;
-
-    // Procesar nueva muestra
-    bool beatDetected = ecgMonitor.processSample();
-    bool leadsAreConnected = ecgMonitor.checkLeadsConnected();
+    for (uint8_t i = 0; i < b->count; i++)
+    {
+      const ProcessedSample &sample = b->samples[i];
 
-    // Enviar datos al plotter de Python si los electrodos están conectados
-    if (leadsAreConnected) {
-      sendPlotterData(
-          ecgMonitor.getLastFilteredValue(),
-          ecgMonitor.getBeatInfo().bpm,
-          leadsAreConnected
-      );
+      // Enviar datos al plotter de Python. En binario también se envían las
+      // tramas sin electrodos para que el host vea el estado de conexión.
+#if ECG_BINARY_STREAM
+      sendPlotterData(sample.filtered, sample.bpm, sample.leadsConnected, sample.beat);
+#else
+      if (sample.leadsConnected) {
+        sendPlotterData(sample.filtered, sample.bpm, sample.leadsConnected, sample.beat);
+      }
+#endif
     }
+    lastQuality = b->samples[b->count - 1].quality;
+#if ECG_LOOP_STATS
+    uint32_t endCycles = ESP.getCycleCount();
+    serialCycles.add(endCycles - startCycles);
+    startCycles = endCycles;
+#endif
+  }
 
-    // Tareas de actualización del LCD (se ejecutan con menos frecuencia para evitar parpadeo)
-    unsigned long now = millis();
-    if (now - lastLCDUpdate >= LCD_UPDATE_INTERVAL)
-    {
-      lastLCDUpdate = now;
+  BeatEvent beat;
+  while (sampleBus.nextEvent(id, beat))
+  {
+#if ECG_BINARY_STREAM
+    streamEncoder.encodeHrv(beat.hrv);
+    Serial.write(streamEncoder.data(), streamEncoder.size());
+    streamEncoder.encodeRespiration(beat.respiration);
+    Serial.write(streamEncoder.data(), streamEncoder.size());
+#endif
+  }
+
+#if ECG_BINARY_STREAM
+  if (now - lastStatusFrame >= STATUS_FRAME_INTERVAL)
+  {
+    lastStatusFrame = now;
+    // Muestras que este consumidor no recibió (ver "escrituras" en ecg_stream.h)
+    uint32_t dropped = sampleBus.stats(id).droppedSamples;
+    streamEncoder.encodeStatus(sourceOverruns, dropped, lastQuality);
+    Serial.write(streamEncoder.data(), streamEncoder.size());
+  }
+#else
+  (void)now;
+#endif
+}
+
+// Consumidor LCD: solo el último bloque (buzón) y los latidos para el corazón
+void serviceLcdSink(int8_t id, unsigned long now)
+{
+  const ECGBus::Block *b = sampleBus.next(id);
+  if (b != nullptr)
+  {
+    lastSample = b->samples[b->count - 1];
+  }
+  sampleBus.release(id);
+  bool leadsAreConnected = lastSample.leadsConnected;
 
-      // Gestionar el apagado del indicador de latido (corazón)
-      lcd.manageBeatIndicator();
+  bool beatSeen = false;
+  BeatEvent beat;
+  while (sampleBus.nextEvent(id, beat))
+  {
+    lastHrv = beat.hrv;
+    lastRespiration = beat.respiration;
+    beatSeen = true;
+  }
+  if (!leadsAreConnected)
+  {
+    lastHrv = HRVMetrics();
+    lastRespiration.rate = 0.0f;
+  }
+
+  // Tareas de actualización del LCD (se ejecutan con menos frecuencia para evitar parpadeo)
+#if ECG_LOOP_STATS
+  uint32_t startCycles = ESP.getCycleCount();
+#endif
+  if (now - lastLCDUpdate >= LCD_UPDATE_INTERVAL)
+  {
+    lastLCDUpdate = now;
 
-      // Actualizar la barra de señal a una velocidad visualmente agradable
-      lcd.updateSignalBar(ecgMonitor.getLastFilteredValue());
+    // Gestionar el apagado del indicador de latido (corazón)
+    lcd.manageBeatIndicator();
 
-      // Actualizar Status y BPM
-      if (!leadsAreConnected)
+    // Actualizar la barra de señal a una velocidad visualmente agradable
+    lcd.updateSignalBar(lastSample.filtered);
+    lcd.updateHRV(lastHrv);
+    lcd.updateRespiration(lastRespiration.rate);
+
+    // Actualizar Status, BPM y calidad. Con la calidad bajo el umbral los
+    // latidos se descartan; si el detector pierde el enganche la FC sale
+    // de la estimación espectral, y si tampoco la hay se queda en el
+    // último valor bueno.
+    if (!leadsAreConnected)
+    {
+      lcd.updateStatus("Sin electrodos");
+      lcd.updateBPM(0);
+      lcd.updateQuality(QUALITY_UNKNOWN);
+    }
+    else
+    {
+      uint8_t q = lastSample.quality;
+      if (q != QUALITY_UNKNOWN && q < ECGMonitor::QUALITY_GATE)
+      {
+        lcd.updateStatus("Artefactos");
+      }
+      else if (lastSample.hrSource == HR_SOURCE_SPECTRAL)
       {
-        lcd.updateStatus("Sin electrodos");
-        lcd.updateBPM(0);
+        lcd.updateStatus("FC espectral");
       }
       else
       {
         lcd.updateStatus("Monitoreando");
-        const BeatInfo &beatInfo = ecgMonitor.getBeatInfo();
-        lcd.updateBPM(beatInfo.bpm);
       }
+      lcd.updateBPM(lastSample.bpm);
+      lcd.updateQuality(q);
+    }
+  }
+
+  // Mostrar el indicador de latido en el LCD instantáneamente (no bloqueante)
+  if (beatSeen && leadsAreConnected)
+  {
+    lcd.showBeat();
+  }
+
+  // Las update* solo marcan celdas: aquí se envía una porción acotada
+  lcd.service();
+#if ECG_LOOP_STATS
+  lcdCycles.add(ESP.getCycleCount() - startCycles);
+#endif
+
+#if !ECG_BINARY_STREAM
+  if (now - lastLCDStatsReport >= LCD_STATS_INTERVAL)
+  {
+    lastLCDStatsReport = now;
+    Serial.print("# LCD us/tick: ultimo=");
+    Serial.print(lcd.getLastTickUs());
+    Serial.print(" peor=");
+    Serial.print(lcd.getWorstTickUs());
+    Serial.print(" ticks=");
+    Serial.println(lcd.getBusyTicks());
+    lcd.resetTickStats();
+  }
+#endif
+}
+
+#if ECG_EVENT_CAPTURE
+// Envía por serie lo capturado del episodio en curso, entre sus tramas de
+// inicio y fin (solo en binario: el CSV no tiene dónde marcarlos)
+void sendEpisodeSamples()
+{
+#if ECG_BINARY_STREAM
+  int16_t filtered[EPISODE_SERIAL_CHUNK];
+  eventCapture.streamEpisode(serialEpisodes, streamEncoder,
+                             [](const uint8_t *data, size_t size) { Serial.write(data, size); },
+                             filtered, EPISODE_SERIAL_CHUNK);
+#endif
+}
+
+#if ECG_HOLTER_RECORDER
+// Graba en la flash lo capturado del episodio en curso, un bloque de
+// HolterRecorder por vuelta; entre episodios queda un hueco en el índice
+void recordEpisodeSamples()
+{
+  if (!holterReady)
+  {
+    return;
+  }
+  int16_t raw[HOLTER_BLOCK_SAMPLES];
+  eventCapture.recordEpisode(holterEpisodes, holter, raw, HOLTER_BLOCK_SAMPLES);
+}
+#endif
+
+// Consumidor de captura por eventos: alimenta eventCapture con cada
+// muestra y cada latido, y envía y graba solo los episodios
+void serviceEventSink(int8_t id, unsigned long now)
+{
+  static uint8_t lastQuality = QUALITY_UNKNOWN;
+  const ECGBus::Block *b;
+  BeatEvent beat;
+  while ((b = sampleBus.next(id)) != nullptr)
+  {
+    for (uint8_t i = 0; i < b->count; i++)
+    {
+      const ProcessedSample &sample = b->samples[i];
+      bool clean = sample.quality == QUALITY_UNKNOWN || sample.quality >= ECGMonitor::QUALITY_GATE;
+      eventCapture.push(b->firstSample + i, sample.raw, sample.filtered, sample.leadsConnected, clean);
+    }
+    lastQuality = b->samples[b->count - 1].quality;
+    // Los latidos de este bloque, antes de contar pausa en el siguiente
+    while (sampleBus.nextEvent(id, beat))
+    {
+      eventCapture.onBeat(beat.sample);
+    }
+  }
+
+  sendEpisodeSamples();
+#if ECG_HOLTER_RECORDER
+  recordEpisodeSamples();
+  if (holterReady)
+  {
+    holter.service(now);
+  }
+#endif
+
+#if ECG_BINARY_STREAM
+  if (now - lastStatusFrame >= STATUS_FRAME_INTERVAL)
+  {
+    lastStatusFrame = now;
+    // Muestras que este consumidor no recibió (ver "escrituras" en ecg_stream.h)
+    uint32_t dropped = sampleBus.stats(id).droppedSamples;
+    streamEncoder.encodeStatus(sourceOverruns, dropped, lastQuality);
+    Serial.write(streamEncoder.data(), streamEncoder.size());
+  }
+#endif
+}
+#endif
+
+#if ECG_HOLTER_RECORDER
+// Consumidor Holter: las muestras crudas a la flash
+void serviceHolterSink(int8_t id, unsigned long now)
+{
+  const ECGBus::Block *b;
+  while ((b = sampleBus.next(id)) != nullptr)
+  {
+    if (!holterReady)
+    {
+      continue;
+    }
+    for (uint8_t i = 0; i < b->count; i++)
+    {
+      holter.push(b->samples[i].raw, !b->samples[i].leadsConnected);
+    }
+  }
+
+  // Como mucho HolterRecorder::WRITE_CHUNK bytes cada WRITE_INTERVAL_MS. Un
+  // borrado de sector para la caché de la flash, pero la adquisición sigue
+  // por DMA en el núcleo 0 y el buffer del driver cubre ~200 ms.
+  if (holterReady)
+  {
+    holter.service(now);
+  }
+}
+#endif
+
+// Consumidores del bus, atendidos por turno en loop(). Uno nuevo (red,
+// BLE...) es una función de servicio y una línea aquí: se suscribe en
+// setup() y no toca la adquisición ni a los demás.
+struct BusSink
+{
+  const char *name;
+  uint8_t depth;        // bloques de cola (1 con BUS_KEEP_LATEST)
+  BusPolicy policy;
+  uint8_t divider;      // recibe uno de cada 'divider' bloques
+  bool beatEvents;      // recibe los BeatEvent
+  void (*service)(int8_t id, unsigned long now);
+};
+
+const BusSink sinks[] = {
+#if ECG_EVENT_CAPTURE
+  // Serie y flash salen de los episodios: sin huecos en lo que se vigila
+  {"eventos", 16, BUS_DROP_NEWEST, 1, true, serviceEventSink},
+#else
+  // ~1 s de cola: serie no pierde muestras por un parón corto
+  {"serie", 16, BUS_DROP_NEWEST, 1, true, serviceSerialSink},
+#endif
+  // El LCD solo quiere el último estado y los latidos
+  {"lcd", 1, BUS_KEEP_LATEST, 1, true, serviceLcdSink},
+#if ECG_HOLTER_RECORDER && !ECG_EVENT_CAPTURE
+  // HolterRecorder tiene su propia cola; 0.5 s cubre un borrado de sector
+  {"holter", 8, BUS_DROP_NEWEST, 1, false, serviceHolterSink},
+#endif
+};
+const size_t SINK_COUNT = sizeof(sinks) / sizeof(sinks[0]);
+int8_t sinkIds[SINK_COUNT];
+
+void setup()
+{
+  Serial.begin(115200);
+
+  // Inicializar LCD
+  lcd.begin();
+  // Mostrar dirección I2C detectada
+  Serial.print("LCD I2C address: 0x");
+  Serial.println(lcd.getAddress(), HEX);
+
+  // Inicializar monitor ECG
+  ecgMonitor.begin();
+
+  // Mostrar mensaje inicial sobre electrodos
+  lcd.updateStatus("Esperando...");
+
+#if ECG_HOLTER_RECORDER
+  holterReady = holter.begin();
+  if (!holterReady)
+  {
+    Serial.println("Error al montar LittleFS: registro Holter desactivado");
+  }
+#endif
+
+  // Suscribir los consumidores antes de publicar el primer bloque
+  for (size_t k = 0; k < SINK_COUNT; k++)
+  {
+    const BusSink &sink = sinks[k];
+    sinkIds[k] = sampleBus.subscribe(sink.name, sink.depth, sink.policy, sink.divider, sink.beatEvents);
+    if (sinkIds[k] < 0)
+    {
+      Serial.print("Sin sitio en el bus para ");
+      Serial.println(sink.name);
     }
+  }
+
+  // Arrancar la adquisición
+  if (!sampleSource.begin())
+  {
+    Serial.println("Error al iniciar la fuente de muestras");
+    lcd.updateStatus("Error ADC");
+    return;
+  }
+
+#if ECG_DUAL_CORE
+  xTaskCreatePinnedToCore(acquisitionTask, "ecg_acq", 4096, NULL,
+                          ACQUISITION_PRIORITY, &acquisitionTaskHandle, ACQUISITION_CORE);
+#endif
 
-    // Mostrar el indicador de latido en el LCD instantáneamente (no bloqueante)
-    if (beatDetected && leadsAreConnected)
+  lcd.updateStatus("Listo");
+}
+
+void loop()
+{
+#if !ECG_DUAL_CORE
+  acquireBlock(0);
+#endif
+
+  // Cada consumidor recoge lo suyo del bus a su ritmo
+  unsigned long now = millis();
+  bool pending = false;
+  for (size_t k = 0; k < SINK_COUNT; k++)
+  {
+    if (sinkIds[k] >= 0)
     {
-      lcd.showBeat();
+      sinks[k].service(sinkIds[k], now);
+      pending |= sampleBus.pending(sinkIds[k]) > 0;
     }
   }
+
+#if ECG_LOOP_STATS
+  serviceStatsCommands();
+#endif
+
+  // Ceder el núcleo 1 hasta que lleguen más muestras
+  if (!pending && !lcd.hasPendingWork())
+  {
+    delay(1);
+  }
 }
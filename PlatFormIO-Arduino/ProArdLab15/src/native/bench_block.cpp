@@ -0,0 +1,301 @@
+/**
+ * @file bench_block.cpp
+ * @brief ECGMonitor::processBlock() frente a processSample(): equivalencia bit a bit y coste por muestra
+ *
+ * Uso: program block [segundos]
+ *   1. Tres señales sintéticas (limpia; con ruido, deriva y zumbido de red;
+ *      y una que pierde amplitud para que entre la FC espectral), con los
+ *      electrodos sueltos unos segundos. Se procesan muestra a muestra como
+ *      hacía acquireBlock() en el ESP32 (processSample(), otra lectura de
+ *      electrodos y los getters) y con processBlock() en bloques de 1, 7,
+ *      16, 32 y 100 muestras; los electrodos solo cambian entre bloques.
+ *      Cada ProcessedSample, los latidos, la HRV final y la historia deben
+ *      coincidir bit a bit.
+ *   2. ns por muestra de las dos formas según el tamaño de bloque, y de la
+ *      cadena de filtrado sola (process() frente a processBlock()). Las dos
+ *      rellenan un ProcessedSample por muestra. Avisa si el bloque no es
+ *      más rápido; no falla por ello (la medida depende del host).
+ *   Devuelve 1 si alguna muestra difiere.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <Arduino.h>
+#include "ecg_monitor.h"
+#include "recorded_stream.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+struct BlockSignal {
+    const char* name;
+    std::vector<int16_t> samples;
+    uint32_t offStart; // electrodos sueltos en [offStart, offEnd)
+    uint32_t offEnd;
+};
+
+static BlockSignal makeSignal(const char* name, int seconds, float noise, float hum, bool fade)
+{
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 450.0f;
+    cfg.noiseAmplitude = noise;
+    cfg.wanderAmplitude = 40.0f;
+    cfg.humAmplitude = hum;
+    SynthECG synth(cfg);
+
+    BlockSignal s;
+    s.name = name;
+    const uint32_t total = (uint32_t)seconds * SAMPLE_RATE_HZ;
+    for (uint32_t i = 0; i < total; i++) {
+        // Onda R a un tercio en la segunda mitad, con la FC subiendo
+        if (fade && i == total / 2) {
+            synth.setAmplitude(150.0f);
+            synth.setNoise(70.0f);
+            synth.setBpm(95.0f);
+        }
+        s.samples.push_back((int16_t)synth.next());
+    }
+    s.offStart = total / 4;
+    s.offEnd = s.offStart + 2 * SAMPLE_RATE_HZ + 13;
+    return s;
+}
+
+// Los electrodos de la muestra i, leídos una vez por bloque
+static void setLeads(const BlockSignal& s, uint32_t i)
+{
+    int level = i >= s.offStart && i < s.offEnd ? HIGH : LOW;
+    mockSetDigital(AD8232Pins::LO_PLUS, level);
+    mockSetDigital(AD8232Pins::LO_MINUS, level);
+}
+
+struct BlockTrace {
+    std::vector<ProcessedSample> samples;
+    HRVMetrics hrv;
+    uint32_t lastBeatSample;
+    uint32_t rejected;
+    std::vector<int16_t> history;
+};
+
+static void finishTrace(const ECGMonitor& monitor, BlockTrace& t)
+{
+    t.hrv = monitor.getHRV();
+    t.lastBeatSample = monitor.getLastBeatSample();
+    t.rejected = monitor.getRejectedBeats();
+    const ECGMonitor::History& h = monitor.getHistory();
+    for (uint32_t i = h.oldestIndex(); i < h.sampleCount(); i++) {
+        t.history.push_back(h.rawAt(i));
+        t.history.push_back(h.filteredAt(i));
+    }
+}
+
+// Una muestra como el bucle de acquireBlock() antes de processBlock():
+// processSample(), otra lectura de electrodos y los getters
+static inline void streamSample(ECGMonitor& monitor, int16_t raw, ProcessedSample& p)
+{
+    p.raw = raw;
+    p.beat = monitor.processSample(raw);
+    p.leadsConnected = monitor.checkLeadsConnected();
+    p.filtered = p.leadsConnected ? (int16_t)monitor.getLastFilteredValue() : 0;
+    p.bpm = monitor.getBeatInfo().bpm;
+    p.quality = monitor.getSignalQuality();
+    p.hrSource = monitor.getHeartRateSource();
+}
+
+static BlockTrace runStreaming(const BlockSignal& s, size_t blockSize)
+{
+    BlockTrace t;
+    ECGMonitor* monitor = new ECGMonitor();
+    monitor->begin();
+    for (uint32_t i = 0; i < s.samples.size(); i++) {
+        if (i % blockSize == 0) setLeads(s, i);
+        ProcessedSample p;
+        memset(&p, 0, sizeof(p));
+        streamSample(*monitor, s.samples[i], p);
+        t.samples.push_back(p);
+    }
+    finishTrace(*monitor, t);
+    delete monitor;
+    return t;
+}
+
+static BlockTrace runBlocks(const BlockSignal& s, size_t blockSize)
+{
+    BlockTrace t;
+    t.samples.resize(s.samples.size());
+    memset(&t.samples[0], 0, t.samples.size() * sizeof(ProcessedSample));
+    ECGMonitor* monitor = new ECGMonitor();
+    monitor->begin();
+    for (size_t i = 0; i < s.samples.size(); i += blockSize) {
+        size_t n = s.samples.size() - i < blockSize ? s.samples.size() - i : blockSize;
+        setLeads(s, (uint32_t)i);
+        monitor->processBlock(&s.samples[i], n, &t.samples[i]);
+    }
+    finishTrace(*monitor, t);
+    delete monitor;
+    return t;
+}
+
+// Compara campo a campo (bpm por sus bits: también distingue -0 y NaN)
+static bool sameSample(const ProcessedSample& a, const ProcessedSample& b)
+{
+    uint32_t ba, bb;
+    memcpy(&ba, &a.bpm, sizeof(ba));
+    memcpy(&bb, &b.bpm, sizeof(bb));
+    return a.raw == b.raw && a.filtered == b.filtered && ba == bb && a.leadsConnected == b.leadsConnected &&
+           a.beat == b.beat && a.quality == b.quality && a.hrSource == b.hrSource;
+}
+
+static bool compareTraces(const BlockTrace& ref, const BlockTrace& blk, uint32_t& beats, uint32_t& spectral)
+{
+    beats = 0;
+    spectral = 0;
+    uint32_t diffs = 0, first = 0;
+    for (size_t i = 0; i < ref.samples.size(); i++) {
+        beats += ref.samples[i].beat;
+        spectral += ref.samples[i].hrSource == HR_SOURCE_SPECTRAL;
+        if (!sameSample(ref.samples[i], blk.samples[i])) {
+            if (diffs == 0) first = (uint32_t)i;
+            diffs++;
+        }
+    }
+    if (diffs) printf("      %lu muestras distintas (la primera, %lu)\n", (unsigned long)diffs, (unsigned long)first);
+    bool same = diffs == 0 && memcmp(&ref.hrv, &blk.hrv, sizeof(HRVMetrics)) == 0 &&
+                ref.lastBeatSample == blk.lastBeatSample && ref.rejected == blk.rejected && ref.history == blk.history;
+    return same;
+}
+
+static bool checkEquivalence(int seconds)
+{
+    static const size_t sizes[] = {1, 7, 16, 32, 100};
+    BlockSignal signals[] = {
+        makeSignal("limpia", seconds, 10.0f, 0.0f, false),
+        makeSignal("ruido+red", seconds, 60.0f, 80.0f, false),
+        makeSignal("amplitud baja", seconds, 20.0f, 0.0f, true),
+    };
+
+    bool ok = true;
+    printf("1. processBlock() frente a processSample() (%d s, electrodos sueltos ~2 s)\n", seconds);
+    for (const BlockSignal& s : signals) {
+        for (size_t size : sizes) {
+            BlockTrace ref = runStreaming(s, size);
+            BlockTrace blk = runBlocks(s, size);
+            uint32_t beats, spectral;
+            bool same = compareTraces(ref, blk, beats, spectral);
+            printf("   %-14s bloque %3u: %3lu latidos, %5lu muestras con FC espectral  %s\n", s.name, (unsigned)size,
+                   (unsigned long)beats, (unsigned long)spectral, same ? "idéntico" : "DISTINTO");
+            if (!same) ok = false;
+        }
+    }
+    return ok;
+}
+
+static void measureCost(int seconds)
+{
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 450.0f;
+    cfg.noiseAmplitude = 20.0f;
+    cfg.humAmplitude = 40.0f;
+    SynthECG synth(cfg);
+    std::vector<int16_t> x((size_t)seconds * SAMPLE_RATE_HZ);
+    for (size_t i = 0; i < x.size(); i++) x[i] = (int16_t)synth.next();
+    mockSetDigital(AD8232Pins::LO_PLUS, LOW);
+    mockSetDigital(AD8232Pins::LO_MINUS, LOW);
+    const int reps = 5;
+
+    printf("2. Coste por muestra (%u muestras, mejor de %d)\n", (unsigned)x.size(), reps);
+
+    // Las dos formas rellenan el mismo ProcessedSample por muestra, como la
+    // tarea de adquisición del ESP32
+    static const size_t MAX_BLOCK = 256;
+    std::vector<ProcessedSample> out(MAX_BLOCK);
+    double best = 1e30;
+    for (int r = 0; r < reps; r++) {
+        ECGMonitor* monitor = new ECGMonitor();
+        monitor->begin();
+        BenchTimer t;
+        t.start();
+        for (size_t i = 0; i < x.size(); i++) streamSample(*monitor, x[i], out[i % MAX_BLOCK]);
+        t.stop();
+        benchKeep(out[0].bpm);
+        if (t.elapsedNs() < best) best = t.elapsedNs();
+        delete monitor;
+    }
+    double streaming = best / x.size();
+    printf("   processSample():          %7.1f ns/muestra\n", streaming);
+
+    static const size_t sizes[] = {4, 16, 64, MAX_BLOCK};
+    size_t slower = 0;
+    for (size_t size : sizes) {
+        best = 1e30;
+        for (int r = 0; r < reps; r++) {
+            ECGMonitor* monitor = new ECGMonitor();
+            monitor->begin();
+            BenchTimer t;
+            t.start();
+            for (size_t i = 0; i < x.size(); i += size) {
+                size_t n = x.size() - i < size ? x.size() - i : size;
+                benchKeep(monitor->processBlock(&x[i], n, &out[0]));
+            }
+            t.stop();
+            benchKeep(out[0].bpm);
+            if (t.elapsedNs() < best) best = t.elapsedNs();
+            delete monitor;
+        }
+        double ratio = streaming / (best / x.size());
+        printf("   processBlock(), bloque %3u: %5.1f ns/muestra (%.2fx)%s\n", (unsigned)size, best / x.size(), ratio,
+               ratio > 1.0 ? "" : "  AVISO: no es más rápido");
+        if (ratio <= 1.0) slower++;
+    }
+
+    // Solo la cadena de filtrado
+    std::vector<ECGFilter::Value> lp(x.size());
+    std::vector<int16_t> unsmoothed(x.size());
+    double perSample = 1e30, perBlock = 1e30;
+    for (int r = 0; r < reps; r++) {
+        ECGFilter f;
+        f.reset(x[0]);
+        BenchTimer t;
+        t.start();
+        for (size_t i = 0; i < x.size(); i++) {
+            lp[i] = f.process(x[i]);
+            unsmoothed[i] = (int16_t)f.lastUnsmoothed();
+        }
+        t.stop();
+        benchKeep(lp[x.size() - 1]);
+        if (t.elapsedNs() < perSample) perSample = t.elapsedNs();
+
+        ECGFilter g;
+        g.reset(x[0]);
+        t.start();
+        for (size_t i = 0; i < x.size(); i += ECGMonitor::BLOCK_CHUNK) {
+            size_t n = x.size() - i < ECGMonitor::BLOCK_CHUNK ? x.size() - i : ECGMonitor::BLOCK_CHUNK;
+            g.processBlock(&x[i], &lp[i], &unsmoothed[i], n);
+        }
+        t.stop();
+        benchKeep(lp[x.size() - 1]);
+        if (t.elapsedNs() < perBlock) perBlock = t.elapsedNs();
+    }
+    printf("   filtro: process() %.2f ns/muestra, processBlock() %.2f ns/muestra (%.2fx)%s\n", perSample / x.size(),
+           perBlock / x.size(), perSample / perBlock, perSample > perBlock ? "" : "  AVISO: no es más rápido");
+
+    // Solo aviso: la medida depende de la máquina y de su carga. La
+    // detección se hace muestra a muestra igual que en processSample(), así
+    // que processBlock() solo ahorra las lecturas de electrodos y los getters
+    if (slower > 0 || perSample <= perBlock) {
+        printf("   AVISO: processBlock() no es más rápido en %u de %u tamaños de bloque%s\n", (unsigned)slower,
+               (unsigned)(sizeof(sizes) / sizeof(sizes[0])), perSample <= perBlock ? " ni en el filtro" : "");
+    }
+}
+
+int benchBlock(int argc, char** argv)
+{
+    int seconds = argc > 0 ? atoi(argv[0]) : 60;
+    if (seconds < 10) seconds = 10;
+
+    bool ok = checkEquivalence(seconds);
+    measureCost(seconds);
+
+    printf("%s\n", ok ? "OK" : "FALLO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+/**
+ * @file bench_bus.cpp
+ * @brief Prueba de carga de SampleBus (sample_bus.h) con un productor y cuatro suscriptores en hilos reales
+ *
+ * Uso: program bus [miles_de_bloques]
+ *   El bus de esp32_main.cpp (bloques de 16 ProcessedSample, pool de 32)
+ *   con un productor que publica un bloque cada 20 us (uno de cada 7 a
+ *   medias, como los de un readWait() que vence) y un BeatEvent cada 10
+ *   bloques, y cuatro suscriptores:
+ *     - "rapido": cola de 16, sin pausas (como el puerto serie).
+ *     - "lento": cola de 8, se para 2 ms cada 50 bloques (flash borrando).
+ *     - "ultimo": buzón BUS_KEEP_LATEST con eventos (LCD).
+ *     - "diezmado": uno de cada 4 bloques, cola de 2.
+ *   Comprueba que claim() nunca falla, que ningún bloque cambia mientras un
+ *   suscriptor lo tiene (se relee tras una pausa), que cada uno recibe en
+ *   orden y que recibidos + perdidos cuadra con lo publicado, en bloques y
+ *   en muestras; al final todo
+ *   el pool vuelve a estar libre. Mide el coste de claim() + publish().
+ *   Devuelve 1 si falla alguna comprobación.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <chrono>
+#include "ecg_types.h"
+#include "signal_quality.h"
+#include "spectral_hr.h"
+#include "sample_bus.h"
+#include "loop_stats.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+static const uint8_t BLOCK_SAMPLES = 16;
+typedef SampleBus<ProcessedSample, BeatEvent, BLOCK_SAMPLES, 32> TestBus;
+
+static const uint32_t EVENT_EVERY = 10;
+
+// Contenido de la muestra i del bloque que empieza en 'first'
+static int16_t patternRaw(uint32_t first, uint8_t i) { return (int16_t)(first + i); }
+static int16_t patternFiltered(uint32_t first, uint8_t i) { return (int16_t)~(first + i); }
+
+// Muestras del bloque 'sequence': algunos no van llenos
+static uint8_t blockCount(uint32_t sequence)
+{
+    return sequence % 7 == 3 ? (uint8_t)(1 + sequence % BLOCK_SAMPLES) : BLOCK_SAMPLES;
+}
+
+static bool blockIntact(const TestBus::Block& b)
+{
+    if (b.count != blockCount(b.sequence) || b.firstSample != b.sequence * BLOCK_SAMPLES) return false;
+    for (uint8_t i = 0; i < b.count; i++) {
+        if (b.samples[i].raw != patternRaw(b.firstSample, i) ||
+            b.samples[i].filtered != patternFiltered(b.firstSample, i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct SubscriberSpec {
+    const char* name;
+    uint8_t depth;
+    BusPolicy policy;
+    uint8_t divider;
+    bool events;
+    uint32_t stallEvery;   // bloques entre pausas (0 = sin pausas)
+    uint32_t stallUs;
+    uint32_t holdUs;       // tiempo con cada bloque en la mano
+};
+
+struct SubscriberResult {
+    uint32_t received = 0;
+    uint32_t samples = 0;
+    uint32_t events = 0;
+    bool ordered = true;
+    bool intact = true;
+    bool eventsOrdered = true;
+};
+
+static void consume(TestBus& bus, int8_t id, const SubscriberSpec& spec, const std::atomic<bool>& done,
+                    SubscriberResult& r)
+{
+    uint32_t nextSequence = 0, nextEventSample = 0;
+    for (;;) {
+        bool finished = done.load(std::memory_order_acquire);
+        const TestBus::Block* b = bus.next(id);
+        BeatEvent ev;
+        while (bus.nextEvent(id, ev)) {
+            if (ev.sample < nextEventSample) r.eventsOrdered = false;
+            nextEventSample = ev.sample + 1;
+            r.events++;
+        }
+        if (b == nullptr) {
+            if (finished) break;
+            std::this_thread::yield();
+            continue;
+        }
+        if (b->sequence < nextSequence || b->sequence % spec.divider != 0) r.ordered = false;
+        nextSequence = b->sequence + 1;
+        r.intact &= blockIntact(*b);
+        if (spec.holdUs > 0) {
+            // El productor sigue publicando: el bloque no debe reutilizarse
+            std::this_thread::sleep_for(std::chrono::microseconds(spec.holdUs));
+            r.intact &= blockIntact(*b);
+        }
+        r.received++;
+        r.samples += b->count;
+        if (spec.stallEvery > 0 && r.received % spec.stallEvery == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(spec.stallUs));
+        }
+    }
+    bus.release(id);
+}
+
+int benchBus(int argc, char** argv)
+{
+    uint32_t thousands = argc > 0 ? (uint32_t)atoi(argv[0]) : 100;
+    if (thousands == 0) thousands = 100;
+    const uint32_t total = thousands * 1000u;
+    const int producerPeriodUs = 20;
+
+    static const SubscriberSpec specs[] = {
+        {"rapido", 16, BUS_DROP_NEWEST, 1, true, 0, 0, 0},
+        {"lento", 8, BUS_DROP_NEWEST, 1, false, 50, 2000, 0},
+        {"ultimo", 1, BUS_KEEP_LATEST, 1, true, 0, 0, 100},
+        {"diezmado", 2, BUS_DROP_NEWEST, 4, false, 0, 0, 0},
+    };
+    const size_t count = sizeof(specs) / sizeof(specs[0]);
+
+    TestBus* bus = new TestBus();
+    int8_t ids[count];
+    for (size_t k = 0; k < count; k++) {
+        const SubscriberSpec& s = specs[k];
+        ids[k] = bus->subscribe(s.name, s.depth, s.policy, s.divider, s.events);
+        if (ids[k] < 0) {
+            printf("subscribe(%s) falló\n", s.name);
+            delete bus;
+            return 1;
+        }
+    }
+    printf("%lu bloques de %u muestras cada %d us; pool de %u bloques, %u reservados, %u bytes\n",
+           (unsigned long)total, (unsigned)BLOCK_SAMPLES, producerPeriodUs, (unsigned)TestBus::capacity(),
+           (unsigned)bus->reservedBlocks(), (unsigned)sizeof(TestBus));
+
+    std::atomic<bool> done(false);
+    SubscriberResult results[count];
+    std::thread consumers[count];
+    for (size_t k = 0; k < count; k++) {
+        consumers[k] = std::thread(consume, std::ref(*bus), ids[k], std::cref(specs[k]), std::cref(done),
+                                   std::ref(results[k]));
+    }
+
+    TimingHistogram publishCycles;
+    uint32_t claimFailures = 0, events = 0;
+    uint32_t offeredSamples[count] = {};
+    auto next = std::chrono::steady_clock::now();
+    for (uint32_t seq = 0; seq < total; seq++) {
+        uint64_t c0 = BenchTimer::cycles();
+        TestBus::Block* b = bus->claim();
+        if (b == nullptr) {
+            claimFailures++;
+            continue;
+        }
+        uint32_t first = seq * BLOCK_SAMPLES;
+        uint8_t n = blockCount(seq);
+        for (uint8_t i = 0; i < n; i++) {
+            ProcessedSample& p = b->samples[i];
+            p.raw = patternRaw(first, i);
+            p.filtered = patternFiltered(first, i);
+            p.bpm = 72.0f;
+            p.leadsConnected = true;
+            p.beat = false;
+            p.quality = QUALITY_UNKNOWN;
+            p.hrSource = HR_SOURCE_DETECTOR;
+        }
+        bus->publish(n, first);
+        for (size_t k = 0; k < count; k++) {
+            if (seq % specs[k].divider == 0) offeredSamples[k] += n;
+        }
+        if (seq % EVENT_EVERY == 0) {
+            BeatEvent ev = {first, 72.0f, HRVMetrics(), RespirationEstimate()};
+            bus->publishEvent(ev);
+            events++;
+        }
+        publishCycles.add((uint32_t)(BenchTimer::cycles() - c0));
+        next += std::chrono::microseconds(producerPeriodUs);
+        std::this_thread::sleep_until(next);
+    }
+    done.store(true, std::memory_order_release);
+    for (size_t k = 0; k < count; k++) consumers[k].join();
+
+    bool ok = claimFailures == 0;
+    printf("claim() sin bloque libre: %lu\n", (unsigned long)claimFailures);
+    for (size_t k = 0; k < count; k++) {
+        const SubscriberSpec& s = specs[k];
+        const SubscriberResult& r = results[k];
+        BusSubscriberStats st = bus->stats(ids[k]);
+        uint32_t offered = (total + s.divider - 1) / s.divider;
+        // DROP_NEWEST: lo perdido nunca entró; KEEP_LATEST: lo sustituido sí
+        uint32_t accounted = s.policy == BUS_KEEP_LATEST ? st.delivered : st.delivered + st.dropped;
+        bool balanced = accounted == offered && r.received + st.dropped == offered &&
+                        r.samples + st.droppedSamples == offeredSamples[k];
+        bool eventsOk = !s.events || (r.eventsOrdered && r.events + st.eventsDropped == events);
+        bool subOk = r.ordered && r.intact && balanced && eventsOk && st.pending == 0;
+        printf("   %-9s recibidos %7lu  perdidos %7lu (%8lu muestras)  cola max %2lu  eventos %5lu (perdidos %lu)  %s%s%s\n", s.name,
+               (unsigned long)r.received, (unsigned long)st.dropped, (unsigned long)st.droppedSamples,
+               (unsigned long)st.maxPending,
+               (unsigned long)r.events, (unsigned long)st.eventsDropped, subOk ? "OK" : "ERROR",
+               r.intact ? "" : " (bloque reutilizado)", r.ordered ? "" : " (desordenado)");
+        ok &= subOk;
+    }
+    bool poolFree = bus->freeBlocks() == TestBus::capacity();
+    printf("pool libre al final: %u de %u  %s\n", (unsigned)bus->freeBlocks(), (unsigned)TestBus::capacity(),
+           poolFree ? "OK" : "ERROR");
+    ok &= poolFree;
+    dumpBusStats(*bus, [](const char* line) { printf("%s\n", line); });
+
+    printf("claim() + relleno + publish() (ciclos del host): media %.0f, p50 <= %lu, p99 <= %lu; "
+           "0 bytes de muestras copiados por suscriptor\n",
+           publishCycles.mean(), (unsigned long)publishCycles.percentile(500),
+           (unsigned long)publishCycles.percentile(990));
+
+    delete bus;
+    printf("%s\n", ok ? "OK" : "FALLO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+/**
+ * @file bench_dsp.cpp
+ * @brief Benchmark de la cadena de filtrado: ECGFilterFloat frente a ECGFilterFixed
+ *
+ * Uso: program dsp [segundos_de_senal]
+ *   Además de la cadena del firmware, mide una cadena de filter_chain.h con
+ *   biquads (paso-alto 0.5 Hz, paso-bajo 40 Hz y notch 50 Hz): coeficientes
+ *   constexpr frente a los mismos calculados con <math.h>, respuesta en
+ *   frecuencia de las rutas float y fija frente a la analítica, y coste.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include "ecg_dsp.h"
+#include "synth_ecg.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+template <typename Filter>
+static void runFilter(const char* name, const std::vector<int>& input, int repeats)
+{
+    Filter filter;
+    BenchTimer timer;
+    double bestNs = 1e300;
+    uint64_t bestCycles = 0;
+
+    for (int r = 0; r < repeats; r++) {
+        filter.reset(input[0]);
+        typename Filter::Value acc = 0;
+        timer.start();
+        for (size_t i = 0; i < input.size(); i++) {
+            acc += filter.process(input[i]);
+        }
+        timer.stop();
+        benchKeep(acc);
+        if (timer.elapsedNs() < bestNs) {
+            bestNs = timer.elapsedNs();
+            bestCycles = timer.elapsedCycles();
+        }
+    }
+
+    printf("  %-8s %8.2f ns/muestra  %8.1f ciclos/muestra\n", name,
+           bestNs / input.size(), (double)bestCycles / input.size());
+}
+
+// Error máximo de la ruta fija frente a la float, ignorando el arranque
+static double maxError(const std::vector<int>& input, size_t warmup)
+{
+    ECGFilterFloat ref;
+    ECGFilterFixed fix;
+    ref.reset(input[0]);
+    fix.reset(input[0]);
+
+    double worst = 0.0;
+    for (size_t i = 0; i < input.size(); i++) {
+        float a = ref.process(input[i]);
+        int16_t b = fix.process(input[i]);
+        double err = fabs((double)a - (double)b);
+        if (i >= warmup && err > worst) worst = err;
+    }
+    return worst;
+}
+
+// Cadena de ejemplo con biquads, la misma definición en float y en coma fija
+template <typename T>
+using BandChain = FilterChain<T, DCBlocker<T, SAMPLE_RATE_HZ, 500>,
+                              Biquad<T, BIQUAD_LOWPASS, SAMPLE_RATE_HZ, 40000>,
+                              Biquad<T, BIQUAD_NOTCH, SAMPLE_RATE_HZ, 50000, 2000>>;
+
+typedef Biquad<float, BIQUAD_LOWPASS, SAMPLE_RATE_HZ, 40000> LowPass40;
+typedef Biquad<float, BIQUAD_NOTCH, SAMPLE_RATE_HZ, 50000, 2000> Notch50;
+
+// Adaptador al interfaz reset(int)/process(int) de runFilter
+template <typename T>
+struct BandFilter {
+    typedef T Value;
+    BandChain<T> chain;
+    void reset(int initial) { chain.reset((T)initial); }
+    T process(int raw) { return chain.process((T)raw); }
+};
+
+// Mayor diferencia relativa entre los coeficientes constexpr y los de <math.h>
+template <typename Stage>
+static double coefficientError(BiquadType type, double fc, double q)
+{
+    double w0 = 2.0 * M_PI * fc / SAMPLE_RATE_HZ;
+    BiquadCoefficients ref = biquadFromTrig(type, cos(w0), sin(w0) / (2.0 * q));
+    const BiquadCoefficients& c = Stage::C;
+    double pairs[5][2] = {{c.b0, ref.b0}, {c.b1, ref.b1}, {c.b2, ref.b2}, {c.a1, ref.a1}, {c.a2, ref.a2}};
+    double worst = 0.0;
+    for (auto& p : pairs) {
+        double err = fabs(p[0] - p[1]) / (fabs(p[1]) > 1e-12 ? fabs(p[1]) : 1.0);
+        if (err > worst) worst = err;
+    }
+    return worst;
+}
+
+// |H(f)| analítico de la cadena BandChain
+static double bandResponse(double f)
+{
+    double w = 2.0 * M_PI * f / SAMPLE_RATE_HZ;
+    double alpha = (double)DCBlockerBank<float, SAMPLE_RATE_HZ, 500, 1>::ALPHA;
+    // Paso-alto y = x - dc: H = alpha (1 - z^-1) / (1 - alpha z^-1)
+    double hpRe = alpha * (1.0 - cos(w)), hpIm = alpha * sin(w);
+    double hpDenRe = 1.0 - alpha * cos(w), hpDenIm = alpha * sin(w);
+    double gain = hypot(hpRe, hpIm) / hypot(hpDenRe, hpDenIm);
+    const BiquadCoefficients stages[2] = {LowPass40::C, Notch50::C};
+    for (const BiquadCoefficients& c : stages) {
+        double numRe = c.b0 + c.b1 * cos(w) + c.b2 * cos(2 * w);
+        double numIm = -c.b1 * sin(w) - c.b2 * sin(2 * w);
+        double denRe = 1.0 + c.a1 * cos(w) + c.a2 * cos(2 * w);
+        double denIm = -c.a1 * sin(w) - c.a2 * sin(2 * w);
+        gain *= hypot(numRe, numIm) / hypot(denRe, denIm);
+    }
+    return gain;
+}
+
+// Amplitud de salida para un seno de amplitud 'amplitude' sobre la línea base
+template <typename T>
+static double measuredGain(double f, double amplitude)
+{
+    BandChain<T> chain;
+    const double baseline = 2048.0;
+    chain.reset((T)baseline);
+    const int settle = 10 * SAMPLE_RATE_HZ, span = 4 * SAMPLE_RATE_HZ;
+    double peak = 0.0;
+    for (int i = 0; i < settle + span; i++) {
+        double x = baseline + amplitude * sin(2.0 * M_PI * f * i / SAMPLE_RATE_HZ);
+        double y = (double)chain.process((T)lround(x));
+        if (i >= settle && fabs(y) > peak) peak = fabs(y);
+    }
+    return peak / amplitude;
+}
+
+static void benchBandChain(const std::vector<int>& input)
+{
+    printf("Cadena con biquads (paso-alto 0.5 Hz, paso-bajo 40 Hz, notch 50 Hz Q=2)\n");
+    printf("  coeficientes constexpr frente a <math.h>: paso-bajo %.1e, notch %.1e (error relativo)\n",
+           coefficientError<LowPass40>(BIQUAD_LOWPASS, 40.0, 0.707),
+           coefficientError<Notch50>(BIQUAD_NOTCH, 50.0, 2.0));
+
+    const double freqs[] = {0.2, 1.0, 10.0, 30.0, 40.0, 50.0, 80.0};
+    double worstFixed = 0.0;
+    printf("  f (Hz)   |H| analítica   float    fixed (amplitud 500 cuentas)\n");
+    for (double f : freqs) {
+        double ideal = bandResponse(f);
+        double gf = measuredGain<float>(f, 500.0);
+        double gx = measuredGain<int16_t>(f, 500.0);
+        printf("  %6.1f   %8.4f       %8.4f %8.4f\n", f, ideal, gf, gx);
+        if (fabs(gx - gf) > worstFixed) worstFixed = fabs(gx - gf);
+    }
+    printf("  diferencia máx fixed - float: %.4f (%.1f cuentas)\n", worstFixed, worstFixed * 500.0);
+
+    runFilter<BandFilter<float>>("float", input, 20);
+    runFilter<BandFilter<int16_t>>("fixed", input, 20);
+}
+
+int benchDsp(int argc, char** argv)
+{
+    int seconds = (argc > 0) ? atoi(argv[0]) : 60;
+    if (seconds <= 0) seconds = 60;
+
+    struct Case { const char* name; int adcMax; float baseline; float amplitude; };
+    const Case cases[] = {
+        {"ESP32 (12 bits)", 4095, 2048.0f, 600.0f},
+        {"UNO (10 bits)", 1023, 512.0f, 150.0f},
+    };
+
+    // Cota del error de la ruta fija respecto a la float, en cuentas del ADC
+    const double bound = ECG_HUM_CANCELLER ? 2.5 : 1.5;
+    bool ok = true;
+
+    printf("Cadena DC removal + %smedia móvil (%d s de señal a 250 Hz)\n",
+           ECG_HUM_CANCELLER ? "cancelador de red + " : "", seconds);
+    for (const Case& c : cases) {
+        SynthECGConfig cfg;
+        cfg.adcMax = c.adcMax;
+        cfg.baseline = c.baseline;
+        cfg.rAmplitude = c.amplitude;
+        cfg.wanderAmplitude = c.amplitude * 0.3f;
+        cfg.noiseAmplitude = c.amplitude * 0.05f;
+        SynthECG synth(cfg);
+
+        std::vector<int> input((size_t)seconds * 250);
+        for (size_t i = 0; i < input.size(); i++) input[i] = synth.next();
+
+        printf("%s\n", c.name);
+        runFilter<ECGFilterFloat>("float", input, 20);
+        runFilter<ECGFilterFixed>("fixed", input, 20);
+        double error = maxError(input, 250);
+        bool pass = error <= bound;
+        ok &= pass;
+        printf("  error máx |fixed - float| = %.3f cuentas (cota %.1f)  %s\n", error, bound,
+               pass ? "bien" : "FALLO");
+    }
+    {
+        SynthECGConfig cfg;
+        SynthECG synth(cfg);
+        std::vector<int> input((size_t)seconds * 250);
+        for (size_t i = 0; i < input.size(); i++) input[i] = synth.next();
+        benchBandChain(input);
+    }
+    printf("Nota: el host tiene FPU; en el AVR del UNO el float es emulado por software,\n"
+           "así que la ruta fija es allí mucho más barata que lo que sugieren estos números.\n");
+    printf("%s\n", ok ? "OK" : "FALLO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file bench_events.cpp
+ * @brief Captura por eventos (event_capture.h) reproducida en el host: episodios, contenido de las ventanas y ancho de banda
+ *
+ * Uso: program events [fichero]
+ *   Pasa la señal por ECGMonitor::processBlock() en bloques de 16 y
+ *   alimenta EventCapture como el consumidor "eventos" de esp32_main.cpp
+ *   (misma regla de señal limpia, latidos tras cada bloque). Los
+ *   episodios salen por dos destinos, como en el ESP32: tramas de
+ *   ecg_stream.h (50 muestras por vuelta) y HolterRecorder sobre un
+ *   directorio temporal con skip() entre episodios.
+ *
+ *   Sin fichero, una sesión sintética de 10 min: ritmo sinusal a 72 lpm
+ *   con una bradicardia a 45 lpm, una taquicardia a 130 lpm, una pausa de
+ *   3 s y un tramo de RR irregular. Cada anomalía debe dar su episodio,
+ *   ninguno fuera de ellas; las muestras enviadas por serie deben ser el
+ *   filtrado del monitor y las leídas del Holter, la señal cruda de
+ *   entrada. Con fichero (formato de recorded_stream.h) lista los
+ *   episodios y el ancho de banda.
+ *   Compara los bytes por serie con el envío continuo (muestras + HRV).
+ *   Devuelve 1 si falla alguna comprobación de la sesión sintética.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include "ecg_monitor.h"
+#include "ecg_stream.h"
+#include "event_capture.h"
+#include "holter_log.h"
+#include "file_holter_storage.h"
+#include "recorded_stream.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+typedef EventCapture<SAMPLE_RATE_HZ, 5 * SAMPLE_RATE_HZ, 5 * SAMPLE_RATE_HZ, 4096> Capture;
+
+static const size_t BLOCK = 16;
+static const size_t SERIAL_CHUNK = 50;
+
+// Tramo anormal del guion sintético
+struct Anomaly {
+    uint8_t type;
+    uint32_t start;
+    uint32_t end;
+};
+
+static const char* typeNames(uint8_t types, char* buf, size_t len)
+{
+    static const char* names[] = {"bradicardia", "taquicardia", "pausa", "irregular"};
+    buf[0] = '\0';
+    for (uint8_t i = 0; i < 4; i++) {
+        if (!(types & (1u << i))) continue;
+        if (buf[0]) strncat(buf, "+", len - strlen(buf) - 1);
+        strncat(buf, names[i], len - strlen(buf) - 1);
+    }
+    return buf;
+}
+
+/**
+ * 10 min a 250 Hz: 72 lpm con ±3 % latido a latido y, a partir de los
+ * 90 s, bradicardia, taquicardia, pausa e irregularidad separadas por
+ * ritmo normal.
+ */
+static void synthesizeSession(std::vector<int>& x, std::vector<Anomaly>& anomalies)
+{
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 500.0f;
+    cfg.noiseAmplitude = 15.0f;
+    cfg.wanderAmplitude = 40.0f;
+    SynthECG synth(cfg);
+    const uint32_t s = SAMPLE_RATE_HZ;
+    anomalies.push_back({EPISODE_BRADYCARDIA, 90 * s, 150 * s});
+    anomalies.push_back({EPISODE_TACHYCARDIA, 210 * s, 270 * s});
+    anomalies.push_back({EPISODE_PAUSE, 330 * s, 333 * s});
+    anomalies.push_back({EPISODE_IRREGULAR, 390 * s, 450 * s});
+
+    uint32_t rng = 777;
+    auto uniform = [&rng]() {
+        rng = rng * 1664525u + 1013904223u;
+        return (rng >> 8) * (1.0f / 16777216.0f);
+    };
+    float bpm = 72.0f;
+    for (uint32_t i = 0; i < 600 * s; i++) {
+        bpm = 72.0f;
+        for (const Anomaly& a : anomalies) {
+            if (i < a.start || i >= a.end) continue;
+            if (a.type == EPISODE_BRADYCARDIA) bpm = 45.0f;
+            if (a.type == EPISODE_TACHYCARDIA) bpm = 130.0f;
+        }
+        int v = synth.next();
+        if (synth.lastWasRPeak()) {
+            bool irregular = i >= anomalies[3].start && i < anomalies[3].end;
+            // Latido a latido: ±3 % en sinusal, 55-125 lpm en el tramo irregular
+            synth.setBpm(irregular ? 55.0f + 70.0f * uniform() : bpm * (0.97f + 0.06f * uniform()));
+        }
+        // Pausa sinusal: línea base con el mismo ruido, sin complejos
+        if (i >= anomalies[2].start && i < anomalies[2].end) {
+            v = (int)(cfg.baseline + cfg.noiseAmplitude * (2.0f * uniform() - 1.0f));
+        }
+        x.push_back(v);
+    }
+}
+
+struct SessionResult {
+    std::vector<CaptureEpisode> episodes;
+    size_t continuousBytes;
+    size_t episodeBytes;
+    size_t statusBytes;
+    uint32_t serialMismatches;
+    uint32_t holterMismatches;
+    uint32_t holterChecked;
+    uint32_t lost;
+    double pushNs;
+};
+
+static SessionResult runSession(const std::vector<int>& input)
+{
+    SessionResult r;
+    r.continuousBytes = r.episodeBytes = r.statusBytes = 0;
+    r.serialMismatches = r.holterMismatches = r.holterChecked = r.lost = 0;
+
+    mockSetDigital(AD8232Pins::LO_PLUS, LOW);
+    mockSetDigital(AD8232Pins::LO_MINUS, LOW);
+    ECGMonitor* monitor = new ECGMonitor();
+    monitor->begin();
+    Capture* capture = new Capture();
+    EpisodeCursor serial, flash;
+    ECGStreamEncoder continuous, episodes;
+
+    char dirTemplate[] = "/tmp/eventsXXXXXX";
+    const bool haveDir = mkdtemp(dirTemplate) != nullptr;
+    FileHolterStorage storage(haveDir ? dirTemplate : "/tmp");
+    HolterRecorder* holter = new HolterRecorder(storage, SAMPLE_RATE_HZ);
+    const bool holterOk = haveDir && holter->begin();
+    const uint32_t holterBase = holter->nextSampleIndex();
+
+    // Muestras y filtrado del monitor, para comparar lo enviado
+    std::vector<int16_t> filtered(input.size());
+    std::vector<int16_t> raw(input.size());
+    for (size_t i = 0; i < input.size(); i++) raw[i] = (int16_t)input[i];
+
+    ProcessedSample out[BLOCK];
+    double pushNs = 0.0;
+    for (size_t i = 0; i < input.size(); i += BLOCK) {
+        size_t n = input.size() - i < BLOCK ? input.size() - i : BLOCK;
+        uint32_t first = monitor->getHistory().sampleCount();
+        uint16_t beats = monitor->processBlock(&raw[i], n, out);
+
+        // Envío continuo, como serviceSerialSink()
+        for (size_t k = 0; k < n; k++) {
+            filtered[i + k] = out[k].filtered;
+            if (continuous.push(out[k].filtered, out[k].bpm, out[k].leadsConnected, out[k].beat)) {
+                r.continuousBytes += continuous.size();
+            }
+        }
+        if (beats > 0) {
+            continuous.encodeHrv(monitor->getHRV());
+            r.continuousBytes += continuous.size();
+        }
+
+        // Consumidor "eventos"
+        BenchTimer t;
+        t.start();
+        for (size_t k = 0; k < n; k++) {
+            const ProcessedSample& p = out[k];
+            bool clean = p.quality == QUALITY_UNKNOWN || p.quality >= ECGMonitor::QUALITY_GATE;
+            capture->push(first + (uint32_t)k, p.raw, p.filtered, p.leadsConnected, clean);
+        }
+        if (beats > 0) capture->onBeat(monitor->getLastBeatSample());
+        t.stop();
+        pushNs += t.elapsedNs();
+
+        // Serie: 50 muestras por vuelta entre las tramas de inicio y fin
+        int16_t chunk[SERIAL_CHUNK];
+        size_t m;
+        auto count = [&r](const uint8_t*, size_t size) { r.episodeBytes += size; };
+        if (capture->streamEpisode(serial, episodes, count, chunk, SERIAL_CHUNK, &m)) {
+            r.episodes.push_back(serial.episode);
+        }
+        for (size_t k = 0; k < m; k++) {
+            if (chunk[k] != filtered[serial.position - m + k]) r.serialMismatches++;
+        }
+
+        // Flash: un bloque de HolterRecorder por vuelta con sitio en su cola
+        if (holterOk) {
+            int16_t block[HOLTER_BLOCK_SAMPLES];
+            capture->recordEpisode(flash, *holter, block, HOLTER_BLOCK_SAMPLES);
+            holter->service((uint32_t)(i * 1000 / SAMPLE_RATE_HZ));
+        }
+
+        // Trama de estado una vez por segundo en los dos modos
+        if ((i / BLOCK) % (SAMPLE_RATE_HZ / BLOCK) == 0) {
+            continuous.encodeStatus(0, 0, out[n - 1].quality);
+            r.statusBytes += continuous.size();
+        }
+    }
+    r.lost += serial.lostSamples + flash.lostSamples;
+
+    // Lo grabado en la flash, leído por índice
+    if (holterOk) {
+        holter->stop();
+        HolterReader* reader = new HolterReader(storage);
+        if (reader->open()) {
+            for (const CaptureEpisode& e : r.episodes) {
+                std::vector<int16_t> back(e.endSample - e.firstSample);
+                size_t got = 0;
+                if (reader->seek(holterBase + e.firstSample) && reader->position() == holterBase + e.firstSample) {
+                    while (got < back.size()) {
+                        size_t m = reader->read(&back[got], back.size() - got);
+                        if (m == 0) break;
+                        got += m;
+                    }
+                }
+                for (size_t k = 0; k < back.size(); k++) {
+                    r.holterChecked++;
+                    if (k >= got || back[k] != raw[e.firstSample + k]) r.holterMismatches++;
+                }
+            }
+        }
+        delete reader;
+        uint32_t ids[HOLTER_MAX_SEGMENTS];
+        size_t count = storage.listSegments(ids, HOLTER_MAX_SEGMENTS);
+        for (size_t k = 0; k < count; k++) storage.removeSegment(ids[k]);
+    }
+    delete holter;
+    if (haveDir) rmdir(dirTemplate);
+    if (!holterOk) r.holterMismatches = 1;
+
+    r.pushNs = pushNs / input.size();
+    delete capture;
+    delete monitor;
+    return r;
+}
+
+static void printSession(const SessionResult& r, size_t samples)
+{
+    char names[64];
+    printf("   %-3s %-24s %9s %8s %8s\n", "id", "tipos", "disparo", "ventana", "lpm");
+    for (const CaptureEpisode& e : r.episodes) {
+        printf("   %-3lu %-24s %8.1fs %7.1fs %8.1f\n", (unsigned long)e.id, typeNames(e.types, names, sizeof(names)),
+               e.triggerSample / (double)SAMPLE_RATE_HZ, (e.endSample - e.firstSample) / (double)SAMPLE_RATE_HZ,
+               e.bpm);
+    }
+    double seconds = samples / (double)SAMPLE_RATE_HZ;
+    size_t episodeTotal = r.episodeBytes + r.statusBytes;
+    printf("   Serie en %.0f s: continuo %lu bytes (%.0f B/s), solo episodios %lu bytes (%.1f B/s, %lu de estado): %.1fx menos\n",
+           seconds, (unsigned long)r.continuousBytes, r.continuousBytes / seconds, (unsigned long)episodeTotal,
+           episodeTotal / seconds, (unsigned long)r.statusBytes,
+           episodeTotal ? (double)r.continuousBytes / episodeTotal : 0.0);
+    printf("   Sin episodios (ritmo normal) quedan %.1f B/s de estado frente a %.0f B/s: %.0fx menos\n",
+           r.statusBytes / seconds, (r.continuousBytes + r.statusBytes) / seconds,
+           r.statusBytes ? (double)(r.continuousBytes + r.statusBytes) / r.statusBytes : 0.0);
+    printf("   EventCapture::push()/onBeat(): %.1f ns por muestra; %u bytes\n", r.pushNs, (unsigned)sizeof(Capture));
+}
+
+int benchEvents(int argc, char** argv)
+{
+    if (argc > 0) {
+        RecordedStream stream;
+        if (!loadRecordedStream(argv[0], stream) || stream.samples.empty()) {
+            fprintf(stderr, "No se puede leer %s\n", argv[0]);
+            return 1;
+        }
+        printf("%s: %lu muestras\n", argv[0], (unsigned long)stream.samples.size());
+        SessionResult r = runSession(stream.samples);
+        printSession(r, stream.samples.size());
+        printf("   muestras sobrescritas antes de enviarlas: %lu\n", (unsigned long)r.lost);
+        return 0;
+    }
+
+    std::vector<int> x;
+    std::vector<Anomaly> anomalies;
+    synthesizeSession(x, anomalies);
+    printf("Sesión sintética de %lu s: bradicardia 90-150 s, taquicardia 210-270 s, pausa 330-333 s, irregular 390-450 s\n",
+           (unsigned long)(x.size() / SAMPLE_RATE_HZ));
+    SessionResult r = runSession(x);
+    printSession(r, x.size());
+
+    // Cada anomalía con su episodio; ninguno disparado fuera de ellas (con
+    // 10 s de margen: la media de 8 RR tarda en cruzar la banda)
+    bool ok = true;
+    const uint32_t grace = 10 * SAMPLE_RATE_HZ;
+    for (const Anomaly& a : anomalies) {
+        bool found = false;
+        for (const CaptureEpisode& e : r.episodes) {
+            found |= (e.types & a.type) && e.triggerSample >= a.start && e.triggerSample < a.end + grace;
+        }
+        char names[32];
+        printf("   %-12s %s\n", typeNames(a.type, names, sizeof(names)), found ? "detectado" : "NO DETECTADO");
+        ok &= found;
+    }
+    uint32_t spurious = 0;
+    for (const CaptureEpisode& e : r.episodes) {
+        bool inside = false;
+        for (const Anomaly& a : anomalies) inside |= e.triggerSample >= a.start && e.triggerSample < a.end + grace;
+        spurious += !inside;
+    }
+    printf("   episodios fuera de las anomalías: %lu\n", (unsigned long)spurious);
+    printf("   serie: %lu muestras distintas del filtrado; Holter: %lu de %lu distintas de la entrada; sobrescritas: %lu\n",
+           (unsigned long)r.serialMismatches, (unsigned long)r.holterMismatches, (unsigned long)r.holterChecked,
+           (unsigned long)r.lost);
+    ok &= spurious == 0 && r.serialMismatches == 0 && r.holterMismatches == 0 && r.holterChecked > 0 && r.lost == 0;
+
+    printf("%s\n", ok ? "OK" : "FALLO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file bench_hrv.cpp
+ * @brief HRVEngine: exactitud frente a recalcular la ventana y rechazo de ectópicos
+ *
+ * Uso: program hrv [latidos] [porcentaje_ectopicos]
+ *   Genera una serie RR con arritmia sinusal respiratoria, ruido y
+ *   extrasístoles (RR corto + pausa compensadora) o latidos no detectados
+ *   (RR doble). En cada latido compara las métricas incrementales con las
+ *   recalculadas sobre toda la ventana, mide el coste por latido y compara
+ *   SDNN/RMSSD con las de la serie limpia.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <random>
+#include "hrv_engine.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+typedef HRVEngine<512> Engine;
+
+struct RRBeat {
+    uint16_t rr;
+    bool ectopic; // extrasístole, pausa compensadora o latido perdido
+};
+
+static std::vector<RRBeat> makeSeries(int beats, double ectopicPercent, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0, 18.0);
+    std::uniform_real_distribution<double> uni(0.0, 100.0);
+    std::vector<RRBeat> out;
+    double t = 0.0;
+    while ((int)out.size() < beats) {
+        // 800 ms con deriva lenta y arritmia respiratoria (~0.25 Hz)
+        double base = 800.0 + 60.0 * sin(t / 90000.0) + 35.0 * sin(2 * M_PI * 0.25 * t / 1000.0);
+        double rr = base + noise(rng);
+        double r = uni(rng);
+        if (r < ectopicPercent * 0.9) {
+            // Extrasístole: RR al 60 % y pausa compensadora
+            out.push_back({(uint16_t)(rr * 0.6), true});
+            out.push_back({(uint16_t)(rr * 1.4), true});
+            t += 2 * rr;
+        } else if (r < ectopicPercent) {
+            // Latido no detectado: el RR medido es doble
+            out.push_back({(uint16_t)(rr * 2.0), true});
+            t += 2 * rr;
+        } else {
+            out.push_back({(uint16_t)rr, false});
+            t += rr;
+        }
+    }
+    out.resize(beats);
+    return out;
+}
+
+struct Reference {
+    double sdnn = 0, rmssd = 0, pnn50 = 0, meanHr = 0;
+    size_t beats = 0;
+};
+
+// Recalcula la ventana desde cero con la misma definición que HRVEngine
+static Reference recompute(const std::vector<uint16_t>& nn, const std::vector<bool>& adjacent,
+                           uint32_t windowMs, size_t capacity)
+{
+    Reference ref;
+    size_t first = nn.size();
+    uint64_t sum = 0;
+    while (first > 0 && nn.size() - first < capacity) {
+        if (first < nn.size() && sum + nn[first - 1] > windowMs) break;
+        sum += nn[--first];
+    }
+    ref.beats = nn.size() - first;
+    if (ref.beats == 0) return ref;
+
+    double mean = (double)sum / ref.beats;
+    double var = 0;
+    for (size_t i = first; i < nn.size(); i++) var += (nn[i] - mean) * (nn[i] - mean);
+    ref.sdnn = ref.beats > 1 ? sqrt(var / (ref.beats - 1)) : 0;
+    ref.meanHr = 60000.0 / mean;
+
+    double sq = 0;
+    size_t diffs = 0, nn50 = 0;
+    for (size_t i = first + 1; i < nn.size(); i++) {
+        if (!adjacent[i]) continue;
+        double d = (double)nn[i] - nn[i - 1];
+        sq += d * d;
+        diffs++;
+        if (fabs(d) > 50) nn50++;
+    }
+    ref.rmssd = diffs ? sqrt(sq / diffs) : 0;
+    ref.pnn50 = diffs ? 100.0 * nn50 / diffs : 0;
+    return ref;
+}
+
+int benchHrv(int argc, char** argv)
+{
+    int beats = argc > 0 && atoi(argv[0]) > 0 ? atoi(argv[0]) : 20000;
+    double ectopicPercent = argc > 1 ? atof(argv[1]) : 3.0;
+
+    std::vector<RRBeat> series = makeSeries(beats, ectopicPercent, 2024);
+    Engine engine(Engine::DEFAULT_WINDOW_MS);
+
+    std::vector<uint16_t> accepted;
+    std::vector<bool> adjacent;
+    bool prevAccepted = false;
+    double maxSdnnErr = 0, maxRmssdErr = 0, maxPnnErr = 0, maxHrErr = 0;
+    uint32_t trueRejects = 0, falseRejects = 0, missedEctopics = 0, ectopics = 0;
+    double addNs = 0, metricsNs = 0;
+    double instHrSq = 0, displayHrSq = 0, instHrSum = 0, displayHrSum = 0;
+    uint32_t hrSamples = 0;
+    BenchTimer timer;
+
+    for (const RRBeat& beat : series) {
+        timer.start();
+        bool ok = engine.addRR(beat.rr);
+        timer.stop();
+        addNs += timer.elapsedNs();
+        timer.start();
+        HRVMetrics m = engine.metrics();
+        timer.stop();
+        metricsNs += timer.elapsedNs();
+        benchKeep(m.sdnnMs);
+
+        if (beat.ectopic) {
+            ectopics++;
+            if (ok) missedEctopics++;
+            else trueRejects++;
+        } else if (!ok) {
+            falseRejects++;
+        }
+
+        if (ok) {
+            accepted.push_back(beat.rr);
+            adjacent.push_back(prevAccepted && accepted.size() > 1);
+        }
+        prevAccepted = ok;
+
+        Reference ref = recompute(accepted, adjacent, engine.getWindowMs(), Engine::capacity());
+        if (ref.beats != m.beats) maxSdnnErr = 1e9;
+        maxSdnnErr = fmax(maxSdnnErr, fabs(ref.sdnn - m.sdnnMs));
+        maxRmssdErr = fmax(maxRmssdErr, fabs(ref.rmssd - m.rmssdMs));
+        maxPnnErr = fmax(maxPnnErr, fabs(ref.pnn50 - m.pnn50));
+        if (ref.beats) maxHrErr = fmax(maxHrErr, fabs(ref.meanHr - m.meanHr));
+
+        // Estabilidad de la FC mostrada frente a la instantánea (60000/RR)
+        if (m.displayHr > 0) {
+            double inst = 60000.0 / beat.rr;
+            instHrSum += inst;
+            instHrSq += inst * inst;
+            displayHrSum += m.displayHr;
+            displayHrSq += (double)m.displayHr * m.displayHr;
+            hrSamples++;
+        }
+    }
+
+    // Serie limpia (sin ectópicos) para ver el efecto del rechazo
+    std::vector<RRBeat> clean = makeSeries(beats, 0.0, 2024);
+    Engine cleanEngine(Engine::DEFAULT_WINDOW_MS);
+    for (const RRBeat& beat : clean) cleanEngine.addRR(beat.rr);
+    std::vector<uint16_t> all;
+    std::vector<bool> allAdjacent;
+    for (const RRBeat& beat : series) {
+        all.push_back(beat.rr);
+        allAdjacent.push_back(all.size() > 1);
+    }
+    Reference noReject = recompute(all, allAdjacent, engine.getWindowMs(), Engine::capacity());
+    HRVMetrics last = engine.metrics();
+    HRVMetrics truth = cleanEngine.metrics();
+
+    auto stddev = [&](double sum, double sq) {
+        double mean = sum / hrSamples;
+        return sqrt(fmax(0.0, sq / hrSamples - mean * mean));
+    };
+
+    printf("%d latidos, %.1f %% ectópicos/perdidos, ventana %u s, capacidad %u intervalos\n", beats,
+           ectopicPercent, engine.getWindowMs() / 1000, Engine::capacity());
+    printf("  Coste: addRR %.1f ns, metrics() %.1f ns por latido (O(1), %zu B de estado)\n",
+           addNs / beats, metricsNs / beats, sizeof(Engine));
+    printf("  Error máximo frente a recalcular la ventana: SDNN %.4f ms, RMSSD %.4f ms, pNN50 %.4f %%, FC %.4f lpm\n",
+           maxSdnnErr, maxRmssdErr, maxPnnErr, maxHrErr);
+    printf("  Rechazo: %u de %u intervalos anómalos (%.1f %%), %u normales rechazados (%.2f %%)\n",
+           trueRejects, ectopics, ectopics ? 100.0 * trueRejects / ectopics : 0.0, falseRejects,
+           100.0 * falseRejects / (beats - ectopics));
+    printf("  %-26s %10s %10s %10s\n", "Última ventana", "SDNN", "RMSSD", "pNN50");
+    printf("  %-26s %10.1f %10.1f %10.1f\n", "serie limpia", truth.sdnnMs, truth.rmssdMs, truth.pnn50);
+    printf("  %-26s %10.1f %10.1f %10.1f\n", "con rechazo de ectópicos", last.sdnnMs, last.rmssdMs, last.pnn50);
+    printf("  %-26s %10.1f %10.1f %10.1f\n", "sin rechazo", noReject.sdnn, noReject.rmssd, noReject.pnn50);
+    printf("  FC mostrada: desviación %.1f lpm (instantánea 60000/RR: %.1f lpm)\n",
+           stddev(displayHrSum, displayHrSq), stddev(instHrSum, instHrSq));
+
+    bool ok = maxSdnnErr < 0.05 && maxRmssdErr < 0.05 && maxPnnErr < 0.01 && maxHrErr < 0.05;
+    printf("Resultado: %s\n", ok ? "correcto" : "ERROR");
+    return ok ? 0 : 1;
+}
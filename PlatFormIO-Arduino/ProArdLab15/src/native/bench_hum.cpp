@@ -0,0 +1,226 @@
+/**
+ * @file bench_hum.cpp
+ * @brief Cancelador adaptativo de red (powerline_canceller.h) sobre ECG sintético con zumbido
+ *
+ * Uso: program hum [segundos] [amplitud_zumbido]
+ *   Electrodo de contacto dudoso: onda R de 150 cuentas con zumbido de
+ *   red sumado (50 Hz, 60 Hz, 50.1 y 50.4 Hz fuera de nominal, 60 Hz que
+ *   aparece a mitad de la grabación y sin zumbido). Para la cadena de coma fija
+ *   con y sin el cancelador:
+ *   1. Frecuencia a la que se engancha y cuándo.
+ *   2. Zumbido residual tras el cancelador y a la salida de la cadena:
+ *      diferencia RMS frente a la misma señal sin zumbido y atenuación en
+ *      dB. La media móvil de 5 muestras ya tiene un cero en 50 Hz, así que
+ *      a la salida el cancelador se nota sobre todo a 60 Hz. Sin zumbido,
+ *      lo que el cancelador cambia en el ECG.
+ *   3. Se/PPV del detector Pan-Tompkins y del comparador fijo original.
+ *   4. Coste por muestra del cancelador buscando y enganchado.
+ *   Devuelve 1 si no se engancha a la frecuencia correcta, si la etapa
+ *   atenúa menos de 20 dB a frecuencia nominal (6 dB a 50.1 Hz; 50.4 Hz
+ *   cae fuera del notch de ±0.3 Hz y solo se informa) o si Pan-Tompkins
+ *   comete más errores (FP + FN) con el cancelador.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include "ecg_dsp.h"
+#include "qrs_detector.h"
+#include "recorded_stream.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+typedef ECGFilterFixed::DCStage DCStage;
+typedef ECGFilterFixed::HumStage HumStage;
+typedef ECGFilterFixed::MAStage MAStage;
+typedef FilterChain<int16_t, DCStage, HumStage, MAStage> WithCanceller;
+typedef FilterChain<int16_t, DCStage, MAStage> WithoutCanceller;
+// Solo hasta el cancelador, antes de la media móvil
+typedef FilterChain<int16_t, DCStage, HumStage> StageWith;
+typedef FilterChain<int16_t, DCStage> StageWithout;
+typedef QRSDetector<SAMPLE_RATE_HZ> Detector;
+
+static const uint32_t TOLERANCE = SAMPLE_RATE_HZ * 150 / 1000;
+
+struct HumScenario {
+    const char* name;
+    double hz;          // 0 = sin zumbido
+    double startSecond; // el zumbido aparece en este segundo
+    uint8_t expectedLock;
+    double minDb;       // atenuación mínima exigida tras la etapa
+};
+
+static uint8_t mainsOf(const WithCanceller& chain) { return chain.tail().head().mainsHz(); }
+static uint8_t mainsOf(const WithoutCanceller&) { return 0; }
+static uint8_t mainsOf(const StageWith& chain) { return chain.tail().head().mainsHz(); }
+static uint8_t mainsOf(const StageWithout&) { return 0; }
+
+template <typename Chain>
+static std::vector<int16_t> runChain(const std::vector<int>& input, std::vector<uint8_t>* lockTrace = nullptr)
+{
+    Chain chain;
+    chain.reset((int16_t)input[0]);
+    std::vector<int16_t> out(input.size());
+    for (size_t i = 0; i < input.size(); i++) {
+        out[i] = chain.process((int16_t)input[i]);
+        if (lockTrace) lockTrace->push_back(mainsOf(chain));
+    }
+    return out;
+}
+
+static double rmsDiff(const std::vector<int16_t>& a, const std::vector<int16_t>& b, size_t from)
+{
+    double sum = 0.0;
+    for (size_t i = from; i < a.size(); i++) sum += (double)(a[i] - b[i]) * (a[i] - b[i]);
+    return sqrt(sum / (a.size() - from));
+}
+
+// Comparador original (THRESHOLD = 40, refractario de 250 ms), como en 'qrs'
+static std::vector<uint32_t> comparatorBeats(const std::vector<int16_t>& lp)
+{
+    const int threshold = 40;
+    const uint32_t refractory = SAMPLE_RATE_HZ / 4;
+    std::vector<uint32_t> beats;
+    bool inBeat = false;
+    for (uint32_t i = 0; i < lp.size(); i++) {
+        if (lp[i] > threshold && (beats.empty() || i - beats.back() > refractory)) {
+            if (!inBeat) {
+                inBeat = true;
+                beats.push_back(i);
+            }
+        } else if (lp[i] < threshold / 2) {
+            inBeat = false;
+        }
+    }
+    return beats;
+}
+
+static std::vector<uint32_t> panTompkinsBeats(const std::vector<int16_t>& lp)
+{
+    std::vector<uint32_t> beats;
+    Detector* qrs = new Detector();
+    for (size_t i = 0; i < lp.size(); i++) {
+        if (qrs->process(lp[i])) beats.push_back(qrs->lastBeatSample());
+    }
+    delete qrs;
+    return beats;
+}
+
+static void printMatch(const char* label, const BeatMatch& m)
+{
+    printf("    %-28s Se %6.2f %%  PPV %6.2f %%  (FP %u FN %u)\n", label, m.sensitivity(), m.ppv(),
+           m.falsePositives, m.falseNegatives);
+}
+
+static bool runScenario(const HumScenario& sc, const RecordedStream& clean, double amplitude)
+{
+    std::vector<int> noisy(clean.samples);
+    const size_t start = (size_t)(sc.startSecond * SAMPLE_RATE_HZ);
+    for (size_t i = start; sc.hz > 0 && i < noisy.size(); i++) {
+        double t = (double)i / SAMPLE_RATE_HZ;
+        noisy[i] += (int)lround(amplitude * sin(2.0 * M_PI * sc.hz * t + 0.7));
+    }
+
+    std::vector<uint8_t> lock;
+    std::vector<int16_t> cleanOut = runChain<WithoutCanceller>(clean.samples);
+    std::vector<int16_t> cleanCancelled = runChain<WithCanceller>(clean.samples);
+    std::vector<int16_t> with = runChain<WithCanceller>(noisy, &lock);
+    std::vector<int16_t> without = runChain<WithoutCanceller>(noisy);
+
+    printf("%s\n", sc.name);
+    size_t lockedAt = 0;
+    while (lockedAt < lock.size() && lock[lockedAt] == 0) lockedAt++;
+    uint8_t lockedHz = lockedAt < lock.size() ? lock[lockedAt] : 0;
+    if (lockedHz) {
+        printf("  enganchado a %u Hz a los %.1f s", lockedHz, (double)lockedAt / SAMPLE_RATE_HZ);
+        if (sc.hz > 0) printf(" (%.1f s después de aparecer el zumbido)", (double)(lockedAt - start) / SAMPLE_RATE_HZ);
+        printf("\n");
+    } else {
+        printf("  sin enganchar\n");
+    }
+    bool ok = lockedHz == sc.expectedLock;
+
+    // A partir de 5 s tras la aparición del zumbido (o del arranque)
+    size_t from = start + 5 * SAMPLE_RATE_HZ;
+    if (sc.hz > 0) {
+        // Tras la etapa (antes de la media móvil) y a la salida de la cadena
+        double stageWith = rmsDiff(runChain<StageWith>(noisy), runChain<StageWith>(clean.samples), from);
+        double stageWithout = rmsDiff(runChain<StageWithout>(noisy), runChain<StageWithout>(clean.samples), from);
+        double stageDb = 20.0 * log10(stageWithout / fmax(stageWith, 1e-3));
+        double residualWith = rmsDiff(with, cleanCancelled, from);
+        double residualWithout = rmsDiff(without, cleanOut, from);
+        printf("  zumbido tras la etapa:    %6.2f cuentas RMS sin cancelador, %5.2f con él (%.1f dB)\n",
+               stageWithout, stageWith, stageDb);
+        printf("  zumbido tras la cadena:   %6.2f cuentas RMS sin cancelador, %5.2f con él (%.1f dB)\n",
+               residualWithout, residualWith, 20.0 * log10(residualWithout / fmax(residualWith, 1e-3)));
+        ok = ok && stageDb >= sc.minDb;
+    } else {
+        printf("  cambio en el ECG sin zumbido: %.2f cuentas RMS\n", rmsDiff(cleanCancelled, cleanOut, from));
+    }
+
+    BeatMatch ptWithout = matchBeats(clean.annotations, panTompkinsBeats(without), TOLERANCE, Detector::LEARNING);
+    BeatMatch ptWith = matchBeats(clean.annotations, panTompkinsBeats(with), TOLERANCE, Detector::LEARNING);
+    printMatch("Pan-Tompkins sin cancelador", ptWithout);
+    printMatch("Pan-Tompkins con cancelador", ptWith);
+    printMatch("comparador sin cancelador", matchBeats(clean.annotations, comparatorBeats(without), TOLERANCE, 0));
+    printMatch("comparador con cancelador", matchBeats(clean.annotations, comparatorBeats(with), TOLERANCE, 0));
+    ok = ok && ptWith.falsePositives + ptWith.falseNegatives <= ptWithout.falsePositives + ptWithout.falseNegatives;
+    return ok;
+}
+
+// ns por muestra de la etapa sola, buscando (50 y 60 Hz) o enganchada
+static void measureCost(const std::vector<int>& input)
+{
+    BenchTimer timer;
+    for (int locked = 0; locked < 2; locked++) {
+        HumStage stage;
+        stage.reset(0);
+        // Para enganchar, 3 s de zumbido puro
+        for (uint32_t i = 0; locked && i < 3 * SAMPLE_RATE_HZ; i++) {
+            stage.process((int16_t)lround(50.0 * sin(2.0 * M_PI * 50.0 * i / SAMPLE_RATE_HZ)));
+        }
+        int32_t acc = 0;
+        timer.start();
+        for (size_t i = 0; i < input.size(); i++) acc += stage.process((int16_t)(input[i] - 2048));
+        timer.stop();
+        benchKeep(acc);
+        printf("  %-22s %6.2f ns/muestra  %6.1f ciclos/muestra\n",
+               locked ? "enganchado (un LMS)" : "buscando (50 + 60 Hz)",
+               timer.elapsedNs() / input.size(), (double)timer.elapsedCycles() / input.size());
+    }
+}
+
+int benchHum(int argc, char** argv)
+{
+    int seconds = argc > 0 ? atoi(argv[0]) : 120;
+    if (seconds < 30) seconds = 30;
+    double amplitude = argc > 1 ? atof(argv[1]) : 60.0;
+
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 150.0f;
+    cfg.noiseAmplitude = 8.0f;
+    cfg.wanderAmplitude = 40.0f;
+    SynthECG synth(cfg);
+    RecordedStream clean;
+    synthesizeStream(synth, seconds, SAMPLE_RATE_HZ, clean);
+
+    const HumScenario scenarios[] = {
+        {"Red de 50 Hz", 50.0, 0.0, 50, 20.0},
+        {"Red de 60 Hz", 60.0, 0.0, 60, 20.0},
+        {"Red de 50.1 Hz (fuera de nominal)", 50.1, 0.0, 50, 6.0},
+        {"Red de 50.4 Hz (fuera del notch)", 50.4, 0.0, 50, 0.0},
+        {"Red de 60 Hz desde la mitad", 60.0, seconds / 2.0, 60, 20.0},
+        {"Sin zumbido", 0.0, 0.0, 0, 0.0},
+    };
+
+    printf("Zumbido de %.0f cuentas de pico, onda R de %.0f cuentas, %d s (cadena en coma fija)\n",
+           amplitude, cfg.rAmplitude, seconds);
+    bool ok = true;
+    for (const HumScenario& sc : scenarios) ok = runScenario(sc, clean, amplitude) && ok;
+
+    printf("Coste del cancelador\n");
+    measureCost(clean.samples);
+    printf("%s\n", ok ? "OK" : "FALLO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file bench_lcd.cpp
+ * @brief Tráfico I2C del LCD: escritura directa frente a framebuffer con sombra
+ *
+ * Uso: program lcd [segundos]
+ *   Reproduce el patrón de esp32_main.cpp (refresco cada 100 ms de
+ *   updateSignalBar, updateStatus y updateBPM, más el corazón en cada
+ *   latido) sobre MockLCD y compara bytes y transacciones en el bus.
+ *   También comprueba que las dos pantallas acaban mostrando lo mismo.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ecg_dsp.h"
+#include "qrs_detector.h"
+#include "lcd_framebuffer.h"
+#include "synth_ecg.h"
+#include "mock_lcd.h"
+#include "native_commands.h"
+
+static int mapBar(int value)
+{
+    if (value < -400) value = -400;
+    if (value > 400) value = 400;
+    return (value + 400) * 18 / 800;
+}
+
+// Escritura directa, como hacía LCDManager antes del framebuffer
+struct DirectScreen {
+    MockLCD lcd;
+
+    void updateBPM(float bpm) {
+        lcd.setCursor(5, 1);
+        char s[8];
+        if (bpm > 0) snprintf(s, sizeof(s), "%3.0f", bpm);
+        else snprintf(s, sizeof(s), "---");
+        lcd.print(s);
+    }
+    void updateStatus(const char* status) {
+        lcd.setCursor(8, 2);
+        lcd.print("            ");
+        lcd.setCursor(8, 2);
+        lcd.print(status);
+    }
+    void setHeart(bool on) {
+        lcd.setCursor(16, 1);
+        lcd.write(on ? 0 : ' ');
+    }
+    void updateSignalBar(int value) {
+        int mapped = mapBar(value);
+        lcd.setCursor(8, 3);
+        lcd.print("[");
+        for (int i = 0; i < 10; ++i) lcd.print(i < mapped ? "=" : ".");
+        lcd.print("]");
+    }
+};
+
+// Mismas operaciones que el LCDManager actual
+struct BufferedScreen {
+    MockLCD lcd;
+    LCDFrameBuffer<20, 4> screen;
+
+    void updateBPM(float bpm) {
+        char s[8];
+        if (bpm > 0) snprintf(s, sizeof(s), "%3.0f", bpm);
+        else snprintf(s, sizeof(s), "---");
+        screen.setText(5, 1, s);
+        screen.flush(lcd);
+    }
+    void updateStatus(const char* status) {
+        screen.fill(8, 2, 12, ' ');
+        screen.setText(8, 2, status);
+        screen.flush(lcd);
+    }
+    void setHeart(bool on) {
+        screen.setChar(16, 1, on ? 0 : ' ');
+        screen.flush(lcd);
+    }
+    void updateSignalBar(int value) {
+        int mapped = mapBar(value);
+        screen.setChar(8, 3, '[');
+        for (int i = 0; i < 10; ++i) screen.setChar(9 + i, 3, i < mapped ? '=' : '.');
+        screen.setChar(19, 3, ']');
+        screen.flush(lcd);
+    }
+};
+
+template <typename Screen>
+static void simulate(Screen& s, int seconds)
+{
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 600.0f;
+    cfg.noiseAmplitude = 10.0f;
+    SynthECG synth(cfg);
+    ECGFilter filter;
+    filter.reset(synth.next());
+    QRSDetector<250> qrs;
+
+    float bpm = 0.0f;
+    int heartOffAt = -1;
+    for (int n = 0; n < seconds * 250; n++) {
+        int16_t lp = (int16_t)filter.process(synth.next());
+        if (qrs.process(lp)) {
+            if (qrs.lastRR() > 0) bpm = 60.0f * 250 / qrs.lastRR();
+            s.setHeart(true);
+            heartOffAt = n + 25; // 100 ms
+        }
+        // Refresco de 100 ms de esp32_main.cpp
+        if (n % 25 == 0) {
+            if (heartOffAt >= 0 && n >= heartOffAt) {
+                s.setHeart(false);
+                heartOffAt = -1;
+            }
+            s.updateSignalBar(lp);
+            s.updateStatus("Monitoreando");
+            s.updateBPM(bpm);
+        }
+    }
+}
+
+int benchLcd(int argc, char** argv)
+{
+    int seconds = argc > 0 ? atoi(argv[0]) : 60;
+    if (seconds <= 0) seconds = 60;
+
+    DirectScreen* direct = new DirectScreen();
+    BufferedScreen* buffered = new BufferedScreen();
+    simulate(*direct, seconds);
+    simulate(*buffered, seconds);
+
+    bool same = true;
+    for (uint8_t r = 0; r < 4; r++) {
+        for (uint8_t c = 0; c < 20; c++) {
+            if (direct->lcd.at(c, r) != buffered->lcd.at(c, r)) same = false;
+        }
+    }
+
+    printf("%d s de refresco del LCD 20x4 (LiquidCrystal_I2C)\n", seconds);
+    printf("  %-12s %10s %10s %12s %10s\n", "", "comandos", "datos", "trans. I2C", "bytes I2C");
+    printf("  %-12s %10u %10u %12u %10u\n", "directo", direct->lcd.commands, direct->lcd.data,
+           direct->lcd.i2cTransactions(), direct->lcd.i2cBytes());
+    printf("  %-12s %10u %10u %12u %10u\n", "framebuffer", buffered->lcd.commands, buffered->lcd.data,
+           buffered->lcd.i2cTransactions(), buffered->lcd.i2cBytes());
+    printf("  Reducción: %.1fx   Pantalla final idéntica: %s\n",
+           (double)direct->lcd.i2cBytes() / buffered->lcd.i2cBytes(), same ? "sí" : "NO");
+
+    delete direct;
+    delete buffered;
+    return same ? 0 : 1;
+}
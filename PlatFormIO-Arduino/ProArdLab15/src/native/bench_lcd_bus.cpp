@@ -0,0 +1,391 @@
+/**
+ * @file bench_lcd_bus.cpp
+ * @brief Bus I2C del LCD: LiquidCrystal_I2C frente al driver por lotes (hd44780_i2c.h)
+ *
+ * Uso: program lcdbus [segundos]
+ *   1. Actualización de una fila completa (setCursor + 20 caracteres) a 100
+ *      y 400 kHz: transmisiones, bytes y tiempo medido con el reloj simulado
+ *      (tráfico + esperas del driver).
+ *   2. El patrón de refresco de esp32_main.cpp a través de LCDFrameBuffer
+ *      durante [segundos] (60 por defecto): ocupación media del bus.
+ *   3. El mismo patrón con vueltas de loop() de 1 ms: vaciado completo en
+ *      cada actualización frente a LCDManager::service() con presupuesto
+ *      por vuelta. Se mide el peor tiempo de LCD en una vuelta.
+ * En todos los casos MockWire decodifica los nibbles del PCF8574 y se
+ * comprueba el contenido de la DDRAM y que no haya flancos de EN con el
+ * HD44780 ocupado.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ecg_dsp.h"
+#include "qrs_detector.h"
+#include "lcd_framebuffer.h"
+#include "hd44780_i2c.h"
+#include "lcd_manager.h"
+#include "synth_ecg.h"
+#include "mock_hal.h"
+#include "mock_wire.h"
+#include "native_commands.h"
+
+// El <Wire.h> de lcd_manager.h (mock/Wire.h); las medidas usan sus propios buses
+MockWire Wire;
+
+/**
+ * Mismo patrón de bus que LiquidCrystal_I2C 1.1.x: un expanderWrite() por
+ * cambio de pines, cada uno en su propia transmisión, y 50 us de espera
+ * tras cada flanco de bajada de EN.
+ */
+class LegacyLCDI2C {
+public:
+    LegacyLCDI2C(MockWire& wire, uint8_t addr) : wire(wire), addr(addr) {}
+
+    void init() {
+        delay(50);
+        expanderWrite(0);
+        delay(1000);
+        write4bits(0x30);
+        delayMicroseconds(4500);
+        write4bits(0x30);
+        delayMicroseconds(4500);
+        write4bits(0x30);
+        delayMicroseconds(150);
+        write4bits(0x20);
+        command(0x28);
+        command(0x0C);
+        clear();
+        command(0x06);
+    }
+
+    void backlight() { expanderWrite(0); }
+    void clear() {
+        command(0x01);
+        delayMicroseconds(2000);
+    }
+    void createChar(uint8_t location, const uint8_t charmap[8]) {
+        command(0x40 | ((location & 0x07) << 3));
+        for (int i = 0; i < 8; i++) write(charmap[i]);
+    }
+    void setCursor(uint8_t col, uint8_t row) {
+        static const uint8_t rowOffsets[4] = {0x00, 0x40, 0x14, 0x54};
+        command(0x80 | (col + rowOffsets[row]));
+    }
+    size_t write(uint8_t value) {
+        send(value, 0x01);
+        return 1;
+    }
+    void flush() {}
+
+private:
+    MockWire& wire;
+    uint8_t addr;
+
+    void command(uint8_t value) { send(value, 0); }
+    void send(uint8_t value, uint8_t mode) {
+        write4bits((value & 0xF0) | mode);
+        write4bits(((value << 4) & 0xF0) | mode);
+    }
+    void write4bits(uint8_t value) {
+        expanderWrite(value);
+        expanderWrite(value | 0x04);
+        delayMicroseconds(1);
+        expanderWrite(value & ~0x04);
+        delayMicroseconds(50);
+    }
+    void expanderWrite(uint8_t value) {
+        wire.beginTransmission(addr);
+        wire.write(value | 0x08);
+        wire.endTransmission();
+    }
+};
+
+typedef HD44780I2C<MockWire, 128> BatchedLCD;
+
+struct BusStats {
+    uint32_t transactions;
+    uint32_t bytes;
+    double micros;
+    bool ok;
+};
+
+template <typename Driver>
+static void initDisplay(MockWire& wire, Driver& lcd)
+{
+    wire.powerOn();
+    lcd.init();
+    lcd.backlight();
+    lcd.clear();
+    lcd.createChar(0, heart);
+    lcd.flush();
+}
+
+// setCursor + 20 caracteres en la fila 'row'
+template <typename Driver>
+static BusStats measureLine(uint32_t clockHz, uint8_t row)
+{
+    MockWire wire(clockHz);
+    Driver lcd(wire, 0x27);
+    initDisplay(wire, lcd);
+
+    const char* text = "Status: Monitoreando";
+    wire.resetCounters();
+    uint64_t t0 = mockNanos();
+    lcd.setCursor(0, row);
+    for (int i = 0; i < 20; i++) lcd.write((uint8_t)text[i]);
+    lcd.flush();
+
+    BusStats s;
+    s.transactions = wire.transactions;
+    s.bytes = wire.bytes;
+    s.micros = (mockNanos() - t0) / 1000.0;
+    s.ok = wire.busyViolations == 0 && wire.overflows == 0;
+    for (uint8_t c = 0; c < 20; c++) s.ok &= wire.at(c, row) == (uint8_t)text[c];
+    return s;
+}
+
+static int mapBar(int value)
+{
+    if (value < -400) value = -400;
+    if (value > 400) value = 400;
+    return (value + 400) * 18 / 800;
+}
+
+// Patrón de esp32_main.cpp sobre LCDFrameBuffer, como LCDManager
+template <typename Driver>
+static BusStats measureRefresh(uint32_t clockHz, int seconds, char finalScreen[4][21])
+{
+    MockWire wire(clockHz);
+    Driver lcd(wire, 0x27);
+    initDisplay(wire, lcd);
+    LCDFrameBuffer<20, 4> screen;
+    screen.reset(' ');
+    screen.setText(0, 0, "Monitor ECG AD8232");
+    screen.setText(0, 1, "BPM: ---");
+    screen.setText(0, 2, "Status: Iniciando...");
+    screen.setText(0, 3, "Signal: [..........]");
+    screen.flush(lcd);
+    lcd.flush();
+
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 600.0f;
+    cfg.noiseAmplitude = 10.0f;
+    SynthECG synth(cfg);
+    ECGFilter filter;
+    filter.reset(synth.next());
+    QRSDetector<250> qrs;
+
+    wire.resetCounters();
+    uint64_t busNanos = 0;
+    float bpm = 0.0f;
+    int heartOffAt = -1;
+    char text[8];
+    for (int n = 0; n < seconds * 250; n++) {
+        int16_t lp = (int16_t)filter.process(synth.next());
+        bool changed = false;
+        if (qrs.process(lp)) {
+            if (qrs.lastRR() > 0) bpm = 60.0f * 250 / qrs.lastRR();
+            screen.setChar(16, 1, 0);
+            heartOffAt = n + 25;
+            changed = true;
+        }
+        if (n % 25 == 0) {
+            if (heartOffAt >= 0 && n >= heartOffAt) {
+                screen.setChar(16, 1, ' ');
+                heartOffAt = -1;
+            }
+            int mapped = mapBar(lp);
+            for (int i = 0; i < 10; ++i) screen.setChar(9 + i, 3, i < mapped ? '=' : '.');
+            screen.fill(8, 2, 12, ' ');
+            screen.setText(8, 2, "Monitoreando");
+            if (bpm > 0) snprintf(text, sizeof(text), "%3.0f", bpm);
+            else snprintf(text, sizeof(text), "---");
+            screen.setText(5, 1, text);
+            changed = true;
+        }
+        if (changed) {
+            uint64_t t0 = mockNanos();
+            screen.flush(lcd);
+            lcd.flush();
+            busNanos += mockNanos() - t0;
+        }
+    }
+
+    BusStats s;
+    s.transactions = wire.transactions;
+    s.bytes = wire.bytes;
+    s.micros = busNanos / 1000.0;
+    s.ok = wire.busyViolations == 0 && wire.overflows == 0 && !screen.isDirty();
+    for (uint8_t r = 0; r < 4; r++) {
+        for (uint8_t c = 0; c < 20; c++) {
+            uint8_t ch = wire.at(c, r);
+            finalScreen[r][c] = ch == 0 ? '*' : (char)ch;
+        }
+        finalScreen[r][20] = '\0';
+    }
+    s.ok &= memcmp(wire.glyph(0), heart, 8) == 0;
+    return s;
+}
+
+struct TickStats {
+    uint32_t worstTickUs;
+    uint32_t slowTicks;   // vueltas con más de un periodo de muestreo (4 ms) de LCD
+    uint32_t worstLagMs;  // desde que se marca una celda hasta que llega al LCD
+    bool ok;
+};
+
+/**
+ * Vueltas de loop() de 1 ms durante 'seconds'. Con budgetBytes = 0 se vacía
+ * el framebuffer entero en la vuelta en que cambia (LCDManager anterior).
+ */
+template <typename Driver>
+static TickStats measureTicks(uint32_t clockHz, int seconds, uint16_t budgetBytes,
+                              char finalScreen[4][21])
+{
+    MockWire wire(clockHz);
+    Driver lcd(wire, 0x27);
+    initDisplay(wire, lcd);
+    LCDFrameBuffer<20, 4> screen;
+    screen.reset(' ');
+    screen.setText(0, 0, "Monitor ECG AD8232");
+    screen.setText(0, 1, "BPM: ---");
+    screen.setText(0, 2, "Status: Iniciando...");
+    screen.setText(0, 3, "Signal: [..........]");
+    screen.flush(lcd);
+    lcd.flush();
+
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 600.0f;
+    cfg.noiseAmplitude = 10.0f;
+    SynthECG synth(cfg);
+    ECGFilter filter;
+    filter.reset(synth.next());
+    QRSDetector<250> qrs;
+
+    TickStats st = {0, 0, 0, true};
+    float bpm = 0.0f;
+    int heartOffAt = -1;
+    int dirtySinceMs = -1;
+    char text[8];
+    const uint16_t budget = budgetBytes ? budgetBytes : 0xFFFF;
+    for (int ms = 0; ms < seconds * 1000; ms++) {
+        const uint64_t tickStart = mockNanos();
+        if (ms % 4 == 0) {
+            int n = ms / 4;
+            int16_t lp = (int16_t)filter.process(synth.next());
+            if (qrs.process(lp)) {
+                if (qrs.lastRR() > 0) bpm = 60.0f * 250 / qrs.lastRR();
+                screen.setChar(16, 1, 0);
+                heartOffAt = n + 25;
+            }
+            if (n % 25 == 0) {
+                if (heartOffAt >= 0 && n >= heartOffAt) {
+                    screen.setChar(16, 1, ' ');
+                    heartOffAt = -1;
+                }
+                int mapped = mapBar(lp);
+                for (int i = 0; i < 10; ++i) screen.setChar(9 + i, 3, i < mapped ? '=' : '.');
+                screen.fill(8, 2, 12, ' ');
+                screen.setText(8, 2, "Monitoreando");
+                if (bpm > 0) snprintf(text, sizeof(text), "%3.0f", bpm);
+                else snprintf(text, sizeof(text), "---");
+                screen.setText(5, 1, text);
+            }
+        }
+
+        // LCDManager::service()
+        if (screen.isDirty()) {
+            if (dirtySinceMs < 0) dirtySinceMs = ms;
+            const uint64_t t0 = mockNanos();
+            screen.flush(lcd, budget);
+            lcd.flush();
+            uint32_t us = (uint32_t)((mockNanos() - t0) / 1000);
+            if (us > st.worstTickUs) st.worstTickUs = us;
+            if (us > 4000) st.slowTicks++;
+            if (!screen.isDirty()) {
+                uint32_t lag = ms - dirtySinceMs;
+                if (lag > st.worstLagMs) st.worstLagMs = lag;
+                dirtySinceMs = -1;
+            }
+        }
+
+        // El resto de la vuelta hasta completar 1 ms
+        const uint64_t used = mockNanos() - tickStart;
+        if (used < 1000000) mockAdvanceNanos(1000000 - used);
+    }
+
+    st.ok = wire.busyViolations == 0 && wire.overflows == 0 && !screen.isDirty();
+    for (uint8_t r = 0; r < 4; r++) {
+        for (uint8_t c = 0; c < 20; c++) {
+            uint8_t ch = wire.at(c, r);
+            finalScreen[r][c] = ch == 0 ? '*' : (char)ch;
+        }
+        finalScreen[r][20] = '\0';
+    }
+    return st;
+}
+
+// Adaptador para construir ambos drivers con (wire, addr)
+struct BatchedDriver : BatchedLCD {
+    BatchedDriver(MockWire& wire, uint8_t addr) : BatchedLCD(wire, addr, 20, 4) {}
+};
+
+static void printRow(const char* name, uint32_t hz, const BusStats& s)
+{
+    printf("  %-18s %4u kHz %8u %8u %12.1f  %s\n", name, hz / 1000, s.transactions, s.bytes,
+           s.micros, s.ok ? "ok" : "ERROR");
+}
+
+int benchLcdBus(int argc, char** argv)
+{
+    int seconds = argc > 0 ? atoi(argv[0]) : 60;
+    if (seconds <= 0) seconds = 60;
+    static const uint32_t clocks[2] = {100000, 400000};
+    bool ok = true;
+
+    printf("Fila completa del 20x4 (setCursor + 20 caracteres)\n");
+    printf("  %-18s %8s %8s %8s %12s\n", "", "reloj", "trans.", "bytes", "tiempo (us)");
+    for (uint32_t hz : clocks) {
+        BusStats legacy = measureLine<LegacyLCDI2C>(hz, 2);
+        BusStats batched = measureLine<BatchedDriver>(hz, 2);
+        printRow("LiquidCrystal_I2C", hz, legacy);
+        printRow("HD44780I2C", hz, batched);
+        ok &= legacy.ok && batched.ok;
+    }
+
+    printf("\n%d s de refresco (LCDFrameBuffer, patrón de esp32_main.cpp)\n", seconds);
+    printf("  %-18s %8s %8s %8s %12s\n", "", "reloj", "trans.", "bytes", "bus (us)");
+    char legacyScreen[4][21];
+    char batchedScreen[4][21];
+    for (uint32_t hz : clocks) {
+        BusStats legacy = measureRefresh<LegacyLCDI2C>(hz, seconds, legacyScreen);
+        BusStats batched = measureRefresh<BatchedDriver>(hz, seconds, batchedScreen);
+        printRow("LiquidCrystal_I2C", hz, legacy);
+        printRow("HD44780I2C", hz, batched);
+        printf("  Ocupación del bus: %.2f%% -> %.2f%%\n",
+               legacy.micros / (seconds * 1e4), batched.micros / (seconds * 1e4));
+        ok &= legacy.ok && batched.ok && memcmp(legacyScreen, batchedScreen, sizeof(legacyScreen)) == 0;
+    }
+
+    printf("\n%d s con vueltas de loop() de 1 ms a 400 kHz (LCD por vuelta, %u bytes en service())\n", seconds,
+           (unsigned)LCDManager::TICK_BUDGET_BYTES);
+    printf("  %-26s %12s %14s %12s\n", "", "peor (us)", "vueltas >4ms", "retraso (ms)");
+    char slicedScreen[4][21];
+    TickStats legacyTicks = measureTicks<LegacyLCDI2C>(LCDPins::CLOCK_HZ, seconds, 0, legacyScreen);
+    TickStats blocking = measureTicks<BatchedDriver>(LCDPins::CLOCK_HZ, seconds, 0, batchedScreen);
+    TickStats sliced =
+        measureTicks<BatchedDriver>(LCDPins::CLOCK_HZ, seconds, LCDManager::TICK_BUDGET_BYTES, slicedScreen);
+    const TickStats* rows[3] = {&legacyTicks, &blocking, &sliced};
+    const char* names[3] = {"LiquidCrystal_I2C, todo", "HD44780I2C, todo", "HD44780I2C, service()"};
+    for (int i = 0; i < 3; i++) {
+        printf("  %-26s %12u %14u %12u  %s\n", names[i], rows[i]->worstTickUs, rows[i]->slowTicks,
+               rows[i]->worstLagMs, rows[i]->ok ? "ok" : "ERROR");
+        ok &= rows[i]->ok;
+    }
+    ok &= memcmp(batchedScreen, slicedScreen, sizeof(slicedScreen)) == 0;
+
+    printf("\nPantalla final:\n");
+    for (int r = 0; r < 4; r++) printf("  |%s|\n", batchedScreen[r]);
+    printf("Contenido y tiempos del HD44780: %s\n", ok ? "correctos" : "ERROR");
+    return ok ? 0 : 1;
+}
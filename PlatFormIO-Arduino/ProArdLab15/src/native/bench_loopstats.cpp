@@ -0,0 +1,163 @@
+/**
+ * @file bench_loopstats.cpp
+ * @brief Instrumentación del lazo de tiempo real (loop_stats.h) con el reparto del ESP32 en dos hilos
+ *
+ * Uso: program loopstats [segundos] [frecuencia_Hz]
+ *   1. Comprueba las cubetas y los percentiles de TimingHistogram con
+ *      valores conocidos.
+ *   2. Repite el reparto de esp32_main.cpp con std::thread: un hilo de
+ *      adquisición despierta en cada tick (sleep_until), mide la latencia
+ *      tick -> proceso, llama a ECGMonitor::processSample() midiendo los
+ *      ciclos y publica en una SpscRing; otro hilo vacía la cola cada
+ *      milisegundo y anota su ocupación. La frecuencia por defecto es 10
+ *      veces la del firmware para apretar el planificador del host.
+ *   3. Vuelca los histogramas con el mismo formato que la orden 's' del
+ *      firmware y mide el coste de add().
+ * Devuelve 1 si falla la comprobación del punto 1. Las muestras tardías
+ * dependen del planificador del host y solo se informan.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <Arduino.h>
+#include "ecg_monitor.h"
+#include "loop_stats.h"
+#include "spsc_ring.h"
+#include "synth_ecg.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+static bool checkHistogram()
+{
+    bool ok = true;
+    const uint32_t values[] = {0, 1, 2, 3, 4, 255, 256, 1u << 21, (1u << 22) - 1, 1u << 22, 0xFFFFFFFFu};
+    const uint8_t expected[] = {0, 1, 2, 2, 3, 8, 9, 22, 22, 23, 23};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        uint8_t k = TimingHistogram::bucketOf(values[i]);
+        if (k != expected[i]) {
+            printf("  cubeta de %lu: %u (esperada %u)\n", (unsigned long)values[i], k, expected[i]);
+            ok = false;
+        }
+    }
+
+    // 990 valores de 10 y 10 de 5000: p50 y p99 en [8, 16), p99.9 en el máximo
+    TimingHistogram h;
+    for (int i = 0; i < 990; i++) h.add(10);
+    for (int i = 0; i < 10; i++) h.add(5000);
+    if (h.count() != 1000 || h.maxValue() != 5000 || h.percentile(500) != 15 || h.percentile(990) != 15 ||
+        h.percentile(999) != 5000 || h.mean() < 59.0f || h.mean() > 60.0f) {
+        printf("  percentiles: n=%lu p50=%lu p99=%lu p99.9=%lu media=%.2f\n", (unsigned long)h.count(),
+               (unsigned long)h.percentile(500), (unsigned long)h.percentile(990),
+               (unsigned long)h.percentile(999), h.mean());
+        ok = false;
+    }
+    h.reset();
+    if (h.count() != 0 || h.percentile(990) != 0) ok = false;
+    return ok;
+}
+
+static void emitLine(const char* line)
+{
+    puts(line);
+}
+
+int benchLoopStats(int argc, char** argv)
+{
+    double seconds = argc > 0 ? atof(argv[0]) : 5.0;
+    uint32_t rateHz = argc > 1 ? (uint32_t)atoi(argv[1]) : SAMPLE_RATE_HZ * 10;
+    if (seconds <= 0.0) seconds = 5.0;
+    if (rateHz == 0) rateHz = SAMPLE_RATE_HZ * 10;
+    const uint32_t intervalUs = 1000000u / rateHz;
+    const uint32_t total = (uint32_t)(seconds * rateHz);
+
+    printf("1. TimingHistogram: ");
+    bool ok = checkHistogram();
+    printf("%s\n", ok ? "OK" : "FALLO");
+
+    printf("2. Adquisición a %lu Hz (%lu us/muestra) durante %.1f s, consumidor cada 1 ms\n",
+           (unsigned long)rateHz, (unsigned long)intervalUs, seconds);
+
+    ECGMonitor* monitor = new ECGMonitor();
+    mockSetDigital(AD8232Pins::LO_PLUS, LOW);
+    mockSetDigital(AD8232Pins::LO_MINUS, LOW);
+    monitor->begin();
+
+    SynthECGConfig cfg;
+    cfg.noiseAmplitude = 20.0f;
+    cfg.wanderAmplitude = 60.0f;
+    SynthECG synth(cfg);
+
+    SpscRing<ProcessedSample, 256> ring;
+    TimingHistogram tickLatencyUs, processCycles, queueDepth;
+    uint32_t lateSamples = 0;
+    std::atomic<bool> done(false);
+
+    std::thread consumer([&]() {
+        ProcessedSample block[16];
+        while (!done.load(std::memory_order_acquire)) {
+            queueDepth.add(ring.size());
+            while (ring.popBlock(block, 16) > 0) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < total; i++) {
+        Clock::time_point tick = start + std::chrono::microseconds((uint64_t)i * intervalUs);
+        std::this_thread::sleep_until(tick);
+        uint32_t latency = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - tick).count();
+        tickLatencyUs.add(latency);
+        if (latency >= intervalUs) lateSamples++;
+
+        int raw = synth.next();
+        mockAdvanceNanos(SAMPLE_INTERVAL_US * 1000ULL);
+        uint64_t c0 = BenchTimer::cycles();
+        ProcessedSample sample;
+        sample.raw = (int16_t)raw;
+        sample.beat = monitor->processSample(raw);
+        sample.leadsConnected = true;
+        sample.filtered = (int16_t)monitor->getLastFilteredValue();
+        sample.bpm = monitor->getBeatInfo().bpm;
+        sample.quality = monitor->getSignalQuality();
+        ring.push(sample);
+        processCycles.add((uint32_t)(BenchTimer::cycles() - c0));
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    delete monitor;
+
+    // Ciclos del TSC a us, como getCpuFrequencyMhz() en el firmware
+    BenchTimer cal;
+    cal.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    cal.stop();
+    float usPerCycle = cal.elapsedCycles() ? (float)(cal.elapsedNs() / 1000.0 / cal.elapsedCycles()) : 0.0f;
+
+    printf("# perdidas: cola=%lu tarde=%lu\n", (unsigned long)ring.dropped(), (unsigned long)lateSamples);
+    dumpTimingHistogram("tick->proceso", tickLatencyUs, 1.0f, "us", emitLine);
+    dumpTimingHistogram("processSample", processCycles, usPerCycle, "us", emitLine);
+    dumpTimingHistogram("cola", queueDepth, 1.0f, "muestras", emitLine);
+
+    // 3. Coste de add(): valores variados para no favorecer una sola cubeta
+    const uint32_t adds = 10000000;
+    TimingHistogram h;
+    uint32_t x = 12345;
+    BenchTimer timer;
+    timer.start();
+    for (uint32_t i = 0; i < adds; i++) {
+        x = x * 1664525u + 1013904223u;
+        h.add(x >> (x & 31));
+    }
+    timer.stop();
+    benchKeep(h.percentile(990));
+    printf("3. add(): %.2f ns (%.1f ciclos) por llamada, %u bytes por histograma\n",
+           timer.elapsedNs() / adds, (double)timer.elapsedCycles() / adds, (unsigned)sizeof(TimingHistogram));
+
+    printf("%s\n", ok ? "OK" : "FALLO");
+    return ok ? 0 : 1;
+}
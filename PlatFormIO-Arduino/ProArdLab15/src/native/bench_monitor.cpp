@@ -0,0 +1,228 @@
+/**
+ * @file bench_monitor.cpp
+ * @brief ECGMonitor del firmware, sin cambios, sobre grabaciones en el host
+ *
+ * Uso: program monitor [fichero] [Se_min] [PPV_min]
+ *   ecg_monitor.h se compila tal cual contra el HAL simulado
+ *   (mock/Arduino.h): cada muestra avanza el reloj simulado un periodo de
+ *   muestreo, fija los pines LO+/LO- y llama a processSample().
+ *   Sin fichero se usan escenarios sintéticos anotados, uno de ellos con
+ *   los electrodos sueltos unos segundos.
+ *   Informa del coste por muestra (media, p99.9 y máximo de cada llamada),
+ *   del retardo de detección respecto al pico R anotado, del error de la
+ *   marca de tiempo del latido (lastBeatTime, del reloj de muestras) y de
+ *   Se/PPV.
+ *   Devuelve 1 si algún escenario anotado queda por debajo de los mínimos
+ *   (99 % por defecto), para usarlo como puerta antes de cambiar el DSP.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include <Arduino.h>
+#include "ecg_monitor.h"
+#include "recorded_stream.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+typedef QRSDetector<SAMPLE_RATE_HZ> Detector;
+
+// Tolerancia de emparejamiento: 150 ms, como en 'qrs'
+static const uint32_t TOLERANCE = SAMPLE_RATE_HZ * 150 / 1000;
+
+struct LeadOff {
+    uint32_t start;
+    uint32_t end; // muestra en la que se vuelven a conectar
+};
+
+struct MonitorRun {
+    std::vector<uint32_t> detections; // muestra en la que el monitor avisa del latido
+    std::vector<uint32_t> peaks;      // pico R que el monitor da para ese latido
+    std::vector<uint32_t> beatTimes;  // lastBeatTime (ms) de ese latido
+    std::vector<uint32_t> callCycles;
+    double nsPerCycle;
+};
+
+static MonitorRun runMonitor(const std::vector<int>& samples, const std::vector<LeadOff>& leadOff)
+{
+    MonitorRun run;
+    run.callCycles.resize(samples.size());
+
+    ECGMonitor* monitor = new ECGMonitor();
+    mockSetDigital(AD8232Pins::LO_PLUS, LOW);
+    mockSetDigital(AD8232Pins::LO_MINUS, LOW);
+    monitor->begin();
+
+    unsigned long lastBeatTime = monitor->getBeatInfo().lastBeatTime;
+    size_t off = 0;
+    BenchTimer total;
+    total.start();
+    for (uint32_t i = 0; i < samples.size(); i++) {
+        mockAdvanceNanos(SAMPLE_INTERVAL_US * 1000ULL);
+        while (off < leadOff.size() && i >= leadOff[off].end) off++;
+        bool detached = off < leadOff.size() && i >= leadOff[off].start;
+        mockSetDigital(AD8232Pins::LO_PLUS, detached ? HIGH : LOW);
+        mockSetDigital(AD8232Pins::LO_MINUS, detached ? HIGH : LOW);
+        mockSetAnalog(AD8232Pins::OUTPUT_PIN, (uint16_t)samples[i]);
+
+        uint64_t c0 = BenchTimer::cycles();
+        monitor->processSample(samples[i]);
+        run.callCycles[i] = (uint32_t)(BenchTimer::cycles() - c0);
+
+        // lastBeatTime cambia también en el primer latido, que aún no tiene RR
+        const BeatInfo& info = monitor->getBeatInfo();
+        if (info.lastBeatTime != lastBeatTime) {
+            if (info.lastBeatTime != 0) {
+                run.detections.push_back(i);
+                run.peaks.push_back(monitor->getLastBeatSample());
+                run.beatTimes.push_back(info.lastBeatTime);
+            }
+            lastBeatTime = info.lastBeatTime;
+        }
+    }
+    total.stop();
+    delete monitor;
+
+    run.nsPerCycle = total.elapsedCycles() ? total.elapsedNs() / total.elapsedCycles() : 0.0;
+    return run;
+}
+
+// Quita los índices que caen en [start, end)
+static std::vector<uint32_t> dropRange(const std::vector<uint32_t>& v, uint32_t start, uint32_t end)
+{
+    std::vector<uint32_t> out;
+    for (uint32_t x : v) {
+        if (x < start || x >= end) out.push_back(x);
+    }
+    return out;
+}
+
+static bool report(const char* name, const RecordedStream& stream, const std::vector<LeadOff>& leadOff,
+                   double minSe, double minPpv)
+{
+    MonitorRun run = runMonitor(stream.samples, leadOff);
+
+    std::vector<uint32_t> sorted(run.callCycles);
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (uint32_t c : sorted) sum += c;
+    double meanNs = sum / sorted.size() * run.nsPerCycle;
+    double p999Ns = sorted[sorted.size() * 999 / 1000] * run.nsPerCycle;
+    double maxNs = sorted.back() * run.nsPerCycle;
+
+    printf("%s (%zu muestras, %zu latidos anotados)\n", name, stream.samples.size(), stream.annotations.size());
+    printf("  processSample: %.1f ns/muestra  p99.9 %.0f ns  max %.0f ns  (presupuesto %lu us)\n",
+           meanNs, p999Ns, maxNs, SAMPLE_INTERVAL_US);
+    if (stream.annotations.empty()) {
+        printf("  %zu latidos detectados\n", run.detections.size());
+        return true;
+    }
+
+    std::vector<uint32_t> reference = stream.annotations;
+    std::vector<uint32_t> detections = run.detections;
+    std::vector<uint32_t> peaks = run.peaks;
+    for (const LeadOff& o : leadOff) {
+        // Sin electrodos no hay señal, y al volver el detector aprende de nuevo
+        reference = dropRange(reference, o.start, o.end + Detector::LEARNING);
+        detections = dropRange(detections, o.start, o.end + Detector::LEARNING);
+        peaks = dropRange(peaks, o.start, o.end + Detector::LEARNING);
+    }
+
+    // Retardo de detección: del pico R anotado al aviso del monitor
+    std::vector<uint32_t> delays;
+    size_t j = 0;
+    for (uint32_t r : reference) {
+        if (r < Detector::LEARNING) continue;
+        while (j < detections.size() && detections[j] < r) j++;
+        if (j < detections.size() && detections[j] - r <= Detector::DELAY + 2 * TOLERANCE) {
+            delays.push_back(detections[j] - r);
+        }
+    }
+    std::sort(delays.begin(), delays.end());
+    double delaySum = 0.0;
+    for (uint32_t d : delays) delaySum += d;
+    const double msPerSample = 1000.0 / SAMPLE_RATE_HZ;
+    printf("  retardo de detección: medio %.0f ms  max %.0f ms\n",
+           delays.empty() ? 0.0 : delaySum / delays.size() * msPerSample,
+           delays.empty() ? 0.0 : delays.back() * msPerSample);
+
+    // lastBeatTime fecha el pico R con el reloj de muestras: se compara con
+    // el instante anotado. Con millis() al avisar, el error sería el retardo.
+    double timeSum = 0.0, timeAbsSum = 0.0, timeWorst = 0.0;
+    size_t timed = 0;
+    for (size_t k = 0; k < run.peaks.size(); k++) {
+        uint32_t peak = run.peaks[k];
+        std::vector<uint32_t>::const_iterator it = std::lower_bound(reference.begin(), reference.end(), peak);
+        uint32_t nearest = it == reference.end() ? reference.back() : *it;
+        if (it != reference.begin() && (it == reference.end() || peak - *(it - 1) < *it - peak)) nearest = *(it - 1);
+        if (nearest < Detector::LEARNING || (peak > nearest ? peak - nearest : nearest - peak) > TOLERANCE) continue;
+        double err = (double)run.beatTimes[k] - nearest * msPerSample;
+        timeSum += err;
+        timeAbsSum += fabs(err);
+        if (fabs(err) > timeWorst) timeWorst = fabs(err);
+        timed++;
+    }
+    printf("  hora del latido (pico R): error medio %+.1f ms  medio abs %.1f ms  max %.0f ms\n",
+           timed ? timeSum / timed : 0.0, timed ? timeAbsSum / timed : 0.0, timeWorst);
+
+    // Se empareja el pico que da el monitor, como en 'qrs'
+    BeatMatch m = matchBeats(reference, peaks, TOLERANCE, Detector::LEARNING);
+
+    bool pass = m.sensitivity() >= minSe && m.ppv() >= minPpv;
+    printf("  Se %6.2f %%  PPV %6.2f %%  (TP %u FP %u FN %u)  %s\n",
+           m.sensitivity(), m.ppv(), m.truePositives, m.falsePositives, m.falseNegatives,
+           pass ? "OK" : "POR DEBAJO DEL MÍNIMO");
+    return pass;
+}
+
+int benchMonitor(int argc, char** argv)
+{
+    double minSe = argc > 1 ? atof(argv[1]) : 99.0;
+    double minPpv = argc > 2 ? atof(argv[2]) : 99.0;
+    std::vector<LeadOff> none;
+
+    if (argc > 0) {
+        RecordedStream stream;
+        if (!loadRecordedStream(argv[0], stream) || stream.samples.empty()) {
+            fprintf(stderr, "No se puede leer %s\n", argv[0]);
+            return 1;
+        }
+        return report(argv[0], stream, none, minSe, minPpv) ? 0 : 1;
+    }
+
+    bool pass = true;
+    {
+        SynthECGConfig cfg;
+        cfg.rAmplitude = 600.0f;
+        cfg.noiseAmplitude = 15.0f;
+        SynthECG synth(cfg);
+        RecordedStream s;
+        synthesizeStream(synth, 120, SAMPLE_RATE_HZ, s);
+        pass &= report("Estable 72 lpm", s, none, minSe, minPpv);
+    }
+    {
+        SynthECGConfig cfg;
+        cfg.rAmplitude = 400.0f;
+        cfg.noiseAmplitude = 80.0f;
+        SynthECG synth(cfg);
+        RecordedStream s;
+        synthesizeStream(synth, 120, SAMPLE_RATE_HZ, s);
+        pass &= report("Derivación ruidosa", s, none, minSe, minPpv);
+    }
+    {
+        // Electrodos sueltos 3 s a mitad de la grabación
+        SynthECGConfig cfg;
+        cfg.rAmplitude = 600.0f;
+        cfg.noiseAmplitude = 15.0f;
+        SynthECG synth(cfg);
+        RecordedStream s;
+        synthesizeStream(synth, 120, SAMPLE_RATE_HZ, s);
+        std::vector<LeadOff> leadOff(1, LeadOff{60 * SAMPLE_RATE_HZ, 63 * SAMPLE_RATE_HZ});
+        pass &= report("Electrodos sueltos 60-63 s", s, leadOff, minSe, minPpv);
+    }
+
+    printf("%s\n", pass ? "OK" : "FALLO");
+    return pass ? 0 : 1;
+}
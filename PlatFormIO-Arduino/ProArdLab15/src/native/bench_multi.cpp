@@ -0,0 +1,252 @@
+/**
+ * @file bench_multi.cpp
+ * @brief ECGMultiMonitor: equivalencia con ECGMonitor por canal y coste según el número de canales
+ *
+ * Uso: program multi [segundos]
+ *   1. Tres canales sintéticos distintos (FC, amplitud, ruido) con
+ *      desconexiones de electrodos en momentos diferentes: cada canal debe
+ *      dar, muestra a muestra, el mismo filtrado, latidos y BPM que un
+ *      ECGMonitor que solo viera ese canal.
+ *   2. Canales con solo LO+, solo LO- o sin detección de electrodos: el
+ *      pin que falta (-1) no se lee y no los da por desconectados.
+ *   3. Coste por tick y por canal con N = 1, 2, 3, 4 y 8 frente a N copias
+ *      de ECGMonitor, y del banco de filtros SoA frente a N ECGFilter.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <Arduino.h>
+#include "ecg_monitor.h"
+#include "ecg_multi_monitor.h"
+#include "recorded_stream.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+static const uint8_t MAX_CHANNELS = 8;
+
+// Pines del HAL simulado: salida, LO+ y LO- distintos por canal
+static ECGChannelPins pinsFor(uint8_t ch)
+{
+    ECGChannelPins p = {40 + ch, 20 + 2 * ch, 21 + 2 * ch};
+    return p;
+}
+
+struct ChannelSignal {
+    std::vector<int> samples;
+    uint32_t offStart; // electrodos sueltos en [offStart, offEnd)
+    uint32_t offEnd;
+};
+
+static ChannelSignal makeChannel(uint8_t ch, int seconds)
+{
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 350.0f + 80.0f * ch;
+    cfg.noiseAmplitude = 10.0f + 12.0f * ch;
+    cfg.seed = 1234 + ch;
+    cfg.bpm = 62.0f + 9.0f * ch;
+    SynthECG synth(cfg);
+    RecordedStream s;
+    synthesizeStream(synth, seconds, SAMPLE_RATE_HZ, s);
+
+    ChannelSignal out;
+    out.samples = s.samples;
+    out.offStart = (uint32_t)(seconds * SAMPLE_RATE_HZ * (ch + 1) / (MAX_CHANNELS + 2));
+    out.offEnd = out.offStart + 2 * SAMPLE_RATE_HZ + 37 * ch;
+    return out;
+}
+
+static bool detachedAt(const ChannelSignal& s, uint32_t i)
+{
+    return i >= s.offStart && i < s.offEnd;
+}
+
+struct ChannelTrace {
+    std::vector<float> filtered;
+    std::vector<float> bpm;
+    std::vector<uint32_t> beats;
+};
+
+// Referencia: un ECGMonitor que solo ve este canal (con los pines de AD8232Pins)
+static ChannelTrace runSingle(const ChannelSignal& s)
+{
+    ChannelTrace t;
+    ECGMonitor* monitor = new ECGMonitor();
+    monitor->begin();
+    for (uint32_t i = 0; i < s.samples.size(); i++) {
+        mockAdvanceNanos(SAMPLE_INTERVAL_US * 1000ULL);
+        int level = detachedAt(s, i) ? HIGH : LOW;
+        mockSetDigital(AD8232Pins::LO_PLUS, level);
+        mockSetDigital(AD8232Pins::LO_MINUS, level);
+        if (monitor->processSample(s.samples[i])) t.beats.push_back(i);
+        bool on = monitor->checkLeadsConnected();
+        t.filtered.push_back(on ? monitor->getLastFilteredValue() : 0.0f);
+        t.bpm.push_back(monitor->getBeatInfo().bpm);
+    }
+    delete monitor;
+    return t;
+}
+
+static bool checkEquivalence(int seconds)
+{
+    const uint8_t N = 3;
+    ChannelSignal signals[N];
+    ECGChannelPins pins[N];
+    for (uint8_t c = 0; c < N; c++) {
+        signals[c] = makeChannel(c, seconds);
+        pins[c] = pinsFor(c);
+    }
+
+    ChannelTrace multi[N];
+    ECGMultiMonitor<N>* monitor = new ECGMultiMonitor<N>(pins);
+    monitor->begin();
+    for (uint32_t i = 0; i < signals[0].samples.size(); i++) {
+        mockAdvanceNanos(SAMPLE_INTERVAL_US * 1000ULL);
+        int16_t frame[N];
+        for (uint8_t c = 0; c < N; c++) {
+            int level = detachedAt(signals[c], i) ? HIGH : LOW;
+            mockSetDigital((uint8_t)pins[c].loPlus, level);
+            mockSetDigital((uint8_t)pins[c].loMinus, level);
+            frame[c] = (int16_t)signals[c].samples[i];
+        }
+        uint16_t beats = monitor->processFrame(frame);
+        uint16_t leads = monitor->getLeadsMask();
+        for (uint8_t c = 0; c < N; c++) {
+            if (beats & (1u << c)) multi[c].beats.push_back(i);
+            multi[c].filtered.push_back((leads & (1u << c)) ? monitor->getLastFilteredValue(c) : 0.0f);
+            multi[c].bpm.push_back(monitor->getBeatInfo(c).bpm);
+        }
+    }
+    delete monitor;
+
+    bool ok = true;
+    printf("Equivalencia con ECGMonitor por canal (%d s, %u canales)\n", seconds, N);
+    for (uint8_t c = 0; c < N; c++) {
+        ChannelTrace single = runSingle(signals[c]);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < single.filtered.size(); i++) {
+            if (single.filtered[i] != multi[c].filtered[i] || single.bpm[i] != multi[c].bpm[i]) mismatches++;
+        }
+        bool same = mismatches == 0 && single.beats == multi[c].beats;
+        printf("  canal %u: %zu latidos, electrodos sueltos %.1f-%.1f s, %zu muestras distintas  %s\n",
+               c, multi[c].beats.size(), signals[c].offStart / (float)SAMPLE_RATE_HZ,
+               signals[c].offEnd / (float)SAMPLE_RATE_HZ, mismatches, same ? "idéntico" : "DISTINTO");
+        ok = ok && same;
+    }
+    return ok;
+}
+
+// Solo LO+ (canal 0), solo LO- (canal 1) y ninguno (canal 2)
+static bool checkPartialLeadPins()
+{
+    ECGChannelPins pins[3] = {{40, 20, -1}, {41, -1, 23}, {42, -1, -1}};
+    const uint32_t invalidBefore = mockInvalidPinReads();
+    mockSetDigital(20, LOW);
+    mockSetDigital(23, LOW);
+    ECGMultiMonitor<3>* multi = new ECGMultiMonitor<3>(pins);
+    multi->begin();
+
+    bool ok = multi->checkLeadsConnected() == 0x7;
+    mockSetDigital(20, HIGH);
+    ok &= multi->checkLeadsConnected() == 0x6;
+    mockSetDigital(20, LOW);
+    mockSetDigital(23, HIGH);
+    ok &= multi->checkLeadsConnected() == 0x5;
+    mockSetDigital(23, LOW);
+    // Un pin -1 no se lee (digitalRead(-1) sería el pin 255)
+    ok &= mockInvalidPinReads() == invalidBefore;
+    delete multi;
+
+    printf("Canales con un solo pin de electrodos o ninguno: %s\n", ok ? "bien" : "FALLO");
+    return ok;
+}
+
+// Señal común para las medidas de coste (todos los canales conectados)
+static std::vector<int16_t> costSignal;
+
+template <uint8_t N>
+static void measureScaling()
+{
+    const size_t ticks = costSignal.size() / N;
+    ECGChannelPins pins[N];
+    for (uint8_t c = 0; c < N; c++) {
+        pins[c] = pinsFor(c);
+        mockSetDigital((uint8_t)pins[c].loPlus, LOW);
+        mockSetDigital((uint8_t)pins[c].loMinus, LOW);
+    }
+    mockSetDigital(AD8232Pins::LO_PLUS, LOW);
+    mockSetDigital(AD8232Pins::LO_MINUS, LOW);
+    BenchTimer timer;
+    volatile uint32_t sink = 0;
+
+    // Monitor de N canales
+    ECGMultiMonitor<N>* multi = new ECGMultiMonitor<N>(pins);
+    multi->begin();
+    timer.start();
+    for (size_t t = 0; t < ticks; t++) sink += multi->processFrame(&costSignal[t * N]);
+    timer.stop();
+    double multiNs = timer.elapsedNs() / ticks;
+    delete multi;
+
+    // N copias de ECGMonitor
+    ECGMonitor* copies = new ECGMonitor[N];
+    for (uint8_t c = 0; c < N; c++) copies[c].begin();
+    timer.start();
+    for (size_t t = 0; t < ticks; t++) {
+        for (uint8_t c = 0; c < N; c++) sink += copies[c].processSample(costSignal[t * N + c]);
+    }
+    timer.stop();
+    double copiesNs = timer.elapsedNs() / ticks;
+    delete[] copies;
+
+    // Solo el filtrado: banco SoA frente a N ECGFilter
+    ECGFilterBank<N> bank;
+    ECGFilter::Value out[N];
+    timer.start();
+    for (size_t t = 0; t < ticks; t++) {
+        bank.process(&costSignal[t * N], out);
+        sink += (uint32_t)out[0];
+    }
+    timer.stop();
+    double bankNs = timer.elapsedNs() / ticks;
+
+    ECGFilter filters[N];
+    timer.start();
+    for (size_t t = 0; t < ticks; t++) {
+        for (uint8_t c = 0; c < N; c++) out[c] = filters[c].process(costSignal[t * N + c]);
+        sink += (uint32_t)out[0];
+    }
+    timer.stop();
+    double filtersNs = timer.elapsedNs() / ticks;
+
+    printf("  N=%u  multi %7.1f ns/tick %6.1f ns/canal | %u x ECGMonitor %6.1f ns/canal"
+           " | filtro SoA %5.1f ns/canal, %u x ECGFilter %5.1f ns/canal\n",
+           N, multiNs, multiNs / N, N, copiesNs / N, bankNs / N, N, filtersNs / N);
+}
+
+int benchMulti(int argc, char** argv)
+{
+    int seconds = argc > 0 ? atoi(argv[0]) : 60;
+    if (seconds < 10) seconds = 10;
+
+    bool ok = checkEquivalence(seconds);
+    ok &= checkPartialLeadPins();
+
+    // 2.4 M muestras repartidas entre los canales de cada medida
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 500.0f;
+    cfg.noiseAmplitude = 20.0f;
+    SynthECG synth(cfg);
+    costSignal.resize(2400000);
+    for (size_t i = 0; i < costSignal.size(); i++) costSignal[i] = (int16_t)synth.next();
+
+    printf("Coste según el número de canales (%s)\n", ECG_FIXED_POINT ? "coma fija" : "float");
+    measureScaling<1>();
+    measureScaling<2>();
+    measureScaling<3>();
+    measureScaling<4>();
+    measureScaling<MAX_CHANNELS>();
+
+    printf("%s\n", ok ? "OK" : "FALLO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file bench_qrs.cpp
+ * @brief Verificación offline del detector Pan-Tompkins frente al comparador fijo
+ *
+ * Uso: program qrs [fichero]
+ *   Sin fichero se usan escenarios sintéticos anotados (deriva de amplitud,
+ *   ruido, cambios de frecuencia). Con fichero (ver recorded_stream.h) se
+ *   procesa la grabación y, si tiene anotaciones, se calculan Se y PPV.
+ */
+
+#include <stdio.h>
+#include <vector>
+#include "ecg_dsp.h"
+#include "qrs_detector.h"
+#include "recorded_stream.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+static const uint16_t RATE = 250;
+typedef QRSDetector<RATE> Detector;
+
+// Tolerancia de emparejamiento: 150 ms
+static const uint32_t TOLERANCE = RATE * 150 / 1000;
+
+// Detector original: comparador contra THRESHOLD = 40 con refractario de 250 ms
+static std::vector<uint32_t> runComparator(const std::vector<int>& input)
+{
+    const int threshold = 40;
+    const uint32_t refractory = RATE / 4;
+    std::vector<uint32_t> beats;
+    ECGFilter filter;
+    filter.reset(input[0]);
+    bool inBeat = false;
+    uint32_t last = 0;
+    bool hasLast = false;
+
+    for (uint32_t i = 0; i < input.size(); i++) {
+        int lp = filter.process(input[i]);
+        if (lp > threshold && (!hasLast || i - last > refractory)) {
+            if (!inBeat) {
+                inBeat = true;
+                beats.push_back(i);
+                last = i;
+                hasLast = true;
+            }
+        } else if (lp < threshold / 2) {
+            inBeat = false;
+        }
+    }
+    return beats;
+}
+
+static std::vector<uint32_t> runPanTompkins(const std::vector<int>& input, double* nsPerSample)
+{
+    std::vector<uint32_t> beats;
+    std::vector<int16_t> filtered(input.size());
+    ECGFilter filter;
+    filter.reset(input[0]);
+    for (size_t i = 0; i < input.size(); i++) filtered[i] = (int16_t)filter.process(input[i]);
+
+    Detector* qrs = new Detector();
+    BenchTimer timer;
+    timer.start();
+    for (size_t i = 0; i < filtered.size(); i++) {
+        if (qrs->process(filtered[i])) beats.push_back(qrs->lastBeatSample());
+    }
+    timer.stop();
+    delete qrs;
+
+    if (nsPerSample) *nsPerSample = timer.elapsedNs() / filtered.size();
+    return beats;
+}
+
+static void report(const char* name, const RecordedStream& stream)
+{
+    double ns = 0.0;
+    std::vector<uint32_t> pt = runPanTompkins(stream.samples, &ns);
+    std::vector<uint32_t> cmp = runComparator(stream.samples);
+
+    printf("%s (%zu muestras, %zu latidos anotados)\n", name,
+           stream.samples.size(), stream.annotations.size());
+    if (stream.annotations.empty()) {
+        printf("  Pan-Tompkins : %zu latidos, %.1f ns/muestra\n", pt.size(), ns);
+        printf("  Comparador   : %zu latidos\n", cmp.size());
+        return;
+    }
+
+    // Se descarta la fase de aprendizaje del detector en ambos
+    BeatMatch a = matchBeats(stream.annotations, pt, TOLERANCE, Detector::LEARNING);
+    BeatMatch b = matchBeats(stream.annotations, cmp, TOLERANCE, Detector::LEARNING);
+    printf("  Pan-Tompkins : Se %6.2f %%  PPV %6.2f %%  (TP %u FP %u FN %u)  %.1f ns/muestra\n",
+           a.sensitivity(), a.ppv(), a.truePositives, a.falsePositives, a.falseNegatives, ns);
+    printf("  Comparador   : Se %6.2f %%  PPV %6.2f %%  (TP %u FP %u FN %u)\n",
+           b.sensitivity(), b.ppv(), b.truePositives, b.falsePositives, b.falseNegatives);
+}
+
+int benchQrs(int argc, char** argv)
+{
+    if (argc > 0) {
+        RecordedStream stream;
+        if (!loadRecordedStream(argv[0], stream) || stream.samples.empty()) {
+            fprintf(stderr, "No se puede leer %s\n", argv[0]);
+            return 1;
+        }
+        report(argv[0], stream);
+        return 0;
+    }
+
+    {
+        SynthECGConfig cfg;
+        cfg.rAmplitude = 600.0f;
+        cfg.noiseAmplitude = 15.0f;
+        SynthECG synth(cfg);
+        RecordedStream s;
+        synthesizeStream(synth, 120, RATE, s);
+        report("Estable 72 lpm", s);
+    }
+    {
+        // La amplitud cae de 600 a 120 cuentas y vuelve a subir
+        SynthECGConfig cfg;
+        cfg.rAmplitude = 600.0f;
+        cfg.noiseAmplitude = 10.0f;
+        cfg.wanderAmplitude = 150.0f;
+        SynthECG synth(cfg);
+        RecordedStream s;
+        for (int sec = 0; sec < 180; sec++) {
+            float k = sec < 90 ? 1.0f - 0.8f * sec / 90.0f : 0.2f + 0.8f * (sec - 90) / 90.0f;
+            synth.setAmplitude(600.0f * k);
+            synthesizeStream(synth, 1, RATE, s);
+        }
+        report("Deriva de amplitud 600 -> 120 -> 600", s);
+    }
+    {
+        SynthECGConfig cfg;
+        cfg.rAmplitude = 400.0f;
+        cfg.noiseAmplitude = 80.0f;
+        SynthECG synth(cfg);
+        RecordedStream s;
+        synthesizeStream(synth, 120, RATE, s);
+        report("Derivación ruidosa", s);
+    }
+    {
+        SynthECGConfig cfg;
+        cfg.rAmplitude = 500.0f;
+        cfg.noiseAmplitude = 10.0f;
+        SynthECG synth(cfg);
+        RecordedStream s;
+        for (int sec = 0; sec < 180; sec++) {
+            synth.setBpm(50.0f + 100.0f * sec / 180.0f);
+            synthesizeStream(synth, 1, RATE, s);
+        }
+        report("Rampa 50 -> 150 lpm", s);
+    }
+    return 0;
+}
@@ -0,0 +1,302 @@
+/**
+ * @file bench_quality.cpp
+ * @brief Índice de calidad (signal_quality.h) y filtrado de latidos sobre ECG sintético con artefactos
+ *
+ * Uso: program quality [segundos]
+ *   ECG limpio (onda R de 500 cuentas, respiración y algo de ruido) al que
+ *   se le añaden, 2 s de cada 15, artefactos de movimiento (ondas lentas
+ *   de varias veces la onda R), despegues de electrodo (escalón que decae
+ *   y satura el ADC), ráfagas de EMG y saturación del ADC, y en otra
+ *   grabación el QRS cambia de polaridad a mitad (la plantilla se tiene que
+ *   reaprender). Para la cadena
+ *   del firmware con Pan-Tompkins, con y sin el filtrado por calidad (la
+ *   misma lógica que ECGMonitor::processSample()):
+ *   1. Índice medio y % de ventanas bajo el umbral, fuera y dentro de los
+ *      artefactos.
+ *   2. Se/PPV frente a las anotaciones.
+ *   3. Error medio de la FC mostrada (hrv_engine.h) frente a la real.
+ *   4. Coste por muestra de SignalQuality::process().
+ *   Devuelve 1 si sin artefactos el filtrado quita latidos (Se < 99 %) o
+ *   marca ventanas limpias como malas, si con artefactos no reduce los
+ *   falsos positivos y el error de la FC o si tras el cambio de polaridad
+ *   no vuelve a aceptar latidos (Se < 93 %).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include "ecg_dsp.h"
+#include "qrs_detector.h"
+#include "ecg_types.h"
+#include "hrv_engine.h"
+#include "signal_quality.h"
+#include "recorded_stream.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+typedef QRSDetector<SAMPLE_RATE_HZ> Detector;
+typedef SignalQuality<SAMPLE_RATE_HZ, 4095> Quality;
+
+static const uint32_t TOLERANCE = SAMPLE_RATE_HZ * 150 / 1000;
+static const float TRUE_BPM = 72.0f;
+
+enum ArtifactKind { NONE, MOTION, ELECTRODE_POP, EMG, SATURATION, INVERSION };
+
+struct QualityScenario {
+    const char* name;
+    ArtifactKind kind;
+};
+
+struct Segment {
+    uint32_t start;
+    uint32_t end;
+};
+
+struct PipelineRun {
+    std::vector<uint32_t> beats;    // posición del QRS de los latidos que cuentan
+    std::vector<uint8_t> index;     // índice al cerrar cada ventana de 1 s
+    double bpmError = 0.0;          // error absoluto medio de la FC mostrada
+    double bpmWorst = 0.0;
+};
+
+// Generador determinista para los artefactos (el de synth_ecg.h es privado)
+struct Lcg {
+    uint32_t state;
+    explicit Lcg(uint32_t seed) : state(seed) {}
+    double uniform() {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) * (1.0 / 16777216.0);
+    }
+};
+
+static void addArtifact(std::vector<int>& x, ArtifactKind kind, const Segment& seg, double r, Lcg& rng)
+{
+    const double fs = SAMPLE_RATE_HZ;
+    switch (kind) {
+    case MOTION: {
+        // Ondas de 80-250 ms y de 1 a 3 veces la onda R, unas 3 por segundo
+        for (uint32_t c = seg.start; c < seg.end; c += (uint32_t)(fs * (0.2 + 0.3 * rng.uniform()))) {
+            double width = fs * (0.08 + 0.17 * rng.uniform());
+            double amp = r * (1.0 + 2.0 * rng.uniform()) * (rng.uniform() < 0.5 ? -1.0 : 1.0);
+            for (long i = (long)(c - 3 * width); i < (long)(c + 3 * width); i++) {
+                if (i < 0 || i >= (long)x.size()) continue;
+                double t = (i - (double)c) / width;
+                x[i] += (int)lround(amp * exp(-0.5 * t * t));
+            }
+        }
+        break;
+    }
+    case ELECTRODE_POP: {
+        // Escalón de 1800 cuentas que decae con 0.4 s de constante de tiempo
+        double sign = rng.uniform() < 0.5 ? -1.0 : 1.0;
+        for (uint32_t i = seg.start; i < seg.end; i++) {
+            x[i] += (int)lround(sign * 1800.0 * exp(-(i - seg.start) / (0.4 * fs)));
+        }
+        break;
+    }
+    case EMG:
+        for (uint32_t i = seg.start; i < seg.end; i++) {
+            x[i] += (int)lround(0.6 * r * (2.0 * rng.uniform() - 1.0));
+        }
+        break;
+    case SATURATION:
+        for (uint32_t i = seg.start; i < seg.end; i++) x[i] = 4095;
+        break;
+    case INVERSION:
+        // Electrodos recolocados: el QRS cambia de polaridad hasta el final
+        for (uint32_t i = seg.start; i < x.size(); i++) x[i] = 4096 - x[i];
+        break;
+    case NONE:
+        break;
+    }
+    for (uint32_t i = seg.start; i < seg.end + SAMPLE_RATE_HZ && i < x.size(); i++) {
+        if (x[i] < 0) x[i] = 0;
+        if (x[i] > 4095) x[i] = 4095;
+    }
+}
+
+// Filtro + Pan-Tompkins + HRV como en ECGMonitor; con gate = false, todos
+// los QRS cuentan (el comportamiento anterior a signal_quality.h)
+static PipelineRun runPipeline(const std::vector<int>& x, bool gate)
+{
+    PipelineRun run;
+    ECGFilter filter;
+    filter.reset(x[0]);
+    Detector* qrs = new Detector();
+    Quality* quality = new Quality();
+    HRVEngine<HRV_MAX_BEATS>* hrv = new HRVEngine<HRV_MAX_BEATS>(HRV_WINDOW_MS);
+    float bpm = 0.0f;
+    uint32_t lastQrs = 0;
+    uint32_t lastCounted = 0;
+    bool haveCounted = false;
+    double errorSum = 0.0;
+    uint32_t errorCount = 0;
+
+    for (uint32_t i = 0; i < x.size(); i++) {
+        ECGFilter::Value lp = filter.process(x[i]);
+        BeatVerdict verdict = quality->process((int16_t)x[i], (int16_t)filter.lastUnsmoothed(), (int16_t)lp);
+        bool detected = qrs->process((int16_t)lp);
+        if (detected) {
+            lastQrs = qrs->lastBeatSample();
+            BeatVerdict v = quality->addBeat(qrs->sampleCount() - 1 - qrs->lastBeatSample());
+            if (v != BEAT_NONE) verdict = v;
+        }
+        if ((i + 1) % SAMPLE_RATE_HZ == 0) run.index.push_back(quality->index());
+
+        if (gate ? verdict == BEAT_ACCEPTED : detected) {
+            run.beats.push_back(lastQrs);
+            uint32_t rr = gate ? quality->acceptedRR() : (haveCounted ? lastQrs - lastCounted : 0);
+            if (rr > 0) {
+                hrv->addRR((uint16_t)(rr * 1000UL / SAMPLE_RATE_HZ));
+                bpm = hrv->metrics().displayHr;
+            }
+            lastCounted = lastQrs;
+            haveCounted = true;
+        }
+        // La FC mostrada, una vez por segundo tras el aprendizaje
+        if (i >= Detector::LEARNING && (i + 1) % SAMPLE_RATE_HZ == 0 && bpm > 0) {
+            double e = fabs(bpm - TRUE_BPM);
+            errorSum += e;
+            errorCount++;
+            if (e > run.bpmWorst) run.bpmWorst = e;
+        }
+    }
+    run.bpmError = errorCount ? errorSum / errorCount : 0.0;
+    delete hrv;
+    delete quality;
+    delete qrs;
+    return run;
+}
+
+static bool overlaps(const std::vector<Segment>& segs, uint32_t start, uint32_t end)
+{
+    for (const Segment& s : segs) {
+        if (start < s.end && s.start < end) return true;
+    }
+    return false;
+}
+
+static void printMatch(const char* label, const BeatMatch& m, const PipelineRun& run)
+{
+    printf("    %-14s Se %6.2f %%  PPV %6.2f %%  (FP %3u FN %3u)  FC: error medio %5.1f lpm, peor %5.1f\n",
+           label, m.sensitivity(), m.ppv(), m.falsePositives, m.falseNegatives, run.bpmError, run.bpmWorst);
+}
+
+static bool runScenario(const QualityScenario& sc, const RecordedStream& clean, double r)
+{
+    std::vector<int> x(clean.samples);
+    std::vector<Segment> segs;
+    Lcg rng(2024);
+    // 2 s de artefacto cada 15 s, desde el segundo 10; la inversión, una
+    // vez a mitad de la grabación
+    uint32_t first = sc.kind == INVERSION ? (uint32_t)(x.size() / SAMPLE_RATE_HZ / 2) : 10;
+    uint32_t every = sc.kind == INVERSION ? (uint32_t)x.size() : 15;
+    for (uint32_t s = first; sc.kind != NONE && s + 2 < x.size() / SAMPLE_RATE_HZ; s += every) {
+        Segment seg = {(uint32_t)(s * SAMPLE_RATE_HZ), (uint32_t)((s + 2) * SAMPLE_RATE_HZ)};
+        addArtifact(x, sc.kind, seg, r, rng);
+        segs.push_back(seg);
+    }
+
+    PipelineRun without = runPipeline(x, false);
+    PipelineRun with = runPipeline(x, true);
+
+    // Ventanas limpias y con artefacto (tocadas por uno, o en los 2 s siguientes)
+    double cleanSum = 0.0, dirtySum = 0.0;
+    uint32_t cleanCount = 0, dirtyCount = 0, cleanLow = 0, dirtyLow = 0;
+    for (uint32_t w = 1; w < with.index.size(); w++) {
+        uint32_t start = w * SAMPLE_RATE_HZ;
+        uint8_t q = with.index[w];
+        if (q == QUALITY_UNKNOWN) continue;
+        if (overlaps(segs, start, start + SAMPLE_RATE_HZ)) {
+            dirtySum += q;
+            dirtyCount++;
+            dirtyLow += q < Quality::GATE;
+        } else if (!overlaps(segs, start - 2 * SAMPLE_RATE_HZ, start + SAMPLE_RATE_HZ)) {
+            cleanSum += q;
+            cleanCount++;
+            cleanLow += q < Quality::GATE;
+        }
+    }
+    printf("%s\n", sc.name);
+    printf("  índice fuera de artefactos: medio %5.1f, %3u de %3u ventanas bajo %u\n",
+           cleanCount ? cleanSum / cleanCount : 0.0, cleanLow, cleanCount, Quality::GATE);
+    if (dirtyCount) {
+        printf("  índice con artefactos:      medio %5.1f, %3u de %3u ventanas bajo %u\n",
+               dirtySum / dirtyCount, dirtyLow, dirtyCount, Quality::GATE);
+    }
+
+    BeatMatch mWithout = matchBeats(clean.annotations, without.beats, TOLERANCE, Detector::LEARNING);
+    BeatMatch mWith = matchBeats(clean.annotations, with.beats, TOLERANCE, Detector::LEARNING);
+    printMatch("sin filtrado", mWithout, without);
+    printMatch("con filtrado", mWith, with);
+
+    if (sc.kind == NONE) {
+        return mWith.sensitivity() >= 99.0 && mWith.ppv() >= 99.0 && cleanLow == 0;
+    }
+    if (sc.kind == INVERSION) {
+        // Unos latidos rechazados hasta reaprender la plantilla, no más
+        return cleanLow * 10 <= cleanCount && mWith.sensitivity() >= 93.0;
+    }
+    return cleanLow * 10 <= cleanCount && mWith.falsePositives <= mWithout.falsePositives &&
+           with.bpmError <= without.bpmError + 0.1;
+}
+
+// ns por muestra de SignalQuality::process() con un latido por segundo
+static void measureCost(const std::vector<int>& input)
+{
+    ECGFilter filter;
+    filter.reset(input[0]);
+    std::vector<int16_t> lp(input.size()), unsmoothed(input.size());
+    for (size_t i = 0; i < input.size(); i++) {
+        lp[i] = (int16_t)filter.process(input[i]);
+        unsmoothed[i] = (int16_t)filter.lastUnsmoothed();
+    }
+    Quality* quality = new Quality();
+    BenchTimer timer;
+    uint32_t acc = 0;
+    timer.start();
+    for (size_t i = 0; i < input.size(); i++) {
+        acc += quality->process((int16_t)input[i], unsmoothed[i], lp[i]);
+        if (i % SAMPLE_RATE_HZ == 100) acc += quality->addBeat(3);
+    }
+    timer.stop();
+    benchKeep(acc);
+    delete quality;
+    printf("  SignalQuality::process() %6.2f ns/muestra  %6.1f ciclos/muestra (incluye addBeat)\n",
+           timer.elapsedNs() / input.size(), (double)timer.elapsedCycles() / input.size());
+}
+
+int benchQuality(int argc, char** argv)
+{
+    int seconds = argc > 0 ? atoi(argv[0]) : 120;
+    if (seconds < 40) seconds = 40;
+
+    SynthECGConfig cfg;
+    cfg.bpm = TRUE_BPM;
+    cfg.rAmplitude = 500.0f;
+    cfg.noiseAmplitude = 20.0f;
+    cfg.wanderAmplitude = 60.0f;
+    SynthECG synth(cfg);
+    RecordedStream clean;
+    synthesizeStream(synth, seconds, SAMPLE_RATE_HZ, clean);
+
+    const QualityScenario scenarios[] = {
+        {"Sin artefactos", NONE},
+        {"Movimiento", MOTION},
+        {"Despegue de electrodo", ELECTRODE_POP},
+        {"Ráfagas de EMG", EMG},
+        {"ADC saturado", SATURATION},
+        {"Polaridad invertida a mitad", INVERSION},
+    };
+
+    printf("ECG de %.0f lpm, onda R de %.0f cuentas, %d s; artefactos de 2 s cada 15 s\n",
+           TRUE_BPM, cfg.rAmplitude, seconds);
+    bool ok = true;
+    for (const QualityScenario& sc : scenarios) ok = runScenario(sc, clean, cfg.rAmplitude) && ok;
+
+    printf("Coste\n");
+    measureCost(clean.samples);
+    printf("%s\n", ok ? "OK" : "FALLO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+/**
+ * @file bench_resp.cpp
+ * @brief Respiración derivada del ECG (respiration.h) con señales sintéticas moduladas
+ *
+ * Uso: program resp [segundos]
+ *   1. Señales con la respiración solo en la amplitud del latido, solo en
+ *      la línea base, en las dos y con ruido y zumbido de red, de 8 a 30
+ *      rpm. Pasan por ECGMonitor::processBlock() en bloques de 16 muestras,
+ *      como en el ESP32, y se lee getRespiration() cada segundo. Pasado el
+ *      primer minuto debe haber estimación al menos el 90 % del tiempo y a
+ *      menos de 1.5 rpm de la real.
+ *   2. Cambio de 12 a 24 rpm: segundos hasta quedarse a menos de 1.5 rpm.
+ *      Apnea (la respiración se para): segundos hasta dejar de estimar.
+ *      Sin respiración no debe haber estimación más del 10 % del tiempo.
+ *   3. processSample() da la misma estimación que processBlock() y la
+ *      trama de respiración de ecg_stream.h llega igual al decodificador.
+ *   4. Coste de onBeat() y de estimate(), y memoria.
+ *   Devuelve 1 si falla alguna comprobación.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <Arduino.h>
+#include "ecg_monitor.h"
+#include "ecg_stream.h"
+#include "stream_decoder.h"
+#include "synth_ecg.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+static const int WARMUP_S = 60;
+static const float MAX_ERROR_RPM = 1.5f;
+
+struct RespCase {
+    const char* name;
+    float bpm;
+    float rpm;
+    float modulation;   // fracción de amplitud del latido
+    float wander;       // cuentas de línea base
+    float noise;
+    float hum;
+};
+
+// Estimación leída al final de cada segundo
+struct RespTrace {
+    std::vector<RespirationEstimate> perSecond;
+};
+
+static SynthECG makeSynth(const RespCase& c)
+{
+    SynthECGConfig cfg;
+    cfg.bpm = c.bpm;
+    cfg.rAmplitude = 450.0f;
+    cfg.wanderHz = c.rpm / 60.0f;
+    cfg.respModulation = c.modulation;
+    cfg.wanderAmplitude = c.wander;
+    cfg.noiseAmplitude = c.noise;
+    cfg.humAmplitude = c.hum;
+    return SynthECG(cfg);
+}
+
+/**
+ * 'seconds' de la señal del caso; en 'changeAt' (si > 0) la respiración
+ * pasa a 'changeRpm' (0 = apnea). blockSize 0: muestra a muestra.
+ */
+static RespTrace runCase(const RespCase& c, int seconds, size_t blockSize, int changeAt = 0, float changeRpm = 0)
+{
+    SynthECG synth = makeSynth(c);
+    mockSetDigital(AD8232Pins::LO_PLUS, LOW);
+    mockSetDigital(AD8232Pins::LO_MINUS, LOW);
+    ECGMonitor* monitor = new ECGMonitor();
+    monitor->begin();
+
+    RespTrace t;
+    int16_t second[SAMPLE_RATE_HZ];
+    for (int s = 0; s < seconds; s++) {
+        if (changeAt > 0 && s == changeAt) synth.setRespirationHz(changeRpm / 60.0f);
+        for (unsigned i = 0; i < SAMPLE_RATE_HZ; i++) second[i] = (int16_t)synth.next();
+        if (blockSize == 0) {
+            for (unsigned i = 0; i < SAMPLE_RATE_HZ; i++) monitor->processSample(second[i]);
+        } else {
+            for (size_t i = 0; i < SAMPLE_RATE_HZ; i += blockSize) {
+                size_t n = SAMPLE_RATE_HZ - i < blockSize ? SAMPLE_RATE_HZ - i : blockSize;
+                monitor->processBlock(&second[i], n, nullptr);
+            }
+        }
+        t.perSecond.push_back(monitor->getRespiration());
+    }
+    delete monitor;
+    return t;
+}
+
+static const char* sourceName(uint8_t source)
+{
+    return source == RESP_SOURCE_AMPLITUDE ? "amplitud" : source == RESP_SOURCE_BASELINE ? "línea base" : "-";
+}
+
+static bool checkAccuracy(int seconds)
+{
+    static const RespCase cases[] = {
+        {"amplitud", 72, 12, 0.15f, 0, 10, 0},
+        {"amplitud", 80, 24, 0.15f, 0, 10, 0},
+        {"línea base", 72, 8, 0, 60, 10, 0},
+        {"línea base", 72, 16, 0, 60, 10, 0},
+        {"ambas", 90, 30, 0.10f, 40, 10, 0},
+        {"ruido+red", 75, 15, 0.15f, 40, 50, 80},
+    };
+
+    bool ok = true;
+    printf("1. Precisión (%d s, desde el segundo %d)\n", seconds, WARMUP_S);
+    printf("   %-12s %4s %4s  %9s %8s %8s  %s\n", "señal", "lpm", "rpm", "con estim", "media", "err máx", "fuente");
+    for (const RespCase& c : cases) {
+        RespTrace t = runCase(c, seconds, 16);
+        int valid = 0, total = 0, bySource[3] = {0, 0, 0};
+        float sum = 0, worst = 0;
+        for (size_t s = WARMUP_S; s < t.perSecond.size(); s++) {
+            const RespirationEstimate& e = t.perSecond[s];
+            total++;
+            if (e.rate <= 0) continue;
+            valid++;
+            sum += e.rate;
+            bySource[e.source < 3 ? e.source : 0]++;
+            float err = fabsf(e.rate - c.rpm);
+            if (err > worst) worst = err;
+        }
+        float coverage = total ? 100.0f * valid / total : 0;
+        uint8_t source = bySource[RESP_SOURCE_BASELINE] > bySource[RESP_SOURCE_AMPLITUDE] ? RESP_SOURCE_BASELINE
+                                                                                          : RESP_SOURCE_AMPLITUDE;
+        bool pass = coverage >= 90.0f && worst <= MAX_ERROR_RPM;
+        printf("   %-12s %4.0f %4.0f  %8.0f%% %8.2f %8.2f  %-11s %s\n", c.name, c.bpm, c.rpm, coverage,
+               valid ? sum / valid : 0.0f, worst, valid ? sourceName(source) : "-", pass ? "bien" : "FALLO");
+        if (!pass) ok = false;
+    }
+    return ok;
+}
+
+static bool checkDynamics(int seconds)
+{
+    const int changeAt = seconds / 2;
+    bool ok = true;
+    printf("2. Cambios\n");
+
+    // 12 -> 24 rpm: primer segundo desde el que todo queda a menos de 1.5 rpm
+    RespCase change = {"cambio", 80, 12, 0.15f, 40, 10, 0};
+    RespTrace t = runCase(change, seconds, 16, changeAt, 24.0f);
+    int settled = -1;
+    for (int s = (int)t.perSecond.size() - 1; s >= changeAt; s--) {
+        const RespirationEstimate& e = t.perSecond[s];
+        if (e.rate <= 0 || fabsf(e.rate - 24.0f) > MAX_ERROR_RPM) break;
+        settled = s;
+    }
+    bool pass = settled >= 0 && settled - changeAt <= 40;
+    printf("   12 -> 24 rpm en %d s: estable a los %d s  %s\n", changeAt, settled >= 0 ? settled - changeAt : -1,
+           pass ? "bien" : "FALLO");
+    if (!pass) ok = false;
+
+    // Apnea: primer segundo desde el que ya no hay estimación
+    RespCase apnea = {"apnea", 72, 15, 0.15f, 40, 10, 0};
+    t = runCase(apnea, seconds, 16, changeAt, 0.0f);
+    int gone = -1;
+    for (int s = (int)t.perSecond.size() - 1; s >= changeAt; s--) {
+        if (t.perSecond[s].rate > 0) break;
+        gone = s;
+    }
+    const int limit = (int)(ECGMonitor::Respiration::MAX_INTERVAL / SAMPLE_RATE_HZ) + 10;
+    pass = gone >= 0 && gone - changeAt <= limit;
+    printf("   apnea en %d s: sin estimación a los %d s (límite %d)  %s\n", changeAt, gone >= 0 ? gone - changeAt : -1,
+           limit, pass ? "bien" : "FALLO");
+    if (!pass) ok = false;
+
+    // Sin respiración en la señal
+    RespCase none = {"ninguna", 72, 15, 0, 0, 20, 0};
+    t = runCase(none, seconds, 16);
+    int valid = 0, total = 0;
+    for (size_t s = WARMUP_S; s < t.perSecond.size(); s++, total++) valid += t.perSecond[s].rate > 0;
+    float coverage = total ? 100.0f * valid / total : 0;
+    pass = coverage <= 10.0f;
+    printf("   sin respiración: estimación el %.0f%% del tiempo  %s\n", coverage, pass ? "bien" : "FALLO");
+    if (!pass) ok = false;
+    return ok;
+}
+
+static bool checkConsistency(int seconds)
+{
+    bool ok = true;
+    printf("3. Coherencia\n");
+
+    RespCase c = {"ruido+red", 75, 15, 0.15f, 40, 50, 80};
+    RespTrace streaming = runCase(c, seconds, 0);
+    RespTrace blocks = runCase(c, seconds, 16);
+    uint32_t diffs = 0;
+    for (size_t s = 0; s < streaming.perSecond.size(); s++) {
+        const RespirationEstimate& a = streaming.perSecond[s];
+        const RespirationEstimate& b = blocks.perSecond[s];
+        if (memcmp(&a.rate, &b.rate, sizeof(a.rate)) != 0 || a.source != b.source || a.regularity != b.regularity) {
+            diffs++;
+        }
+    }
+    printf("   processSample() frente a processBlock(): %lu segundos distintos  %s\n", (unsigned long)diffs,
+           diffs == 0 ? "bien" : "FALLO");
+    if (diffs) ok = false;
+
+    // Trama de respiración de ida y vuelta
+    ECGStreamEncoder encoder;
+    ECGStreamDecoder decoder;
+    const RespirationEstimate& last = blocks.perSecond.back();
+    encoder.encodeRespiration(last);
+    auto ignoreSamples = [](const DecodedSamples&) {};
+    auto ignoreHrv = [](const DecodedHrv&) {};
+    decoder.feed(encoder.data(), encoder.size(), ignoreSamples, ignoreHrv);
+    DecodedRespiration r;
+    bool same = decoder.getRespiration(r) && fabsf(r.rate - last.rate) <= 0.05f && r.source == last.source &&
+                r.regularity == last.regularity;
+    printf("   trama de respiración (%u bytes): %.1f rpm, %s, regularidad %u%%  %s\n", (unsigned)encoder.size(), r.rate,
+           sourceName(r.source), (unsigned)r.regularity, same ? "bien" : "FALLO");
+    if (!same) ok = false;
+    return ok;
+}
+
+static void measureCost()
+{
+    const uint32_t beats = 1000000;
+    std::vector<int16_t> amplitude(4096), baseline(4096);
+    for (size_t i = 0; i < amplitude.size(); i++) {
+        float breath = sinf(2.0f * (float)M_PI * i / 4.8f);
+        amplitude[i] = (int16_t)(500 + 60 * breath + (int)(i * 7919 % 41) - 20);
+        baseline[i] = (int16_t)(2048 + 40 * breath);
+    }
+
+    printf("4. Coste (mejor de 5)\n");
+    double bestBeat = 1e30, bestEstimate = 1e30;
+    for (int r = 0; r < 5; r++) {
+        ECGMonitor::Respiration* resp = new ECGMonitor::Respiration();
+        BenchTimer t;
+        t.start();
+        for (uint32_t i = 0; i < beats; i++) {
+            resp->onBeat(i * 208, amplitude[i & 4095], baseline[i & 4095]);
+        }
+        t.stop();
+        if (t.elapsedNs() < bestBeat) bestBeat = t.elapsedNs();
+
+        t.start();
+        for (uint32_t i = 0; i < beats; i++) benchKeep(resp->estimate(beats * 208 + (i & 255)).rate);
+        t.stop();
+        if (t.elapsedNs() < bestEstimate) bestEstimate = t.elapsedNs();
+        delete resp;
+    }
+    printf("   onBeat() %.1f ns por latido, estimate() %.1f ns; %u bytes\n", bestBeat / beats, bestEstimate / beats,
+           (unsigned)sizeof(ECGMonitor::Respiration));
+}
+
+int benchResp(int argc, char** argv)
+{
+    int seconds = argc > 0 ? atoi(argv[0]) : 180;
+    if (seconds < WARMUP_S + 60) seconds = WARMUP_S + 60;
+
+    bool ok = checkAccuracy(seconds);
+    ok = checkDynamics(seconds) && ok;
+    ok = checkConsistency(seconds) && ok;
+    measureCost();
+
+    printf("%s\n", ok ? "OK" : "FALLO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/**
+ * @file bench_ring.cpp
+ * @brief Prueba de carga de SpscRing con std::thread (productor y consumidor reales) y de IsrRing
+ *
+ * Uso: program ring [millones_de_elementos]
+ *   1. Throughput sin pausas en el consumidor.
+ *   2. Productor a ritmo fijo y consumidor con pausas largas (como un
+ *      refresco del LCD por I2C) para forzar overruns.
+ *   3. IsrRing (isr_ring.h) con el reparto del UNO simulado milisegundo a
+ *      milisegundo: la ISR del ADC a 1 kHz frente a un loop() que se para,
+ *      y tramas de tamaño variable hacia un UART a 115200 baudios que deja
+ *      de vaciarse.
+ * En todos se comprueba que los elementos llegan en orden, sin duplicados,
+ * y que los huecos coinciden con dropped(); en la cola de envío, además,
+ * que las tramas llegan enteras o no llegan.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <chrono>
+#include "spsc_ring.h"
+#include "isr_ring.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+struct RingItem {
+    uint32_t seq;
+    int16_t value;
+};
+
+typedef SpscRing<RingItem, 256> TestRing;
+
+struct RingResult {
+    uint32_t received = 0;
+    uint32_t gaps = 0;
+    bool ordered = true;
+};
+
+static void consume(TestRing& ring, uint32_t total, const std::atomic<bool>& done,
+                    int stallEvery, int stallUs, RingResult& result)
+{
+    RingItem block[16];
+    uint32_t expected = 0;
+    uint32_t blocks = 0;
+    for (;;) {
+        size_t n = ring.popBlock(block, 16);
+        if (n == 0) {
+            if (done.load(std::memory_order_acquire) && ring.size() == 0) break;
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (block[i].seq < expected || block[i].value != (int16_t)block[i].seq) {
+                result.ordered = false;
+            }
+            result.gaps += block[i].seq - expected;
+            expected = block[i].seq + 1;
+            result.received++;
+        }
+        if (stallEvery > 0 && ++blocks % stallEvery == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(stallUs));
+        }
+    }
+    result.gaps += total - expected;
+}
+
+static bool runCase(const char* name, uint32_t total, int producerPeriodUs, int stallEvery, int stallUs,
+                    bool retryWhenFull)
+{
+    TestRing* ring = new TestRing();
+    std::atomic<bool> done(false);
+    RingResult result;
+
+    BenchTimer timer;
+    timer.start();
+    std::thread consumer(consume, std::ref(*ring), total, std::cref(done), stallEvery, stallUs,
+                         std::ref(result));
+    std::thread producer([&]() {
+        auto next = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < total; i++) {
+            while (!ring->push(RingItem{i, (int16_t)i}) && retryWhenFull) {
+                std::this_thread::yield();
+            }
+            if (producerPeriodUs > 0) {
+                next += std::chrono::microseconds(producerPeriodUs);
+                std::this_thread::sleep_until(next);
+            }
+        }
+        done.store(true, std::memory_order_release);
+    });
+    producer.join();
+    consumer.join();
+    timer.stop();
+
+    // Con reintentos cada push fallido también cuenta en dropped()
+    uint32_t lost = retryWhenFull ? 0 : ring->dropped();
+    bool ok = result.ordered && result.gaps == lost && result.received + lost == total;
+    printf("%s\n", name);
+    printf("  %u enviados, %u recibidos, %u descartados (huecos %u), %.0f elementos/s  %s\n",
+           total, result.received, lost, result.gaps,
+           result.received / (timer.elapsedNs() / 1e9), ok ? "OK" : "ERROR");
+    delete ring;
+    return ok;
+}
+
+// Lecturas del ADC: la "ISR" empuja una por milisegundo y loop() vacía la
+// cola cada milisegundo salvo durante las pausas
+static bool runIsrSamples()
+{
+    IsrRing<int16_t, 64> ring;
+    const uint32_t total = 60000;
+    uint32_t received = 0, gaps = 0;
+    int16_t expected = 0;
+    bool ordered = true;
+    // Un milisegundo más al final para vaciar lo que dejó la última pausa
+    for (uint32_t ms = 0; ms <= total; ms++) {
+        if (ms < total) ring.push((int16_t)ms);
+        // Pausas de 100 ms cada 10 s (p. ej. una escritura a EEPROM)
+        if (ms < total && ms % 10000 >= 9900) continue;
+        int16_t v;
+        while (ring.pop(v)) {
+            if ((int16_t)(v - expected) < 0) ordered = false;
+            gaps += (uint16_t)(v - expected);
+            expected = (int16_t)(v + 1);
+            received++;
+        }
+    }
+    gaps += (uint16_t)((int16_t)total - expected);
+    bool ok = ordered && gaps == ring.dropped() && received + ring.dropped() == total;
+    printf("IsrRing: ADC a 1 kHz, cola de 64, loop() parado 100 ms cada 10 s\n");
+    printf("  %u lecturas, %u recibidas, %u descartadas (huecos %u)  %s\n", total, received,
+           ring.dropped(), gaps, ok ? "OK" : "ERROR");
+    return ok;
+}
+
+// Tramas [longitud, secuencia, relleno...] de 20 a 39 bytes cada 40 ms hacia
+// un UART que saca 11 o 12 bytes por milisegundo y se para 300 ms cada 5 s
+static bool runIsrFrames()
+{
+    IsrRing<uint8_t, 128> ring;
+    uint8_t frame[39];
+    uint32_t sent = 0, rejected = 0, received = 0, gaps = 0;
+    uint8_t seq = 0, expectedSeq = 0;
+    uint8_t current[39];
+    uint8_t have = 0;
+    bool whole = true;
+    // Tras 60 s sin tramas nuevas, hasta vaciar la cola
+    for (uint32_t ms = 0; ms < 60000 || ring.size() > 0; ms++) {
+        if (ms < 60000 && ms % 40 == 0) {
+            uint8_t len = (uint8_t)(20 + (ms / 40) % 20);
+            frame[0] = len;
+            frame[1] = seq++;
+            for (uint8_t i = 2; i < len; i++) frame[i] = (uint8_t)(frame[1] + i);
+            if (ring.pushBlock(frame, len)) sent++;
+            else rejected++;
+        }
+        if (ms < 60000 && ms % 5000 >= 4700) continue;
+        uint8_t budget = (ms % 2) ? 11 : 12;
+        uint8_t b;
+        while (budget-- > 0 && ring.pop(b)) {
+            current[have++] = b;
+            if (have < 2 || have < current[0]) continue;
+            for (uint8_t i = 2; i < have; i++) whole = whole && current[i] == (uint8_t)(current[1] + i);
+            gaps += (uint8_t)(current[1] - expectedSeq);
+            expectedSeq = (uint8_t)(current[1] + 1);
+            received++;
+            have = 0;
+        }
+    }
+    gaps += (uint8_t)(seq - expectedSeq);
+    bool ok = whole && have == 0 && received == sent && rejected == ring.dropped() && gaps == rejected;
+    printf("IsrRing: tramas de 20-39 bytes a un UART de 115200 baudios parado 300 ms cada 5 s\n");
+    printf("  %u tramas, %u recibidas enteras, %u descartadas (huecos %u)  %s\n", sent + rejected, received,
+           ring.dropped(), gaps, ok ? "OK" : "ERROR");
+    return ok;
+}
+
+int benchRing(int argc, char** argv)
+{
+    uint32_t millions = argc > 0 ? (uint32_t)atoi(argv[0]) : 20;
+    if (millions == 0) millions = 20;
+
+    bool ok = true;
+    // El productor reintenta cuando la cola está llena: mide la transferencia
+    ok &= runCase("Throughput máximo (productor reintenta si está llena)",
+                  millions * 1000000u, 0, 0, 0, true);
+    // 2 kHz (8x la frecuencia de muestreo), consumidor que se para 200 ms
+    // cada 64 bloques: la cola de 256 desborda y el productor no espera
+    ok &= runCase("2 kHz con pausas de 200 ms en el consumidor", 20000, 500, 64, 200000, false);
+    ok &= runIsrSamples();
+    ok &= runIsrFrames();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+/**
+ * @file bench_spectral.cpp
+ * @brief FC espectral (spectral_hr.h): error, respaldo del detector en ECGMonitor y coste repartido
+ *
+ * Uso: program spectral [segundos]
+ *   1. Error de SpectralHeartRate frente a la FC real en ECG sintético de
+ *      40 a 200 lpm, con poco y con bastante ruido, tras la ventana inicial.
+ *   2. ECGMonitor sin cambios sobre el HAL simulado: ritmo limpio y después
+ *      un tramo de 'segundos' en el que la onda R cae a menos de un tercio
+ *      con más ruido (electrodo movido), el detector pierde el
+ *      enganche y la FC sube. Compara la FC mostrada con la real y con la
+ *      del detector congelada (el comportamiento anterior), y cuenta los
+ *      avisos de desacuerdo en el tramo limpio y en el ruidoso.
+ *   3. Coste: ciclos por estimación completa y por llamada a process(),
+ *      cuyo peor caso marca BUDGET.
+ *   Devuelve 1 si con poco ruido el error medio pasa de 2 lpm, si el
+ *   respaldo no mejora a la FC congelada o si hay desacuerdos sin motivo.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <Arduino.h>
+#include "ecg_monitor.h"
+#include "loop_stats.h"
+#include "synth_ecg.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+typedef ECGMonitor::SpectralHR SpectralHR;
+
+static const uint32_t WARMUP = SpectralHR::WARMUP_SAMPLES;
+
+struct AccuracyResult {
+    double meanError;
+    double worstError;
+    uint32_t updates;
+    uint32_t valid;
+};
+
+static AccuracyResult measureAccuracy(float bpm, float noise, uint32_t samples)
+{
+    SynthECGConfig cfg;
+    cfg.bpm = bpm;
+    cfg.rAmplitude = 500.0f;
+    cfg.noiseAmplitude = noise;
+    cfg.wanderAmplitude = 60.0f;
+    SynthECG synth(cfg);
+    ECGFilter filter;
+    filter.reset(2048);
+    SpectralHR* spectral = new SpectralHR();
+
+    AccuracyResult r = {0.0, 0.0, 0, 0};
+    for (uint32_t i = 0; i < samples; i++) {
+        int16_t lp = (int16_t)filter.process(synth.next());
+        if (!spectral->process(lp) || i < WARMUP) continue;
+        r.updates++;
+        if (!spectral->valid()) continue;
+        double e = fabs(spectral->bpm() - bpm);
+        r.valid++;
+        r.meanError += e;
+        if (e > r.worstError) r.worstError = e;
+    }
+    if (r.valid) r.meanError /= r.valid;
+    delete spectral;
+    return r;
+}
+
+static bool checkAccuracy()
+{
+    static const float bpms[] = {40, 60, 72, 100, 120, 150, 180, 200};
+    static const float noises[] = {20, 80};
+    const uint32_t samples = 60 * SAMPLE_RATE_HZ;
+    bool ok = true;
+
+    printf("1. Error de la estimación (60 s, onda R de 500 cuentas)\n");
+    printf("   %-6s %-6s %10s %10s %8s\n", "lpm", "ruido", "error", "peor", "válidas");
+    for (float noise : noises) {
+        for (float bpm : bpms) {
+            AccuracyResult r = measureAccuracy(bpm, noise, samples);
+            printf("   %-6.0f %-6.0f %8.2f   %8.2f   %5lu/%lu\n", bpm, noise, r.meanError, r.worstError,
+                   (unsigned long)r.valid, (unsigned long)r.updates);
+            if (noise <= 20 && (r.valid == 0 || r.meanError > 2.0)) ok = false;
+        }
+    }
+    return ok;
+}
+
+struct FallbackResult {
+    double shownError;    // FC mostrada (detector o espectral) frente a la real
+    double frozenError;   // FC del detector sola, congelada sin latidos
+    uint32_t segmentSamples;
+    uint32_t spectralSamples;
+    uint32_t cleanDisagreements;
+    uint32_t cleanUpdates;
+    uint32_t noisyDisagreements;
+    uint32_t noisyUpdates;
+};
+
+/**
+ * 'clean' segundos a 72 lpm con la onda R de 500 cuentas y después 'noisy'
+ * segundos con la onda R de 150 cuentas y ruido de 70: el detector deja de
+ * dar RR mientras la FC sube a 110 lpm en la primera mitad del tramo.
+ */
+static FallbackResult runFallback(uint32_t clean, uint32_t noisy)
+{
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 500.0f;
+    cfg.noiseAmplitude = 20.0f;
+    cfg.wanderAmplitude = 60.0f;
+    SynthECG synth(cfg);
+
+    ECGMonitor* monitor = new ECGMonitor();
+    mockSetDigital(AD8232Pins::LO_PLUS, LOW);
+    mockSetDigital(AD8232Pins::LO_MINUS, LOW);
+    monitor->begin();
+
+    FallbackResult r = {0.0, 0.0, 0, 0, 0, 0, 0, 0};
+    const uint32_t start = clean * SAMPLE_RATE_HZ;
+    const uint32_t total = (clean + noisy) * SAMPLE_RATE_HZ;
+    uint32_t updates = monitor->getSpectralHR().updates();
+    for (uint32_t i = 0; i < total; i++) {
+        float truth = 72.0f;
+        if (i >= start) {
+            float t = (float)(i - start) / (noisy * SAMPLE_RATE_HZ);
+            truth = 72.0f + 38.0f * (t < 0.5f ? 2.0f * t : 1.0f);
+            synth.setBpm(truth);
+        }
+        if (i == start) {
+            synth.setAmplitude(150.0f);
+            synth.setNoise(70.0f);
+        }
+        int raw = synth.next();
+        mockAdvanceNanos(SAMPLE_INTERVAL_US * 1000ULL);
+        monitor->processSample(raw);
+
+        // Desacuerdos en cada estimación nueva, tras la primera ventana
+        bool newEstimate = monitor->getSpectralHR().updates() != updates;
+        updates = monitor->getSpectralHR().updates();
+        if (newEstimate && i >= WARMUP) {
+            bool disagree = monitor->heartRateDisagreement();
+            if (i < start) {
+                r.cleanUpdates++;
+                r.cleanDisagreements += disagree;
+            } else {
+                r.noisyUpdates++;
+                r.noisyDisagreements += disagree;
+            }
+        }
+        if (i < start) continue;
+        r.segmentSamples++;
+        if (monitor->getHeartRateSource() == HR_SOURCE_SPECTRAL) r.spectralSamples++;
+        r.shownError += fabs(monitor->getBeatInfo().bpm - truth);
+        r.frozenError += fabs(monitor->getHRV().displayHr - truth);
+    }
+    r.shownError /= r.segmentSamples;
+    r.frozenError /= r.segmentSamples;
+    delete monitor;
+    return r;
+}
+
+static void measureCost()
+{
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 500.0f;
+    cfg.noiseAmplitude = 20.0f;
+    SynthECG synth(cfg);
+    ECGFilter filter;
+    filter.reset(2048);
+    const uint32_t samples = 120 * SAMPLE_RATE_HZ;
+    std::vector<int16_t> lp(samples);
+    for (uint32_t i = 0; i < samples; i++) lp[i] = (int16_t)filter.process(synth.next());
+
+    SpectralHR* spectral = new SpectralHR();
+    TimingHistogram perCall, busyCall;
+    uint64_t busyCycles = 0;
+    for (uint32_t i = 0; i < samples; i++) {
+        bool busy = spectral->busy();
+        uint64_t c0 = BenchTimer::cycles();
+        bool done = spectral->process(lp[i]);
+        uint32_t c = (uint32_t)(BenchTimer::cycles() - c0);
+        benchKeep(done);
+        perCall.add(c);
+        if (busy || done || spectral->busy()) {
+            busyCall.add(c);
+            busyCycles += c;
+        }
+    }
+    uint32_t updates = spectral->updates();
+    delete spectral;
+
+    printf("3. Coste (ciclos del host): %lu estimaciones, %.0f ciclos por estimación repartidos en %.0f llamadas\n",
+           (unsigned long)updates, updates ? (double)busyCycles / updates : 0.0,
+           updates ? (double)busyCall.count() / updates : 0.0);
+    // El máximo recoge también las interrupciones del host; el peor caso
+    // real es el de p99.9 con cálculo pendiente
+    printf("   process(): media %.1f, p99 <= %lu, máx %lu ciclos; con cálculo pendiente media %.1f, p99.9 <= %lu\n",
+           perCall.mean(), (unsigned long)perCall.percentile(990), (unsigned long)perCall.maxValue(),
+           busyCall.mean(), (unsigned long)busyCall.percentile(999));
+    printf("   %u bytes por estimador, BUDGET = %u pasos por muestra\n", (unsigned)sizeof(SpectralHR),
+           (unsigned)SpectralHR::BUDGET);
+}
+
+int benchSpectral(int argc, char** argv)
+{
+    uint32_t seconds = argc > 0 ? (uint32_t)atoi(argv[0]) : 40;
+    if (seconds < 10) seconds = 10;
+
+    bool ok = checkAccuracy();
+
+    FallbackResult f = runFallback(40, seconds);
+    printf("2. Respaldo en ECGMonitor: %lu s con la onda R a 150 cuentas, ruido de 70 y la FC de 72 a 110 lpm\n",
+           (unsigned long)seconds);
+    printf("   FC espectral el %.0f %% del tramo; error medio %.1f lpm (detector congelado: %.1f lpm)\n",
+           100.0 * f.spectralSamples / f.segmentSamples, f.shownError, f.frozenError);
+    printf("   desacuerdos detector/espectral: %lu de %lu estimaciones en limpio, %lu de %lu en el tramo\n",
+           (unsigned long)f.cleanDisagreements, (unsigned long)f.cleanUpdates,
+           (unsigned long)f.noisyDisagreements, (unsigned long)f.noisyUpdates);
+    if (f.spectralSamples == 0 || f.shownError >= f.frozenError || f.cleanDisagreements > 0) ok = false;
+
+    measureCost();
+
+    printf("%s\n", ok ? "OK" : "FALLO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file bench_stream.cpp
+ * @brief Ancho de banda y coste del protocolo binario frente al CSV por muestra
+ *
+ * Uso: program stream [salida.bin]
+ *   Compara también con el texto de depuración que enviaba el UNO
+ *   ("raw: hp: lp: bpm:"). El binario incluye la trama de estado de cada
+ *   segundo. Con fichero de salida se vuelcan las tramas para comprobar el
+ *   decodificador de Python (tools/ecg_protocol.py).
+ */
+
+#include <stdio.h>
+#include <vector>
+#include "ecg_dsp.h"
+#include "ecg_stream.h"
+#include "synth_ecg.h"
+#include "bench_timer.h"
+#include "native_commands.h"
+
+int benchStream(int argc, char** argv)
+{
+    const int seconds = 60;
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 600.0f;
+    cfg.noiseAmplitude = 15.0f;
+    SynthECG synth(cfg);
+
+    std::vector<int16_t> filtered((size_t)seconds * 250);
+    ECGFilter filter;
+    filter.reset(synth.next());
+    for (size_t i = 0; i < filtered.size(); i++) filtered[i] = (int16_t)filter.process(synth.next());
+
+    // CSV original
+    BenchTimer timer;
+    size_t csvBytes = 0;
+    char line[50];
+    timer.start();
+    for (size_t i = 0; i < filtered.size(); i++) {
+        int len = snprintf(line, sizeof(line), "%.2f,%d,%d\r\n", (float)filtered[i], 72, 1);
+        csvBytes += (size_t)len;
+    }
+    timer.stop();
+    double csvNs = timer.elapsedNs() / filtered.size();
+
+    // Texto del UNO: crudo, paso-alto, filtrado y bpm en cada muestra
+    size_t unoBytes = 0;
+    for (size_t i = 0; i < filtered.size(); i++) {
+        int len = snprintf(line, sizeof(line), "raw:%d hp:%d lp:%d bpm:%d\r\n", filtered[i] + 512,
+                           filtered[i], filtered[i], 72);
+        unoBytes += (size_t)len;
+    }
+
+    // Tramas binarias
+    FILE* out = argc > 0 ? fopen(argv[0], "wb") : nullptr;
+    ECGStreamEncoder encoder;
+    size_t binBytes = 0;
+    size_t frames = 0;
+    timer.start();
+    for (size_t i = 0; i < filtered.size(); i++) {
+        if (encoder.push(filtered[i], 72.0f, true, false)) {
+            binBytes += encoder.size();
+            frames++;
+            if (out) fwrite(encoder.data(), 1, encoder.size(), out);
+        }
+        if ((i + 1) % 250 == 0) {
+            encoder.encodeStatus(0, 0, 100);
+            binBytes += encoder.size();
+            if (out) fwrite(encoder.data(), 1, encoder.size(), out);
+        }
+    }
+    timer.stop();
+    double binNs = timer.elapsedNs() / filtered.size();
+    if (out) fclose(out);
+
+    printf("%zu muestras, %u muestras por trama\n", filtered.size(), STREAM_FRAME_SAMPLES);
+    printf("  Texto UNO: %6.2f bytes/muestra\n", (double)unoBytes / filtered.size());
+    printf("  CSV     : %6.2f bytes/muestra  %7.1f ns/muestra\n", (double)csvBytes / filtered.size(), csvNs);
+    printf("  Binario : %6.2f bytes/muestra  %7.1f ns/muestra  (%zu tramas)\n",
+           (double)binBytes / filtered.size(), binNs, frames);
+    printf("  Reducción de ancho de banda: %.1fx\n", (double)csvBytes / binBytes);
+
+    // 115200 baudios 8N1 = 11520 bytes/s
+    printf("  Frecuencia máxima a 115200 baudios: texto UNO %.0f Hz, CSV %.0f Hz, binario %.0f Hz\n",
+           11520.0 * filtered.size() / unoBytes, 11520.0 * filtered.size() / csvBytes,
+           11520.0 * filtered.size() / binBytes);
+    return 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file bench_timer.h
+ * @brief Medición de tiempo para los benchmarks del host (ns y ciclos)
+ */
+
+#ifndef BENCH_TIMER_H
+#define BENCH_TIMER_H
+
+#include <stdint.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#else
+#define BENCH_HAS_TSC 0
+#endif
+
+class BenchTimer {
+public:
+    void start() {
+        t0 = std::chrono::steady_clock::now();
+        c0 = cycles();
+    }
+
+    void stop() {
+        c1 = cycles();
+        t1 = std::chrono::steady_clock::now();
+    }
+
+    double elapsedNs() const {
+        return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    }
+
+    // Ciclos del TSC (0 si la plataforma no lo tiene)
+    uint64_t elapsedCycles() const { return c1 - c0; }
+
+    static uint64_t cycles() {
+#if BENCH_HAS_TSC
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+private:
+    std::chrono::steady_clock::time_point t0, t1;
+    uint64_t c0 = 0, c1 = 0;
+};
+
+// Evita que el compilador elimine un resultado que no se usa
+template <typename T>
+inline void benchKeep(const T& value) {
+    asm volatile("" : : "g"(value) : "memory");
+}
+
+#endif // BENCH_TIMER_H
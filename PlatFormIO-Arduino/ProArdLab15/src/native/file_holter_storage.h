@@ -0,0 +1,160 @@
+/**
+ * @file file_holter_storage.h
+ * @brief HolterStorage sobre un directorio del host (sustituto de la flash)
+ *
+ * Cada segmento es un fichero <id>.seg. La capacidad se limita como la de
+ * la partición de LittleFS, redondeando cada fichero a bloques de 4 KB, para
+ * que el grabador tenga que borrar segmentos antiguos igual que en el ESP32.
+ * Como LittleFS, lo añadido al segmento abierto no llega al fichero hasta
+ * sync() o closeSegment(): abandonSegment() simula un corte de alimentación
+ * y lo pierde. Cuenta lecturas, escrituras y sincronizaciones para los
+ * benchmarks.
+ */
+
+#ifndef FILE_HOLTER_STORAGE_H
+#define FILE_HOLTER_STORAGE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "holter_storage.h"
+
+class FileHolterStorage : public HolterStorage {
+public:
+    static const uint32_t BLOCK_SIZE = 4096;
+
+    // capacityBytes = 0: sin límite (para leer un volcado de la flash)
+    explicit FileHolterStorage(const std::string& dir, uint32_t capacityBytes = 0)
+        : dir(dir), capacity(capacityBytes), file(nullptr), openId(0), openSize(0) {}
+
+    ~FileHolterStorage() { closeSegment(); }
+
+    bool begin() override {
+        mkdir(dir.c_str(), 0755);
+        struct stat st;
+        return stat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+
+    size_t listSegments(uint32_t* ids, size_t maxIds) override {
+        std::vector<uint32_t> found = scan();
+        size_t n = std::min(found.size(), maxIds);
+        std::copy(found.begin(), found.begin() + n, ids);
+        return n;
+    }
+
+    bool createSegment(uint32_t id) override {
+        closeSegment();
+        file = fopen(path(id).c_str(), "wb");
+        openId = id;
+        openSize = 0;
+        return file != nullptr;
+    }
+
+    size_t append(const uint8_t* data, size_t len) override {
+        if (!file) return 0;
+        if (capacity) {
+            // Solo cabe lo que no obliga a ocupar un bloque más que el libre
+            uint64_t used = usedBytes();
+            uint64_t fileBlocks = roundUp(openSize);
+            uint64_t room = capacity > used ? capacity - used : 0;
+            uint64_t maxSize = fileBlocks + room - (room % BLOCK_SIZE);
+            if (openSize + len > maxSize) len = maxSize > openSize ? (size_t)(maxSize - openSize) : 0;
+        }
+        unsynced.insert(unsynced.end(), data, data + len);
+        openSize += len;
+        appends++;
+        bytesAppended += len;
+        return len;
+    }
+
+    void sync() override {
+        if (!file || unsynced.empty()) return;
+        fwrite(unsynced.data(), 1, unsynced.size(), file);
+        fflush(file);
+        unsynced.clear();
+        syncs++;
+    }
+
+    void closeSegment() override {
+        sync();
+        abandonSegment();
+    }
+
+    // Corte de alimentación: cierra el segmento sin guardar lo no sincronizado
+    void abandonSegment() {
+        if (file) fclose(file);
+        file = nullptr;
+        unsynced.clear();
+    }
+
+    uint32_t segmentSize(uint32_t id) override {
+        struct stat st;
+        return stat(path(id).c_str(), &st) == 0 ? (uint32_t)st.st_size : 0;
+    }
+
+    size_t readSegment(uint32_t id, uint32_t offset, uint8_t* out, size_t len) override {
+        reads++;
+        FILE* f = fopen(path(id).c_str(), "rb");
+        if (!f) return 0;
+        size_t n = fseek(f, offset, SEEK_SET) == 0 ? fread(out, 1, len, f) : 0;
+        fclose(f);
+        return n;
+    }
+
+    bool removeSegment(uint32_t id) override { return unlink(path(id).c_str()) == 0; }
+
+    uint32_t freeBytes() override {
+        if (!capacity) return 0xFFFFFFFFUL;
+        uint64_t used = usedBytes();
+        return used < capacity ? (uint32_t)(capacity - used) : 0;
+    }
+
+    // Ocupación en bloques de 4 KB de todos los segmentos
+    uint64_t usedBytes() {
+        uint64_t used = 0;
+        for (uint32_t id : scan()) used += roundUp(file && id == openId ? openSize : segmentSize(id));
+        return used;
+    }
+
+    uint32_t reads = 0;
+    uint32_t appends = 0;
+    uint64_t bytesAppended = 0;
+    uint32_t syncs = 0;
+
+private:
+    std::string dir;
+    uint64_t capacity;
+    FILE* file;
+    uint32_t openId;
+    uint64_t openSize;           // incluye lo no sincronizado
+    std::vector<uint8_t> unsynced;
+
+    static uint64_t roundUp(uint64_t size) { return (size + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE; }
+
+    std::string path(uint32_t id) const {
+        char name[24];
+        snprintf(name, sizeof(name), "/%08u.seg", id);
+        return dir + name;
+    }
+
+    std::vector<uint32_t> scan() const {
+        std::vector<uint32_t> ids;
+        DIR* d = opendir(dir.c_str());
+        if (!d) return ids;
+        while (struct dirent* e = readdir(d)) {
+            char* end;
+            unsigned long id = strtoul(e->d_name, &end, 10);
+            if (end != e->d_name && strcmp(end, ".seg") == 0) ids.push_back((uint32_t)id);
+        }
+        closedir(d);
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+};
+
+#endif // FILE_HOLTER_STORAGE_H
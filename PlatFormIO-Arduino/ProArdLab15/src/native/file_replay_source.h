@@ -0,0 +1,55 @@
+/**
+ * @file file_replay_source.h
+ * @brief SampleSource que reproduce una grabación (formato de recorded_stream.h)
+ *
+ * Sustituye al AD8232 en el host: entrega los bloques que pida el consumidor
+ * hasta agotar el fichero (o en bucle si loop = true).
+ */
+
+#ifndef FILE_REPLAY_SOURCE_H
+#define FILE_REPLAY_SOURCE_H
+
+#include "sample_source.h"
+#include "recorded_stream.h"
+
+class FileReplaySource : public SampleSource {
+public:
+    explicit FileReplaySource(const char* path, bool loop = false)
+        : path(path), loop(loop), position(0) {}
+
+    // Alternativa sin fichero: reproduce una señal ya cargada o sintetizada
+    explicit FileReplaySource(const RecordedStream& recorded, bool loop = false)
+        : path(nullptr), loop(loop), stream(recorded), position(0) {}
+
+    bool begin() override {
+        position = 0;
+        if (path) {
+            stream = RecordedStream();
+            if (!loadRecordedStream(path, stream)) return false;
+        }
+        return !stream.samples.empty();
+    }
+
+    size_t read(int16_t* out, size_t maxCount) override {
+        size_t count = 0;
+        while (count < maxCount) {
+            if (position == stream.samples.size()) {
+                if (!loop) break;
+                position = 0;
+            }
+            out[count++] = (int16_t)stream.samples[position++];
+        }
+        return count;
+    }
+
+    bool finished() const { return !loop && position == stream.samples.size(); }
+    const RecordedStream& recording() const { return stream; }
+
+private:
+    const char* path;
+    bool loop;
+    RecordedStream stream;
+    size_t position;
+};
+
+#endif // FILE_REPLAY_SOURCE_H
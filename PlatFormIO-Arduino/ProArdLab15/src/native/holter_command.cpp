@@ -0,0 +1,248 @@
+/**
+ * @file holter_command.cpp
+ * @brief Registro Holter en el host: ida y vuelta sobre flash simulada y volcado
+ *
+ * Uso:
+ *   program holter [minutos] [capacidad_kB]
+ *     Graba una señal sintética con HolterRecorder en un directorio temporal
+ *     (FileHolterStorage con la capacidad indicada, 256 kB por defecto para
+ *     forzar el borrado de segmentos antiguos), la relee con HolterReader y
+ *     comprueba que las muestras coinciden bit a bit, las búsquedas por
+ *     índice y la recuperación de un segmento sin índice (corte de
+ *     alimentación). Informa de la compresión y del ritmo de escritura.
+ *   program holter dump <directorio> [salida.csv]
+ *     Convierte los segmentos copiados de la flash al formato de
+ *     recorded_stream.h (se puede pasar después a "replay").
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <random>
+#include "holter_log.h"
+#include "synth_ecg.h"
+#include "bench_timer.h"
+#include "file_holter_storage.h"
+#include "native_commands.h"
+
+static const uint16_t RATE_HZ = 250;
+
+// Señal de prueba: ECG con ruido, deriva y zumbido, y 5 s de electrodos sueltos
+static void makeSignal(uint32_t seconds, uint32_t seed, std::vector<int16_t>& samples,
+                       std::vector<bool>& leadsOff)
+{
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 600.0f;
+    cfg.noiseAmplitude = 8.0f;
+    cfg.wanderAmplitude = 40.0f;
+    cfg.humAmplitude = 15.0f;
+    cfg.seed = seed;
+    SynthECG synth(cfg);
+    const uint32_t total = seconds * RATE_HZ;
+    const uint32_t offStart = total * 2 / 5;
+    const uint32_t offEnd = offStart + 5 * RATE_HZ;
+    for (uint32_t i = 0; i < total; i++) {
+        int v = synth.next();
+        bool off = i >= offStart && i < offEnd;
+        samples.push_back((int16_t)(off ? ((i / 7) % 2 ? 4095 : 0) : v));
+        leadsOff.push_back(off);
+    }
+}
+
+struct RecordStats {
+    size_t maxBytesPerCall = 0;
+    uint32_t writeCalls = 0;
+    double encodeNsPerSample = 0.0;
+};
+
+// Graba como loop(): push por muestra y service() cada 4 ms
+static RecordStats record(HolterRecorder& recorder, const std::vector<int16_t>& samples,
+                          const std::vector<bool>& leadsOff, uint32_t startMs)
+{
+    RecordStats st;
+    BenchTimer timer;
+    double pushNs = 0.0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        timer.start();
+        recorder.push(samples[i], leadsOff[i]);
+        timer.stop();
+        pushNs += timer.elapsedNs();
+        size_t n = recorder.service(startMs + (uint32_t)(i * 1000 / RATE_HZ));
+        if (n > 0) {
+            st.writeCalls++;
+            if (n > st.maxBytesPerCall) st.maxBytesPerCall = n;
+        }
+    }
+    st.encodeNsPerSample = pushNs / samples.size();
+    return st;
+}
+
+// Lee todo desde la primera muestra y lo compara con la señal original
+static bool verifyAll(HolterReader& reader, const std::vector<int16_t>& reference,
+                      uint32_t referenceStart, uint32_t& first, uint32_t& end, uint32_t& gaps)
+{
+    bool ok = reader.open();
+    first = reader.firstSample();
+    end = reader.endSample();
+    ok &= reader.seek(first);
+    gaps = 0;
+    int16_t buffer[300];
+    uint32_t expected = first;
+    size_t n;
+    while ((n = reader.read(buffer, 300)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            uint32_t index = expected + (uint32_t)i;
+            if (index < referenceStart || index - referenceStart >= reference.size() ||
+                buffer[i] != reference[index - referenceStart]) {
+                ok = false;
+            }
+        }
+        expected += (uint32_t)n;
+        if (reader.position() != expected) {
+            gaps++;
+            expected = reader.position();
+        }
+    }
+    return ok && expected == end;
+}
+
+static int holterDump(int argc, char** argv)
+{
+    if (argc < 1) {
+        fprintf(stderr, "Uso: holter dump <directorio> [salida.csv]\n");
+        return 1;
+    }
+    FileHolterStorage storage(argv[0]);
+    HolterReader reader(storage);
+    if (!reader.open()) {
+        fprintf(stderr, "No hay segmentos en %s\n", argv[0]);
+        return 1;
+    }
+    FILE* out = argc > 1 ? fopen(argv[1], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "No se puede crear %s\n", argv[1]);
+        return 1;
+    }
+
+    const uint32_t first = reader.firstSample();
+    fprintf(out, "# holter: %zu segmentos, muestras %u..%u a %u Hz\n", reader.getSegmentCount(),
+            first, reader.endSample(), RATE_HZ);
+    reader.seek(first);
+    int16_t buffer[256];
+    uint32_t position = reader.position();
+    size_t n;
+    while ((n = reader.read(buffer, 256)) > 0) {
+        for (size_t i = 0; i < n; i++) fprintf(out, "%d\n", buffer[i]);
+        position += (uint32_t)n;
+        if (reader.position() != position) {
+            fprintf(out, "# hueco de %u muestras\n", reader.position() - position);
+            position = reader.position();
+        }
+    }
+    if (out != stdout) fclose(out);
+    if (reader.getCrcErrors()) fprintf(stderr, "Bloques con CRC erróneo: %u\n", reader.getCrcErrors());
+    return 0;
+}
+
+int holterLog(int argc, char** argv)
+{
+    if (argc > 0 && strcmp(argv[0], "dump") == 0) return holterDump(argc - 1, argv + 1);
+
+    const uint32_t minutes = argc > 0 && atoi(argv[0]) > 0 ? atoi(argv[0]) : 30;
+    const uint32_t capacityKb = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 256;
+    char dirTemplate[] = "/tmp/holterXXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const std::string dir = dirTemplate;
+    bool ok = true;
+
+    // 1. Sesión completa con cierre ordenado
+    std::vector<int16_t> signal;
+    std::vector<bool> leadsOff;
+    makeSignal(minutes * 60, 12345, signal, leadsOff);
+
+    FileHolterStorage storage(dir, capacityKb * 1024);
+    HolterRecorder recorder(storage, RATE_HZ);
+    if (!recorder.begin()) {
+        fprintf(stderr, "No se puede usar %s\n", dir.c_str());
+        return 1;
+    }
+    RecordStats st = record(recorder, signal, leadsOff, 0);
+    recorder.stop();
+
+    HolterReader reader(storage);
+    uint32_t first, end, gaps;
+    bool same = verifyAll(reader, signal, 0, first, end, gaps);
+    ok &= same && end == signal.size() && recorder.getDroppedBlocks() == 0;
+
+    const uint32_t kept = end - first;
+    const uint64_t used = storage.usedBytes();
+    const double bitsPerSample = 8.0 * recorder.getBytesWritten() / recorder.getSamplesRecorded();
+    printf("Sesión de %u min a %u Hz (%u muestras), flash de %u kB\n", minutes, RATE_HZ,
+           (unsigned)signal.size(), capacityKb);
+    printf("  Compresión: %.2f bits/muestra con cabeceras e índices (x%.1f frente a int16, x%.1f frente a 12 bits)\n",
+           bitsPerSample, 16.0 / bitsPerSample, 12.0 / bitsPerSample);
+    printf("  Escritura: %.0f B/s de media, como mucho %zu B por llamada a service() (%u llamadas con escritura)\n",
+           recorder.getBytesWritten() / (minutes * 60.0), st.maxBytesPerCall, st.writeCalls);
+    printf("  Codificación: %.1f ns/muestra en el host; bloques descartados: %u\n", st.encodeNsPerSample,
+           recorder.getDroppedBlocks());
+    printf("  En flash: %zu segmentos, %.1f kB, muestras %u..%u (%.1f min, los más antiguos se borraron)\n",
+           reader.getSegmentCount(), used / 1024.0, first, end, kept / (60.0 * RATE_HZ));
+    printf("  Relectura completa: %s, huecos %u\n", same ? "idéntica" : "DISTINTA", gaps);
+
+    // 2. Búsqueda aleatoria por índice
+    std::mt19937 rng(7);
+    const int seeks = 2000;
+    int seekErrors = 0;
+    uint32_t maxReads = 0;
+    uint64_t totalReads = 0;
+    for (int i = 0; i < seeks; i++) {
+        uint32_t target = first + rng() % kept;
+        uint32_t before = storage.reads;
+        int16_t value;
+        if (!reader.seek(target) || reader.position() != target || reader.read(&value, 1) != 1 ||
+            value != signal[target]) {
+            seekErrors++;
+        }
+        uint32_t reads = storage.reads - before;
+        totalReads += reads;
+        if (reads > maxReads) maxReads = reads;
+    }
+    ok &= seekErrors == 0;
+    printf("  %d búsquedas aleatorias: %d errores, %.1f lecturas de flash de media (máx. %u)\n", seeks,
+           seekErrors, (double)totalReads / seeks, maxReads);
+
+    // 3. Segunda sesión cortada sin stop(): el último segmento queda sin índice
+    std::vector<int16_t> signal2;
+    std::vector<bool> leadsOff2;
+    makeSignal(151, 999, signal2, leadsOff2);
+    signal2.resize(signal2.size() - HOLTER_BLOCK_SAMPLES / 2); // corte a mitad de bloque
+    {
+        HolterRecorder second(storage, RATE_HZ);
+        second.begin();
+        ok &= second.nextSampleIndex() == end;
+        record(second, signal2, leadsOff2, 0);
+        // Sin stop(): se pierden el bloque en curso, la cola en RAM y lo
+        // escrito sin sincronizar
+    }
+    storage.abandonSegment();
+
+    HolterReader after(storage);
+    uint32_t first2, end2, gaps2;
+    std::vector<int16_t> both(signal.begin(), signal.end());
+    both.insert(both.end(), signal2.begin(), signal2.end());
+    bool same2 = verifyAll(after, both, 0, first2, end2, gaps2);
+    const uint32_t lost = (uint32_t)both.size() - end2;
+    ok &= same2 && after.getUnindexedSegments() > 0 && end2 > end && lost <= 5 * HOLTER_BLOCK_SAMPLES;
+    printf("  Corte sin cierre: %u segmento(s) sin índice recuperado(s), %s, %u muestras perdidas (%.1f s)\n",
+           after.getUnindexedSegments(), same2 ? "datos correctos" : "DATOS DISTINTOS", lost,
+           (double)lost / RATE_HZ);
+
+    printf("Segmentos en %s\n", dir.c_str());
+    printf("Resultado: %s\n", ok ? "correcto" : "ERROR");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,555 @@
+/**
+ * @file ingest_command.cpp
+ * @brief Demonio de ingesta: puerto serie del ESP32 -> anillo en memoria compartida
+ *
+ * Uso: program ingest <puerto> [baudios] [/nombre_shm] [csv]
+ *      program ingest bench [segundos] [muestras/s]
+ *
+ * Sustituye al hilo de lectura de tools/model.py (pyserial con sondeo de
+ * 1 ms): un solo hilo bloqueado en epoll sobre el puerto, decodificación
+ * sin reservas de memoria (stream_decoder.h) y publicación de las muestras
+ * en /dev/shm (shm_ring.h), que la vista mapea con tools/shm_ring.py.
+ * Si el puerto desaparece (USB desconectado) se reintenta cada segundo.
+ *
+ * 'bench' ejecuta el mismo bucle sobre un pseudoterminal al que otro hilo
+ * escribe tramas de ecg_stream.h: a ritmo fijo (CPU por muestra en
+ * régimen) y sin pausa (caudal máximo), en binario y en CSV, y comprueba
+ * que el anillo contiene exactamente lo enviado y que la cabecera refleja
+ * las tramas de estado y de respiración.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include "ecg_dsp.h"
+#include "ecg_stream.h"
+#include "stream_decoder.h"
+#include "shm_ring.h"
+#include "serial_port.h"
+#include "synth_ecg.h"
+#include "native_commands.h"
+
+static const uint32_t STREAM_RATE_HZ = 250;
+static const size_t READ_CHUNK = 4096;
+
+static uint16_t toX10(float v) {
+    float x = v * 10.0f + 0.5f;
+    return x <= 0.0f ? 0 : (x >= 65535.0f ? 0xFFFF : (uint16_t)x);
+}
+
+// Decodifica lo leído del puerto y lo publica en el anillo
+class IngestSink {
+public:
+    IngestSink(ShmRingWriter& ring, ECGStreamDecoder::Mode mode)
+        : ring(ring), decoder(mode), bpmX10(0), leads(0), hrvValid(0), hrvFrames(0),
+          respValid(0), respFrames(0) {
+        memset(&hrv, 0, sizeof(hrv));
+    }
+
+    void onData(const uint8_t* data, size_t n) {
+        decoder.feed(data, n,
+            [this](const DecodedSamples& f) {
+                checkRespiration(); // una trama de respiración anterior a esta cuenta antes
+                bpmX10 = toX10(f.bpm);
+                leads = f.leadsConnected;
+                if (!f.leadsConnected) {
+                    // igual que el modelo: sin electrodos no hay HRV, respiración ni trazado
+                    hrvValid = 0;
+                    respValid = 0;
+                    return;
+                }
+                ring.push(f.samples, f.count);
+            },
+            [this](const DecodedHrv& h) {
+                hrv = h;
+                hrvValid = 1;
+                hrvFrames++;
+            });
+        checkRespiration();
+        ring.commit();
+        publishStatus();
+    }
+
+    // Enlace caído: la vista deja de mostrar datos como válidos
+    void linkDown() {
+        leads = 0;
+        hrvValid = 0;
+        respValid = 0;
+        publishStatus();
+    }
+
+    const ECGStreamDecoder& getDecoder() const { return decoder; }
+
+private:
+    ShmRingWriter& ring;
+    ECGStreamDecoder decoder;
+    uint16_t bpmX10;
+    uint8_t leads;
+    uint8_t hrvValid;
+    uint32_t hrvFrames;
+    DecodedHrv hrv;
+    uint8_t respValid;
+    uint32_t respFrames;   // tramas de respiración del decodificador ya vistas
+
+    void checkRespiration() {
+        if (decoder.getRespirationFrames() == respFrames) return;
+        respFrames = decoder.getRespirationFrames();
+        respValid = 1;
+    }
+
+    void publishStatus() {
+        DecodedRespiration resp;
+        decoder.getRespiration(resp);
+        DecodedStatus device;
+        bool statusValid = decoder.getDeviceStatus(device);
+        ring.updateStatus([&](ShmRingHeader& h) {
+            h.bpmX10 = bpmX10;
+            h.leads = leads;
+            h.hrvValid = hrvValid;
+            h.framesOk = decoder.getFramesOk();
+            h.crcErrors = decoder.getCrcErrors();
+            h.droppedFrames = decoder.getDroppedFrames();
+            h.hrvHrX10 = toX10(hrv.heartRate);
+            h.sdnnX10 = toX10(hrv.sdnnMs);
+            h.rmssdX10 = toX10(hrv.rmssdMs);
+            h.pnn50X10 = toX10(hrv.pnn50);
+            h.hrvBeats = hrv.beats;
+            h.hrvRejected = hrv.rejected;
+            h.hrvFrames = hrvFrames;
+            h.respRateX10 = toX10(resp.rate);
+            h.respSource = resp.source;
+            h.respRegularity = resp.regularity;
+            h.respValid = respValid;
+            h.statusValid = statusValid;
+            h.quality = device.quality;
+            h.adcOverruns = device.adcOverruns;
+            h.txDropped = device.txDropped;
+            h.statusFrames = decoder.getStatusFrames();
+        });
+    }
+};
+
+enum LoopResult { LOOP_STOP, LOOP_HANGUP };
+
+/**
+ * Bucle de ingesta: bloquea en epoll hasta que hay datos en 'serialFd',
+ * lee todo lo disponible y lo publica. Termina cuando 'stopFd' es legible
+ * (señal o eventfd) o el puerto se cierra. 'onTimer' se llama cada vez que
+ * vence 'timerFd' (-1 si no hay temporizador).
+ */
+template <typename OnTimer>
+static LoopResult ingestLoop(int serialFd, int stopFd, int timerFd, IngestSink& sink, OnTimer&& onTimer)
+{
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = serialFd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, serialFd, &ev);
+    ev.data.fd = stopFd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, stopFd, &ev);
+    if (timerFd >= 0) {
+        ev.data.fd = timerFd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, timerFd, &ev);
+    }
+
+    uint8_t buf[READ_CHUNK];
+    LoopResult result = LOOP_STOP;
+    bool running = true;
+    while (running) {
+        struct epoll_event events[3];
+        int n = epoll_wait(ep, events, 3, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        bool stop = false;
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == serialFd) {
+                for (;;) {
+                    ssize_t got = read(serialFd, buf, sizeof(buf));
+                    if (got > 0) {
+                        sink.onData(buf, (size_t)got);
+                        if ((size_t)got < sizeof(buf)) break;
+                    } else if (got < 0 && errno == EAGAIN) {
+                        break;
+                    } else if (got < 0 && errno == EINTR) {
+                        continue;
+                    } else {
+                        result = LOOP_HANGUP; // EOF o EIO: puerto desconectado
+                        running = false;
+                        break;
+                    }
+                }
+            } else if (fd == timerFd) {
+                uint64_t expirations;
+                if (read(timerFd, &expirations, sizeof(expirations)) > 0) onTimer();
+            } else if (fd == stopFd) {
+                stop = true;
+            }
+        }
+        // Se atienden los datos ya recibidos antes de parar
+        if (stop) running = false;
+    }
+    close(ep);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Demonio
+
+static int runDaemon(const char* port, unsigned long baud, const char* shmName, ECGStreamDecoder::Mode mode)
+{
+    if (baud && !serialBaudConstant(baud)) {
+        fprintf(stderr, "Velocidad no soportada: %lu\n", baud);
+        return 1;
+    }
+
+    ShmRingWriter ring;
+    if (!ring.create(shmName, SHM_RING_DEFAULT_CAPACITY, STREAM_RATE_HZ)) {
+        fprintf(stderr, "No se pudo crear la memoria compartida %s: %s\n", shmName, strerror(errno));
+        return 1;
+    }
+    IngestSink sink(ring, mode);
+
+    // SIGINT/SIGTERM por signalfd: salen del epoll como un evento más
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    int sigFd = signalfd(-1, &mask, SFD_CLOEXEC);
+
+    int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    struct itimerspec period;
+    memset(&period, 0, sizeof(period));
+    period.it_value.tv_sec = 5;
+    period.it_interval.tv_sec = 5;
+    timerfd_settime(timerFd, 0, &period, nullptr);
+
+    printf("Ingesta de %s (%s, %lu baudios) en /dev/shm%s, %u muestras\n",
+           port, mode == ECGStreamDecoder::BINARY ? "binario" : "CSV", baud, shmName, ring.capacity());
+    fflush(stdout);
+
+    uint64_t lastWritten = 0;
+    auto report = [&]() {
+        uint64_t w = ring.written();
+        const ECGStreamDecoder& d = sink.getDecoder();
+        fprintf(stderr, "%.1f muestras/s, tramas %u, CRC %u, perdidas %u",
+                (w - lastWritten) / 5.0, d.getFramesOk(), d.getCrcErrors(), d.getDroppedFrames());
+        DecodedStatus device;
+        if (d.getDeviceStatus(device)) {
+            fprintf(stderr, ", en el equipo: ADC %u, envío %u", device.adcOverruns, device.txDropped);
+            if (device.quality <= 100) fprintf(stderr, ", calidad %u", device.quality);
+        }
+        fprintf(stderr, "\n");
+        lastWritten = w;
+    };
+
+    bool warned = false;
+    for (;;) {
+        int fd = serialOpen(port, baud);
+        if (fd >= 0) {
+            warned = false;
+            LoopResult r = ingestLoop(fd, sigFd, timerFd, sink, report);
+            close(fd);
+            if (r == LOOP_STOP) break;
+            fprintf(stderr, "%s desconectado, reintentando\n", port);
+            sink.linkDown();
+        } else if (!warned) {
+            fprintf(stderr, "No se pudo abrir %s: %s (reintentando cada segundo)\n", port, strerror(errno));
+            warned = true;
+        }
+        // Espera de 1 s interrumpible por la señal
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        int ep = epoll_create1(EPOLL_CLOEXEC);
+        ev.events = EPOLLIN;
+        ev.data.fd = sigFd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, sigFd, &ev);
+        int n = epoll_wait(ep, &ev, 1, 1000);
+        close(ep);
+        if (n > 0) break;
+    }
+
+    close(timerFd);
+    close(sigFd);
+    ring.close();
+    printf("Ingesta detenida\n");
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark sobre un pseudoterminal
+
+struct BenchStream {
+    std::vector<uint8_t> bytes;
+    std::vector<size_t> frameEnds;    // fin de cada trama en 'bytes'
+    std::vector<size_t> frameSamples; // muestras enviadas al terminar esa trama
+    std::vector<int16_t> samples;
+    uint32_t statusFrames = 0;      // tramas de estado y de respiración enviadas
+    uint32_t respirationFrames = 0;
+};
+
+static BenchStream makeBinaryStream(size_t count)
+{
+    SynthECGConfig cfg;
+    cfg.rAmplitude = 600.0f;
+    cfg.noiseAmplitude = 15.0f;
+    SynthECG synth(cfg);
+    ECGFilter filter;
+    filter.reset(synth.next());
+
+    BenchStream s;
+    ECGStreamEncoder encoder;
+    HRVMetrics hrv;
+    memset(&hrv, 0, sizeof(hrv));
+    RespirationEstimate resp = {15.0f, RESP_SOURCE_AMPLITUDE, 80};
+    for (size_t i = 0; i < count; i++) {
+        int16_t v = (int16_t)filter.process(synth.next());
+        s.samples.push_back(v);
+        if (encoder.push(v, 72.0f, true, false)) {
+            s.bytes.insert(s.bytes.end(), encoder.data(), encoder.data() + encoder.size());
+            s.frameEnds.push_back(s.bytes.size());
+            s.frameSamples.push_back(i + 1);
+        }
+        if (i % STREAM_RATE_HZ == STREAM_RATE_HZ - 1) { // ~una trama de HRV por latido
+            hrv.displayHr = 72.0f;
+            hrv.sdnnMs = 42.0f;
+            hrv.rmssdMs = 31.5f;
+            hrv.beats = (uint16_t)(i / STREAM_RATE_HZ);
+            encoder.encodeHrv(hrv);
+            s.bytes.insert(s.bytes.end(), encoder.data(), encoder.data() + encoder.size());
+            encoder.encodeStatus(0, 0, 90);
+            s.bytes.insert(s.bytes.end(), encoder.data(), encoder.data() + encoder.size());
+            encoder.encodeRespiration(resp);
+            s.bytes.insert(s.bytes.end(), encoder.data(), encoder.data() + encoder.size());
+            s.frameEnds.push_back(s.bytes.size());
+            s.frameSamples.push_back(i + 1);
+            s.statusFrames++;
+            s.respirationFrames++;
+        }
+    }
+    if (encoder.flush()) {
+        s.bytes.insert(s.bytes.end(), encoder.data(), encoder.data() + encoder.size());
+        s.frameEnds.push_back(s.bytes.size());
+        s.frameSamples.push_back(count);
+    }
+    return s;
+}
+
+// Las mismas muestras como "%.2f,%d,%d\r\n" (ECG_BINARY_STREAM 0)
+static BenchStream makeCsvStream(const std::vector<int16_t>& samples)
+{
+    BenchStream s;
+    s.samples = samples;
+    char line[50];
+    for (size_t i = 0; i < samples.size(); i++) {
+        int len = snprintf(line, sizeof(line), "%.2f,%d,%d\r\n", (float)samples[i], 72, 1);
+        s.bytes.insert(s.bytes.end(), line, line + len);
+        if (i % STREAM_FRAME_SAMPLES == STREAM_FRAME_SAMPLES - 1 || i + 1 == samples.size()) {
+            s.frameEnds.push_back(s.bytes.size());
+            s.frameSamples.push_back(i + 1);
+        }
+    }
+    return s;
+}
+
+struct BenchResult {
+    double seconds;
+    double cpuSeconds;
+    uint64_t samples;
+    uint32_t crcErrors;
+    uint32_t dropped;
+    bool intact;
+    bool statusOk;  // la cabecera refleja las tramas de estado y de respiración
+};
+
+static double threadCpuSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Envía 'stream' por un pty, a 'rateHz' muestras/s (0 = sin pausa), y
+ * lo ingiere con ingestLoop() en otro hilo.
+ */
+static bool runBench(const BenchStream& stream, ECGStreamDecoder::Mode mode, double rateHz, BenchResult& result)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return false;
+    int slave = serialOpen(ptsname(master), 0);
+    if (slave < 0) {
+        close(master);
+        return false;
+    }
+
+    std::string shmName = "/ecg_ring_bench_" + std::to_string(getpid());
+    ShmRingWriter ring;
+    if (!ring.create(shmName.c_str(), SHM_RING_DEFAULT_CAPACITY, STREAM_RATE_HZ)) {
+        close(slave);
+        close(master);
+        return false;
+    }
+    IngestSink sink(ring, mode);
+    int stopFd = eventfd(0, EFD_CLOEXEC);
+
+    double cpu = 0.0;
+    std::thread reader([&]() {
+        double c0 = threadCpuSeconds();
+        ingestLoop(slave, stopFd, -1, sink, []() {});
+        cpu = threadCpuSeconds() - c0;
+    });
+
+    auto t0 = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    size_t frame = 0;
+    while (sent < stream.bytes.size()) {
+        size_t end = stream.bytes.size();
+        if (rateHz > 0) {
+            // Todo lo que toca enviar hasta ahora, en pasos de 1 ms
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            size_t dueSamples = (size_t)(elapsed * rateHz);
+            size_t due = frame;
+            while (due < stream.frameEnds.size() && stream.frameSamples[due] <= dueSamples + STREAM_FRAME_SAMPLES) due++;
+            if (due <= frame) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            end = stream.frameEnds[due - 1];
+            frame = due;
+        }
+        while (sent < end) {
+            ssize_t w = write(master, stream.bytes.data() + sent, end - sent);
+            if (w > 0) sent += (size_t)w;
+            else if (w < 0 && errno != EINTR && errno != EAGAIN) break;
+        }
+        if (sent < end) break;
+    }
+
+    // Espera a que el lector lo haya publicado todo
+    for (int i = 0; i < 2000 && (ring.written() < stream.samples.size() ||
+                                 __atomic_load_n(&ring.status().statusFrames, __ATOMIC_ACQUIRE) < stream.statusFrames); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    uint64_t one = 1;
+    if (write(stopFd, &one, sizeof(one)) < 0) {}
+    reader.join();
+
+    result.seconds = std::chrono::duration<double>(t1 - t0).count();
+    result.cpuSeconds = cpu;
+    result.samples = ring.written();
+    result.crcErrors = sink.getDecoder().getCrcErrors();
+    result.dropped = sink.getDecoder().getDroppedFrames();
+
+    // Las últimas 'capacity' muestras del anillo deben ser las enviadas
+    result.intact = result.samples == stream.samples.size();
+    size_t check = stream.samples.size() < ring.capacity() ? stream.samples.size() : ring.capacity();
+    for (size_t k = stream.samples.size() - check; result.intact && k < stream.samples.size(); k++) {
+        if (ring.data()[k & (ring.capacity() - 1)] != stream.samples[k]) result.intact = false;
+    }
+
+    const ShmRingHeader& h = ring.status();
+    result.statusOk = h.statusFrames == stream.statusFrames && h.statusValid == (stream.statusFrames > 0) &&
+                      h.respValid == (stream.respirationFrames > 0);
+    if (stream.statusFrames > 0) result.statusOk = result.statusOk && h.quality == 90;
+    if (stream.respirationFrames > 0) {
+        result.statusOk = result.statusOk && h.respRateX10 == 150 && h.respSource == RESP_SOURCE_AMPLITUDE &&
+                          h.respRegularity == 80;
+    }
+
+    ring.close();
+    close(stopFd);
+    close(slave);
+    close(master);
+    return true;
+}
+
+static void printResult(const char* label, const BenchResult& r)
+{
+    printf("  %-22s %9.0f muestras/s  CPU %5.1f%%  %6.0f ns/muestra  CRC %u  perdidas %u  %s%s\n",
+           label, r.samples / r.seconds, 100.0 * r.cpuSeconds / r.seconds,
+           r.samples ? 1e9 * r.cpuSeconds / r.samples : 0.0, r.crcErrors, r.dropped,
+           r.intact ? "anillo = enviado" : "ANILLO DISTINTO", r.statusOk ? "" : "  ESTADO DISTINTO");
+}
+
+static int benchIngest(int argc, char** argv)
+{
+    double seconds = argc > 0 ? atof(argv[0]) : 5.0;
+    double rate = argc > 1 ? atof(argv[1]) : 10.0 * STREAM_RATE_HZ;
+    if (seconds <= 0 || rate <= 0) {
+        fprintf(stderr, "Uso: ingest bench [segundos] [muestras/s]\n");
+        return 1;
+    }
+
+    BenchStream paced = makeBinaryStream((size_t)(seconds * rate));
+    BenchStream bulk = makeBinaryStream(2000000);
+    BenchStream csv = makeCsvStream(std::vector<int16_t>(bulk.samples.begin(), bulk.samples.begin() + 500000));
+
+    printf("Ingesta por pty (epoll + decodificador sin reservas + anillo en /dev/shm)\n");
+    printf("  binario: %.2f bytes/muestra, CSV: %.2f bytes/muestra\n",
+           (double)bulk.bytes.size() / bulk.samples.size(), (double)csv.bytes.size() / csv.samples.size());
+
+    BenchResult r;
+    bool ok = true;
+    if (!runBench(paced, ECGStreamDecoder::BINARY, rate, r)) {
+        fprintf(stderr, "No se pudo crear el pty o la memoria compartida\n");
+        return 1;
+    }
+    char label[40];
+    snprintf(label, sizeof(label), "binario a %.0f Hz", rate);
+    printResult(label, r);
+    ok = ok && r.intact && r.statusOk && r.crcErrors == 0 && r.dropped == 0 && r.samples / r.seconds >= 0.95 * rate;
+
+    runBench(bulk, ECGStreamDecoder::BINARY, 0, r);
+    printResult("binario sin pausa", r);
+    ok = ok && r.intact && r.statusOk && r.crcErrors == 0;
+
+    runBench(csv, ECGStreamDecoder::CSV, 0, r);
+    printResult("CSV sin pausa", r);
+    ok = ok && r.intact && r.statusOk && r.crcErrors == 0;
+
+    // Referencia: lo que cabe en el enlace real
+    double binBytesPerSample = (double)bulk.bytes.size() / bulk.samples.size();
+    printf("  (115200 baudios limitan el enlace a %.0f muestras/s en binario y %.0f en CSV)\n",
+           11520.0 / binBytesPerSample, 11520.0 * csv.samples.size() / csv.bytes.size());
+
+    printf("%s\n", ok ? "OK" : "FALLO");
+    return ok ? 0 : 1;
+}
+
+int ingestSerial(int argc, char** argv)
+{
+    if (argc > 0 && strcmp(argv[0], "bench") == 0) return benchIngest(argc - 1, argv + 1);
+    if (argc < 1) {
+        fprintf(stderr, "Uso: ingest <puerto> [baudios] [/nombre_shm] [csv]\n"
+                        "     ingest bench [segundos] [muestras/s]\n");
+        return 1;
+    }
+    unsigned long baud = argc > 1 ? strtoul(argv[1], nullptr, 10) : 115200;
+    const char* shmName = argc > 2 ? argv[2] : "/ecg_ring";
+    ECGStreamDecoder::Mode mode = argc > 3 && strcmp(argv[3], "csv") == 0 ? ECGStreamDecoder::CSV
+                                                                          : ECGStreamDecoder::BINARY;
+    if (shmName[0] != '/') {
+        fprintf(stderr, "El nombre de la memoria compartida empieza por '/'\n");
+        return 1;
+    }
+    return runDaemon(argv[0], baud, shmName, mode);
+}
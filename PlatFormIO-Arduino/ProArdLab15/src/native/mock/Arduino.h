@@ -0,0 +1,54 @@
+/**
+ * @file Arduino.h
+ * @brief HAL mínimo de Arduino para el entorno native
+ *
+ * Lo justo para compilar sin cambios las cabeceras del firmware que incluyen
+ * <Arduino.h> (ecg_types.h, ecg_monitor.h, lcd_manager.h): pines digitales
+ * y analógicos que el programa del host fija con mockSetDigital()/
+ * mockSetAnalog(), millis()/micros() sobre el reloj simulado de mock_hal.h,
+ * que solo avanza cuando el host lo pide, y map()/constrain(). No define ARDUINO: las cabeceras que distinguen
+ * entre firmware y host siguen viendo el host.
+ */
+
+#ifndef MOCK_ARDUINO_H
+#define MOCK_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../mock_hal.h"
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+typedef uint8_t byte;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+uint16_t analogRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+
+// Estado de las entradas que leerá el código del firmware
+void mockSetDigital(uint8_t pin, int level);
+void mockSetAnalog(uint8_t pin, uint16_t value);
+
+// digitalRead() de pines que no existen (p. ej. un -1 de "sin pin")
+uint32_t mockInvalidPinReads();
+
+#endif // MOCK_ARDUINO_H
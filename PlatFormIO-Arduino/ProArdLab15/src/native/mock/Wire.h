@@ -0,0 +1,17 @@
+/**
+ * @file Wire.h
+ * @brief <Wire.h> del entorno native: el bus I2C simulado de mock_wire.h
+ *
+ * Para compilar lcd_manager.h en el host. El programa que lo incluya define
+ * la instancia global Wire.
+ */
+
+#ifndef MOCK_WIRE_ARDUINO_H
+#define MOCK_WIRE_ARDUINO_H
+
+#include "../mock_wire.h"
+
+typedef MockWire TwoWire;
+extern MockWire Wire;
+
+#endif // MOCK_WIRE_ARDUINO_H
@@ -0,0 +1,84 @@
+/**
+ * @file mock_hal.cpp
+ * @brief Reloj simulado y pines del entorno native (ver mock_hal.h y mock/Arduino.h)
+ */
+
+#include "mock_hal.h"
+#include "mock/Arduino.h"
+
+static uint64_t simulatedNanos = 0;
+
+static const uint8_t MOCK_PINS = 64;
+static uint8_t pinModes[MOCK_PINS];
+static uint8_t digitalLevels[MOCK_PINS];
+static uint16_t analogLevels[MOCK_PINS];
+static uint32_t invalidPinReads = 0;
+
+void delay(unsigned long ms)
+{
+    simulatedNanos += (uint64_t)ms * 1000000ULL;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    simulatedNanos += (uint64_t)us * 1000ULL;
+}
+
+uint64_t mockNanos()
+{
+    return simulatedNanos;
+}
+
+void mockAdvanceNanos(uint64_t ns)
+{
+    simulatedNanos += ns;
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(simulatedNanos / 1000000ULL);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)(simulatedNanos / 1000ULL);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin < MOCK_PINS) pinModes[pin] = mode;
+}
+
+int digitalRead(uint8_t pin)
+{
+    if (pin >= MOCK_PINS) {
+        invalidPinReads++;
+        return LOW;
+    }
+    return digitalLevels[pin];
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pin < MOCK_PINS) digitalLevels[pin] = value ? HIGH : LOW;
+}
+
+uint16_t analogRead(uint8_t pin)
+{
+    return pin < MOCK_PINS ? analogLevels[pin] : 0;
+}
+
+void mockSetDigital(uint8_t pin, int level)
+{
+    if (pin < MOCK_PINS) digitalLevels[pin] = level ? HIGH : LOW;
+}
+
+void mockSetAnalog(uint8_t pin, uint16_t value)
+{
+    if (pin < MOCK_PINS) analogLevels[pin] = value;
+}
+
+uint32_t mockInvalidPinReads()
+{
+    return invalidPinReads;
+}
@@ -0,0 +1,24 @@
+/**
+ * @file mock_hal.h
+ * @brief Reloj simulado del entorno native para delay() y delayMicroseconds()
+ *
+ * Los drivers compartidos con el firmware (hd44780_i2c.h) llaman a delay();
+ * en el host no se duerme, solo avanza este reloj. Los buses simulados
+ * también lo avanzan con la duración de cada transmisión, así que el tiempo
+ * medido incluye esperas y tráfico.
+ *
+ * millis(), micros() y los pines simulados están en mock/Arduino.h.
+ */
+
+#ifndef MOCK_HAL_H
+#define MOCK_HAL_H
+
+#include <stdint.h>
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+uint64_t mockNanos();
+void mockAdvanceNanos(uint64_t ns);
+
+#endif // MOCK_HAL_H
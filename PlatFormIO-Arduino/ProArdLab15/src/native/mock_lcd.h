@@ -0,0 +1,69 @@
+/**
+ * @file mock_lcd.h
+ * @brief LCD HD44780 20x4 simulado que cuenta el tráfico I2C
+ *
+ * Modela la DDRAM (con el salto de filas 0 -> 2 -> 1 -> 3 del 20x4) para
+ * poder comprobar lo que se ve en pantalla. El coste en el bus se calcula
+ * como lo genera LiquidCrystal_I2C: cada byte del HD44780 son dos nibbles y
+ * cada nibble tres expanderWrite() (dato, EN alto, EN bajo), cada uno en su
+ * propia transmisión Wire de dirección + 1 byte.
+ */
+
+#ifndef MOCK_LCD_H
+#define MOCK_LCD_H
+
+#include <stdint.h>
+#include <string.h>
+
+class MockLCD {
+public:
+    static const uint8_t COLS = 20;
+    static const uint8_t ROWS = 4;
+    static const uint32_t TRANSACTIONS_PER_BYTE = 6;
+    static const uint32_t BUS_BYTES_PER_TRANSACTION = 2; // dirección + dato
+
+    MockLCD() { clear(); }
+
+    void clear() {
+        memset(ddram, ' ', sizeof(ddram));
+        address = 0;
+        commands++;
+    }
+
+    void setCursor(uint8_t col, uint8_t row) {
+        static const uint8_t rowOffsets[ROWS] = {0x00, 0x40, 0x14, 0x54};
+        address = rowOffsets[row] + col;
+        commands++;
+    }
+
+    void write(uint8_t c) {
+        ddram[address & 0x7F] = c;
+        address = (address + 1) & 0x7F;
+        data++;
+    }
+
+    void print(const char* text) {
+        while (*text) write((uint8_t)*text++);
+    }
+
+    // Carácter visible en (col, row)
+    uint8_t at(uint8_t col, uint8_t row) const {
+        static const uint8_t rowOffsets[ROWS] = {0x00, 0x40, 0x14, 0x54};
+        return ddram[rowOffsets[row] + col];
+    }
+
+    uint32_t hd44780Bytes() const { return commands + data; }
+    uint32_t i2cTransactions() const { return hd44780Bytes() * TRANSACTIONS_PER_BYTE; }
+    uint32_t i2cBytes() const { return i2cTransactions() * BUS_BYTES_PER_TRANSACTION; }
+
+    void resetCounters() { commands = data = 0; }
+
+    uint32_t commands = 0;
+    uint32_t data = 0;
+
+private:
+    uint8_t ddram[128];
+    uint8_t address;
+};
+
+#endif // MOCK_LCD_H
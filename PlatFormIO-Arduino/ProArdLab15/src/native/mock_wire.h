@@ -0,0 +1,173 @@
+/**
+ * @file mock_wire.h
+ * @brief Bus I2C simulado con un backpack PCF8574 + HD44780 20x4 conectado
+ *
+ * Implementa la parte de TwoWire que usan los drivers del LCD y cuenta
+ * transmisiones y bytes. Cada transmisión avanza el reloj de mock_hal.h con
+ * su duración a clockHz (start, 9 bits por byte con ACK, stop).
+ *
+ * Los bytes escritos se aplican a las salidas del PCF8574 en el instante en
+ * que terminan en el bus. El HD44780 captura D4..D7 en cada flanco de bajada
+ * de EN: en modo 8 bits (tras el encendido) cada nibble es una instrucción,
+ * en modo 4 bits se juntan de dos en dos. Se modela la DDRAM para comprobar
+ * el contenido y el tiempo de ejecución de cada instrucción: un flanco que
+ * llega con el controlador ocupado se cuenta en busyViolations.
+ */
+
+#ifndef MOCK_WIRE_H
+#define MOCK_WIRE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "mock_hal.h"
+
+class MockWire {
+public:
+    static const size_t BUFFER_SIZE = 128; // TwoWire del ESP32
+    static const uint8_t PIN_RS = 0x01;
+    static const uint8_t PIN_EN = 0x04;
+
+    explicit MockWire(uint32_t clockHz = 100000) : clockHz(clockHz) { powerOn(); }
+
+    void begin(int sda = -1, int scl = -1) { (void)sda; (void)scl; }
+    void setClock(uint32_t hz) { clockHz = hz; }
+
+    // Estado del HD44780 tras el encendido (modo 8 bits, DDRAM sin definir)
+    void powerOn() {
+        memset(ddram, '?', sizeof(ddram));
+        memset(cgram, 0, sizeof(cgram));
+        pins = 0;
+        fourBit = false;
+        pendingHigh = false;
+        initSteps = 0;
+        address = 0;
+        toCgram = false;
+        busyUntil = 0;
+    }
+
+    void beginTransmission(uint8_t addr) {
+        txAddr = addr;
+        txLen = 0;
+        overflow = false;
+    }
+
+    size_t write(const uint8_t* data, size_t len) {
+        size_t n = 0;
+        while (n < len && txLen < BUFFER_SIZE) txBuffer[txLen++] = data[n++];
+        if (n < len) overflow = true;
+        return n;
+    }
+
+    size_t write(uint8_t value) { return write(&value, 1); }
+
+    uint8_t endTransmission(bool = true) {
+        transactions++;
+        bytes += txLen + 1; // + byte de dirección
+        if (overflow) overflows++;
+
+        // Start + dirección, luego cada byte llega a las salidas tras su ACK
+        const uint64_t t0 = mockNanos();
+        for (size_t i = 0; i < txLen; i++) {
+            setPins(txBuffer[i], t0 + bitsToNanos(1 + 9 * (i + 2)));
+        }
+        mockAdvanceNanos(bitsToNanos(2 + 9 * (txLen + 1)));
+        return 0;
+    }
+
+    // Carácter visible en (col, row) del 20x4
+    uint8_t at(uint8_t col, uint8_t row) const {
+        static const uint8_t rowOffsets[4] = {0x00, 0x40, 0x14, 0x54};
+        return ddram[rowOffsets[row] + col];
+    }
+
+    const uint8_t* glyph(uint8_t location) const { return &cgram[(location & 0x07) * 8]; }
+
+    void resetCounters() { transactions = bytes = instructions = busyViolations = overflows = 0; }
+
+    // Tiempo de bus para 'busBytes' bytes (dirección incluida) en 'count' transmisiones
+    static double busMicros(uint32_t busBytes, uint32_t count, uint32_t hz) {
+        return (9.0 * busBytes + 2.0 * count) * 1e6 / hz;
+    }
+
+    uint32_t transactions = 0;
+    uint32_t bytes = 0;          // incluye el byte de dirección de cada transmisión
+    uint32_t instructions = 0;   // comandos + datos ejecutados por el HD44780
+    uint32_t busyViolations = 0; // flancos de EN con el controlador ocupado
+    uint32_t overflows = 0;      // transmisiones que no cabían en el buffer
+
+private:
+    uint32_t clockHz;
+    uint8_t txAddr;
+    uint8_t txBuffer[BUFFER_SIZE];
+    size_t txLen = 0;
+    bool overflow = false;
+
+    uint8_t pins;
+    bool fourBit;
+    bool pendingHigh;
+    uint8_t highNibble;
+    uint8_t initSteps;
+    uint8_t address;
+    bool toCgram;
+    uint64_t busyUntil;
+    uint8_t ddram[128];
+    uint8_t cgram[64];
+
+    uint64_t bitsToNanos(uint64_t bits) const { return bits * 1000000000ULL / clockHz; }
+
+    void setPins(uint8_t value, uint64_t t) {
+        bool fallingEdge = (pins & PIN_EN) && !(value & PIN_EN);
+        pins = value;
+        if (!fallingEdge) return;
+
+        if (t < busyUntil) busyViolations++;
+        uint8_t nibble = value & 0xF0;
+        bool rs = (value & PIN_RS) != 0;
+        if (!fourBit) {
+            execute(nibble, false, t);
+        } else if (!pendingHigh) {
+            highNibble = nibble;
+            pendingHigh = true;
+        } else {
+            pendingHigh = false;
+            execute(highNibble | (nibble >> 4), rs, t);
+        }
+    }
+
+    void execute(uint8_t value, bool rs, uint64_t t) {
+        instructions++;
+        uint64_t execNs = 37000;
+        if (rs) {
+            if (toCgram) cgram[address & 0x3F] = value;
+            else ddram[address & 0x7F] = value;
+            address++;
+        } else if (value & 0x80) {
+            address = value & 0x7F;
+            toCgram = false;
+        } else if (value & 0x40) {
+            address = value & 0x3F;
+            toCgram = true;
+        } else if (value & 0x20) {
+            // Function set: antes del primer 0x20 el controlador va en 8 bits
+            if (!fourBit) {
+                static const uint64_t initWaitNs[3] = {4100000, 100000, 37000};
+                execNs = initWaitNs[initSteps < 3 ? initSteps : 2];
+                initSteps++;
+                fourBit = (value & 0x10) == 0;
+            }
+        } else if (value == 0x01) {
+            memset(ddram, ' ', sizeof(ddram));
+            address = 0;
+            toCgram = false;
+            execNs = 1520000;
+        } else if ((value & 0xFE) == 0x02) {
+            address = 0;
+            toCgram = false;
+            execNs = 1520000;
+        }
+        busyUntil = t + execNs;
+    }
+};
+
+#endif // MOCK_WIRE_H
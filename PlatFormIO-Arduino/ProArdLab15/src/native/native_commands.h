@@ -0,0 +1,34 @@
+/**
+ * @file native_commands.h
+ * @brief Subcomandos del ejecutable del entorno native (benchmarks y herramientas del host)
+ */
+
+#ifndef NATIVE_COMMANDS_H
+#define NATIVE_COMMANDS_H
+
+// Cada subcomando recibe los argumentos que siguen a su nombre y devuelve
+// el código de salida del proceso (0 = correcto).
+int benchDsp(int argc, char** argv);
+int benchQrs(int argc, char** argv);
+int benchStream(int argc, char** argv);
+int replayFile(int argc, char** argv);
+int synthRecording(int argc, char** argv);
+int benchRing(int argc, char** argv);
+int benchLcd(int argc, char** argv);
+int benchLcdBus(int argc, char** argv);
+int holterLog(int argc, char** argv);
+int benchHrv(int argc, char** argv);
+int ingestSerial(int argc, char** argv);
+int benchMonitor(int argc, char** argv);
+int benchMulti(int argc, char** argv);
+int benchCic(int argc, char** argv);
+int benchHum(int argc, char** argv);
+int benchQuality(int argc, char** argv);
+int benchLoopStats(int argc, char** argv);
+int benchSpectral(int argc, char** argv);
+int benchBlock(int argc, char** argv);
+int benchBus(int argc, char** argv);
+int benchEvents(int argc, char** argv);
+int benchResp(int argc, char** argv);
+
+#endif // NATIVE_COMMANDS_H
@@ -0,0 +1,99 @@
+/**
+ * @file recorded_stream.h
+ * @brief Lectura de señales ECG grabadas y comparación de latidos con anotaciones
+ *
+ * Formato de fichero (texto, una muestra por línea):
+ *   <raw_adc>[,<anotacion>]
+ * La anotación es 1 en la muestra del pico R y 0 (u omitida) en el resto.
+ * Las líneas vacías o que empiezan por '#' se ignoran.
+ */
+
+#ifndef RECORDED_STREAM_H
+#define RECORDED_STREAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "synth_ecg.h"
+
+struct RecordedStream {
+    std::vector<int> samples;
+    std::vector<uint32_t> annotations; // índices de muestra de los picos R
+};
+
+inline bool loadRecordedStream(const char* path, RecordedStream& out) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+        char* end = nullptr;
+        long raw = strtol(line, &end, 10);
+        if (end == line) continue;
+        if (*end == ',' && strtol(end + 1, nullptr, 10) != 0) {
+            out.annotations.push_back((uint32_t)out.samples.size());
+        }
+        out.samples.push_back((int)raw);
+    }
+    fclose(f);
+    return true;
+}
+
+// Añade 'seconds' segundos de señal sintética anotada al final de 'out'
+inline void synthesizeStream(SynthECG& synth, int seconds, int rate, RecordedStream& out) {
+    for (long i = 0; i < (long)seconds * rate; i++) {
+        int v = synth.next();
+        if (synth.lastWasRPeak()) out.annotations.push_back((uint32_t)out.samples.size());
+        out.samples.push_back(v);
+    }
+}
+
+struct BeatMatch {
+    uint32_t truePositives = 0;
+    uint32_t falsePositives = 0;
+    uint32_t falseNegatives = 0;
+
+    double sensitivity() const {
+        uint32_t d = truePositives + falseNegatives;
+        return d ? 100.0 * truePositives / d : 0.0;
+    }
+    double ppv() const {
+        uint32_t d = truePositives + falsePositives;
+        return d ? 100.0 * truePositives / d : 0.0;
+    }
+};
+
+/**
+ * Empareja detecciones con anotaciones (ambas ordenadas) con una tolerancia
+ * en muestras. Las anotaciones anteriores a 'skip' (aprendizaje) no cuentan.
+ */
+inline BeatMatch matchBeats(const std::vector<uint32_t>& reference,
+                            const std::vector<uint32_t>& detected,
+                            uint32_t tolerance, uint32_t skip = 0) {
+    BeatMatch m;
+    size_t i = 0, j = 0;
+    while (i < reference.size() && reference[i] < skip) i++;
+    while (j < detected.size() && detected[j] < skip) j++;
+
+    while (i < reference.size() && j < detected.size()) {
+        uint32_t r = reference[i], d = detected[j];
+        if (d + tolerance < r) {
+            m.falsePositives++;
+            j++;
+        } else if (d > r + tolerance) {
+            m.falseNegatives++;
+            i++;
+        } else {
+            m.truePositives++;
+            i++;
+            j++;
+        }
+    }
+    m.falseNegatives += (uint32_t)(reference.size() - i);
+    m.falsePositives += (uint32_t)(detected.size() - j);
+    return m;
+}
+
+#endif // RECORDED_STREAM_H
@@ -0,0 +1,65 @@
+/**
+ * @file replay.cpp
+ * @brief Reproduce una grabación por la cadena completa del firmware en el host
+ *
+ * Uso: program replay <fichero> [salida.bin]
+ *   FileReplaySource -> ECGFilter -> QRSDetector -> ECGStreamEncoder.
+ *   Imprime cada latido con su BPM y, si se indica, guarda las tramas
+ *   binarias que el ESP32 enviaría por el puerto serie.
+ */
+
+#include <stdio.h>
+#include "ecg_dsp.h"
+#include "qrs_detector.h"
+#include "ecg_stream.h"
+#include "file_replay_source.h"
+#include "native_commands.h"
+
+int replayFile(int argc, char** argv)
+{
+    if (argc < 1) {
+        fprintf(stderr, "Uso: replay <fichero> [salida.bin]\n");
+        return 1;
+    }
+
+    FileReplaySource source(argv[0]);
+    if (!source.begin()) {
+        fprintf(stderr, "No se puede leer %s\n", argv[0]);
+        return 1;
+    }
+    FILE* out = argc > 1 ? fopen(argv[1], "wb") : nullptr;
+
+    const uint16_t rate = 250;
+    ECGFilter filter;
+    QRSDetector<rate> qrs;
+    ECGStreamEncoder encoder;
+    bool primed = false;
+    float bpm = 0.0f;
+    uint32_t beats = 0;
+
+    int16_t block[16];
+    size_t count;
+    while ((count = source.read(block, 16)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            if (!primed) {
+                filter.reset(block[i]);
+                primed = true;
+            }
+            int16_t lp = (int16_t)filter.process(block[i]);
+            bool beat = qrs.process(lp);
+            if (beat) {
+                beats++;
+                if (qrs.lastRR() > 0) bpm = 60.0f * rate / qrs.lastRR();
+                printf("%10.3f s  latido  BPM %5.1f\n", qrs.lastBeatSample() / (float)rate, bpm);
+            }
+            if (encoder.push(lp, bpm, true, beat) && out) {
+                fwrite(encoder.data(), 1, encoder.size(), out);
+            }
+        }
+    }
+    if (encoder.flush() && out) fwrite(encoder.data(), 1, encoder.size(), out);
+    if (out) fclose(out);
+
+    printf("%zu muestras, %u latidos\n", source.recording().samples.size(), beats);
+    return 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file serial_port.h
+ * @brief Apertura del puerto serie del host en modo crudo (termios) para el demonio de ingesta
+ */
+
+#ifndef SERIAL_PORT_H
+#define SERIAL_PORT_H
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+static inline speed_t serialBaudConstant(unsigned long baud) {
+    switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return 0;
+    }
+}
+
+/**
+ * Pone 'fd' en modo crudo 8N1 sin control de flujo. VMIN/VTIME a 0: con
+ * O_NONBLOCK y epoll, read() devuelve lo que haya sin esperar.
+ * baud = 0 deja la velocidad como está (p. ej. en un pty).
+ */
+static inline bool serialConfigureRaw(int fd, unsigned long baud) {
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) return false;
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~CRTSCTS;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if (baud) {
+        speed_t speed = serialBaudConstant(baud);
+        if (!speed) return false;
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+    }
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) return false;
+    tcflush(fd, TCIFLUSH);
+    return true;
+}
+
+// Abre el puerto sin bloquear y sin convertirlo en terminal de control. -1 si falla.
+static inline int serialOpen(const char* path, unsigned long baud) {
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return -1;
+    if (!serialConfigureRaw(fd, baud)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+#endif // SERIAL_PORT_H
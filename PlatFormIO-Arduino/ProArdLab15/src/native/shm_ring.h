@@ -0,0 +1,189 @@
+/**
+ * @file shm_ring.h
+ * @brief Anillo de muestras en memoria compartida POSIX (demonio de ingesta -> vista)
+ *
+ * Un escritor (el demonio) y cualquier número de lectores que mapean el
+ * mismo objeto /dev/shm/<nombre> en solo lectura (tools/shm_ring.py). Nadie
+ * copia las muestras: el lector toma una vista directa sobre el anillo.
+ *
+ * Disposición (little endian, 80 bytes de cabecera y después las muestras):
+ *
+ *   0   u32 magic        SHM_RING_MAGIC ("ECGR")
+ *   4   u32 version      SHM_RING_VERSION
+ *   8   u32 capacity     muestras, potencia de 2
+ *   12  u32 rateHz       frecuencia de muestreo nominal
+ *   16  u64 writeIndex   muestras publicadas desde el inicio (release/acquire)
+ *   24  u32 statusSeq    seqlock del estado: impar mientras se escribe
+ *   28  u16 bpm x10
+ *   30  u8  leads        electrodos conectados
+ *   31  u8  hrvValid     hay una trama de HRV vigente
+ *   32  u32 framesOk
+ *   36  u32 crcErrors
+ *   40  u32 droppedFrames
+ *   44  u16 FC, SDNN, RMSSD y pNN50 x10, NN, rechazados (tramas de HRV)
+ *   56  u32 hrvFrames
+ *   60  u32 pid          del demonio
+ *   64  u16 respiración x10 (rpm)
+ *   66  u8  fuente y regularidad (%) de la respiración
+ *   68  u8  respValid    hay una trama de respiración vigente
+ *   69  u8  statusValid  ha llegado alguna trama de estado del equipo
+ *   70  u8  calidad      0-100, 255 si el equipo aún no la conoce
+ *   71  u8  (reservado)
+ *   72  u16 desbordes del ADC y tramas no enviadas (trama de estado)
+ *   76  u32 statusFrames
+ *   80  i16 samples[capacity]; la muestra k está en samples[k & (capacity-1)]
+ *
+ * El lector lee writeIndex, después las muestras que quiera (como mucho
+ * capacity) y vuelve a leer writeIndex: si ha avanzado más de lo que le
+ * quedaba de margen, esas muestras se han sobrescrito.
+ */
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+constexpr uint32_t SHM_RING_MAGIC = 0x52474345; // "ECGR"
+constexpr uint32_t SHM_RING_VERSION = 2;
+constexpr uint32_t SHM_RING_DEFAULT_CAPACITY = 1u << 16; // 26 s a 2500 Hz
+
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t rateHz;
+    uint64_t writeIndex;
+    uint32_t statusSeq;
+    uint16_t bpmX10;
+    uint8_t leads;
+    uint8_t hrvValid;
+    uint32_t framesOk;
+    uint32_t crcErrors;
+    uint32_t droppedFrames;
+    uint16_t hrvHrX10;
+    uint16_t sdnnX10;
+    uint16_t rmssdX10;
+    uint16_t pnn50X10;
+    uint16_t hrvBeats;
+    uint16_t hrvRejected;
+    uint32_t hrvFrames;
+    uint32_t pid;
+    uint16_t respRateX10;
+    uint8_t respSource;
+    uint8_t respRegularity;
+    uint8_t respValid;
+    uint8_t statusValid;
+    uint8_t quality;
+    uint8_t reserved;
+    uint16_t adcOverruns;
+    uint16_t txDropped;
+    uint32_t statusFrames;
+};
+
+static_assert(sizeof(ShmRingHeader) == 80, "la cabecera es parte del formato compartido");
+
+class ShmRingWriter {
+public:
+    ShmRingWriter() : header(nullptr), samples(nullptr), mapSize(0), mask(0), local(0) { name[0] = 0; }
+    ~ShmRingWriter() { close(); }
+
+    ShmRingWriter(const ShmRingWriter&) = delete;
+    ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+    /**
+     * Crea (o reutiliza) el objeto de memoria compartida y lo inicializa.
+     * @param shmName nombre POSIX, con '/' inicial (p. ej. "/ecg_ring")
+     * @param capacity muestras; se redondea a la potencia de 2 superior
+     */
+    bool create(const char* shmName, uint32_t capacity, uint32_t rateHz) {
+        close();
+        uint32_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+
+        int fd = shm_open(shmName, O_CREAT | O_RDWR, 0644);
+        if (fd < 0) return false;
+        mapSize = sizeof(ShmRingHeader) + (size_t)cap * sizeof(int16_t);
+        if (ftruncate(fd, (off_t)mapSize) != 0) {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+
+        strncpy(name, shmName, sizeof(name) - 1);
+        name[sizeof(name) - 1] = 0;
+        header = (ShmRingHeader*)p;
+        samples = (int16_t*)((uint8_t*)p + sizeof(ShmRingHeader));
+        mask = cap - 1;
+        local = 0;
+
+        // El magic se escribe el último: un lector que lo ve ya tiene el resto
+        __atomic_store_n(&header->magic, 0u, __ATOMIC_RELAXED);
+        memset((uint8_t*)header + sizeof(uint32_t), 0, sizeof(ShmRingHeader) - sizeof(uint32_t));
+        header->version = SHM_RING_VERSION;
+        header->capacity = cap;
+        header->rateHz = rateHz;
+        header->pid = (uint32_t)getpid();
+        __atomic_store_n(&header->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Desmapea y borra el objeto (los lectores que ya lo tienen mapeado siguen viéndolo)
+    void close() {
+        if (!header) return;
+        munmap(header, mapSize);
+        shm_unlink(name);
+        header = nullptr;
+        samples = nullptr;
+    }
+
+    bool isOpen() const { return header != nullptr; }
+
+    // Escribe una muestra sin publicarla: los lectores la ven tras commit()
+    void push(int16_t value) { samples[local++ & mask] = value; }
+
+    void push(const int16_t* values, size_t n) {
+        for (size_t i = 0; i < n; i++) samples[(local + i) & mask] = values[i];
+        local += n;
+    }
+
+    // Publica todo lo escrito con push(); una vez por lectura del puerto
+    void commit() { __atomic_store_n(&header->writeIndex, local, __ATOMIC_RELEASE); }
+
+    uint64_t written() const { return local; }
+    uint32_t capacity() const { return mask + 1; }
+    const int16_t* data() const { return samples; }
+
+    // Cabecera publicada; el escritor la lee sin el seqlock
+    const ShmRingHeader& status() const { return *header; }
+
+    /**
+     * Actualiza el bloque de estado bajo el seqlock. 'update' recibe la
+     * cabecera y solo debe tocar los campos de estado.
+     */
+    template <typename Update>
+    void updateStatus(Update&& update) {
+        uint32_t seq = header->statusSeq;
+        __atomic_store_n(&header->statusSeq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        update(*header);
+        __atomic_store_n(&header->statusSeq, seq + 2, __ATOMIC_RELEASE);
+    }
+
+private:
+    ShmRingHeader* header;
+    int16_t* samples;
+    size_t mapSize;
+    uint32_t mask;
+    uint64_t local;
+    char name[64];
+};
+
+#endif // SHM_RING_H
@@ -0,0 +1,284 @@
+/**
+ * @file stream_decoder.h
+ * @brief Decodificador del flujo serie del ESP32 y del UNO sin reservas de memoria (host)
+ *
+ * Equivalente en C++ de FrameDecoder (tools/ecg_protocol.py) para el
+ * demonio de ingesta. Acepta los dos formatos de salida del firmware:
+ *   - tramas binarias COBS de ecg_stream.h (ECG_BINARY_STREAM 1)
+ *   - líneas CSV "filtrado,bpm,electrodos" (ECG_BINARY_STREAM 0),
+ *     analizadas con std::from_chars
+ * Todo se hace sobre búferes fijos: feed() no reserva memoria y entrega
+ * cada trama a los callbacks en cuanto se completa.
+ */
+
+#ifndef STREAM_DECODER_H
+#define STREAM_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <charconv>
+#include "ecg_stream.h"
+
+// Trama de muestras ya decodificada; 'samples' apunta al búfer interno
+// y solo es válido durante el callback
+struct DecodedSamples {
+    const int16_t* samples;
+    uint8_t count;
+    uint8_t seq;
+    float bpm;
+    bool leadsConnected;
+    bool beat;
+};
+
+struct DecodedHrv {
+    float heartRate;
+    float sdnnMs;
+    float rmssdMs;
+    float pnn50;
+    uint16_t beats;
+    uint16_t rejected;
+};
+
+// Contadores de pérdidas y calidad de señal del propio equipo (trama de estado)
+struct DecodedStatus {
+    uint16_t adcOverruns;
+    uint16_t txDropped;
+    uint8_t quality;    // 0-100, QUALITY_UNKNOWN (255) si aún no hay
+};
+
+// Respiración derivada del ECG (trama de respiración)
+struct DecodedRespiration {
+    float rate;         // rpm, 0 = sin estimación
+    uint8_t source;     // RespirationSource
+    uint8_t regularity; // %
+};
+
+class ECGStreamDecoder {
+public:
+    enum Mode { BINARY, CSV };
+
+    // Mayor trama que se acepta: de sobra para las tramas de ecg_stream.h,
+    // y una línea CSV cabe con holgura
+    static constexpr size_t MAX_CHUNK = 128;
+
+    explicit ECGStreamDecoder(Mode mode = BINARY) : mode(mode) { reset(); }
+
+    void reset() {
+        len = 0;
+        overflow = false;
+        haveSeq = false;
+        lastSeq = 0;
+        framesOk = crcErrors = droppedFrames = 0;
+        statusFrames = respirationFrames = 0;
+        haveStatus = false;
+        status.adcOverruns = status.txDropped = 0;
+        status.quality = 255; // QUALITY_UNKNOWN
+        haveRespiration = false;
+        respiration.rate = 0;
+        respiration.source = respiration.regularity = 0;
+    }
+
+    /**
+     * Procesa los bytes recibidos.
+     * onSamples(const DecodedSamples&) por cada trama de muestras (o línea
+     * CSV, con count = 1) y onHrv(const DecodedHrv&) por cada trama de HRV.
+     */
+    template <typename OnSamples, typename OnHrv>
+    void feed(const uint8_t* data, size_t n, OnSamples&& onSamples, OnHrv&& onHrv) {
+        const uint8_t delimiter = mode == BINARY ? 0x00 : '\n';
+        for (size_t i = 0; i < n; i++) {
+            // Copia en bloque hasta el siguiente delimitador
+            const uint8_t* end = (const uint8_t*)memchr(data + i, delimiter, n - i);
+            size_t run = end ? (size_t)(end - (data + i)) : n - i;
+            if (!overflow) {
+                if (len + run <= MAX_CHUNK) {
+                    memcpy(chunk + len, data + i, run);
+                    len += run;
+                } else {
+                    overflow = true; // se descarta hasta el siguiente delimitador
+                }
+            }
+            i += run;
+            if (!end) break;
+
+            if (overflow) crcErrors++;
+            else if (len > 0) {
+                if (mode == BINARY) parseFrame(onSamples, onHrv);
+                else parseLine(onSamples);
+            }
+            len = 0;
+            overflow = false;
+        }
+    }
+
+    uint32_t getFramesOk() const { return framesOk; }
+    uint32_t getCrcErrors() const { return crcErrors; }
+    uint32_t getDroppedFrames() const { return droppedFrames; }
+
+    // Última trama de estado del equipo; false si no ha llegado ninguna
+    bool getDeviceStatus(DecodedStatus& out) const {
+        out = status;
+        return haveStatus;
+    }
+
+    // Última trama de respiración; false si no ha llegado ninguna
+    bool getRespiration(DecodedRespiration& out) const {
+        out = respiration;
+        return haveRespiration;
+    }
+
+    // Tramas de estado y de respiración recibidas: permiten saber si ha
+    // llegado una nueva desde la última consulta
+    uint32_t getStatusFrames() const { return statusFrames; }
+    uint32_t getRespirationFrames() const { return respirationFrames; }
+
+private:
+    Mode mode;
+    uint8_t chunk[MAX_CHUNK];
+    size_t len;
+    bool overflow;
+    bool haveSeq;
+    uint8_t lastSeq;
+    int16_t samples[255]; // n es u8
+    uint32_t framesOk;
+    uint32_t crcErrors;
+    uint32_t droppedFrames;
+    uint32_t statusFrames;
+    uint32_t respirationFrames;
+    bool haveStatus;
+    DecodedStatus status;
+    bool haveRespiration;
+    DecodedRespiration respiration;
+
+    static uint16_t getU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+    // COBS en el sitio: la salida nunca adelanta a la entrada
+    static bool cobsDecodeInPlace(uint8_t* buf, size_t n, size_t& outLen) {
+        size_t i = 0, o = 0;
+        while (i < n) {
+            uint8_t code = buf[i];
+            if (code == 0 || i + code > n) return false;
+            for (uint8_t k = 1; k < code; k++) buf[o++] = buf[i + k];
+            i += code;
+            if (code != 0xFF && i < n) buf[o++] = 0;
+        }
+        outLen = o;
+        return true;
+    }
+
+    template <typename OnSamples, typename OnHrv>
+    void parseFrame(OnSamples& onSamples, OnHrv& onHrv) {
+        size_t rawLen;
+        if (!cobsDecodeInPlace(chunk, len, rawLen) || rawLen < 3) {
+            crcErrors++;
+            return;
+        }
+        const uint8_t* raw = chunk;
+        if (crc16Ccitt(raw, rawLen - 2) != getU16(raw + rawLen - 2)) {
+            crcErrors++;
+            return;
+        }
+
+        if (raw[0] == STREAM_FRAME_HRV_TYPE && rawLen == STREAM_HRV_RAW) {
+            DecodedHrv h;
+            h.heartRate = getU16(raw + 1) / 10.0f;
+            h.sdnnMs = getU16(raw + 3) / 10.0f;
+            h.rmssdMs = getU16(raw + 5) / 10.0f;
+            h.pnn50 = getU16(raw + 7) / 10.0f;
+            h.beats = getU16(raw + 9);
+            h.rejected = getU16(raw + 11);
+            framesOk++;
+            onHrv(h);
+            return;
+        }
+        if (raw[0] == STREAM_FRAME_STATUS_TYPE && rawLen == STREAM_STATUS_RAW) {
+            status.adcOverruns = getU16(raw + 1);
+            status.txDropped = getU16(raw + 3);
+            status.quality = raw[5];
+            haveStatus = true;
+            statusFrames++;
+            framesOk++;
+            return;
+        }
+        if (raw[0] == STREAM_FRAME_RESPIRATION_TYPE && rawLen == STREAM_RESPIRATION_RAW) {
+            respiration.rate = getU16(raw + 1) / 10.0f;
+            respiration.source = raw[3];
+            respiration.regularity = raw[4];
+            haveRespiration = true;
+            respirationFrames++;
+            framesOk++;
+            return;
+        }
+        if (raw[0] != STREAM_FRAME_SAMPLES_TYPE || rawLen < STREAM_HEADER_SIZE + 2 + 2) return;
+
+        uint8_t seq = raw[1];
+        if (haveSeq) droppedFrames += (uint8_t)(seq - lastSeq - 1);
+        haveSeq = true;
+        lastSeq = seq;
+
+        uint8_t count = raw[2];
+        int16_t value = (int16_t)getU16(raw + STREAM_HEADER_SIZE);
+        samples[0] = value;
+        uint8_t got = 1;
+        size_t i = STREAM_HEADER_SIZE + 2;
+        size_t payloadEnd = rawLen - 2;
+        while (got < count && i < payloadEnd) {
+            uint8_t b = raw[i];
+            if (b == STREAM_DELTA_ESCAPE) {
+                if (i + 3 > payloadEnd) break;
+                value = (int16_t)getU16(raw + i + 1);
+                i += 3;
+            } else {
+                value = (int16_t)(value + (int8_t)b);
+                i++;
+            }
+            samples[got++] = value;
+        }
+
+        DecodedSamples f;
+        f.samples = samples;
+        f.count = got;
+        f.seq = seq;
+        f.bpm = getU16(raw + 4) / 10.0f;
+        f.leadsConnected = (raw[3] & STREAM_FLAG_LEADS) != 0;
+        f.beat = (raw[3] & STREAM_FLAG_BEAT) != 0;
+        framesOk++;
+        onSamples(f);
+    }
+
+    // "%.2f,%d,%d": valor filtrado, bpm y electrodos conectados (0/1)
+    template <typename OnSamples>
+    void parseLine(OnSamples& onSamples) {
+        const char* p = (const char*)chunk;
+        const char* end = p + len;
+        if (end > p && end[-1] == '\r') end--;
+        if (p == end || *p == '#') return; // mensajes de diagnóstico del firmware
+
+        float filtered;
+        int bpm, leads;
+        auto r = std::from_chars(p, end, filtered);
+        if (r.ec != std::errc() || r.ptr == end || *r.ptr != ',') { crcErrors++; return; }
+        r = std::from_chars(r.ptr + 1, end, bpm);
+        if (r.ec != std::errc() || r.ptr == end || *r.ptr != ',') { crcErrors++; return; }
+        r = std::from_chars(r.ptr + 1, end, leads);
+        if (r.ec != std::errc() || r.ptr != end) { crcErrors++; return; }
+
+        float rounded = filtered < 0 ? filtered - 0.5f : filtered + 0.5f;
+        if (rounded > 32767.0f) rounded = 32767.0f;
+        if (rounded < -32768.0f) rounded = -32768.0f;
+        samples[0] = (int16_t)rounded;
+
+        DecodedSamples f;
+        f.samples = samples;
+        f.count = 1;
+        f.seq = 0;
+        f.bpm = (float)bpm;
+        f.leadsConnected = leads != 0;
+        f.beat = false;
+        framesOk++;
+        onSamples(f);
+    }
+};
+
+#endif // STREAM_DECODER_H
@@ -0,0 +1,42 @@
+/**
+ * @file synth_command.cpp
+ * @brief Genera una grabación sintética anotada (formato de recorded_stream.h)
+ *
+ * Uso: program synth <salida.csv> [segundos] [bpm] [ruido]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "synth_ecg.h"
+#include "native_commands.h"
+
+int synthRecording(int argc, char** argv)
+{
+    if (argc < 1) {
+        fprintf(stderr, "Uso: synth <salida.csv> [segundos] [bpm] [ruido]\n");
+        return 1;
+    }
+
+    SynthECGConfig cfg;
+    int seconds = argc > 1 ? atoi(argv[1]) : 60;
+    cfg.bpm = argc > 2 ? (float)atof(argv[2]) : 72.0f;
+    cfg.noiseAmplitude = argc > 3 ? (float)atof(argv[3]) : 10.0f;
+    cfg.rAmplitude = 600.0f;
+    cfg.wanderAmplitude = 100.0f;
+
+    FILE* out = fopen(argv[0], "w");
+    if (!out) {
+        fprintf(stderr, "No se puede escribir %s\n", argv[0]);
+        return 1;
+    }
+
+    SynthECG synth(cfg);
+    fprintf(out, "# ECG sintético %.0f Hz, %.0f lpm: raw,anotacion_R\n", cfg.sampleRateHz, cfg.bpm);
+    for (long i = 0; i < (long)seconds * (long)cfg.sampleRateHz; i++) {
+        int v = synth.next();
+        fprintf(out, "%d,%d\n", v, synth.lastWasRPeak() ? 1 : 0);
+    }
+    fclose(out);
+    printf("%s: %d s, %u latidos\n", argv[0], seconds, synth.beats());
+    return 0;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file synth_ecg.h
+ * @brief Generador determinista de ECG sintético para las herramientas del host
+ *
+ * Cada latido es una suma de gaussianas (P, Q, R, S, T) sobre una línea base
+ * con deriva respiratoria, ruido blanco y zumbido de red opcionales. La
+ * respiración puede modular también la amplitud del latido. La
+ * salida está en cuentas ADC, de modo que se puede inyectar tal cual en la
+ * cadena de filtrado del firmware.
+ */
+
+#ifndef SYNTH_ECG_H
+#define SYNTH_ECG_H
+
+#include <stdint.h>
+#include <math.h>
+
+struct SynthECGConfig {
+    float sampleRateHz = 250.0f;
+    float bpm = 72.0f;
+    float rAmplitude = 300.0f;    // Amplitud de la onda R en cuentas
+    float baseline = 2048.0f;     // Nivel DC (mitad del ADC de 12 bits)
+    float wanderAmplitude = 0.0f; // Deriva de línea base (cuentas)
+    float wanderHz = 0.25f;       // Frecuencia de la deriva (respiración)
+    float respModulation = 0.0f;  // Modulación de amplitud del latido por la respiración (fracción)
+    float noiseAmplitude = 0.0f;  // Ruido blanco uniforme (cuentas pico)
+    float humAmplitude = 0.0f;    // Zumbido de red (cuentas pico)
+    float humHz = 50.0f;
+    int adcMax = 4095;
+    uint32_t seed = 12345;
+};
+
+class SynthECG {
+public:
+    explicit SynthECG(const SynthECGConfig& cfg = SynthECGConfig())
+        : cfg(cfg), n(0), phase(0.0f), wanderPhase(0.0f), rng(cfg.seed), rPeak(false), beatCount(0) {}
+
+    // Siguiente muestra en cuentas ADC
+    int next() {
+        const float dt = 1.0f / cfg.sampleRateHz;
+        const float period = 60.0f / cfg.bpm;
+        float t = phase * period; // segundos desde el inicio del ciclo
+
+        float v = 0.0f;
+        v += 0.12f * gauss(t, 0.20f * period, 0.025f);  // P
+        v -= 0.10f * gauss(t, 0.345f * period, 0.008f); // Q
+        v += 1.00f * gauss(t, 0.36f * period, 0.010f);  // R
+        v -= 0.20f * gauss(t, 0.375f * period, 0.008f); // S
+        v += 0.30f * gauss(t, 0.60f * period, 0.040f);  // T
+
+        float time = n * dt;
+        float breath = sinf(2.0f * (float)M_PI * cfg.wanderHz * time + wanderPhase);
+        if (cfg.respModulation != 0.0f) v *= 1.0f + cfg.respModulation * breath;
+        float y = cfg.baseline + cfg.rAmplitude * v;
+        y += cfg.wanderAmplitude * breath;
+        y += cfg.humAmplitude * sinf(2.0f * (float)M_PI * cfg.humHz * time);
+        y += cfg.noiseAmplitude * (2.0f * uniform() - 1.0f);
+
+        // Marca la muestra más cercana al pico R
+        float rTime = 0.36f * period;
+        rPeak = (t <= rTime && t + dt > rTime);
+        if (rPeak) beatCount++;
+
+        phase += dt / period;
+        if (phase >= 1.0f) phase -= 1.0f;
+        n++;
+
+        int out = (int)lrintf(y);
+        if (out < 0) out = 0;
+        if (out > cfg.adcMax) out = cfg.adcMax;
+        return out;
+    }
+
+    // true si la última muestra devuelta por next() es un pico R
+    bool lastWasRPeak() const { return rPeak; }
+    uint32_t beats() const { return beatCount; }
+    uint32_t sampleIndex() const { return n; }
+
+    // Permite variar la frecuencia cardiaca en mitad de la señal
+    void setBpm(float bpm) { cfg.bpm = bpm; }
+    void setAmplitude(float amplitude) { cfg.rAmplitude = amplitude; }
+    void setNoise(float amplitude) { cfg.noiseAmplitude = amplitude; }
+
+    // Cambia la frecuencia respiratoria sin saltos de fase
+    void setRespirationHz(float hz) {
+        wanderPhase += 2.0f * (float)M_PI * (cfg.wanderHz - hz) * (n / cfg.sampleRateHz);
+        cfg.wanderHz = hz;
+    }
+
+private:
+    SynthECGConfig cfg;
+    uint32_t n;
+    float phase;
+    float wanderPhase;
+    uint32_t rng;
+    bool rPeak;
+    uint32_t beatCount;
+
+    static float gauss(float t, float mu, float sigma) {
+        float d = (t - mu) / sigma;
+        return expf(-0.5f * d * d);
+    }
+
+    float uniform() {
+        rng = rng * 1664525u + 1013904223u;
+        return (rng >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+#endif // SYNTH_ECG_H
@@ -0,0 +1,74 @@
+/*
+  Host (native) tools for the ECG monitor
+
+  Build and run:
+    pio run -e native
+    .pio/build/native/program <command> [args...]
+
+  Without arguments it lists the available commands.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "native/native_commands.h"
+
+struct NativeCommand {
+  const char *name;
+  int (*run)(int argc, char **argv);
+  const char *help;
+};
+
+static const NativeCommand commands[] = {
+    {"dsp", benchDsp, "float vs fixed-point filter chains: ns/cycles per sample, error bound, biquad response"},
+    {"qrs", benchQrs, "Pan-Tompkins vs fixed threshold on synthetic or recorded [file] streams"},
+    {"stream", benchStream, "binary framed protocol vs per-sample CSV; [out.bin] dumps the frames"},
+    {"replay", replayFile, "run a recorded <file> through filter, detector and encoder [out.bin]"},
+    {"synth", synthRecording, "write an annotated synthetic recording <out.csv> [seconds] [bpm] [noise]"},
+    {"ring", benchRing, "SPSC ring stress test with std::thread: throughput, overruns, ordering"},
+    {"lcd", benchLcd, "mock 20x4 LCD: I2C bytes for direct writes vs shadow framebuffer"},
+    {"lcdbus", benchLcdBus, "PCF8574/HD44780 bus model: LiquidCrystal_I2C vs batched driver timing"},
+    {"holter", holterLog, "flash recorder round trip on a file-backed flash [minutes] [kB]; dump <dir> [out.csv]"},
+    {"hrv", benchHrv, "incremental HRV vs full recompute, ectopic rejection [beats] [ectopic %]"},
+    {"monitor", benchMonitor, "unmodified ECGMonitor on the mock Arduino HAL: ns/sample, latency, Se/PPV [file] [Se] [PPV]"},
+    {"multi", benchMulti, "N-channel SoA monitor: per-channel equivalence with ECGMonitor and cost vs N [seconds]"},
+    {"cic", benchCic, "ADC oversampling with CIC decimation: response, SNR gain, ns/cycles per output [seconds] [noise]"},
+    {"hum", benchHum, "adaptive 50/60 Hz canceller on synthetic hum: lock, residual, Se/PPV, cost [seconds] [amplitude]"},
+    {"quality", benchQuality, "signal-quality index and artifact gating on synthetic motion/EMG/clipping: index, Se/PPV, BPM error, cost [seconds]"},
+    {"loopstats", benchLoopStats, "real-time loop instrumentation: histogram checks, tick latency and processSample cycles on two threads [seconds] [rate]"},
+    {"spectral", benchSpectral, "FFT autocorrelation heart rate: error vs true BPM, fallback when the detector loses lock, amortised cost [seconds]"},
+    {"block", benchBlock, "ECGMonitor::processBlock vs processSample: bit-identical results per sample, ns/sample by block size [seconds]"},
+    {"bus", benchBus, "zero-copy sample bus under load: four subscribers with drop/latest policies, integrity, accounting, publish cost [thousand blocks]"},
+    {"events", benchEvents, "event-triggered capture replayed on the host: brady/tachy/pause/irregular episodes, window contents over serial and flash, bandwidth vs continuous [file]"},
+    {"resp", benchResp, "ECG-derived respiration on synthetic amplitude/baseline-modulated signals: accuracy, tracking, apnea, block vs sample, stream frame, cost [seconds]"},
+    {"ingest", ingestSerial, "serial ingestion daemon into a /dev/shm ring <port> [baud] [/shm] [csv]; bench [s] [rate]"},
+};
+
+static void printUsage(const char *prog)
+{
+  printf("Usage: %s <command> [args...]\n\nCommands:\n", prog);
+  for (const NativeCommand &cmd : commands)
+  {
+    printf("  %-12s %s\n", cmd.name, cmd.help);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  for (const NativeCommand &cmd : commands)
+  {
+    if (strcmp(argv[1], cmd.name) == 0)
+    {
+      return cmd.run(argc - 2, argv + 2);
+    }
+  }
+
+  fprintf(stderr, "Unknown command: %s\n\n", argv[1]);
+  printUsage(argv[0]);
+  return 1;
+}
@@ -1,88 +1,161 @@
 /*
   UNO specific ECG reader for AD8232 (cloned modules)
-  - Uses analogRead(A0)
-  - Software sampling ~250 Hz (micros based)
-  - Simple DC removal (IIR), moving average smoothing and R-peak detection
-  - Prints raw/hp/lp and BEAT,BPM lines for debugging
+  - ADC conversions auto-triggered by Timer1 at 1 kHz (4x oversampling),
+    read by the ADC interrupt into a ring buffer (uno_sample_sources.h)
+    and decimated to 250 Hz with an integer CIC (cic_decimator.h)
+  - Simple DC removal (IIR) and moving average smoothing
+    (shared filter chain from ecg_dsp.h, fixed point by default)
+  - Pan-Tompkins R-peak detection with adaptive thresholds (qrs_detector.h);
+    beats rejected by the signal-quality index (signal_quality.h) do not
+    update the BPM
+  - Binary COBS frames (ecg_stream.h) sent from an interrupt-driven TX ring
+    (uno_uart_tx.h), plus a status frame with the drop counters and the
+    quality index once per second. ECG_BINARY_STREAM 0 prints the old raw/hp/lp debug lines.
 */
 
 #include <Arduino.h>
+#include "ecg_dsp.h"
+#include "qrs_detector.h"
+#include "signal_quality.h"
+#include "uno_sample_sources.h"
+
+// ADC reads per output sample (power of 2): 4 = 1 kHz + CIC decimation,
+// 1 = one conversion per 4 ms tick. Sampling is paced by Timer1 either way.
+#define ECG_OVERSAMPLE_RATIO 4
+
+// Serial output:
+//   1 = binary frames (ecg_stream.h) from the TX ring, never blocks loop()
+//   0 = "raw: hp: lp: bpm:" text through Serial, for the serial monitor
+#define ECG_BINARY_STREAM 1
+
+#if ECG_BINARY_STREAM
+#include "ecg_stream.h"
+#include "uno_uart_tx.h"
+#endif
 
 const int ECG_PIN = A0;
-const unsigned long SAMPLE_INTERVAL_US = 4000UL; // ~250 Hz
-const int MA_WINDOW = 5;
-int maBuf[MA_WINDOW];
-int maIndex = 0;
-long maSum = 0;
 
-unsigned long lastMicros = 0;
-float dcEstimate = 0.0;
-const float DC_ALPHA = 0.995;
+#if ECG_OVERSAMPLE_RATIO > 1
+UnoOversampledAdcSource<ECG_OVERSAMPLE_RATIO> sampleSource(ECG_PIN - A0);
+#else
+UnoTimerAdcSource sampleSource(ECG_PIN - A0);
+#endif
+ECGFilter filter;
+QRSDetector<SAMPLE_RATE_HZ> qrs;
+SignalQuality<SAMPLE_RATE_HZ, 1023> quality;
+
+#if ECG_BINARY_STREAM
+UnoUartTx uart;
+ECGStreamEncoder streamEncoder;
+#endif
 
-unsigned long lastBeatMillis = 0;
 float bpm = 0;
-int threshold = 20; // ajuste inicial en unidades ADC (0-1023)
-bool inBeat = false;
+uint16_t samplesSinceStatus = 0;
 
 void setup()
 {
+#if ECG_BINARY_STREAM
+  uart.begin(115200);
+#else
   Serial.begin(115200);
+#endif
   pinMode(ECG_PIN, INPUT);
-  for (int i = 0; i < MA_WINDOW; i++)
-    maBuf[i] = 0;
-  lastMicros = micros();
-  dcEstimate = analogRead(ECG_PIN);
-  Serial.println("UNO ECG started. Adjust 'threshold' if needed.");
+  if (!sampleSource.begin())
+  {
+    // Reported like the ESP32 setup does; without the ADC trigger loop()
+    // never gets a sample. In binary mode the host decoder counts the text
+    // as one bad frame, but a serial monitor shows it.
+    static const char message[] = "UNO ECG: sample source failed to start\r\n";
+#if ECG_BINARY_STREAM
+    uart.write((const uint8_t *)message, sizeof(message) - 1);
+#else
+    Serial.print(message);
+#endif
+    return;
+  }
+
+  // The filter starts from the first decimated sample
+  int16_t initial = 0;
+  while (sampleSource.read(&initial, 1) == 0)
+  {
+  }
+  filter.reset(initial);
+#if !ECG_BINARY_STREAM
+  Serial.println("UNO ECG started. Learning thresholds (2 s)...");
+#endif
 }
 
-void loop()
+static void processSample(int16_t raw)
 {
-  unsigned long now = micros();
-  if (now - lastMicros >= SAMPLE_INTERVAL_US)
+  // DC removal (IIR) + moving average
+  ECGFilter::Value lp = filter.process(raw);
+
+  // A QRS is judged once the template window after it has arrived, so the
+  // verdict may come a few samples after the detection
+  BeatVerdict verdict = quality.process(raw, (int16_t)filter.lastUnsmoothed(), (int16_t)lp);
+  if (qrs.process((int16_t)lp))
   {
-    lastMicros += SAMPLE_INTERVAL_US;
-    int raw = analogRead(ECG_PIN);
-
-    // DC removal (IIR)
-    dcEstimate = DC_ALPHA * dcEstimate + (1.0 - DC_ALPHA) * raw;
-    float hp = raw - dcEstimate;
-
-    // moving average
-    maSum -= maBuf[maIndex];
-    maBuf[maIndex] = (int)hp;
-    maSum += maBuf[maIndex];
-    maIndex = (maIndex + 1) % MA_WINDOW;
-    float lp = (float)maSum / MA_WINDOW;
-
-    unsigned long nowMs = millis();
-    if (lp > threshold && (nowMs - lastBeatMillis) > 250)
-    {
-      if (!inBeat)
-      {
-        inBeat = true;
-        if (lastBeatMillis != 0)
-        {
-          unsigned long beatInterval = nowMs - lastBeatMillis;
-          bpm = 60000.0 / beatInterval;
-        }
-        lastBeatMillis = nowMs;
-        Serial.print("BEAT, BPM=");
-        Serial.println((int)bpm);
-      }
-    }
-    else if (lp < (threshold / 2))
+    BeatVerdict v = quality.addBeat(qrs.sampleCount() - 1 - qrs.lastBeatSample());
+    if (v != BEAT_NONE)
     {
-      inBeat = false;
+      verdict = v;
     }
+  }
+  bool beat = verdict == BEAT_ACCEPTED;
+  if (beat && quality.acceptedRR() > 0)
+  {
+    bpm = 60.0 * SAMPLE_RATE_HZ / quality.acceptedRR();
+  }
 
-    // debug output
-    Serial.print("raw:");
-    Serial.print(raw);
-    Serial.print(" hp:");
-    Serial.print((int)hp);
-    Serial.print(" lp:");
-    Serial.print((int)lp);
-    Serial.print(" bpm:");
+#if ECG_BINARY_STREAM
+  // No lead-off pins on this board: frames always report leads connected
+  if (streamEncoder.push((int16_t)lp, bpm, true, beat))
+  {
+    uart.write(streamEncoder.data(), streamEncoder.size());
+  }
+  if (++samplesSinceStatus == SAMPLE_RATE_HZ)
+  {
+    samplesSinceStatus = 0;
+    streamEncoder.encodeStatus(sampleSource.overruns(), uart.droppedWrites(), quality.index());
+    uart.write(streamEncoder.data(), streamEncoder.size());
+  }
+#else
+  if (beat)
+  {
+    Serial.print("BEAT, BPM=");
     Serial.println((int)bpm);
   }
+
+  // debug output; blocking here only delays loop(), the ADC keeps sampling
+  Serial.print("raw:");
+  Serial.print(raw);
+  Serial.print(" hp:");
+  Serial.print(filter.lastHighPass());
+  Serial.print(" lp:");
+  Serial.print((int)lp);
+  Serial.print(" bpm:");
+  Serial.println((int)bpm);
+
+  if (++samplesSinceStatus == SAMPLE_RATE_HZ)
+  {
+    samplesSinceStatus = 0;
+    Serial.print("dropped adc:");
+    Serial.print(sampleSource.overruns());
+    Serial.print(" quality:");
+    Serial.println(quality.index());
+  }
+#endif
+}
+
+void loop()
+{
+  int16_t block[8];
+  size_t count;
+  while ((count = sampleSource.read(block, 8)) > 0)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      processSample(block[i]);
+    }
+  }
 }
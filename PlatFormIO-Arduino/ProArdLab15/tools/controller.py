@@ -86,14 +86,16 @@ class ECGController:
                 # Actualizar BPM con mayor frecuencia
                 if current_time - self.last_bpm_update >= self.bpm_update_interval:
                     bpm = self.model.get_bpm()
+                    respiration = self.model.get_respiration()
                     if self.model.is_running() and bpm > 0:
                         # Determinar estado clínico
                         if bpm < 60:
-                            self.view.update_bpm(bpm, "bradycardia")
+                            self.view.update_bpm(bpm, "bradycardia", respiration)
                         elif bpm > 100:
-                            self.view.update_bpm(bpm, "tachycardia")
+                            self.view.update_bpm(bpm, "tachycardia", respiration)
                         else:
-                            self.view.update_bpm(bpm, "normal")
+                            self.view.update_bpm(bpm, "normal", respiration)
+                    self.view.update_hrv(self.model.get_hrv())
                     self.last_bpm_update = current_time
                 
                 # Actualizar gráfico con mayor frecuencia para suavidad
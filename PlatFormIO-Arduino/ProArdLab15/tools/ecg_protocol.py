@@ -0,0 +1,211 @@
+# ecg_protocol.py
+"""Decodificador del protocolo binario del ESP32 y del UNO (include/ecg_stream.h).
+
+Cada trama va codificada con COBS y termina en 0x00. Tramas de muestras:
+tipo, secuencia, n, flags, bpm x10, muestra absoluta, deltas int8 (0x80 =
+escape seguido de int16 absoluto) y CRC-16/CCITT. Tramas de HRV (una por
+latido): FC, SDNN, RMSSD y pNN50 x10, intervalos NN y rechazados. Tramas de
+estado (una por segundo en el UNO): lecturas del ADC perdidas y tramas
+descartadas en la cola de envío del equipo. Tramas de episodio
+(include/event_capture.h): marcan el inicio y el fin de cada episodio
+capturado por eventos; sus muestras llegan entre ambas como tramas de
+muestras normales. Tramas de respiración (include/respiration.h), tras la
+de HRV de cada latido: respiraciones por minuto x10, fuente y regularidad.
+"""
+import binascii
+import struct
+
+FRAME_SAMPLES_TYPE = 0x01
+FRAME_HRV_TYPE = 0x02
+FRAME_STATUS_TYPE = 0x03
+FRAME_EPISODE_TYPE = 0x04
+FRAME_RESPIRATION_TYPE = 0x05
+DELTA_ESCAPE = 0x80
+FLAG_LEADS = 0x01
+FLAG_BEAT = 0x02
+HEADER = struct.Struct('<BBBBHh')
+HRV = struct.Struct('<BHHHHHH')
+STATUS = struct.Struct('<BHHB')
+EPISODE = struct.Struct('<BBHBBIHHHH')
+RESPIRATION = struct.Struct('<BHBB')
+EPISODE_BRADYCARDIA = 0x01
+EPISODE_TACHYCARDIA = 0x02
+EPISODE_PAUSE = 0x04
+EPISODE_IRREGULAR = 0x08
+RESP_SOURCE_NONE = 0
+RESP_SOURCE_AMPLITUDE = 1
+RESP_SOURCE_BASELINE = 2
+QUALITY_UNKNOWN = 255
+
+
+def cobs_decode(data):
+    """Decodifica un bloque COBS (sin el 0x00 final). Devuelve None si es inválido."""
+    out = bytearray()
+    i = 0
+    n = len(data)
+    while i < n:
+        code = data[i]
+        if code == 0 or i + code > n:
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < n:
+            out.append(0)
+    return bytes(out)
+
+
+class SampleFrame:
+    """Trama de muestras ya decodificada"""
+    __slots__ = ('seq', 'samples', 'bpm', 'leads_connected', 'beat')
+
+    def __init__(self, seq, samples, bpm, leads_connected, beat):
+        self.seq = seq
+        self.samples = samples
+        self.bpm = bpm
+        self.leads_connected = leads_connected
+        self.beat = beat
+
+
+class HrvFrame:
+    """Estadísticas de HRV de la ventana del ESP32 (include/hrv_engine.h)"""
+    __slots__ = ('heart_rate', 'sdnn_ms', 'rmssd_ms', 'pnn50', 'beats', 'rejected')
+
+    def __init__(self, heart_rate, sdnn_ms, rmssd_ms, pnn50, beats, rejected):
+        self.heart_rate = heart_rate
+        self.sdnn_ms = sdnn_ms
+        self.rmssd_ms = rmssd_ms
+        self.pnn50 = pnn50
+        self.beats = beats
+        self.rejected = rejected
+
+
+class StatusFrame:
+    """Contadores de pérdidas del equipo (saturan en 65535) e índice de
+    calidad de señal 0-100 (QUALITY_UNKNOWN si aún no hay).
+
+    adc_overruns: muestras del ADC perdidas. tx_dropped: en el UNO, tramas
+    que no cabían en la cola de la UART; en el ESP32, muestras que el bus
+    descartó para el consumidor que envía este flujo (ver ecg_stream.h)."""
+    __slots__ = ('adc_overruns', 'tx_dropped', 'quality')
+
+    def __init__(self, adc_overruns, tx_dropped, quality):
+        self.adc_overruns = adc_overruns
+        self.tx_dropped = tx_dropped
+        self.quality = quality
+
+
+class EpisodeFrame:
+    """Inicio (end = False) o fin (end = True) de un episodio capturado por
+    eventos. trigger y types son máscaras EPISODE_*; trigger_sample es el
+    índice de muestra del disparo y la ventana va de pre muestras antes a
+    post después."""
+    __slots__ = ('end', 'episode_id', 'trigger', 'types', 'trigger_sample', 'pre', 'post', 'bpm', 'lost')
+
+    def __init__(self, end, episode_id, trigger, types, trigger_sample, pre, post, bpm, lost):
+        self.end = end
+        self.episode_id = episode_id
+        self.trigger = trigger
+        self.types = types
+        self.trigger_sample = trigger_sample
+        self.pre = pre
+        self.post = post
+        self.bpm = bpm
+        self.lost = lost
+
+
+class RespirationFrame:
+    """Frecuencia respiratoria derivada del ECG (rate = 0: sin estimación).
+    source es RESP_SOURCE_*; regularity, 100 - coeficiente de variación en %."""
+    __slots__ = ('rate', 'source', 'regularity')
+
+    def __init__(self, rate, source, regularity):
+        self.rate = rate
+        self.source = source
+        self.regularity = regularity
+
+
+class FrameDecoder:
+    """Decodificador incremental: se le pasan bytes tal como llegan del puerto."""
+
+    def __init__(self):
+        self._buffer = bytearray()
+        self._last_seq = None
+        self.frames_ok = 0
+        self.crc_errors = 0
+        self.dropped_frames = 0
+
+    def feed(self, data):
+        """Añade bytes recibidos y devuelve la lista de tramas completas
+        (SampleFrame, HrvFrame, StatusFrame, EpisodeFrame o RespirationFrame)."""
+        self._buffer += data
+        frames = []
+        start = 0
+        while True:
+            end = self._buffer.find(b'\x00', start)
+            if end < 0:
+                break
+            chunk = bytes(self._buffer[start:end])
+            start = end + 1
+            if chunk:
+                frame = self._parse(chunk)
+                if frame is not None:
+                    frames.append(frame)
+        del self._buffer[:start]
+        return frames
+
+    def _parse(self, chunk):
+        raw = cobs_decode(chunk)
+        if raw is None or len(raw) < 3:
+            self.crc_errors += 1
+            return None
+
+        crc = raw[-2] | (raw[-1] << 8)
+        if binascii.crc_hqx(raw[:-2], 0xFFFF) != crc:
+            self.crc_errors += 1
+            return None
+
+        ftype = raw[0]
+        if ftype == FRAME_HRV_TYPE and len(raw) == HRV.size + 2:
+            _, hr, sdnn, rmssd, pnn50, beats, rejected = HRV.unpack_from(raw)
+            self.frames_ok += 1
+            return HrvFrame(hr / 10.0, sdnn / 10.0, rmssd / 10.0, pnn50 / 10.0, beats, rejected)
+        if ftype == FRAME_STATUS_TYPE and len(raw) == STATUS.size + 2:
+            _, adc_overruns, tx_dropped, quality = STATUS.unpack_from(raw)
+            self.frames_ok += 1
+            return StatusFrame(adc_overruns, tx_dropped, quality)
+        if ftype == FRAME_EPISODE_TYPE and len(raw) == EPISODE.size + 2:
+            (_, phase, episode_id, trigger, types, trigger_sample, pre, post, bpm_x10,
+             lost) = EPISODE.unpack_from(raw)
+            self.frames_ok += 1
+            return EpisodeFrame(phase == 1, episode_id, trigger, types, trigger_sample, pre, post,
+                                bpm_x10 / 10.0, lost)
+        if ftype == FRAME_RESPIRATION_TYPE and len(raw) == RESPIRATION.size + 2:
+            _, rate_x10, source, regularity = RESPIRATION.unpack_from(raw)
+            self.frames_ok += 1
+            return RespirationFrame(rate_x10 / 10.0, source, regularity)
+        if ftype != FRAME_SAMPLES_TYPE or len(raw) < HEADER.size + 2:
+            return None
+
+        ftype, seq, count, flags, bpm_x10, value = HEADER.unpack_from(raw)
+
+        # Detección de pérdidas por el número de secuencia
+        if self._last_seq is not None:
+            self.dropped_frames += (seq - self._last_seq - 1) & 0xFF
+        self._last_seq = seq
+
+        samples = [value]
+        payload = raw[HEADER.size:-2]
+        i = 0
+        while len(samples) < count and i < len(payload):
+            b = payload[i]
+            if b == DELTA_ESCAPE:
+                value = struct.unpack_from('<h', payload, i + 1)[0]
+                i += 3
+            else:
+                value += b - 256 if b > 127 else b
+                i += 1
+            samples.append(value)
+
+        self.frames_ok += 1
+        return SampleFrame(seq, samples, bpm_x10 / 10.0,
+                           bool(flags & FLAG_LEADS), bool(flags & FLAG_BEAT))
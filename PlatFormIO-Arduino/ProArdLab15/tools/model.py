@@ -5,6 +5,13 @@ import threading
 import queue
 import time
 
+from ecg_protocol import FrameDecoder, HrvFrame, StatusFrame, EpisodeFrame, RespirationFrame
+import shm_ring
+
+# Puertos "shm:<nombre>": muestras publicadas por el demonio de ingesta
+# (program ingest <puerto>) en lugar de leer el puerto serie desde Python
+SHM_PREFIX = 'shm:'
+
 class ECGModel:
     """Clase modelo que maneja los datos y la lógica de negocio"""
     
@@ -15,10 +22,18 @@ class ECGModel:
         self.running = False
         self.bpm = 0
         self.lead_connected = True
+        self.hrv = None
+        self.device_status = None
+        self.episode = None
+        self.respiration = None
         self.data_points = queue.Queue(maxsize=1000)  # Almacenar 4 segundos de datos (1000 pts @ 250Hz)
+        self.decoder = FrameDecoder()
+        self.ring = None
     
     def start_monitoring(self, port):
         """Inicia la monitorización del puerto serial"""
+        if port.startswith(SHM_PREFIX):
+            return self._start_shm(port)
         try:
             self.port = port
             self.serial_port = serial.Serial(
@@ -32,6 +47,8 @@ class ECGModel:
             # Limpiar buffer inicial
             time.sleep(0.5)
             self.serial_port.reset_input_buffer()
+            self.decoder = FrameDecoder()
+            self.device_status = None
             
             # Iniciar hilo de lectura
             threading.Thread(target=self._serial_reader, daemon=True).start()
@@ -44,71 +61,124 @@ class ECGModel:
             return False, f"Error de conexión: {error_msg}"
         except Exception as e:
             return False, f"Error inesperado: {str(e)}"
+
+    def _start_shm(self, port):
+        """Mapea el anillo del demonio de ingesta: no hay hilo de lectura"""
+        try:
+            self.ring = shm_ring.ShmRingReader(port[len(SHM_PREFIX):])
+        except (OSError, ValueError) as e:
+            return False, f"Error de conexión: {e}"
+        self.port = port
+        self.running = True
+        return True, f"Conectado a {port}"
     
     def stop_monitoring(self):
         """Detiene la monitorización"""
         self.running = False
+        if self.ring is not None:
+            self.ring.close()
+            self.ring = None
         if self.serial_port and self.serial_port.is_open:
             self.serial_port.close()
     
     def _serial_reader(self):
-        """Lector de datos serial que procesa el formato unificado CSV."""
-        buffer = bytearray()
-        
+        """Lector de datos serial que decodifica las tramas binarias (ecg_stream.h)."""
         while self.running:
             try:
-                if self.serial_port.in_waiting:
-                    buffer.extend(self.serial_port.read(self.serial_port.in_waiting))
-                    
-                    while b'\n' in buffer:
-                        line, buffer = buffer.split(b'\n', 1)
-                        line_str = line.decode('utf-8', errors='ignore').strip()
-                        
-                        if not line_str:
-                            continue
+                # Bloquea hasta que llega al menos un byte (o vence el timeout)
+                data = self.serial_port.read(max(1, self.serial_port.in_waiting))
+                if not data:
+                    continue
 
-                        try:
-                            # Procesar el formato unificado: filtered_val,bpm,lead_status
-                            parts = line_str.split(',')
-                            if len(parts) == 3:
-                                filtered_val = float(parts[0])
-                                self.bpm = int(parts[1])
-                                self.lead_connected = (int(parts[2]) == 1)
+                for frame in self.decoder.feed(data):
+                    if isinstance(frame, HrvFrame):
+                        self.hrv = frame
+                        continue
+                    if isinstance(frame, StatusFrame):
+                        self.device_status = frame
+                        continue
+                    if isinstance(frame, EpisodeFrame):
+                        self.episode = frame
+                        continue
+                    if isinstance(frame, RespirationFrame):
+                        self.respiration = frame
+                        continue
 
-                                # Añadir punto de datos para el gráfico
-                                if self.data_points.qsize() >= self.data_points.maxsize:
-                                    try:
-                                        self.data_points.get_nowait()  # Eliminar el más antiguo
-                                    except queue.Empty:
-                                        pass
-                                self.data_points.put_nowait(filtered_val)
+                    self.bpm = int(frame.bpm)
+                    self.lead_connected = frame.leads_connected
+                    if not frame.leads_connected:
+                        self.hrv = None
+                        self.respiration = None
+                        continue
 
-                        except (ValueError, IndexError):
-                            # Ignorar líneas que no se ajustan al formato
-                            continue
-                
-                time.sleep(0.001) # Dormir muy poco para alta resolución
+                    # Añadir puntos de datos para el gráfico
+                    for value in frame.samples:
+                        if self.data_points.qsize() >= self.data_points.maxsize:
+                            try:
+                                self.data_points.get_nowait()  # Eliminar el más antiguo
+                            except queue.Empty:
+                                pass
+                        self.data_points.put_nowait(value)
             except Exception:
                 self.running = False
                 break
+
+    def get_link_stats(self):
+        """Estadísticas del enlace: tramas correctas, errores de CRC y tramas perdidas"""
+        if self.ring is not None:
+            status = self.ring.status()
+            return status.frames_ok, status.crc_errors, status.dropped_frames
+        return self.decoder.frames_ok, self.decoder.crc_errors, self.decoder.dropped_frames
     
     def get_data_points(self):
         """Obtiene los puntos de datos actuales"""
+        if self.ring is not None:
+            # Vista directa sobre la memoria compartida, sin copiar
+            return self.ring.latest(self.data_points.maxsize)
         points = list(self.data_points.queue)
         return points
     
     def get_bpm(self):
         """Obtiene el valor actual de BPM"""
+        if self.ring is not None:
+            return int(self.ring.status().bpm)
         return self.bpm
     
+    def get_hrv(self):
+        """Última HRV recibida (HrvFrame) o None"""
+        if self.ring is not None:
+            return self.ring.status().hrv
+        return self.hrv
+
+    def get_device_status(self):
+        """Última trama de estado del equipo (StatusFrame) o None"""
+        if self.ring is not None:
+            return self.ring.status().device
+        return self.device_status
+
+    def get_episode(self):
+        """Último inicio o fin de episodio capturado por eventos (EpisodeFrame) o None"""
+        return self.episode
+
+    def get_respiration(self):
+        """Última respiración derivada del ECG (RespirationFrame) o None"""
+        if self.ring is not None:
+            return self.ring.status().respiration
+        return self.respiration
+
     def is_lead_connected(self):
         """Verifica si los electrodos están conectados"""
+        if self.ring is not None:
+            return self.ring.status().leads_connected
         return self.lead_connected
     
     def is_running(self):
         """Verifica si la monitorización está activa"""
+        if self.ring is not None and not self.ring.writer_alive():
+            self.running = False
         return self.running
     
     def get_ports(self):
         """Obtiene los puertos seriales disponibles"""
-        return [p.device for p in serial.tools.list_ports.comports()]
\ No newline at end of file
+        ports = [p.device for p in serial.tools.list_ports.comports()]
+        return ports + [SHM_PREFIX + name for name in shm_ring.list_rings()]
\ No newline at end of file
@@ -0,0 +1,149 @@
+# shm_ring.py
+"""Lector del anillo de muestras en memoria compartida (src/native/shm_ring.h).
+
+El demonio de ingesta (program ingest <puerto>) lee el puerto serie y
+publica las muestras en /dev/shm/<nombre>. Aquí se mapea ese objeto en solo
+lectura: latest() devuelve vistas (memoryview) directamente sobre el anillo,
+sin copiar las muestras.
+"""
+import mmap
+import os
+import struct
+
+from ecg_protocol import HrvFrame, StatusFrame, RespirationFrame
+
+SHM_DIR = '/dev/shm'
+DEFAULT_NAME = 'ecg_ring'
+MAGIC = 0x52474345  # "ECGR"
+VERSION = 2
+HEADER_SIZE = 80
+
+_INFO = struct.Struct('<IIII')
+_INDEX = struct.Struct('<Q')
+_SEQ = struct.Struct('<I')
+# bpm, leads, hrv válida, tramas, CRC, perdidas, FC, SDNN, RMSSD, pNN50, NN, rechazados, tramas HRV, pid,
+# respiración, fuente, regularidad, respiración válida, estado válido, calidad, desbordes ADC,
+# tramas no enviadas, tramas de estado
+_STATUS = struct.Struct('<HBBIIIHHHHHHIIHBBBBBxHHI')
+_INDEX_OFFSET = 16
+_SEQ_OFFSET = 24
+_STATUS_OFFSET = 28
+
+
+def list_rings():
+    """Nombres de los anillos de ingesta presentes en /dev/shm"""
+    try:
+        names = os.listdir(SHM_DIR)
+    except OSError:
+        return []
+    return sorted(n for n in names if n.startswith(DEFAULT_NAME) and not n.startswith(DEFAULT_NAME + '_bench'))
+
+
+class RingStatus:
+    """Copia coherente del bloque de estado de la cabecera"""
+    __slots__ = ('bpm', 'leads_connected', 'hrv', 'frames_ok', 'crc_errors', 'dropped_frames', 'pid',
+                 'respiration', 'device')
+
+    def __init__(self, fields):
+        (bpm_x10, leads, hrv_valid, self.frames_ok, self.crc_errors, self.dropped_frames,
+         hr, sdnn, rmssd, pnn50, beats, rejected, _hrv_frames, self.pid,
+         resp_x10, resp_source, regularity, resp_valid, status_valid, quality,
+         adc_overruns, tx_dropped, _status_frames) = fields
+        self.bpm = bpm_x10 / 10.0
+        self.leads_connected = bool(leads)
+        self.hrv = (HrvFrame(hr / 10.0, sdnn / 10.0, rmssd / 10.0, pnn50 / 10.0, beats, rejected)
+                    if hrv_valid else None)
+        self.respiration = RespirationFrame(resp_x10 / 10.0, resp_source, regularity) if resp_valid else None
+        self.device = StatusFrame(adc_overruns, tx_dropped, quality) if status_valid else None
+
+
+class RingWindow:
+    """Últimas muestras del anillo como una o dos vistas (si dan la vuelta).
+    Se puede iterar y tiene len(), que es lo que necesita la vista."""
+    __slots__ = ('_parts',)
+
+    def __init__(self, *parts):
+        self._parts = parts
+
+    def __len__(self):
+        return sum(len(p) for p in self._parts)
+
+    def __iter__(self):
+        for part in self._parts:
+            yield from part
+
+    def tolist(self):
+        out = []
+        for part in self._parts:
+            out += part.tolist()
+        return out
+
+
+class ShmRingReader:
+    def __init__(self, name=DEFAULT_NAME):
+        path = os.path.join(SHM_DIR, name.lstrip('/'))
+        fd = os.open(path, os.O_RDONLY)
+        try:
+            self._map = mmap.mmap(fd, 0, mmap.MAP_SHARED, mmap.PROT_READ)
+        finally:
+            os.close(fd)
+
+        magic, version, self.capacity, self.rate_hz = _INFO.unpack_from(self._map, 0)
+        if magic != MAGIC or version != VERSION:
+            self._map.close()
+            raise ValueError(f"{path} no es un anillo de ingesta ECG (versión {VERSION})")
+        if len(self._map) < HEADER_SIZE + 2 * self.capacity:
+            self._map.close()
+            raise ValueError(f"{path} está truncado")
+        self._mask = self.capacity - 1
+        self._samples = memoryview(self._map)[HEADER_SIZE:HEADER_SIZE + 2 * self.capacity].cast('h')
+
+    def close(self):
+        if self._map is None:
+            return
+        try:
+            self._samples.release()
+            self._map.close()
+        except BufferError:
+            pass  # aún hay vistas de latest() vivas: se libera con la última
+        self._map = None
+
+    def write_index(self):
+        """Muestras publicadas desde que arrancó el demonio"""
+        # Un u64 alineado no se lee partido en las arquitecturas del host,
+        # pero se repite hasta que dos lecturas coinciden por si acaso
+        while True:
+            a = _INDEX.unpack_from(self._map, _INDEX_OFFSET)[0]
+            b = _INDEX.unpack_from(self._map, _INDEX_OFFSET)[0]
+            if a == b:
+                return a
+
+    def latest(self, count):
+        """Vista de las últimas 'count' muestras (como mucho capacity).
+        El anillo tiene margen de sobra: a 2500 Hz tarda ~26 s en dar la vuelta."""
+        end = self.write_index()
+        count = min(count, end, self.capacity)
+        start = (end - count) & self._mask
+        if start + count <= self.capacity:
+            return RingWindow(self._samples[start:start + count])
+        return RingWindow(self._samples[start:], self._samples[:start + count - self.capacity])
+
+    def status(self):
+        """Estado (bpm, electrodos, enlace, HRV, respiración, estado del equipo) leído bajo el seqlock del demonio"""
+        while True:
+            seq = _SEQ.unpack_from(self._map, _SEQ_OFFSET)[0]
+            if seq & 1:
+                continue
+            fields = _STATUS.unpack_from(self._map, _STATUS_OFFSET)
+            if _SEQ.unpack_from(self._map, _SEQ_OFFSET)[0] == seq:
+                return RingStatus(fields)
+
+    def writer_alive(self):
+        """El demonio que creó el anillo sigue en marcha"""
+        try:
+            os.kill(self.status().pid, 0)
+            return True
+        except ProcessLookupError:
+            return False
+        except PermissionError:
+            return True
@@ -31,6 +31,7 @@ class ECGView:
         self.status_text = None
         self.bpm_text = None
         self.lead_status = None
+        self.hrv_text = None
         self.port_dropdown = None
         
         # Elementos para el gráfico con Canvas
@@ -101,6 +102,12 @@ class ECGView:
             color=ft.Colors.GREY_400,
             size=14
         )
+
+        self.hrv_text = ft.Text(
+            "HRV: --",
+            color=ft.Colors.GREY_400,
+            size=14
+        )
         
         # Layout de la página (sin cambios)
         self.page.add(
@@ -159,6 +166,10 @@ class ECGView:
                         width=200,
                         alignment=ft.alignment.center
                     ),
+                    ft.Container(
+                        content=self.hrv_text,
+                        padding=10,
+                    ),
                     ft.Container(expand=True),
                     ft.Container(
                         content=self.lead_status,
@@ -270,9 +281,12 @@ class ECGView:
             self.status_text.color = ft.Colors.GREY_400
         self.page.update()
     
-    def update_bpm(self, bpm, status="normal"):
-        """Actualiza el valor de BPM y su color según estado clínico"""
+    def update_bpm(self, bpm, status="normal", respiration=None):
+        """Actualiza el valor de BPM y su color según estado clínico, con la
+        respiración derivada del ECG al lado (RespirationFrame o None)"""
         self.bpm_text.value = f"BPM: {bpm}"
+        if respiration is not None and respiration.rate > 0:
+            self.bpm_text.value += f"   Resp: {respiration.rate:.0f} rpm"
         
         # Colorear según valores clínicos (la vista decide los colores)
         if status == "bradycardia" or bpm < 60:
@@ -283,6 +297,15 @@ class ECGView:
             self.bpm_text.color = ft.Colors.CYAN_200  # Normal
         self.page.update()
     
+    def update_hrv(self, hrv):
+        """Muestra SDNN, RMSSD y pNN50 de la ventana del ESP32 (None = sin datos)"""
+        if hrv is None or hrv.beats < 2:
+            self.hrv_text.value = "HRV: --"
+        else:
+            self.hrv_text.value = (f"SDNN {hrv.sdnn_ms:.0f} ms  RMSSD {hrv.rmssd_ms:.0f} ms  "
+                                   f"pNN50 {hrv.pnn50:.1f}%  ({hrv.beats} NN, {hrv.rejected} rechazados)")
+        self.page.update()
+
     def update_lead_status(self, is_connected):
         """Actualiza el estado de los electrodos"""
         if is_connected: